@@ -0,0 +1,50 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#ifndef __ADC_IO_H__
+#define __ADC_IO_H__
+
+#include <stdint.h>
+
+using namespace std;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Class support types
+/////////////////////////////////////////////////////////////////////////////
+typedef enum {ADC_IO_CH0,
+	      ADC_IO_CH1,
+	      ADC_IO_CH2,
+	      ADC_IO_CH3,
+	      ADC_IO_CH4,
+	      ADC_IO_CH5,
+	      ADC_IO_CH6,
+	      ADC_IO_CH7} ADC_IO_CHANNEL;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of classes
+/////////////////////////////////////////////////////////////////////////////
+
+// A/D Converter backend (hardware or simulated)
+class adc_io {
+  
+ public:
+  virtual ~adc_io(void) {};
+
+  virtual void initialize(uint32_t speed) = 0; // Pure virtual function
+  virtual void finalize(void) = 0;             // Pure virtual function
+
+  virtual void read_single(ADC_IO_CHANNEL channel,
+			   uint16_t &value) = 0; // Pure virtual function
+
+  virtual float to_voltage(uint16_t value) = 0;  // Pure virtual function
+};
+
+#endif // __ADC_IO_H__
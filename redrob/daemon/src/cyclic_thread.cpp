@@ -9,6 +9,12 @@
 // *                                                                      *
 // ************************************************************************
 
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+
 #include "cyclic_thread.h"
 #include "delay.h"
 
@@ -22,12 +28,22 @@ cyclic_thread::cyclic_thread(string thread_name,
 			     double frequency) : thread(thread_name)
 {
   m_frequency = frequency;
+  m_new_frequency = frequency;
+  m_frequency_change_requested = false;
+  m_overrun_policy = CYCLIC_OVERRUN_CATCH_UP;
+  m_event_fd = -1;
+
+  m_stat_reset_requested = false;
+  clear_cycle_stat();
 }
 
 ////////////////////////////////////////////////////////////////
 
 cyclic_thread::~cyclic_thread(void)
 {
+  if (m_event_fd >= 0) {
+    close(m_event_fd);
+  }
 }
 
 ////////////////////////////////////////////////////////////////
@@ -37,6 +53,82 @@ double cyclic_thread::get_frequency(void)
   return m_frequency;
 }
 
+////////////////////////////////////////////////////////////////
+
+void cyclic_thread::set_frequency(double frequency)
+{
+  m_new_frequency = frequency;
+  __atomic_store_n(&m_frequency_change_requested, true, __ATOMIC_RELEASE);
+}
+
+////////////////////////////////////////////////////////////////
+
+long cyclic_thread::set_overrun_policy(CYCLIC_OVERRUN_POLICY policy)
+{
+  // Check state
+  if (get_state() != THREAD_STATE_NOT_STARTED) {
+    return THREAD_WRONG_STATE;
+  }
+
+  m_overrun_policy = policy;
+
+  return THREAD_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+void cyclic_thread::get_cycle_stat(CYCLIC_THREAD_STAT &stat)
+{
+  // Never blocks the cyclic thread
+  m_stat_published.read(stat);
+}
+
+////////////////////////////////////////////////////////////////
+
+void cyclic_thread::reset_cycle_stat(void)
+{
+  __atomic_store_n(&m_stat_reset_requested, true, __ATOMIC_RELEASE);
+}
+
+////////////////////////////////////////////////////////////////
+
+long cyclic_thread::enable_event_wakeup(void)
+{
+  // Check state
+  if (get_state() != THREAD_STATE_NOT_STARTED) {
+    return THREAD_WRONG_STATE;
+  }
+
+  if (m_event_fd >= 0) {
+    return THREAD_SUCCESS; // Already enabled
+  }
+
+  m_event_fd = eventfd(0, EFD_NONBLOCK);
+  if (m_event_fd < 0) {
+    return THREAD_EVENT_ERROR;
+  }
+
+  return THREAD_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+void cyclic_thread::signal_event(void)
+{
+  uint64_t value = 1;
+
+  if (m_event_fd < 0) {
+    return;
+  }
+
+  // Counter is only used as a flag, a full counter
+  // (EAGAIN) means that an event is already pending.
+  ssize_t rc;
+  do {
+    rc = write(m_event_fd, &value, sizeof(value));
+  } while ( (rc < 0) && (errno == EINTR) );
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //               Protected member functions
 /////////////////////////////////////////////////////////////////////////////
@@ -45,10 +137,14 @@ double cyclic_thread::get_frequency(void)
 
 long cyclic_thread::execute(void *arg)
 {
-  const float delay_interval = 1.0 / m_frequency;
+  float delay_interval = 1.0 / m_frequency;
+
+  long rc;
 
   struct timespec t1;
   struct timespec t2; 
+  struct timespec t_wakeup;
+  struct timespec t_done;
 
   // Make GCC happy (-Wextra)
   if (arg) {
@@ -62,9 +158,14 @@ long cyclic_thread::execute(void *arg)
   if ( get_new_time(&t1, delay_interval, &t2) != DELAY_SUCCESS ) {
     return THREAD_TIME_ERROR;
   }
-  if ( delay_until(&t2) != DELAY_SUCCESS) {
+  rc = wait_until(&t2);
+  if (rc != THREAD_SUCCESS) {
+    return rc;
+  }
+  if ( clock_gettime(get_clock_id(), &t_wakeup) ) {
     return THREAD_TIME_ERROR;
   }
+  update_wakeup_stat(&t2, &t_wakeup);
 
   while ( !is_stopped() ) {
 
@@ -72,17 +173,251 @@ long cyclic_thread::execute(void *arg)
     if ( cyclic_execute() != THREAD_SUCCESS ) {
       return THREAD_INTERNAL_ERROR;
     }
+    if ( clock_gettime(get_clock_id(), &t_done) ) {
+      return THREAD_TIME_ERROR;
+    }
 
     // Calculate next interval
+    if (check_frequency_change()) {
+      delay_interval = 1.0 / m_frequency;
+    }
     if ( get_new_time(&t2, delay_interval, &t2) != DELAY_SUCCESS ) {
       return THREAD_TIME_ERROR;
     }
-    if ( delay_until(&t2) != DELAY_SUCCESS) {
+    update_exec_stat(&t_wakeup, &t_done, &t2);
+
+    // Check if next period already has started
+    if ( get_time_diff(&t_done, &t2) < 0.0 ) {
+      rc = handle_overrun(&t_done, delay_interval, &t2);
+      if (rc != THREAD_SUCCESS) {
+	return rc;
+      }
+    }
+
+    rc = wait_until(&t2);
+    if (rc != THREAD_SUCCESS) {
+      return rc;
+    }
+    if ( clock_gettime(get_clock_id(), &t_wakeup) ) {
       return THREAD_TIME_ERROR;
     }
+    update_wakeup_stat(&t2, &t_wakeup);
 
     update_exe_cnt();
   }
 
   return THREAD_SUCCESS;
 }
+
+////////////////////////////////////////////////////////////////
+
+long cyclic_thread::event_execute(void)
+{
+  // Default is to do nothing, cyclic work is done next period
+  return THREAD_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+void cyclic_thread::cyclic_overrun(unsigned missed_periods)
+{
+  // Default is to do nothing, handled by overrun policy
+  (void)missed_periods;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Private member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+long cyclic_thread::wait_until(const struct timespec *wakeup)
+{
+  struct timespec now;
+  struct timespec timeout;
+  struct pollfd pfd;
+  double time_left;
+  int rc;
+
+  // Plain absolute sleep if no events are used
+  if (m_event_fd < 0) {
+    if ( delay_until(wakeup) != DELAY_SUCCESS) {
+      return THREAD_TIME_ERROR;
+    }
+    return THREAD_SUCCESS;
+  }
+
+  pfd.fd = m_event_fd;
+  pfd.events = POLLIN;
+
+  while (1) {
+    if ( clock_gettime(get_clock_id(), &now) ) {
+      return THREAD_TIME_ERROR;
+    }
+    time_left = get_time_diff(&now, wakeup);
+    if (time_left <= 0.0) {
+      break;
+    }
+
+    // Wait for event or end of period.
+    // Note! Relative timeout, rounded up to avoid early wakeup.
+    timeout.tv_sec  = (time_t)time_left;
+    timeout.tv_nsec = (long)((time_left - timeout.tv_sec) * 1000000000.0) + 1;
+    if (timeout.tv_nsec >= 1000000000) {
+      timeout.tv_sec++;
+      timeout.tv_nsec -= 1000000000;
+    }
+
+    pfd.revents = 0;
+    rc = ppoll(&pfd, 1, &timeout, NULL);
+    if (rc < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      return THREAD_EVENT_ERROR;
+    }
+    if ( (rc > 0) && (pfd.revents & POLLIN) ) {
+      rc = handle_event();
+      if (rc != THREAD_SUCCESS) {
+	return rc;
+      }
+    }
+  }
+
+  return THREAD_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+bool cyclic_thread::check_frequency_change(void)
+{
+  if (!__atomic_exchange_n(&m_frequency_change_requested, false, __ATOMIC_ACQ_REL)) {
+    return false;
+  }
+  if (m_new_frequency == m_frequency) {
+    return false;
+  }
+
+  m_frequency = m_new_frequency;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////
+
+long cyclic_thread::handle_event(void)
+{
+  uint64_t value;
+
+  // Clear event (all pending signals are handled at once)
+  if (read(m_event_fd, &value, sizeof(value)) < 0) {
+    if ( (errno == EAGAIN) || (errno == EINTR) ) {
+      return THREAD_SUCCESS;
+    }
+    return THREAD_EVENT_ERROR;
+  }
+
+  // No more work when stop is requested
+  if ( is_stopped() ) {
+    return THREAD_SUCCESS;
+  }
+
+  if ( event_execute() != THREAD_SUCCESS ) {
+    return THREAD_INTERNAL_ERROR;
+  }
+
+  return THREAD_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+void cyclic_thread::update_wakeup_stat(const struct timespec *planned_wakeup,
+				       const struct timespec *actual_wakeup)
+{
+  double latency = get_time_diff(planned_wakeup, actual_wakeup);
+
+  if (__atomic_exchange_n(&m_stat_reset_requested, false, __ATOMIC_ACQ_REL)) {
+    clear_cycle_stat();
+  }
+
+  m_stat.wakeup_latency.add(latency);
+
+  // Wakeup is the last event of a cycle
+  m_stat_published.write(m_stat);
+}
+
+////////////////////////////////////////////////////////////////
+
+void cyclic_thread::update_exec_stat(const struct timespec *exec_start,
+				     const struct timespec *exec_done,
+				     const struct timespec *deadline)
+{
+  double exec_time = get_time_diff(exec_start, exec_done);
+
+  // Deadline is missed if work was not done before next period starts
+  bool missed = (get_time_diff(exec_done, deadline) < 0.0);
+
+  m_stat.cycles++;
+  m_stat.exec_time.add(exec_time);
+  if (missed) {
+    m_stat.overrun_time.add(get_time_diff(deadline, exec_done));
+    m_stat.missed_deadlines++;
+    m_missed_in_row++;
+    if (m_missed_in_row > m_stat.max_missed_in_row) {
+      m_stat.max_missed_in_row = m_missed_in_row;
+    }
+  }
+  else {
+    m_missed_in_row = 0;
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+long cyclic_thread::handle_overrun(const struct timespec *exec_done,
+				   double period,
+				   struct timespec *next_wakeup)
+{
+  // Number of period starts passed, the missed deadline included
+  unsigned missed_periods =
+    1 + (unsigned)(get_time_diff(next_wakeup, exec_done) / period);
+
+  switch (m_overrun_policy) {
+  case CYCLIC_OVERRUN_SKIP:
+    // Next wakeup is first period start after work was done
+    if ( get_new_time(next_wakeup,
+		      missed_periods * period,
+		      next_wakeup) != DELAY_SUCCESS ) {
+      return THREAD_TIME_ERROR;
+    }
+    m_stat.skipped_cycles += missed_periods;
+    break;
+  case CYCLIC_OVERRUN_STRETCH:
+    // Current period ends now, new grid starts from here
+    *next_wakeup = *exec_done;
+    break;
+  default:
+    // CYCLIC_OVERRUN_CATCH_UP, keep next wakeup
+    break;
+  }
+
+  cyclic_overrun(missed_periods);
+
+  return THREAD_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+void cyclic_thread::clear_cycle_stat(void)
+{
+  m_stat.cycles = 0;
+  m_stat.missed_deadlines = 0;
+  m_stat.max_missed_in_row = 0;
+  m_stat.skipped_cycles = 0;
+  m_stat.wakeup_latency.reset();
+  m_stat.exec_time.reset();
+  m_stat.overrun_time.reset();
+  m_missed_in_row = 0;
+
+  m_stat_published.write(m_stat);
+}
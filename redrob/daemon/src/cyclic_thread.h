@@ -13,6 +13,9 @@
 #define __CYCLIC_THREAD_H__
 
 #include "thread.h"
+#include "periodic_task.h"
+#include "histogram.h"
+#include "latest_value.h"
 
 using namespace std;
 
@@ -20,11 +23,36 @@ using namespace std;
 //               Definition of macros
 /////////////////////////////////////////////////////////////////////////////
 
+/////////////////////////////////////////////////////////////////////////////
+//               Class support types
+/////////////////////////////////////////////////////////////////////////////
+
+// Action when cyclic_execute is not done before next period starts
+typedef enum {CYCLIC_OVERRUN_CATCH_UP, // Run missed cycles back-to-back
+	      CYCLIC_OVERRUN_SKIP,     // Skip missed cycles, keep period grid
+	      CYCLIC_OVERRUN_STRETCH}  // Start next cycle now, new period grid
+  CYCLIC_OVERRUN_POLICY;
+
+typedef struct {
+  unsigned  cycles;               // Number of completed cycles
+  unsigned  missed_deadlines;     // Cycles not done before next period
+  unsigned  max_missed_in_row;    // Longest sequence of missed deadlines
+  unsigned  skipped_cycles;       // Cycles skipped (CYCLIC_OVERRUN_SKIP)
+  histogram wakeup_latency;       // Actual wakeup - planned wakeup
+  histogram exec_time;            // Time spent in cyclic_execute
+  histogram overrun_time;         // Time past deadline for missed deadlines
+} CYCLIC_THREAD_STAT;
+
 /////////////////////////////////////////////////////////////////////////////
 //               Definition of classes
 /////////////////////////////////////////////////////////////////////////////
 
-class cyclic_thread : public thread {
+// Note! A cyclic thread is also a periodic task. This makes it
+//       possible to execute it by a periodic_scheduler instead
+//       of starting the thread. Cycle statistics are only
+//       updated when executed as a thread.
+
+class cyclic_thread : public thread, public periodic_task {
 
  public:
   cyclic_thread(string thread_name,
@@ -33,15 +61,82 @@ class cyclic_thread : public thread {
 
   double get_frequency(void);
 
+  // New frequency is applied by thread at next cycle, the period grid
+  // restarts from the last planned wakeup. No effect when executed
+  // by a periodic_scheduler.
+  void set_frequency(double frequency);
+
+  // Overrun policy, must be set before thread is started
+  long set_overrun_policy(CYCLIC_OVERRUN_POLICY policy);
+  CYCLIC_OVERRUN_POLICY get_overrun_policy(void) {return m_overrun_policy;}
+
+  void get_cycle_stat(CYCLIC_THREAD_STAT &stat);
+  void reset_cycle_stat(void); // Done by thread at next cycle
+
+  // Event wakeup, must be enabled before thread is started.
+  // When enabled, any thread can signal an event that makes this
+  // thread call event_execute immediately instead of waiting
+  // for next period. The periodic cycle is not affected.
+  long enable_event_wakeup(void);
+  bool is_event_wakeup_enabled(void) {return (m_event_fd >= 0);}
+
+  void signal_event(void); // No effect if event wakeup is not enabled
+
+  // Implements pure virtual functions from periodic_task
+  virtual string get_task_name(void) {return get_name();}
+  virtual long task_setup(void) {return setup();}
+  virtual long task_execute(void) {return cyclic_execute();}
+  virtual long task_cleanup(void) {return cleanup();}
+
  protected:
   virtual long setup(void) = 0;    // Pure virtual function
   virtual long execute(void *arg); // Implements pure virtual function from base class
   virtual long cleanup(void) = 0;  // Pure virtual function
 
   virtual long cyclic_execute(void) = 0; // Pure virtual function
+
+  virtual long event_execute(void); // Called when event is signalled
+
+  // Called when cyclic_execute missed its deadline,
+  // missed_periods is the number of period starts passed.
+  virtual void cyclic_overrun(unsigned missed_periods);
     
  private:
   double m_frequency;
+  double m_new_frequency;
+  bool   m_frequency_change_requested;
+
+  CYCLIC_OVERRUN_POLICY m_overrun_policy;
+
+  // Event wakeup (eventfd), negative if not enabled
+  int m_event_fd;
+
+  // Cycle timing statistics, only updated by this thread
+  // and published once every cycle
+  CYCLIC_THREAD_STAT m_stat;
+  unsigned           m_missed_in_row;
+  bool               m_stat_reset_requested;
+
+  latest_value<CYCLIC_THREAD_STAT> m_stat_published;
+
+  long wait_until(const struct timespec *wakeup);
+
+  bool check_frequency_change(void);
+
+  long handle_event(void);
+
+  void clear_cycle_stat(void);
+
+  void update_wakeup_stat(const struct timespec *planned_wakeup,
+			  const struct timespec *actual_wakeup);
+
+  void update_exec_stat(const struct timespec *exec_start,
+			const struct timespec *exec_done,
+			const struct timespec *deadline);
+
+  long handle_overrun(const struct timespec *exec_done,
+		      double period,
+		      struct timespec *next_wakeup);
 };
 
 #endif // __CYCLIC_THREAD_H__
@@ -21,6 +21,9 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <pwd.h>
+#include <malloc.h>
+#include <alloca.h>
+#include <sys/mman.h>
 
 #include "daemon_utility.h"
 #include "shell_cmd.h"
@@ -77,6 +80,20 @@ static long acquire_lock_file(const char *lock_file,
   return rc;
 }
 
+////////////////////////////////////////////////////////////////
+
+static void __attribute__ ((noinline)) prefault_stack(unsigned size_kb)
+{
+  // Touch each page of stack so it gets mapped (and locked) now
+  const long page_size = sysconf(_SC_PAGESIZE);
+  volatile unsigned char *stack =
+    (volatile unsigned char *)alloca(size_kb * 1024);
+
+  for (unsigned i=0; i < (size_kb * 1024); i += page_size) {
+    stack[i] = 0;
+  }
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //               Public member functions
 /////////////////////////////////////////////////////////////////////////////
@@ -265,6 +282,28 @@ long become_daemon(const char *run_as_user,
 
 ////////////////////////////////////////////////////////////////
 
+long lock_memory(unsigned prefault_stack_kb)
+{
+  // Lock all current and future pages in RAM
+  if (mlockall(MCL_CURRENT | MCL_FUTURE)) {
+    syslog_error("Unable to lock memory, code=%d (%s)",
+		 errno, strerror(errno));
+    return DAEMON_FAILURE;
+  }
+
+  // Never give heap memory back to the system, and never
+  // use mmap for allocations. Otherwise the next allocation
+  // will cause page faults again.
+  mallopt(M_TRIM_THRESHOLD, -1);
+  mallopt(M_MMAP_MAX, 0);
+
+  prefault_stack(prefault_stack_kb);
+
+  return DAEMON_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
 long shutdown_system(void)
 {
   const string cmd = "shutdown -h now";
@@ -45,6 +45,8 @@ extern long become_daemon(const char *run_as_user,  // IN
 			  const char *lock_file,    // IN
 			  int *fd_lock_file);       // OUT
 
+extern long lock_memory(unsigned prefault_stack_kb);
+
 extern long shutdown_system(void);
 
 #endif // __DAEMON_UTILITY_H__
@@ -107,6 +107,17 @@ long get_new_time(const struct timespec *old_time,
 
 ////////////////////////////////////////////////////////////////
 
+double get_time_diff(const struct timespec *start_time,
+		     const struct timespec *end_time)
+{
+  // Returns (end_time - start_time) in seconds, may be negative
+  return ( (double)(end_time->tv_sec - start_time->tv_sec) +
+	   (double)(end_time->tv_nsec - start_time->tv_nsec) /
+	   (double) NSEC_PER_SEC );
+}
+
+////////////////////////////////////////////////////////////////
+
 long delay(double time_in_sec)
 {
   long rc;
@@ -32,6 +32,9 @@ extern long get_new_time(const struct timespec *old_time,
 			 double diff_in_sec,
 			 struct timespec *new_time);
 
+extern double get_time_diff(const struct timespec *start_time,
+			    const struct timespec *end_time);
+
 extern long delay(double time_in_sec);
 
 extern long delay_until(const struct timespec *the_time);
@@ -0,0 +1,57 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#ifndef __GPIO_IO_H__
+#define __GPIO_IO_H__
+
+#include <stdint.h>
+
+using namespace std;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Class support types
+/////////////////////////////////////////////////////////////////////////////
+// GPIO Function Select Registers
+typedef enum {RPI_GPIO_FUNC_INP,  // 000
+	      RPI_GPIO_FUNC_OUT,  // 001
+              RPI_GPIO_FUNC_ALT5, // 010
+	      RPI_GPIO_FUNC_ALT4, // 011
+	      RPI_GPIO_FUNC_ALT0, // 100
+	      RPI_GPIO_FUNC_ALT1, // 101
+	      RPI_GPIO_FUNC_ALT2, // 110
+	      RPI_GPIO_FUNC_ALT3, // 111
+} RPI_GPIO_FUNCTION;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of classes
+/////////////////////////////////////////////////////////////////////////////
+
+// GPIO backend (hardware or simulated)
+class gpio_io {
+  
+ public:
+  virtual ~gpio_io(void) {};
+
+  virtual void initialize(void) = 0; // Pure virtual function
+  virtual void finalize(void) = 0;   // Pure virtual function
+
+  virtual void set_function(uint8_t pin,
+			    RPI_GPIO_FUNCTION func) = 0; // Pure virtual function
+
+  virtual RPI_GPIO_FUNCTION get_function(uint8_t pin) = 0; // Pure virtual function
+
+  virtual void set_pin_high(uint8_t pin) = 0; // Pure virtual function
+  virtual void set_pin_low(uint8_t pin) = 0;  // Pure virtual function
+
+  virtual uint8_t get_pin(uint8_t pin) = 0;   // Pure virtual function
+};
+
+#endif // __GPIO_IO_H__
@@ -0,0 +1,182 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#include <strings.h>
+
+#include "histogram.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of macros
+/////////////////////////////////////////////////////////////////////////////
+#define MAX_VALUE_US  0xffffffff
+
+/////////////////////////////////////////////////////////////////////////////
+//               Public member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+histogram::histogram(void)
+{
+  reset();
+}
+
+////////////////////////////////////////////////////////////////
+
+histogram::~histogram(void)
+{
+}
+
+////////////////////////////////////////////////////////////////
+
+void histogram::reset(void)
+{
+  bzero(m_bucket, sizeof(m_bucket));
+  m_count  = 0;
+  m_min_us = MAX_VALUE_US;
+  m_max_us = 0;
+  m_sum_us = 0;
+}
+
+////////////////////////////////////////////////////////////////
+
+void histogram::add(double value_in_sec)
+{
+  double value_in_us = value_in_sec * 1000000.0;
+
+  if (value_in_us <= 0.0) {
+    add_us(0);
+  }
+  else if (value_in_us >= (double)MAX_VALUE_US) {
+    add_us(MAX_VALUE_US);
+  }
+  else {
+    add_us((uint32_t)value_in_us);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void histogram::add_us(uint32_t value_in_us)
+{
+  m_bucket[get_bucket(value_in_us)]++;
+  m_count++;
+  m_sum_us += value_in_us;
+
+  if (value_in_us < m_min_us) {
+    m_min_us = value_in_us;
+  }
+  if (value_in_us > m_max_us) {
+    m_max_us = value_in_us;
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+uint32_t histogram::get_min_us(void) const
+{
+  return (m_count ? m_min_us : 0);
+}
+
+////////////////////////////////////////////////////////////////
+
+uint32_t histogram::get_mean_us(void) const
+{
+  return (m_count ? (uint32_t)(m_sum_us / m_count) : 0);
+}
+
+////////////////////////////////////////////////////////////////
+
+uint32_t histogram::get_percentile_us(double percentile) const
+{
+  if (!m_count) {
+    return 0;
+  }
+
+  // Number of values that shall be covered (at least one)
+  uint64_t target = (uint64_t)((m_count * percentile) / 100.0 + 0.5);
+  if (target < 1) {
+    target = 1;
+  }
+  if (target > m_count) {
+    target = m_count;
+  }
+
+  // Walk buckets until target is covered
+  uint64_t covered = 0;
+  for (unsigned i=0; i < HISTOGRAM_NR_BUCKETS; i++) {
+    covered += m_bucket[i];
+    if (covered >= target) {
+      uint32_t upper = get_bucket_upper_us(i);
+      return (upper < m_max_us ? upper : m_max_us);
+    }
+  }
+
+  return m_max_us;
+}
+
+////////////////////////////////////////////////////////////////
+
+uint32_t histogram::get_bucket_count(unsigned bucket) const
+{
+  if (bucket >= HISTOGRAM_NR_BUCKETS) {
+    return 0;
+  }
+  return m_bucket[bucket];
+}
+
+////////////////////////////////////////////////////////////////
+
+uint32_t histogram::get_bucket_upper_us(unsigned bucket) const
+{
+  if (bucket < HISTOGRAM_SUB_BUCKETS) {
+    return bucket;
+  }
+  if (bucket >= (HISTOGRAM_NR_BUCKETS - 1)) {
+    return MAX_VALUE_US;
+  }
+
+  // Bucket covers [low, low + width - 1]
+  unsigned power = HISTOGRAM_SUB_BUCKET_BITS +
+    (bucket - HISTOGRAM_SUB_BUCKETS) / HISTOGRAM_SUB_BUCKETS;
+  unsigned sub   = (bucket - HISTOGRAM_SUB_BUCKETS) % HISTOGRAM_SUB_BUCKETS;
+  unsigned shift = power - HISTOGRAM_SUB_BUCKET_BITS;
+
+  uint32_t low = (HISTOGRAM_SUB_BUCKETS + sub) << shift;
+
+  return low + (1 << shift) - 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Private member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+unsigned histogram::get_bucket(uint32_t value_in_us) const
+{
+  // Small values are stored linear
+  if (value_in_us < HISTOGRAM_SUB_BUCKETS) {
+    return value_in_us;
+  }
+
+  // Most significant bit decides the power of two
+  unsigned power = 31 - __builtin_clz(value_in_us);
+  if (power > HISTOGRAM_MAX_POWER) {
+    return HISTOGRAM_NR_BUCKETS - 1;
+  }
+
+  // The following bits decides the linear sub-bucket
+  unsigned shift = power - HISTOGRAM_SUB_BUCKET_BITS;
+  unsigned sub   = (value_in_us >> shift) & (HISTOGRAM_SUB_BUCKETS - 1);
+
+  return HISTOGRAM_SUB_BUCKETS + (shift * HISTOGRAM_SUB_BUCKETS) + sub;
+}
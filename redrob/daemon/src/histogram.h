@@ -0,0 +1,73 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+
+#include <stdint.h>
+
+using namespace std;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of macros
+/////////////////////////////////////////////////////////////////////////////
+
+// Values are stored in micro seconds.
+// Values 0..7 us have one bucket each, above that every power of two
+// is divided into eight linear sub-buckets (max error 12.5%).
+#define HISTOGRAM_SUB_BUCKET_BITS  3
+#define HISTOGRAM_SUB_BUCKETS      (1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_MAX_POWER        24 // Values >= 2^25 us (~33s) are clamped
+#define HISTOGRAM_NR_BUCKETS       (HISTOGRAM_SUB_BUCKETS + \
+				    (HISTOGRAM_MAX_POWER - \
+				     HISTOGRAM_SUB_BUCKET_BITS + 1) * \
+				    HISTOGRAM_SUB_BUCKETS)
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of classes
+/////////////////////////////////////////////////////////////////////////////
+
+// Note! This class never allocates memory, it can be copied
+//       and used in real-time context.
+
+class histogram {
+
+ public:
+  histogram(void);
+  ~histogram(void);
+
+  void reset(void);
+
+  void add(double value_in_sec); // Negative values are counted as zero
+  void add_us(uint32_t value_in_us);
+
+  uint32_t get_count(void) const {return m_count;}
+  uint32_t get_min_us(void) const;
+  uint32_t get_max_us(void) const {return m_max_us;}
+  uint32_t get_mean_us(void) const;
+
+  uint32_t get_percentile_us(double percentile) const; // 0.0 .. 100.0
+
+  unsigned get_nr_buckets(void) const {return HISTOGRAM_NR_BUCKETS;}
+  uint32_t get_bucket_count(unsigned bucket) const;
+  uint32_t get_bucket_upper_us(unsigned bucket) const;
+
+ private:
+  uint32_t m_bucket[HISTOGRAM_NR_BUCKETS];
+  uint32_t m_count;
+  uint32_t m_min_us;
+  uint32_t m_max_us;
+  uint64_t m_sum_us;
+
+  unsigned get_bucket(uint32_t value_in_us) const;
+};
+
+#endif // __HISTOGRAM_H__
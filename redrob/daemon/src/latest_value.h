@@ -0,0 +1,157 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#ifndef __LATEST_VALUE_H__
+#define __LATEST_VALUE_H__
+
+#include <stdint.h>
+
+using namespace std;
+
+// Implementation notes:
+// 1. Lock-free channel for the latest value of a POD type.
+//    One writer thread, any number of reader threads.
+//
+// 2. The value is stored in a ring of slots, each protected by
+//    its own sequence counter (seqlock). The writer always fills
+//    the slot after the latest published slot, so a writer that is
+//    preempted in the middle of a write never blocks a reader.
+//    A reader only retries if the writer has wrapped the complete
+//    ring during the time it takes to copy one value.
+//
+// 3. Each write increments a version (first write is version 1).
+//    Readers can use the version to detect new values.
+//
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of classes
+/////////////////////////////////////////////////////////////////////////////
+
+template <typename T, unsigned N = 3>
+class latest_value {
+
+ public:
+
+  ////////////////////////////////////////////////////////////////
+
+  latest_value(void)
+  {
+    for (unsigned i=0; i < N; i++) {
+      m_slot[i].seq     = 0;
+      m_slot[i].version = 0;
+    }
+    m_latest  = 0;
+    m_version = 0;
+  }
+
+  ////////////////////////////////////////////////////////////////
+
+  latest_value(const T &value)
+  {
+    for (unsigned i=0; i < N; i++) {
+      m_slot[i].seq     = 0;
+      m_slot[i].version = 0;
+      m_slot[i].value   = value;
+    }
+    m_latest  = 0;
+    m_version = 0;
+  }
+
+  ////////////////////////////////////////////////////////////////
+
+  // Note! Only one thread is allowed to write
+  void write(const T &value)
+  {
+    unsigned next = (m_latest + 1) % N;
+    SLOT *slot = &m_slot[next];
+    uint32_t seq = slot->seq;
+
+    // Mark slot busy (odd sequence)
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    slot->value   = value;
+    slot->version = ++m_version;
+
+    // Mark slot done (even sequence)
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+
+    // Publish slot
+    __atomic_store_n(&m_latest, next, __ATOMIC_RELEASE);
+  }
+
+  ////////////////////////////////////////////////////////////////
+
+  // Returns version of value, zero if never written.
+  // Never blocks, only retries when a concurrent write
+  // has wrapped the ring of slots.
+  uint32_t read(T &value) const
+  {
+    for (;;) {
+      unsigned latest = __atomic_load_n(&m_latest, __ATOMIC_ACQUIRE);
+      const SLOT *slot = &m_slot[latest];
+
+      uint32_t seq1 = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+      if (seq1 & 1) {
+	continue; // Writer has wrapped, try latest again
+      }
+
+      value = slot->value;
+      uint32_t version = slot->version;
+
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      uint32_t seq2 = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+      if (seq1 == seq2) {
+	return version;
+      }
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////
+
+  // Returns true and updates last_version if a newer value exists
+  bool read_new(T &value,
+		uint32_t &last_version) const
+  {
+    T the_value;
+    uint32_t version = read(the_value);
+
+    if (version == last_version) {
+      return false;
+    }
+
+    value = the_value;
+    last_version = version;
+
+    return true;
+  }
+
+  ////////////////////////////////////////////////////////////////
+
+  uint32_t get_version(void) const
+  {
+    unsigned latest = __atomic_load_n(&m_latest, __ATOMIC_ACQUIRE);
+    return __atomic_load_n(&m_slot[latest].version, __ATOMIC_RELAXED);
+  }
+
+ private:
+  typedef struct {
+    uint32_t seq;     // Odd while slot is written
+    uint32_t version;
+    T        value;
+  } SLOT;
+
+  SLOT     m_slot[N];
+  unsigned m_latest;   // Slot holding latest value
+  uint32_t m_version;  // Only used by writer
+};
+
+#endif // __LATEST_VALUE_H__
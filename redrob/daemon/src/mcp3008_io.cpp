@@ -125,7 +125,7 @@ void mcp3008_io::finalize(void)
 
 /////////////////////////////////////////////////////////////////////////////
 
-void mcp3008_io::read_single(MCP3008_IO_CHANNEL channel,
+void mcp3008_io::read_single(ADC_IO_CHANNEL channel,
 			     uint16_t &value)
 {
   uint8_t tx_buf[3];
@@ -17,41 +17,32 @@
 #include <stdint.h>
 #include <string>
 
+#include "adc_io.h"
+
 using namespace std;
 
 /////////////////////////////////////////////////////////////////////////////
 //               Definition of macros
 /////////////////////////////////////////////////////////////////////////////
 
-/////////////////////////////////////////////////////////////////////////////
-//               Class support types
-/////////////////////////////////////////////////////////////////////////////
-typedef enum {MCP3008_IO_CH0,
-	      MCP3008_IO_CH1,
-	      MCP3008_IO_CH2,
-	      MCP3008_IO_CH3,
-	      MCP3008_IO_CH4,
-	      MCP3008_IO_CH5,
-	      MCP3008_IO_CH6,
-	      MCP3008_IO_CH7} MCP3008_IO_CHANNEL;
-
 /////////////////////////////////////////////////////////////////////////////
 //               Definition of classes
 /////////////////////////////////////////////////////////////////////////////
 
-class mcp3008_io {
+class mcp3008_io : public adc_io {
   
  public:
   mcp3008_io(string spi_dev, float vref);
   ~mcp3008_io(void);
 
-  void initialize(uint32_t speed);
-  void finalize(void);
+  // Implements pure virtual functions from base class
+  virtual void initialize(uint32_t speed);
+  virtual void finalize(void);
 
-  void read_single(MCP3008_IO_CHANNEL channel,
-		   uint16_t &value);
+  virtual void read_single(ADC_IO_CHANNEL channel,
+			   uint16_t &value);
 
-  float to_voltage(uint16_t value);
+  virtual float to_voltage(uint16_t value);
 
  private:  
   string          m_spi_dev;
@@ -0,0 +1,139 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#ifndef __MPSC_QUEUE_H__
+#define __MPSC_QUEUE_H__
+
+#include <stdint.h>
+
+using namespace std;
+
+// Implementation notes:
+// 1. Bounded lock-free FIFO queue of a POD type.
+//    Any number of producer threads and one consumer thread.
+//
+// 2. Each slot has a sequence number telling if it is free for the
+//    producer at a given head position, or holds a value for the
+//    consumer at a given tail position. Producers claim a slot by
+//    moving head (compare and swap), the value is published by
+//    updating the slot sequence number. N must be a power of two.
+//
+// 3. A push to a full queue is rejected and counted as a drop,
+//    producers never wait for the consumer.
+//
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of classes
+/////////////////////////////////////////////////////////////////////////////
+
+template <typename T, unsigned N>
+class mpsc_queue {
+
+ public:
+
+  ////////////////////////////////////////////////////////////////
+
+  mpsc_queue(void)
+  {
+    // Compile time check, N must be a power of two
+    typedef char n_is_power_of_two[((N != 0) && !(N & (N - 1))) ? 1 : -1];
+    (void)sizeof(n_is_power_of_two);
+
+    for (unsigned i=0; i < N; i++) {
+      m_slot[i].seq = i; // Free for producer at head position i
+    }
+    m_head  = 0;
+    m_tail  = 0;
+    m_drops = 0;
+  }
+
+  ////////////////////////////////////////////////////////////////
+
+  // May be called by any thread.
+  // Returns false if queue is full (value dropped).
+  bool push(const T &value)
+  {
+    uint32_t head = __atomic_load_n(&m_head, __ATOMIC_RELAXED);
+
+    while (1) {
+      SLOT &slot = m_slot[head & (N - 1)];
+      uint32_t seq = __atomic_load_n(&slot.seq, __ATOMIC_ACQUIRE);
+      int32_t diff = (int32_t)(seq - head);
+
+      if (diff == 0) {
+	// Slot is free, claim it (head is reloaded on failure)
+	if (__atomic_compare_exchange_n(&m_head, &head, head + 1,
+					true, // Weak
+					__ATOMIC_RELAXED,
+					__ATOMIC_RELAXED)) {
+	  slot.value = value;
+
+	  // Publish slot
+	  __atomic_store_n(&slot.seq, head + 1, __ATOMIC_RELEASE);
+	  return true;
+	}
+      }
+      else if (diff < 0) {
+	// Slot still holds a value not yet popped
+	__atomic_add_fetch(&m_drops, 1, __ATOMIC_RELAXED);
+	return false;
+      }
+      else {
+	// Claimed by another producer
+	head = __atomic_load_n(&m_head, __ATOMIC_RELAXED);
+      }
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////
+
+  // Note! Only consumer is allowed to pop.
+  // Returns false if queue is empty.
+  bool pop(T &value)
+  {
+    SLOT &slot = m_slot[m_tail & (N - 1)];
+    uint32_t seq = __atomic_load_n(&slot.seq, __ATOMIC_ACQUIRE);
+
+    if (seq != m_tail + 1) {
+      return false; // Empty or value not yet published
+    }
+
+    value = slot.value;
+
+    // Release slot for producer one lap later
+    __atomic_store_n(&slot.seq, m_tail + N, __ATOMIC_RELEASE);
+    m_tail++;
+
+    return true;
+  }
+
+  ////////////////////////////////////////////////////////////////
+
+  unsigned get_size(void) const {return N;}
+
+  uint32_t get_drops(void) const
+  {
+    return __atomic_load_n(&m_drops, __ATOMIC_RELAXED);
+  }
+
+ private:
+  typedef struct {
+    uint32_t seq;
+    T        value;
+  } SLOT;
+
+  SLOT     m_slot[N];
+  uint32_t m_head;  // Next slot to claim, written by producers
+  uint32_t m_tail;  // Next slot to read, only used by consumer
+  uint32_t m_drops; // Rejected pushes, written by producers
+};
+
+#endif // __MPSC_QUEUE_H__
@@ -0,0 +1,368 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+
+#include "periodic_scheduler.h"
+#include "delay.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of macros
+/////////////////////////////////////////////////////////////////////////////
+
+// Max wait for timers, limits time to detect a stop request
+#define EPOLL_TIMEOUT_MS  1000
+
+/////////////////////////////////////////////////////////////////////////////
+//               Private member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+static inline void add_interval(struct timespec *the_time,
+				const struct timespec *interval,
+				uint64_t count)
+{
+  // Same arithmetic as the kernel timer, no drift
+  uint64_t nsec = (uint64_t)interval->tv_nsec * count + the_time->tv_nsec;
+
+  the_time->tv_sec += (time_t)(interval->tv_sec * count + nsec / 1000000000);
+  the_time->tv_nsec = (long)(nsec % 1000000000);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Public member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+periodic_scheduler::periodic_scheduler(string thread_name) : thread(thread_name)
+{
+  m_nr_tasks = 0;
+
+  init_members();
+}
+
+////////////////////////////////////////////////////////////////
+
+periodic_scheduler::~periodic_scheduler(void)
+{
+  // Normally closed by cleanup
+  for (unsigned i=0; i < m_nr_tasks; i++) {
+    if (m_task[i].timer_fd >= 0) {
+      close(m_task[i].timer_fd);
+    }
+  }
+  if (m_epoll_fd >= 0) {
+    close(m_epoll_fd);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+long periodic_scheduler::add_task(periodic_task *task,
+				  double frequency,
+				  int priority,
+				  double phase)
+{
+  // Check state
+  if (get_state() != THREAD_STATE_NOT_STARTED) {
+    return THREAD_WRONG_STATE;
+  }
+
+  // Check arguments
+  if ( (!task) ||
+       (frequency <= 0.0) ||
+       (phase < 0.0) ||
+       (m_nr_tasks >= PERIODIC_SCHEDULER_MAX_TASKS) ) {
+    return THREAD_INTERNAL_ERROR;
+  }
+
+  TASK_INFO *info = &m_task[m_nr_tasks];
+
+  info->task       = task;
+  info->frequency  = frequency;
+  info->priority   = priority;
+  info->phase      = phase;
+  info->timer_fd   = -1;
+  info->setup_done = false;
+
+  m_nr_tasks++;
+
+  return THREAD_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+string periodic_scheduler::get_task_name(unsigned index)
+{
+  if (index >= m_nr_tasks) {
+    return "";
+  }
+  return m_task[index].task->get_task_name();
+}
+
+////////////////////////////////////////////////////////////////
+
+double periodic_scheduler::get_task_frequency(unsigned index)
+{
+  if (index >= m_nr_tasks) {
+    return 0.0;
+  }
+  return m_task[index].frequency;
+}
+
+////////////////////////////////////////////////////////////////
+
+long periodic_scheduler::get_task_stat(unsigned index,
+				       PERIODIC_TASK_STAT &stat)
+{
+  if (index >= m_nr_tasks) {
+    return THREAD_INTERNAL_ERROR;
+  }
+
+  // Never blocks the scheduler thread
+  m_stat_published[index].read(stat);
+
+  return THREAD_SUCCESS;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Protected member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+long periodic_scheduler::setup(void)
+{
+  init_members();
+
+  m_epoll_fd = epoll_create(PERIODIC_SCHEDULER_MAX_TASKS);
+  if (m_epoll_fd < 0) {
+    return THREAD_EVENT_ERROR;
+  }
+
+  for (unsigned i=0; i < m_nr_tasks; i++) {
+    // Create timer, armed when thread is released
+    m_task[i].timer_fd = timerfd_create(get_clock_id(), TFD_NONBLOCK);
+    if (m_task[i].timer_fd < 0) {
+      return THREAD_EVENT_ERROR;
+    }
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = i;
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_task[i].timer_fd, &event)) {
+      return THREAD_EVENT_ERROR;
+    }
+
+    if (m_task[i].task->task_setup() != THREAD_SUCCESS) {
+      return THREAD_INTERNAL_ERROR;
+    }
+    m_task[i].setup_done = true;
+  }
+
+  return THREAD_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+long periodic_scheduler::execute(void *arg)
+{
+  struct epoll_event events[PERIODIC_SCHEDULER_MAX_TASKS];
+  unsigned ready[PERIODIC_SCHEDULER_MAX_TASKS];
+  unsigned nr_ready;
+  long rc;
+
+  // Make GCC happy (-Wextra)
+  if (arg) {
+    return THREAD_INTERNAL_ERROR;
+  }
+
+  rc = start_timers();
+  if (rc != THREAD_SUCCESS) {
+    return rc;
+  }
+
+  while ( !is_stopped() ) {
+
+    int nr_events = epoll_wait(m_epoll_fd,
+			       events,
+			       PERIODIC_SCHEDULER_MAX_TASKS,
+			       EPOLL_TIMEOUT_MS);
+    if (nr_events < 0) {
+      if (errno == EINTR) {
+	continue;
+      }
+      return THREAD_EVENT_ERROR;
+    }
+
+    // Order due tasks by priority, highest first
+    nr_ready = 0;
+    for (int i=0; i < nr_events; i++) {
+      unsigned index = events[i].data.u32;
+      unsigned pos = nr_ready;
+      while ( (pos > 0) &&
+	      (m_task[ready[pos-1]].priority < m_task[index].priority) ) {
+	ready[pos] = ready[pos-1];
+	pos--;
+      }
+      ready[pos] = index;
+      nr_ready++;
+    }
+
+    for (unsigned i=0; i < nr_ready; i++) {
+      rc = execute_task(ready[i]);
+      if (rc != THREAD_SUCCESS) {
+	return rc;
+      }
+    }
+
+    update_exe_cnt();
+  }
+
+  return THREAD_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+long periodic_scheduler::cleanup(void)
+{
+  long rc = THREAD_SUCCESS;
+
+  // Cleanup in reverse order of setup
+  for (unsigned i=m_nr_tasks; i > 0; i--) {
+    TASK_INFO *info = &m_task[i-1];
+
+    if (info->setup_done) {
+      if (info->task->task_cleanup() != THREAD_SUCCESS) {
+	rc = THREAD_INTERNAL_ERROR;
+      }
+      info->setup_done = false;
+    }
+    if (info->timer_fd >= 0) {
+      close(info->timer_fd);
+      info->timer_fd = -1;
+    }
+  }
+
+  if (m_epoll_fd >= 0) {
+    close(m_epoll_fd);
+    m_epoll_fd = -1;
+  }
+
+  return rc;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Private member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+void periodic_scheduler::init_members(void)
+{
+  m_epoll_fd = -1;
+
+  for (unsigned i=0; i < PERIODIC_SCHEDULER_MAX_TASKS; i++) {
+    m_stat[i].executions = 0;
+    m_stat[i].missed_periods = 0;
+    m_stat[i].wakeup_latency.reset();
+    m_stat[i].exec_time.reset();
+    m_stat_published[i].write(m_stat[i]);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+long periodic_scheduler::start_timers(void)
+{
+  struct timespec now;
+
+  // All phases are relative to the same start time
+  if ( clock_gettime(get_clock_id(), &now) ) {
+    return THREAD_TIME_ERROR;
+  }
+
+  for (unsigned i=0; i < m_nr_tasks; i++) {
+    TASK_INFO *info = &m_task[i];
+    struct itimerspec its;
+    double period = 1.0 / info->frequency;
+
+    if ( get_new_time(&now, info->phase, &info->next_expiry) != DELAY_SUCCESS ) {
+      return THREAD_TIME_ERROR;
+    }
+
+    info->interval.tv_sec  = (time_t)period;
+    info->interval.tv_nsec = (long)((period - info->interval.tv_sec) * 1000000000.0);
+
+    its.it_value    = info->next_expiry;
+    its.it_interval = info->interval;
+
+    if (timerfd_settime(info->timer_fd, TFD_TIMER_ABSTIME, &its, NULL)) {
+      return THREAD_EVENT_ERROR;
+    }
+  }
+
+  return THREAD_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+long periodic_scheduler::execute_task(unsigned index)
+{
+  TASK_INFO *info = &m_task[index];
+  PERIODIC_TASK_STAT *stat = &m_stat[index];
+  struct timespec t_wakeup;
+  struct timespec t_done;
+  uint64_t expirations;
+
+  // Number of periods started since last read
+  if (read(info->timer_fd, &expirations, sizeof(expirations)) < 0) {
+    if ( (errno == EAGAIN) || (errno == EINTR) ) {
+      return THREAD_SUCCESS;
+    }
+    return THREAD_EVENT_ERROR;
+  }
+  if (!expirations) {
+    return THREAD_SUCCESS;
+  }
+
+  if ( clock_gettime(get_clock_id(), &t_wakeup) ) {
+    return THREAD_TIME_ERROR;
+  }
+
+  // Planned wakeup is the latest period start
+  add_interval(&info->next_expiry, &info->interval, expirations - 1);
+  stat->wakeup_latency.add(get_time_diff(&info->next_expiry, &t_wakeup));
+  stat->missed_periods += (unsigned)(expirations - 1);
+
+  if (info->task->task_execute() != THREAD_SUCCESS) {
+    return THREAD_INTERNAL_ERROR;
+  }
+
+  if ( clock_gettime(get_clock_id(), &t_done) ) {
+    return THREAD_TIME_ERROR;
+  }
+  stat->exec_time.add(get_time_diff(&t_wakeup, &t_done));
+  stat->executions++;
+
+  // Prepare next period
+  add_interval(&info->next_expiry, &info->interval, 1);
+
+  m_stat_published[index].write(*stat);
+
+  return THREAD_SUCCESS;
+}
@@ -0,0 +1,111 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#ifndef __PERIODIC_SCHEDULER_H__
+#define __PERIODIC_SCHEDULER_H__
+
+#include "thread.h"
+#include "periodic_task.h"
+#include "histogram.h"
+#include "latest_value.h"
+
+using namespace std;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of macros
+/////////////////////////////////////////////////////////////////////////////
+
+#define PERIODIC_SCHEDULER_MAX_TASKS  8
+
+/////////////////////////////////////////////////////////////////////////////
+//               Class support types
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  unsigned  executions;     // Number of executions
+  unsigned  missed_periods; // Timer expirations not executed
+  histogram wakeup_latency; // Actual wakeup - planned wakeup
+  histogram exec_time;      // Time spent in task_execute
+} PERIODIC_TASK_STAT;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of classes
+/////////////////////////////////////////////////////////////////////////////
+
+// Implementation notes:
+// 1. All tasks are executed by one thread. Each task has its own
+//    timerfd (absolute, periodic) and all timers are waited for
+//    using one epoll instance.
+//
+// 2. Tasks that are due at the same time are executed in priority
+//    order (highest first). A phase offset can be used to spread
+//    tasks sharing a resource, so they are never due at same time.
+//
+// 3. A task that is not done before its next period starts is not
+//    executed back-to-back, missed periods are only counted.
+//
+
+class periodic_scheduler : public thread {
+
+ public:
+  periodic_scheduler(string thread_name);
+  ~periodic_scheduler(void);
+
+  // Tasks must be added before thread is started.
+  // The task object is not owned by the scheduler.
+  long add_task(periodic_task *task,
+		double frequency,
+		int priority,      // Higher value executes first
+		double phase);     // Offset (s) of first period
+
+  unsigned get_nr_tasks(void) {return m_nr_tasks;}
+
+  string get_task_name(unsigned index);
+  double get_task_frequency(unsigned index);
+
+  long get_task_stat(unsigned index,
+		     PERIODIC_TASK_STAT &stat);
+
+ protected:
+  virtual long setup(void);        // Implements pure virtual function from base class
+  virtual long execute(void *arg); // Implements pure virtual function from base class
+  virtual long cleanup(void);      // Implements pure virtual function from base class
+
+ private:
+  typedef struct {
+    periodic_task   *task;
+    double           frequency;
+    int              priority;
+    double           phase;
+    int              timer_fd;
+    struct timespec  interval;    // Period of timer
+    struct timespec  next_expiry; // Planned wakeup of current period
+    bool             setup_done;
+  } TASK_INFO;
+
+  TASK_INFO m_task[PERIODIC_SCHEDULER_MAX_TASKS];
+  unsigned  m_nr_tasks;
+
+  int m_epoll_fd;
+
+  // Task statistics, only updated by scheduler thread
+  // and published after each execution
+  PERIODIC_TASK_STAT m_stat[PERIODIC_SCHEDULER_MAX_TASKS];
+  latest_value<PERIODIC_TASK_STAT> m_stat_published[PERIODIC_SCHEDULER_MAX_TASKS];
+
+  void init_members(void);
+
+  long start_timers(void);
+
+  long execute_task(unsigned index);
+};
+
+#endif // __PERIODIC_SCHEDULER_H__
@@ -0,0 +1,39 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#ifndef __PERIODIC_TASK_H__
+#define __PERIODIC_TASK_H__
+
+#include <string>
+
+using namespace std;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of classes
+/////////////////////////////////////////////////////////////////////////////
+
+// Interface of work that is executed periodically by a
+// periodic_scheduler. All functions are called from the
+// scheduler thread and shall return THREAD_SUCCESS if ok.
+
+class periodic_task {
+
+ public:
+  virtual ~periodic_task(void) {}
+
+  virtual string get_task_name(void) = 0;
+
+  virtual long task_setup(void) = 0;   // Before first execution
+  virtual long task_execute(void) = 0; // Once every period
+  virtual long task_cleanup(void) = 0; // When scheduler stops
+};
+
+#endif // __PERIODIC_TASK_H__
@@ -51,15 +51,11 @@ long redrobd_check_run_status(void)
 
 ////////////////////////////////////////////////////////////////
 
-long redrobd_initialize(const char *logfile,
-			bool log_stdout,
-			double ctrl_thread_frequency,
-			bool verbose)
+long redrobd_initialize(const REDROBD_CONFIG *config,
+			bool log_stdout)
 {
-  return g_object.initialize(logfile,
-			     log_stdout,
-			     ctrl_thread_frequency,
-			     verbose);
+  return g_object.initialize(config,
+			     log_stdout);
 }
 
 ////////////////////////////////////////////////////////////////
@@ -68,3 +64,14 @@ long redrobd_finalize(void)
 {
   return g_object.finalize();
 }
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_reconfigure(const REDROBD_CONFIG *config,
+			 bool log_stdout,
+			 bool *applied)
+{
+  return g_object.reconfigure(config,
+			      log_stdout,
+			      applied);
+}
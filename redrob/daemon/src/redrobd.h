@@ -70,6 +70,55 @@ typedef struct {
   long                 error_code;
 } REDROBD_STATUS;
 
+typedef enum {REDROBD_SCHED_OTHER,
+	      REDROBD_SCHED_FIFO,
+	      REDROBD_SCHED_RR} REDROBD_SCHED_POLICY;
+
+typedef struct {
+  REDROBD_SCHED_POLICY policy;
+  int                  priority; /* Ignored for REDROBD_SCHED_OTHER */
+  int                  cpu;      /* -1 means any CPU */
+} REDROBD_THREAD_SCHED;
+
+typedef enum {REDROBD_OVERRUN_CATCH_UP, /* Run missed cycles back-to-back */
+	      REDROBD_OVERRUN_SKIP,     /* Skip missed cycles             */
+	      REDROBD_OVERRUN_STRETCH}  /* Stretch period of late cycle   */
+  REDROBD_OVERRUN_POLICY;
+
+typedef enum {REDROBD_CMD_LATEST, /* Only latest command is applied */
+	      REDROBD_CMD_ALL}    /* Every command is applied       */
+  REDROBD_CMD_POLICY;
+
+typedef enum {REDROBD_INPUT_NORMAL,          /* Inputs from hardware and clients */
+	      REDROBD_INPUT_RECORD,          /* Inputs recorded to file          */
+	      REDROBD_INPUT_REPLAY_REALTIME, /* Inputs replayed at recorded pace */
+	      REDROBD_INPUT_REPLAY_FULL}     /* Inputs replayed at full speed    */
+  REDROBD_INPUT_MODE;
+
+typedef enum {REDROBD_HW_RPI, /* Raspberry Pi GPIO and MCP3008       */
+	      REDROBD_HW_SIM} /* Simulated, inputs from script file */
+  REDROBD_HW_BACKEND;
+
+typedef enum {REDROBD_LOG_TEXT,   /* Text lines                      */
+	      REDROBD_LOG_BINARY} /* Message records, see redrobd_logdec */
+  REDROBD_LOG_FORMAT;
+
+typedef struct {
+  double cpu_load;    /* All values are sample rates (Hz) */
+  double mem_used;    /* Zero means disabled              */
+  double irq;
+  double uptime;
+  double cpu_temp;
+  double cpu_voltage;
+  double cpu_freq;
+  double throttled;
+} REDROBD_SYS_STAT_RATE;
+
+typedef enum {REDROBD_RPI_STAT_MAILBOX,  /* VideoCore mailbox (/dev/vcio) */
+	      REDROBD_RPI_STAT_SYSFS,    /* Thermal and cpufreq nodes     */
+	      REDROBD_RPI_STAT_VCGENCMD} /* Shell command, forks          */
+  REDROBD_RPI_STAT_BACKEND;
+
 typedef struct {
   bool           daemonize;
   REDROBD_STRING user;
@@ -77,9 +126,39 @@ typedef struct {
   REDROBD_STRING lock_file;
   REDROBD_STRING log_file;
   bool           log_stdout;
+  REDROBD_LOG_FORMAT log_format;
+  unsigned       log_file_size_kb; // 0 if not circular
   double         supervision_freq;
   double         ctrl_thread_freq;
+  bool           ctrl_event_driven;
+  bool           ctrl_cmd_trace;
+  REDROBD_CMD_POLICY steer_cmd_policy;
+  REDROBD_CMD_POLICY camera_cmd_policy;
+  unsigned       net_udp_steer_port; // 0 if disabled
+  REDROBD_STRING net_unix_socket;    // Empty if disabled
+  int            net_unix_allow_uid; // -1 if none
+  REDROBD_INPUT_MODE ctrl_input_mode;
+  REDROBD_STRING ctrl_input_file;
+  REDROBD_STRING ctrl_output_file;
+  REDROBD_HW_BACKEND hw_backend;
+  REDROBD_STRING hw_sim_script;
+  REDROBD_STRING hw_sim_output;
   bool           verbose;
+  bool           lock_memory;
+  unsigned       thread_stack_kb;
+  bool           use_task_scheduler;
+  REDROBD_THREAD_SCHED ctrl_thread_sched;
+  REDROBD_THREAD_SCHED bat_mon_thread_sched;
+  REDROBD_THREAD_SCHED alive_thread_sched;
+  REDROBD_THREAD_SCHED net_server_thread_sched;
+  REDROBD_THREAD_SCHED sys_stat_thread_sched;
+  REDROBD_OVERRUN_POLICY ctrl_thread_overrun;
+  REDROBD_OVERRUN_POLICY bat_mon_thread_overrun;
+  REDROBD_OVERRUN_POLICY alive_thread_overrun;
+  REDROBD_OVERRUN_POLICY sys_stat_thread_overrun;
+  REDROBD_SYS_STAT_RATE sys_stat_rate;
+  REDROBD_RPI_STAT_BACKEND sys_stat_rpi_backend;
+  REDROBD_STRING sys_stat_rpi_root;
 } REDROBD_CONFIG;
 
 /****************************************************************************
@@ -148,19 +227,16 @@ extern long redrobd_check_run_status(void);
 * Description Allocates system resources and performs operations that are
 *             necessary to start REDROBD.
 *
-* Parameters logfile                IN  Path to daemon internal log file
-*            log_stdout             IN  Controls if internal log to STDOUT
-*            ctrl_thread_frequency  IN  Frequency (Hz) of control thread
-*            verbose                IN  Full verbose logging enable
+* Parameters config      IN  Configuration (see redrobd_get_config)
+*            log_stdout  IN  Controls if internal log to STDOUT
+*                            (overrides value in configuration)
 *
 * Error handling Returns REDROBD_SUCCESS if successful
 *                otherwise REDROBD_FAILURE or REDROBD_MUTEX_FAILURE
 *
 ****************************************************************************/
-extern long redrobd_initialize(const char *logfile,
-			       bool log_stdout,
-			       double ctrl_thread_frequency,
-			       bool verbose);
+extern long redrobd_initialize(const REDROBD_CONFIG *config,
+			       bool log_stdout);
 
 /****************************************************************************
 *
@@ -176,6 +252,30 @@ extern long redrobd_initialize(const char *logfile,
 ****************************************************************************/
 extern long redrobd_finalize(void);
 
+/****************************************************************************
+*
+* Name redrobd_reconfigure
+*
+* Description Applies a new configuration without finalization, threads
+*             and hardware are kept running. Only log_file,
+*             supervision_freq, ctrl_thread_freq and verbose can be applied
+*             this way, items only valid during start are ignored.
+*             If any other item is changed nothing is applied and a
+*             restart (finalize and initialize) is required.
+*
+* Parameters config      IN   Configuration (see redrobd_get_config)
+*            log_stdout  IN   Controls if internal log to STDOUT
+*                             (overrides value in configuration)
+*            applied     OUT  True if applied, false if restart required
+*
+* Error handling Returns REDROBD_SUCCESS if successful
+*                otherwise REDROBD_FAILURE or REDROBD_MUTEX_FAILURE
+*
+****************************************************************************/
+extern long redrobd_reconfigure(const REDROBD_CONFIG *config,
+				bool log_stdout,
+				bool *applied);
+
 #ifdef  __cplusplus
 }
 #endif
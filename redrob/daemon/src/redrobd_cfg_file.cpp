@@ -23,9 +23,55 @@
 #define LOCK_FILE          "lock_file"
 #define LOG_FILE           "log_file"
 #define LOG_STDOUT         "log_stdout"
+#define LOG_FORMAT         "log_format"
+#define LOG_FILE_SIZE_KB   "log_file_size_kb"
 #define SUPERVISION_FREQ   "supervision_freq"
 #define CTRL_THREAD_FREQ   "ctrl_thread_freq"
+#define CTRL_EVENT_DRIVEN  "ctrl_event_driven"
+#define CTRL_CMD_TRACE     "ctrl_cmd_trace"
+#define STEER_CMD_POLICY   "steer_cmd_policy"
+#define CAMERA_CMD_POLICY  "camera_cmd_policy"
+#define NET_UDP_STEER_PORT "net_udp_steer_port"
+#define NET_UNIX_SOCKET    "net_unix_socket"
+#define NET_UNIX_ALLOW_UID "net_unix_allow_uid"
+#define CTRL_INPUT_MODE    "ctrl_input_mode"
+#define CTRL_INPUT_FILE    "ctrl_input_file"
+#define CTRL_OUTPUT_FILE   "ctrl_output_file"
+#define HW_BACKEND         "hw_backend"
+#define HW_SIM_SCRIPT      "hw_sim_script"
+#define HW_SIM_OUTPUT      "hw_sim_output"
 #define VERBOSE            "verbose"
+#define LOCK_MEMORY        "lock_memory"
+#define THREAD_STACK_KB    "thread_stack_kb"
+#define USE_TASK_SCHEDULER "use_task_scheduler"
+
+// Thread scheduling items are named <thread>_thread_<suffix>
+#define CTRL_THREAD        "ctrl"
+#define BAT_MON_THREAD     "bat_mon"
+#define ALIVE_THREAD       "alive"
+#define NET_SERVER_THREAD  "net_server"
+#define SYS_STAT_THREAD    "sys_stat"
+
+#define THREAD_SCHED_SUFFIX  "_thread_sched"
+#define THREAD_PRIO_SUFFIX   "_thread_prio"
+#define THREAD_CPU_SUFFIX    "_thread_cpu"
+
+// Overrun policy of cyclic threads are named <thread>_thread_overrun
+#define THREAD_OVERRUN_SUFFIX  "_thread_overrun"
+
+// System statistics sample rates
+#define SYS_STAT_CPU_LOAD_RATE     "sys_stat_cpu_load_rate"
+#define SYS_STAT_MEM_USED_RATE     "sys_stat_mem_used_rate"
+#define SYS_STAT_IRQ_RATE          "sys_stat_irq_rate"
+#define SYS_STAT_UPTIME_RATE       "sys_stat_uptime_rate"
+#define SYS_STAT_CPU_TEMP_RATE     "sys_stat_cpu_temp_rate"
+#define SYS_STAT_CPU_VOLTAGE_RATE  "sys_stat_cpu_voltage_rate"
+#define SYS_STAT_CPU_FREQ_RATE     "sys_stat_cpu_freq_rate"
+#define SYS_STAT_THROTTLED_RATE    "sys_stat_throttled_rate"
+
+// Raspberry Pi statistics source
+#define SYS_STAT_RPI_BACKEND  "sys_stat_rpi_backend"
+#define SYS_STAT_RPI_ROOT     "sys_stat_rpi_root"
 
 // Default configuration values
 #define DEF_DAEMONIZE           true
@@ -34,9 +80,34 @@
 #define DEF_LOCK_FILE           "/var/run/"REDROBD_NAME".pid"
 #define DEF_LOG_FILE            "/var/log/"REDROBD_NAME".log"
 #define DEF_LOG_STDOUT          false
+#define DEF_LOG_FORMAT          "text"
+#define DEF_LOG_FILE_SIZE_KB    0        // Not circular
 #define DEF_SUPERVISION_FREQ    1.0  // Hz
 #define DEF_CTRL_THREAD_FREQ    66.7 // Hz
+#define DEF_CTRL_EVENT_DRIVEN   false
+#define DEF_CTRL_CMD_TRACE      false
+#define DEF_STEER_CMD_POLICY    "latest"
+#define DEF_CAMERA_CMD_POLICY   "all"
+#define DEF_NET_UDP_STEER_PORT  0        // Disabled
+#define DEF_NET_UNIX_SOCKET     "none"   // Disabled
+#define DEF_NET_UNIX_ALLOW_UID  -1       // Only root and daemon user
+#define DEF_CTRL_INPUT_MODE     "normal"
+#define DEF_CTRL_INPUT_FILE     "/tmp/"REDROBD_NAME"_input.rec"
+#define DEF_CTRL_OUTPUT_FILE    "/tmp/"REDROBD_NAME"_output.rec"
+#define DEF_HW_BACKEND          "rpi"
+#define DEF_HW_SIM_SCRIPT       "/proj/redrob/"REDROBD_NAME"_sim.script"
+#define DEF_HW_SIM_OUTPUT       "/tmp/"REDROBD_NAME"_sim_output.txt"
 #define DEF_VERBOSE             false
+#define DEF_LOCK_MEMORY         false
+#define DEF_THREAD_STACK_KB     0        // System default
+#define DEF_USE_TASK_SCHEDULER  false
+#define DEF_THREAD_SCHED        "other"
+#define DEF_THREAD_PRIO         0
+#define DEF_THREAD_CPU          -1       // Any CPU
+#define DEF_THREAD_OVERRUN      "catch_up"
+#define DEF_SYS_STAT_RATE       1.0      // Hz
+#define DEF_SYS_STAT_RPI_BACKEND  "mailbox"
+#define DEF_SYS_STAT_RPI_ROOT     "/"
 
 /////////////////////////////////////////////////////////////////////////////
 //               Public member functions
@@ -57,9 +128,69 @@ redrobd_cfg_file::redrobd_cfg_file(string file_name) : cfg_file(file_name)
   set_default_item_value(LOCK_FILE, string(DEF_LOCK_FILE), left);
   set_default_item_value(LOG_FILE,  string(DEF_LOG_FILE),  left);
   set_default_item_value(LOG_STDOUT, bool(DEF_LOG_STDOUT), boolalpha);
+  set_default_item_value(LOG_FORMAT, string(DEF_LOG_FORMAT), left);
+  set_default_item_value(LOG_FILE_SIZE_KB, int(DEF_LOG_FILE_SIZE_KB), dec);
   set_default_item_value(SUPERVISION_FREQ, double(DEF_SUPERVISION_FREQ), dec);
   set_default_item_value(CTRL_THREAD_FREQ, double(DEF_CTRL_THREAD_FREQ), dec);
+  set_default_item_value(CTRL_EVENT_DRIVEN, bool(DEF_CTRL_EVENT_DRIVEN), boolalpha);
+  set_default_item_value(CTRL_CMD_TRACE, bool(DEF_CTRL_CMD_TRACE), boolalpha);
+  set_default_item_value(STEER_CMD_POLICY,  string(DEF_STEER_CMD_POLICY),  left);
+  set_default_item_value(CAMERA_CMD_POLICY, string(DEF_CAMERA_CMD_POLICY), left);
+  set_default_item_value(NET_UDP_STEER_PORT, int(DEF_NET_UDP_STEER_PORT), dec);
+  set_default_item_value(NET_UNIX_SOCKET, string(DEF_NET_UNIX_SOCKET), left);
+  set_default_item_value(NET_UNIX_ALLOW_UID, int(DEF_NET_UNIX_ALLOW_UID), dec);
+  set_default_item_value(CTRL_INPUT_MODE,  string(DEF_CTRL_INPUT_MODE),  left);
+  set_default_item_value(CTRL_INPUT_FILE,  string(DEF_CTRL_INPUT_FILE),  left);
+  set_default_item_value(CTRL_OUTPUT_FILE, string(DEF_CTRL_OUTPUT_FILE), left);
+  set_default_item_value(HW_BACKEND,    string(DEF_HW_BACKEND),    left);
+  set_default_item_value(HW_SIM_SCRIPT, string(DEF_HW_SIM_SCRIPT), left);
+  set_default_item_value(HW_SIM_OUTPUT, string(DEF_HW_SIM_OUTPUT), left);
   set_default_item_value(VERBOSE, bool(DEF_VERBOSE), boolalpha);
+  set_default_item_value(LOCK_MEMORY, bool(DEF_LOCK_MEMORY), boolalpha);
+  set_default_item_value(THREAD_STACK_KB, int(DEF_THREAD_STACK_KB), dec);
+  set_default_item_value(USE_TASK_SCHEDULER, bool(DEF_USE_TASK_SCHEDULER), boolalpha);
+
+  set_default_thread_sched(CTRL_THREAD,
+			   DEF_THREAD_SCHED, DEF_THREAD_PRIO, DEF_THREAD_CPU);
+  set_default_thread_sched(BAT_MON_THREAD,
+			   DEF_THREAD_SCHED, DEF_THREAD_PRIO, DEF_THREAD_CPU);
+  set_default_thread_sched(ALIVE_THREAD,
+			   DEF_THREAD_SCHED, DEF_THREAD_PRIO, DEF_THREAD_CPU);
+  set_default_thread_sched(NET_SERVER_THREAD,
+			   DEF_THREAD_SCHED, DEF_THREAD_PRIO, DEF_THREAD_CPU);
+  set_default_thread_sched(SYS_STAT_THREAD,
+			   DEF_THREAD_SCHED, DEF_THREAD_PRIO, DEF_THREAD_CPU);
+
+  set_default_item_value(CTRL_THREAD THREAD_OVERRUN_SUFFIX,
+			 string(DEF_THREAD_OVERRUN), left);
+  set_default_item_value(BAT_MON_THREAD THREAD_OVERRUN_SUFFIX,
+			 string(DEF_THREAD_OVERRUN), left);
+  set_default_item_value(ALIVE_THREAD THREAD_OVERRUN_SUFFIX,
+			 string(DEF_THREAD_OVERRUN), left);
+  set_default_item_value(SYS_STAT_THREAD THREAD_OVERRUN_SUFFIX,
+			 string(DEF_THREAD_OVERRUN), left);
+
+  set_default_item_value(SYS_STAT_CPU_LOAD_RATE,
+			 double(DEF_SYS_STAT_RATE), dec);
+  set_default_item_value(SYS_STAT_MEM_USED_RATE,
+			 double(DEF_SYS_STAT_RATE), dec);
+  set_default_item_value(SYS_STAT_IRQ_RATE,
+			 double(DEF_SYS_STAT_RATE), dec);
+  set_default_item_value(SYS_STAT_UPTIME_RATE,
+			 double(DEF_SYS_STAT_RATE), dec);
+  set_default_item_value(SYS_STAT_CPU_TEMP_RATE,
+			 double(DEF_SYS_STAT_RATE), dec);
+  set_default_item_value(SYS_STAT_CPU_VOLTAGE_RATE,
+			 double(DEF_SYS_STAT_RATE), dec);
+  set_default_item_value(SYS_STAT_CPU_FREQ_RATE,
+			 double(DEF_SYS_STAT_RATE), dec);
+  set_default_item_value(SYS_STAT_THROTTLED_RATE,
+			 double(DEF_SYS_STAT_RATE), dec);
+
+  set_default_item_value(SYS_STAT_RPI_BACKEND,
+			 string(DEF_SYS_STAT_RPI_BACKEND), left);
+  set_default_item_value(SYS_STAT_RPI_ROOT,
+			 string(DEF_SYS_STAT_RPI_ROOT), left);
 
   /*
     Example on how to use hex/dec integers   
@@ -118,6 +249,20 @@ long redrobd_cfg_file::get_log_stdout(bool &value)
 
 ////////////////////////////////////////////////////////////////
 
+long redrobd_cfg_file::get_log_format(string &value)
+{
+  return get_item_value(LOG_FORMAT, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_log_file_size_kb(int &value)
+{
+  return get_item_value(LOG_FILE_SIZE_KB, value);
+}
+
+////////////////////////////////////////////////////////////////
+
 long redrobd_cfg_file::get_supervision_freq(double &value)
 {
   return get_item_value(SUPERVISION_FREQ, value);
@@ -132,7 +277,301 @@ long redrobd_cfg_file::get_ctrl_thread_freq(double &value)
 
 ////////////////////////////////////////////////////////////////
 
+long redrobd_cfg_file::get_ctrl_event_driven(bool &value)
+{
+  return get_item_value(CTRL_EVENT_DRIVEN, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_ctrl_cmd_trace(bool &value)
+{
+  return get_item_value(CTRL_CMD_TRACE, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_steer_cmd_policy(string &value)
+{
+  return get_item_value(STEER_CMD_POLICY, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_camera_cmd_policy(string &value)
+{
+  return get_item_value(CAMERA_CMD_POLICY, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_net_udp_steer_port(int &value)
+{
+  return get_item_value(NET_UDP_STEER_PORT, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_net_unix_socket(string &value)
+{
+  return get_item_value(NET_UNIX_SOCKET, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_net_unix_allow_uid(int &value)
+{
+  return get_item_value(NET_UNIX_ALLOW_UID, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_ctrl_input_mode(string &value)
+{
+  return get_item_value(CTRL_INPUT_MODE, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_ctrl_input_file(string &value)
+{
+  return get_item_value(CTRL_INPUT_FILE, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_ctrl_output_file(string &value)
+{
+  return get_item_value(CTRL_OUTPUT_FILE, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_hw_backend(string &value)
+{
+  return get_item_value(HW_BACKEND, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_hw_sim_script(string &value)
+{
+  return get_item_value(HW_SIM_SCRIPT, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_hw_sim_output(string &value)
+{
+  return get_item_value(HW_SIM_OUTPUT, value);
+}
+
+////////////////////////////////////////////////////////////////
+
 long redrobd_cfg_file::get_verbose(bool &value)
 {
   return get_item_value(VERBOSE, value);
 }
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_lock_memory(bool &value)
+{
+  return get_item_value(LOCK_MEMORY, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_thread_stack_kb(int &value)
+{
+  return get_item_value(THREAD_STACK_KB, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_use_task_scheduler(bool &value)
+{
+  return get_item_value(USE_TASK_SCHEDULER, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_ctrl_thread_sched(string &policy,
+					     int &priority,
+					     int &cpu)
+{
+  return get_thread_sched(CTRL_THREAD, policy, priority, cpu);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_bat_mon_thread_sched(string &policy,
+						int &priority,
+						int &cpu)
+{
+  return get_thread_sched(BAT_MON_THREAD, policy, priority, cpu);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_alive_thread_sched(string &policy,
+					      int &priority,
+					      int &cpu)
+{
+  return get_thread_sched(ALIVE_THREAD, policy, priority, cpu);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_net_server_thread_sched(string &policy,
+						   int &priority,
+						   int &cpu)
+{
+  return get_thread_sched(NET_SERVER_THREAD, policy, priority, cpu);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_sys_stat_thread_sched(string &policy,
+						 int &priority,
+						 int &cpu)
+{
+  return get_thread_sched(SYS_STAT_THREAD, policy, priority, cpu);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_ctrl_thread_overrun(string &policy)
+{
+  return get_item_value(CTRL_THREAD THREAD_OVERRUN_SUFFIX, policy);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_bat_mon_thread_overrun(string &policy)
+{
+  return get_item_value(BAT_MON_THREAD THREAD_OVERRUN_SUFFIX, policy);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_alive_thread_overrun(string &policy)
+{
+  return get_item_value(ALIVE_THREAD THREAD_OVERRUN_SUFFIX, policy);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_sys_stat_thread_overrun(string &policy)
+{
+  return get_item_value(SYS_STAT_THREAD THREAD_OVERRUN_SUFFIX, policy);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_sys_stat_cpu_load_rate(double &value)
+{
+  return get_item_value(SYS_STAT_CPU_LOAD_RATE, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_sys_stat_mem_used_rate(double &value)
+{
+  return get_item_value(SYS_STAT_MEM_USED_RATE, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_sys_stat_irq_rate(double &value)
+{
+  return get_item_value(SYS_STAT_IRQ_RATE, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_sys_stat_uptime_rate(double &value)
+{
+  return get_item_value(SYS_STAT_UPTIME_RATE, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_sys_stat_cpu_temp_rate(double &value)
+{
+  return get_item_value(SYS_STAT_CPU_TEMP_RATE, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_sys_stat_cpu_voltage_rate(double &value)
+{
+  return get_item_value(SYS_STAT_CPU_VOLTAGE_RATE, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_sys_stat_cpu_freq_rate(double &value)
+{
+  return get_item_value(SYS_STAT_CPU_FREQ_RATE, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_sys_stat_throttled_rate(double &value)
+{
+  return get_item_value(SYS_STAT_THROTTLED_RATE, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_sys_stat_rpi_backend(string &value)
+{
+  return get_item_value(SYS_STAT_RPI_BACKEND, value);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_sys_stat_rpi_root(string &value)
+{
+  return get_item_value(SYS_STAT_RPI_ROOT, value);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Private member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_cfg_file::set_default_thread_sched(const string &thread_prefix,
+						const string &policy,
+						int priority,
+						int cpu)
+{
+  set_default_item_value((thread_prefix + THREAD_SCHED_SUFFIX).c_str(),
+			 policy, left);
+  set_default_item_value((thread_prefix + THREAD_PRIO_SUFFIX).c_str(),
+			 priority, dec);
+  set_default_item_value((thread_prefix + THREAD_CPU_SUFFIX).c_str(),
+			 cpu, dec);
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_cfg_file::get_thread_sched(const string &thread_prefix,
+					string &policy,
+					int &priority,
+					int &cpu)
+{
+  long rc;
+
+  rc = get_item_value((thread_prefix + THREAD_SCHED_SUFFIX).c_str(), policy);
+  if (rc != CFG_FILE_SUCCESS) {
+    return rc;
+  }
+  rc = get_item_value((thread_prefix + THREAD_PRIO_SUFFIX).c_str(), priority);
+  if (rc != CFG_FILE_SUCCESS) {
+    return rc;
+  }
+  return get_item_value((thread_prefix + THREAD_CPU_SUFFIX).c_str(), cpu);
+}
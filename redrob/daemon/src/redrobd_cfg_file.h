@@ -32,9 +32,57 @@ class redrobd_cfg_file : public cfg_file {
   long get_lock_file(string &value);
   long get_log_file(string &value);
   long get_log_stdout(bool &value);
+  long get_log_format(string &value);
+  long get_log_file_size_kb(int &value);
   long get_supervision_freq(double &value);
   long get_ctrl_thread_freq(double &value);
+  long get_ctrl_event_driven(bool &value);
+  long get_ctrl_cmd_trace(bool &value);
+  long get_steer_cmd_policy(string &value);
+  long get_camera_cmd_policy(string &value);
+  long get_net_udp_steer_port(int &value);
+  long get_net_unix_socket(string &value);
+  long get_net_unix_allow_uid(int &value);
+  long get_ctrl_input_mode(string &value);
+  long get_ctrl_input_file(string &value);
+  long get_ctrl_output_file(string &value);
+  long get_hw_backend(string &value);
+  long get_hw_sim_script(string &value);
+  long get_hw_sim_output(string &value);
   long get_verbose(bool &value);
+  long get_lock_memory(bool &value);
+  long get_thread_stack_kb(int &value);
+  long get_use_task_scheduler(bool &value);
+  long get_ctrl_thread_sched(string &policy, int &priority, int &cpu);
+  long get_bat_mon_thread_sched(string &policy, int &priority, int &cpu);
+  long get_alive_thread_sched(string &policy, int &priority, int &cpu);
+  long get_net_server_thread_sched(string &policy, int &priority, int &cpu);
+  long get_sys_stat_thread_sched(string &policy, int &priority, int &cpu);
+  long get_ctrl_thread_overrun(string &policy);
+  long get_bat_mon_thread_overrun(string &policy);
+  long get_alive_thread_overrun(string &policy);
+  long get_sys_stat_thread_overrun(string &policy);
+  long get_sys_stat_cpu_load_rate(double &value);
+  long get_sys_stat_mem_used_rate(double &value);
+  long get_sys_stat_irq_rate(double &value);
+  long get_sys_stat_uptime_rate(double &value);
+  long get_sys_stat_cpu_temp_rate(double &value);
+  long get_sys_stat_cpu_voltage_rate(double &value);
+  long get_sys_stat_cpu_freq_rate(double &value);
+  long get_sys_stat_throttled_rate(double &value);
+  long get_sys_stat_rpi_backend(string &value);
+  long get_sys_stat_rpi_root(string &value);
+
+ private:
+  void set_default_thread_sched(const string &thread_prefix,
+				const string &policy,
+				int priority,
+				int cpu);
+
+  long get_thread_sched(const string &thread_prefix,
+			string &policy,
+			int &priority,
+			int &cpu);
 };
 
 #endif // __REDROBD_CFG_FILE_H__
@@ -10,6 +10,8 @@
 // ************************************************************************
 
 #include <string.h>
+#include <time.h>
+#include <sstream>
 
 #include "redrobd_core.h"
 #include "redrobd_log.h"
@@ -18,6 +20,9 @@
 #include "redrobd_thread_utility.h"
 #include "redrobd_gpio.h"
 #include "redrobd_led.h"
+#include "redrobd_hw_sim.h"
+#include "delay.h"
+#include "timer.h"
 #include "daemon_utility.h"
 
 /////////////////////////////////////////////////////////////////////////////
@@ -62,6 +67,7 @@ redrobd_core::redrobd_core(void)
 
   m_initialized = false;
   m_led_initialized = false;
+  memset(&m_config, 0, sizeof(m_config));
   pthread_mutex_init(&m_init_mutex, NULL); // Use default mutex attributes
 }
 
@@ -156,10 +162,8 @@ long redrobd_core::check_run_status(void)
 
 /////////////////////////////////////////////////////////////////////////////
 
-long redrobd_core::initialize(string logfile,
-			      bool log_stdout,
-			      double ctrl_thread_frequency,
-			      bool verbose)
+long redrobd_core::initialize(const REDROBD_CONFIG *config,
+			      bool log_stdout)
 {
   try {
     MUTEX_LOCK(m_init_mutex);
@@ -171,17 +175,19 @@ long redrobd_core::initialize(string logfile,
     }
 
     // Check input values
-    if (ctrl_thread_frequency < 0.0) {
+    if (!config) {
+      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_BAD_ARGUMENT,
+		"Illegal configuration (NULL)");
+    }
+    if (config->ctrl_thread_freq < 0.0) {
       THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_BAD_ARGUMENT,
 		"Illegal ctrl thread frequency (%f)",
-		ctrl_thread_frequency);
+		config->ctrl_thread_freq);
     }
 
     // Do the actual initialization
-    internal_initialize(logfile,
-			log_stdout,
-			ctrl_thread_frequency,
-			verbose);
+    internal_initialize(config,
+			log_stdout);
 
     // Initialization completed
     m_initialized = true;
@@ -231,6 +237,50 @@ long redrobd_core::finalize(void)
   }
 }
 
+/////////////////////////////////////////////////////////////////////////////
+
+long redrobd_core::reconfigure(const REDROBD_CONFIG *config,
+			       bool log_stdout,
+			       bool *applied)
+{
+  try {
+    MUTEX_LOCK(m_init_mutex);
+
+    // Check if initialized
+    if (!m_initialized) {
+      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_NOT_INITIALIZED,
+		"Not initialized");
+    }
+
+    // Check input values
+    if ( (!config) || (!applied) ) {
+      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_BAD_ARGUMENT,
+		"Illegal argument (NULL)");
+    }
+    if (config->ctrl_thread_freq < 0.0) {
+      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_BAD_ARGUMENT,
+		"Illegal ctrl thread frequency (%f)",
+		config->ctrl_thread_freq);
+    }
+
+    // Do the actual reconfiguration
+    *applied = internal_reconfigure(config,
+				    log_stdout);
+
+    MUTEX_UNLOCK(m_init_mutex);
+
+    return REDROBD_SUCCESS;
+  }
+  catch (excep &exp) {
+    MUTEX_UNLOCK(m_init_mutex);
+    return set_error(exp);
+  }
+  catch (...) {
+    MUTEX_UNLOCK(m_init_mutex);
+    return set_error(EXP(REDROBD_INTERNAL_ERROR, REDROBD_UNEXPECTED_EXCEPTION, NULL));
+  }
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //               Private member functions
 /////////////////////////////////////////////////////////////////////////////
@@ -360,6 +410,33 @@ long redrobd_core::internal_get_config(REDROBD_CONFIG *config)
     THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
 	      "Unexpected error(%ld) get_log_stdout", rc);
   }
+  string log_format_str;
+  REDROBD_LOG_FORMAT log_format;
+  rc = cfg_f->get_log_format(log_format_str);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_log_format", rc);
+  }
+  if (!get_log_format(log_format_str, &log_format)) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad log format (%s)", log_format_str.c_str());
+  }
+  int log_file_size_kb;
+  rc = cfg_f->get_log_file_size_kb(log_file_size_kb);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_log_file_size_kb", rc);
+  }
+  // Header block and at least two data blocks
+  if ( (log_file_size_kb < 0) ||
+       ( (log_file_size_kb) && (log_file_size_kb < 12) ) ) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad log file size (%d)", log_file_size_kb);
+  }
   double s_freq;
   rc = cfg_f->get_supervision_freq(s_freq);
   if (rc != CFG_FILE_SUCCESS) {
@@ -374,6 +451,138 @@ long redrobd_core::internal_get_config(REDROBD_CONFIG *config)
     THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
 	      "Unexpected error(%ld) get_ctrl_thread_freq", rc);
   }
+  bool event_driven;
+  rc = cfg_f->get_ctrl_event_driven(event_driven);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_ctrl_event_driven", rc);
+  }
+  bool cmd_trace;
+  rc = cfg_f->get_ctrl_cmd_trace(cmd_trace);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_ctrl_cmd_trace", rc);
+  }
+  string cmd_policy;
+  REDROBD_CMD_POLICY steer_cmd_policy;
+  rc = cfg_f->get_steer_cmd_policy(cmd_policy);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_steer_cmd_policy", rc);
+  }
+  if (!get_cmd_policy(cmd_policy, &steer_cmd_policy)) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad steer command policy (%s)", cmd_policy.c_str());
+  }
+  REDROBD_CMD_POLICY camera_cmd_policy;
+  rc = cfg_f->get_camera_cmd_policy(cmd_policy);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_camera_cmd_policy", rc);
+  }
+  if (!get_cmd_policy(cmd_policy, &camera_cmd_policy)) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad camera command policy (%s)", cmd_policy.c_str());
+  }
+  int net_udp_steer_port;
+  rc = cfg_f->get_net_udp_steer_port(net_udp_steer_port);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_net_udp_steer_port", rc);
+  }
+  if ( (net_udp_steer_port < 0) || (net_udp_steer_port > 65535) ) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad UDP steer port (%d)", net_udp_steer_port);
+  }
+  string net_unix_socket;
+  rc = cfg_f->get_net_unix_socket(net_unix_socket);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_net_unix_socket", rc);
+  }
+  if (net_unix_socket == "none") {
+    net_unix_socket = ""; // Disabled
+  }
+  else if (net_unix_socket[0] != '/') {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad unix socket path (%s)", net_unix_socket.c_str());
+  }
+  int net_unix_allow_uid;
+  rc = cfg_f->get_net_unix_allow_uid(net_unix_allow_uid);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_net_unix_allow_uid", rc);
+  }
+  if (net_unix_allow_uid < -1) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad unix socket allowed uid (%d)", net_unix_allow_uid);
+  }
+  string input_mode_str;
+  REDROBD_INPUT_MODE input_mode;
+  rc = cfg_f->get_ctrl_input_mode(input_mode_str);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_ctrl_input_mode", rc);
+  }
+  if (!get_input_mode(input_mode_str, &input_mode)) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad control input mode (%s)", input_mode_str.c_str());
+  }
+  string input_file;
+  rc = cfg_f->get_ctrl_input_file(input_file);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_ctrl_input_file", rc);
+  }
+  string output_file;
+  rc = cfg_f->get_ctrl_output_file(output_file);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_ctrl_output_file", rc);
+  }
+  string hw_backend_str;
+  REDROBD_HW_BACKEND hw_backend;
+  rc = cfg_f->get_hw_backend(hw_backend_str);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_hw_backend", rc);
+  }
+  if (!get_hw_backend(hw_backend_str, &hw_backend)) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad hardware backend (%s)", hw_backend_str.c_str());
+  }
+  string hw_sim_script;
+  rc = cfg_f->get_hw_sim_script(hw_sim_script);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_hw_sim_script", rc);
+  }
+  string hw_sim_output;
+  rc = cfg_f->get_hw_sim_output(hw_sim_output);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_hw_sim_output", rc);
+  }
   bool verbose;
   rc = cfg_f->get_verbose(verbose);
   if (rc != CFG_FILE_SUCCESS) {
@@ -381,6 +590,220 @@ long redrobd_core::internal_get_config(REDROBD_CONFIG *config)
     THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
 	      "Unexpected error(%ld) get_verbose", rc);
   }
+
+  bool lock_memory;
+  rc = cfg_f->get_lock_memory(lock_memory);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_lock_memory", rc);
+  }
+  int thread_stack_kb;
+  rc = cfg_f->get_thread_stack_kb(thread_stack_kb);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_thread_stack_kb", rc);
+  }
+  if (thread_stack_kb < 0) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad thread stack size (%d)", thread_stack_kb);
+  }
+  bool use_task_scheduler;
+  rc = cfg_f->get_use_task_scheduler(use_task_scheduler);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_use_task_scheduler", rc);
+  }
+  string sched_policy;
+  int sched_prio;
+  int sched_cpu;
+  REDROBD_THREAD_SCHED ctrl_thread_sched;
+  rc = cfg_f->get_ctrl_thread_sched(sched_policy, sched_prio, sched_cpu);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_ctrl_thread_sched", rc);
+  }
+  if (!get_thread_sched(sched_policy, sched_prio, sched_cpu,
+			&ctrl_thread_sched)) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad ctrl thread scheduling (%s)", sched_policy.c_str());
+  }
+  REDROBD_THREAD_SCHED bat_mon_thread_sched;
+  rc = cfg_f->get_bat_mon_thread_sched(sched_policy, sched_prio, sched_cpu);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_bat_mon_thread_sched", rc);
+  }
+  if (!get_thread_sched(sched_policy, sched_prio, sched_cpu,
+			&bat_mon_thread_sched)) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad bat_mon thread scheduling (%s)", sched_policy.c_str());
+  }
+  REDROBD_THREAD_SCHED alive_thread_sched;
+  rc = cfg_f->get_alive_thread_sched(sched_policy, sched_prio, sched_cpu);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_alive_thread_sched", rc);
+  }
+  if (!get_thread_sched(sched_policy, sched_prio, sched_cpu,
+			&alive_thread_sched)) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad alive thread scheduling (%s)", sched_policy.c_str());
+  }
+  REDROBD_THREAD_SCHED net_server_thread_sched;
+  rc = cfg_f->get_net_server_thread_sched(sched_policy, sched_prio, sched_cpu);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_net_server_thread_sched", rc);
+  }
+  if (!get_thread_sched(sched_policy, sched_prio, sched_cpu,
+			&net_server_thread_sched)) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad net_server thread scheduling (%s)", sched_policy.c_str());
+  }
+
+  REDROBD_THREAD_SCHED sys_stat_thread_sched;
+  rc = cfg_f->get_sys_stat_thread_sched(sched_policy, sched_prio, sched_cpu);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_sys_stat_thread_sched", rc);
+  }
+  if (!get_thread_sched(sched_policy, sched_prio, sched_cpu,
+			&sys_stat_thread_sched)) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad sys_stat thread scheduling (%s)", sched_policy.c_str());
+  }
+  string overrun_policy;
+  REDROBD_OVERRUN_POLICY ctrl_thread_overrun;
+  rc = cfg_f->get_ctrl_thread_overrun(overrun_policy);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_ctrl_thread_overrun", rc);
+  }
+  if (!get_overrun_policy(overrun_policy, &ctrl_thread_overrun)) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad ctrl thread overrun policy (%s)", overrun_policy.c_str());
+  }
+  REDROBD_OVERRUN_POLICY bat_mon_thread_overrun;
+  rc = cfg_f->get_bat_mon_thread_overrun(overrun_policy);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_bat_mon_thread_overrun", rc);
+  }
+  if (!get_overrun_policy(overrun_policy, &bat_mon_thread_overrun)) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad bat_mon thread overrun policy (%s)", overrun_policy.c_str());
+  }
+  REDROBD_OVERRUN_POLICY alive_thread_overrun;
+  rc = cfg_f->get_alive_thread_overrun(overrun_policy);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_alive_thread_overrun", rc);
+  }
+  if (!get_overrun_policy(overrun_policy, &alive_thread_overrun)) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad alive thread overrun policy (%s)", overrun_policy.c_str());
+  }
+  REDROBD_OVERRUN_POLICY sys_stat_thread_overrun;
+  rc = cfg_f->get_sys_stat_thread_overrun(overrun_policy);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_sys_stat_thread_overrun", rc);
+  }
+  if (!get_overrun_policy(overrun_policy, &sys_stat_thread_overrun)) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad sys_stat thread overrun policy (%s)", overrun_policy.c_str());
+  }
+  REDROBD_SYS_STAT_RATE sys_stat_rate;
+  rc = cfg_f->get_sys_stat_cpu_load_rate(sys_stat_rate.cpu_load);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_sys_stat_cpu_load_rate", rc);
+  }
+  rc = cfg_f->get_sys_stat_mem_used_rate(sys_stat_rate.mem_used);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_sys_stat_mem_used_rate", rc);
+  }
+  rc = cfg_f->get_sys_stat_irq_rate(sys_stat_rate.irq);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_sys_stat_irq_rate", rc);
+  }
+  rc = cfg_f->get_sys_stat_uptime_rate(sys_stat_rate.uptime);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_sys_stat_uptime_rate", rc);
+  }
+  rc = cfg_f->get_sys_stat_cpu_temp_rate(sys_stat_rate.cpu_temp);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_sys_stat_cpu_temp_rate", rc);
+  }
+  rc = cfg_f->get_sys_stat_cpu_voltage_rate(sys_stat_rate.cpu_voltage);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_sys_stat_cpu_voltage_rate", rc);
+  }
+  rc = cfg_f->get_sys_stat_cpu_freq_rate(sys_stat_rate.cpu_freq);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_sys_stat_cpu_freq_rate", rc);
+  }
+  rc = cfg_f->get_sys_stat_throttled_rate(sys_stat_rate.throttled);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_sys_stat_throttled_rate", rc);
+  }
+  string rpi_backend_str;
+  REDROBD_RPI_STAT_BACKEND rpi_backend;
+  rc = cfg_f->get_sys_stat_rpi_backend(rpi_backend_str);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_sys_stat_rpi_backend", rc);
+  }
+  if (!get_rpi_stat_backend(rpi_backend_str, &rpi_backend)) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+	      "Bad sys_stat rpi backend (%s)", rpi_backend_str.c_str());
+  }
+  string rpi_root;
+  rc = cfg_f->get_sys_stat_rpi_root(rpi_root);
+  if (rc != CFG_FILE_SUCCESS) {
+    delete cfg_f;
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_UNEXCPECTED_ERROR,
+	      "Unexpected error(%ld) get_sys_stat_rpi_root", rc);
+  }
   
   // Copy configuration values to caller
   config->daemonize = daemonize;
@@ -389,9 +812,39 @@ long redrobd_core::internal_get_config(REDROBD_CONFIG *config)
   strncpy(config->lock_file, lock_file.c_str(), sizeof(REDROBD_STRING));
   strncpy(config->log_file,  log_file.c_str(),  sizeof(REDROBD_STRING));
   config->log_stdout = log_stdout;
+  config->log_format = log_format;
+  config->log_file_size_kb = (unsigned)log_file_size_kb;
   config->supervision_freq = s_freq;
   config->ctrl_thread_freq = wt_freq;
+  config->ctrl_event_driven = event_driven;
+  config->ctrl_cmd_trace = cmd_trace;
+  config->steer_cmd_policy = steer_cmd_policy;
+  config->camera_cmd_policy = camera_cmd_policy;
+  config->net_udp_steer_port = (unsigned)net_udp_steer_port;
+  strncpy(config->net_unix_socket, net_unix_socket.c_str(), sizeof(REDROBD_STRING));
+  config->net_unix_allow_uid = net_unix_allow_uid;
+  config->ctrl_input_mode = input_mode;
+  strncpy(config->ctrl_input_file,  input_file.c_str(),  sizeof(REDROBD_STRING));
+  strncpy(config->ctrl_output_file, output_file.c_str(), sizeof(REDROBD_STRING));
+  config->hw_backend = hw_backend;
+  strncpy(config->hw_sim_script, hw_sim_script.c_str(), sizeof(REDROBD_STRING));
+  strncpy(config->hw_sim_output, hw_sim_output.c_str(), sizeof(REDROBD_STRING));
   config->verbose = verbose;
+  config->lock_memory = lock_memory;
+  config->thread_stack_kb = (unsigned)thread_stack_kb;
+  config->use_task_scheduler = use_task_scheduler;
+  config->ctrl_thread_sched = ctrl_thread_sched;
+  config->bat_mon_thread_sched = bat_mon_thread_sched;
+  config->alive_thread_sched = alive_thread_sched;
+  config->net_server_thread_sched = net_server_thread_sched;
+  config->sys_stat_thread_sched = sys_stat_thread_sched;
+  config->ctrl_thread_overrun = ctrl_thread_overrun;
+  config->bat_mon_thread_overrun = bat_mon_thread_overrun;
+  config->alive_thread_overrun = alive_thread_overrun;
+  config->sys_stat_thread_overrun = sys_stat_thread_overrun;
+  config->sys_stat_rate = sys_stat_rate;
+  config->sys_stat_rpi_backend = rpi_backend;
+  strncpy(config->sys_stat_rpi_root, rpi_root.c_str(), sizeof(REDROBD_STRING));
   
   delete cfg_f;
 
@@ -424,16 +877,35 @@ void redrobd_core::internal_check_run_status(void)
 
 /////////////////////////////////////////////////////////////////////////////
 
-void redrobd_core::internal_initialize(string logfile,
-				       bool log_stdout,
-				       double ctrl_thread_frequency,
-				       bool verbose)
+void redrobd_core::internal_initialize(const REDROBD_CONFIG *config,
+				       bool log_stdout)
 {
+  // Measure time until ready to drive
+  timer init_timer;
+  if (init_timer.reset() != TIMER_SUCCESS) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_TIME_ERROR,
+	      "Error resetting initialization timer");
+  }
+
+  // Keep configuration for reconfiguration
+  memcpy(&m_config, config, sizeof(m_config));
+
   // Initialize the logfile singleton object
-  redrobd_log_initialize(logfile, log_stdout);
+  redrobd_log_initialize(config->log_file,
+			 log_stdout,
+			 (config->log_format == REDROBD_LOG_BINARY),
+			 config->log_file_size_kb);
+
+  // Initialize simulated hardware
+  // Note! This must be done before initialization of GPIO
+  bool simulated = (config->hw_backend == REDROBD_HW_SIM);
+  if (simulated) {
+    redrobd_hw_sim_initialize(config->hw_sim_script,
+			      config->hw_sim_output);
+  }
 
   // Initialize GPIO
-  redrobd_gpio_initialize();
+  redrobd_gpio_initialize(simulated);
 
   // Initialize LEDs
   // Note! This must be done after initialization of GPIO
@@ -443,11 +915,29 @@ void redrobd_core::internal_initialize(string logfile,
   // Create the cyclic control thread object with garbage collector
   redrobd_ctrl_thread *thread_ptr = 
     new redrobd_ctrl_thread(CTRL_THREAD_NAME,
-			    ctrl_thread_frequency,
-			    verbose);
+			    config);
   m_ctrl_thread_auto =
     auto_ptr<redrobd_ctrl_thread>(thread_ptr);
 
+  // Scheduling and stack size of control thread
+  redrobd_thread_set_sched(thread_ptr,
+			   &config->ctrl_thread_sched,
+			   config->thread_stack_kb);
+
+  // Overrun policy of control thread
+  redrobd_thread_set_overrun(thread_ptr,
+			     config->ctrl_thread_overrun);
+
+  // Control thread woken up by new remote commands
+  if (config->ctrl_event_driven) {
+    long rc = thread_ptr->enable_event_wakeup();
+    if (rc != THREAD_SUCCESS) {
+      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_THREAD_OPERATION_FAILED,
+		"Enable event wakeup failed for thread %s (%ld)",
+		thread_ptr->get_name().c_str(), rc);
+    }
+  }
+
   /////////////////////////////////////
   //  INITIALIZE CONTROL THREAD
   /////////////////////////////////////
@@ -469,6 +959,11 @@ void redrobd_core::internal_initialize(string logfile,
   
   // Give back ownership to auto_ptr
   m_ctrl_thread_auto = auto_ptr<redrobd_ctrl_thread>(thread_ptr);
+
+  ostringstream oss_msg;
+  oss_msg << "Initialized in "
+	  << init_timer.get_elapsed_time() * 1000.0 << " ms";
+  redrobd_log_writeln(oss_msg.str());
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -507,6 +1002,224 @@ void redrobd_core::internal_finalize(void)
   // Finalize GPIO
   redrobd_gpio_finalize(); 
 
+  // Finalize simulated hardware, no effect unless initialized
+  redrobd_hw_sim_finalize();
+
   // Finalize the logfile singleton object
   redrobd_log_finalize();
 }
+
+/////////////////////////////////////////////////////////////////////////////
+
+bool redrobd_core::internal_reconfigure(const REDROBD_CONFIG *config,
+					bool log_stdout)
+{
+  struct timespec t_start;
+  struct timespec t_done;
+
+  if ( clock_gettime(get_clock_id(), &t_start) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+	      "Get start time failed for reconfiguration");
+  }
+
+  // Compare with current configuration, except items that
+  // can be applied while running and items only used at start.
+  // Note! Configuration is compared as memory, padding is
+  //       expected to be the same (see redrobd_get_config).
+  REDROBD_CONFIG cmp_config;
+  memcpy(&cmp_config, config, sizeof(cmp_config));
+
+  cmp_config.daemonize = m_config.daemonize;
+  memcpy(cmp_config.user, m_config.user, sizeof(REDROBD_STRING));
+  memcpy(cmp_config.work_dir, m_config.work_dir, sizeof(REDROBD_STRING));
+  memcpy(cmp_config.lock_file, m_config.lock_file, sizeof(REDROBD_STRING));
+  cmp_config.log_stdout = m_config.log_stdout;
+  cmp_config.lock_memory = m_config.lock_memory;
+
+  memcpy(cmp_config.log_file, m_config.log_file, sizeof(REDROBD_STRING));
+  cmp_config.supervision_freq = m_config.supervision_freq;
+  cmp_config.ctrl_thread_freq = m_config.ctrl_thread_freq;
+  cmp_config.verbose = m_config.verbose;
+
+  if ( memcmp(&cmp_config, &m_config, sizeof(cmp_config)) ) {
+    redrobd_log_writeln("Reconfiguration requires restart");
+    return false;
+  }
+
+  // Switch logfile
+  if ( strncmp(config->log_file, m_config.log_file, sizeof(REDROBD_STRING)) ) {
+    redrobd_log_writeln(string("Switching logfile to ") + config->log_file);
+    redrobd_log_reopen(config->log_file, log_stdout);
+  }
+
+  // Re-time control thread in place
+  m_ctrl_thread_auto->reconfigure(config);
+
+  // Supervision frequency is used by caller
+  memcpy(&m_config, config, sizeof(m_config));
+
+  if ( clock_gettime(get_clock_id(), &t_done) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+	      "Get done time failed for reconfiguration");
+  }
+
+  ostringstream oss_msg;
+  oss_msg << "Reconfigured in "
+	  << get_time_diff(&t_start, &t_done) * 1000.0 << " ms"
+	  << " (ctrl_freq=" << config->ctrl_thread_freq
+	  << ", verbose=" << config->verbose << ")";
+  redrobd_log_writeln(oss_msg.str());
+
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+bool redrobd_core::get_thread_sched(const string &policy,
+				    int priority,
+				    int cpu,
+				    REDROBD_THREAD_SCHED *sched)
+{
+  if (policy == "other") {
+    sched->policy = REDROBD_SCHED_OTHER;
+  }
+  else if (policy == "fifo") {
+    sched->policy = REDROBD_SCHED_FIFO;
+  }
+  else if (policy == "rr") {
+    sched->policy = REDROBD_SCHED_RR;
+  }
+  else {
+    return false;
+  }
+
+  // Range of priority is checked when thread is created
+  sched->priority = priority;
+
+  if (cpu < -1) {
+    return false;
+  }
+  sched->cpu = cpu;
+
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+bool redrobd_core::get_cmd_policy(const string &value,
+				  REDROBD_CMD_POLICY *policy)
+{
+  if (value == "latest") {
+    *policy = REDROBD_CMD_LATEST;
+  }
+  else if (value == "all") {
+    *policy = REDROBD_CMD_ALL;
+  }
+  else {
+    return false;
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+bool redrobd_core::get_overrun_policy(const string &value,
+				      REDROBD_OVERRUN_POLICY *policy)
+{
+  if (value == "catch_up") {
+    *policy = REDROBD_OVERRUN_CATCH_UP;
+  }
+  else if (value == "skip") {
+    *policy = REDROBD_OVERRUN_SKIP;
+  }
+  else if (value == "stretch") {
+    *policy = REDROBD_OVERRUN_STRETCH;
+  }
+  else {
+    return false;
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+bool redrobd_core::get_input_mode(const string &value,
+				  REDROBD_INPUT_MODE *mode)
+{
+  if (value == "normal") {
+    *mode = REDROBD_INPUT_NORMAL;
+  }
+  else if (value == "record") {
+    *mode = REDROBD_INPUT_RECORD;
+  }
+  else if (value == "replay_realtime") {
+    *mode = REDROBD_INPUT_REPLAY_REALTIME;
+  }
+  else if (value == "replay_full") {
+    *mode = REDROBD_INPUT_REPLAY_FULL;
+  }
+  else {
+    return false;
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+bool redrobd_core::get_hw_backend(const string &value,
+				  REDROBD_HW_BACKEND *backend)
+{
+  if (value == "rpi") {
+    *backend = REDROBD_HW_RPI;
+  }
+  else if (value == "sim") {
+    *backend = REDROBD_HW_SIM;
+  }
+  else {
+    return false;
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+bool redrobd_core::get_log_format(const string &value,
+				  REDROBD_LOG_FORMAT *format)
+{
+  if (value == "text") {
+    *format = REDROBD_LOG_TEXT;
+  }
+  else if (value == "binary") {
+    *format = REDROBD_LOG_BINARY;
+  }
+  else {
+    return false;
+  }
+
+  return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
+bool redrobd_core::get_rpi_stat_backend(const string &value,
+					REDROBD_RPI_STAT_BACKEND *backend)
+{
+  if (value == "mailbox") {
+    *backend = REDROBD_RPI_STAT_MAILBOX;
+  }
+  else if (value == "sysfs") {
+    *backend = REDROBD_RPI_STAT_SYSFS;
+  }
+  else if (value == "vcgencmd") {
+    *backend = REDROBD_RPI_STAT_VCGENCMD;
+  }
+  else {
+    return false;
+  }
+
+  return true;
+}
@@ -39,13 +39,15 @@ public:
 
   long check_run_status(void);
 
-  long initialize(string logfile,
-		  bool log_stdout,
-		  double ctrl_thread_frequency,
-		  bool verbose);
+  long initialize(const REDROBD_CONFIG *config,
+		  bool log_stdout);
 
   long finalize(void);
 
+  long reconfigure(const REDROBD_CONFIG *config,
+		   bool log_stdout,
+		   bool *applied);
+
 private:
   // Error handling information
   REDROBD_ERROR_SOURCE  m_error_source;
@@ -58,6 +60,9 @@ private:
   pthread_mutex_t  m_init_mutex;
   bool             m_led_initialized;
 
+  // Configuration currently applied
+  REDROBD_CONFIG   m_config;
+
   // The cyclic control thread object
   auto_ptr<redrobd_ctrl_thread> m_ctrl_thread_auto;
 
@@ -71,12 +76,36 @@ private:
 
   void internal_check_run_status(void);
 
-  void internal_initialize(string logfile,
-			   bool log_stdout,
-			   double ctrl_thread_frequency,
-			   bool verbose);
+  void internal_initialize(const REDROBD_CONFIG *config,
+			   bool log_stdout);
 
   void internal_finalize(void);  
+
+  bool internal_reconfigure(const REDROBD_CONFIG *config,
+			    bool log_stdout);
+
+  bool get_thread_sched(const string &policy,
+			int priority,
+			int cpu,
+			REDROBD_THREAD_SCHED *sched);
+
+  bool get_cmd_policy(const string &value,
+		      REDROBD_CMD_POLICY *policy);
+
+  bool get_overrun_policy(const string &value,
+			  REDROBD_OVERRUN_POLICY *policy);
+
+  bool get_input_mode(const string &value,
+		      REDROBD_INPUT_MODE *mode);
+
+  bool get_hw_backend(const string &value,
+		      REDROBD_HW_BACKEND *backend);
+
+  bool get_log_format(const string &value,
+		      REDROBD_LOG_FORMAT *format);
+
+  bool get_rpi_stat_backend(const string &value,
+			    REDROBD_RPI_STAT_BACKEND *backend);
 };
 
 #endif // __REDROBD_CORE_H__
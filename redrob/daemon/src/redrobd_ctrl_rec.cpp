@@ -0,0 +1,564 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "redrobd_ctrl_rec.h"
+#include "redrobd_error_utility.h"
+#include "daemon_utility.h"
+#include "delay.h"
+#include "excep.h"
+
+// Implementation notes:
+// 1. The control thread only copies each step to a queue, files are
+//    written by a writer thread with lowest priority (SCHED_OTHER,
+//    nice). A slow file (SD card) never delays the control thread.
+//    When recording, a step that does not fit in the queue is lost
+//    and counted. When replaying, the control thread waits for the
+//    writer instead, the output file is then always complete.
+//
+// 2. Inputs are replayed per type in recorded order within each step.
+//    This keeps replay useful when the control logic is changed to
+//    read inputs in another order. An input missing in the recorded
+//    step gets the last replayed value of its type and is counted.
+//
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of macros
+/////////////////////////////////////////////////////////////////////////////
+#define REC_FILE_MAGIC    0x52435252 // 'RRCR'
+#define REC_FILE_VERSION  1
+
+#define REC_FILE_KIND_INPUT   1
+#define REC_FILE_KIND_OUTPUT  2
+
+#define REC_FILE_BUFFER_SIZE  65536 // Bytes
+
+#define WRITER_PERIOD  0.05 // Seconds
+#define WRITER_NICE    19
+
+/////////////////////////////////////////////////////////////////////////////
+//               Public member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+redrobd_ctrl_rec::redrobd_ctrl_rec(REDROBD_INPUT_MODE mode,
+				   string input_file,
+				   string output_file)
+{
+  m_mode        = mode;
+  m_input_file  = input_file;
+  m_output_file = output_file;
+
+  m_input_fp  = NULL;
+  m_output_fp = NULL;
+
+  m_writer_running = false;
+  m_writer_stop    = false;
+
+  init_members();
+}
+
+////////////////////////////////////////////////////////////////
+
+redrobd_ctrl_rec::~redrobd_ctrl_rec(void)
+{
+  // Normally stopped by finalize, files must not be
+  // closed while still written by writer thread
+  if (m_writer_running) {
+    __atomic_store_n(&m_writer_stop, true, __ATOMIC_RELEASE);
+    pthread_join(m_writer, NULL);
+    m_writer_running = false;
+  }
+
+  // Normally closed by finalize
+  if (m_input_fp) {
+    fclose(m_input_fp);
+  }
+  if (m_output_fp) {
+    fclose(m_output_fp);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_rec::initialize(void)
+{
+  init_members();
+
+  if (is_recording()) {
+    m_input_fp = open_file(m_input_file, "wb");
+    write_header(m_input_fp, m_input_file, REC_FILE_KIND_INPUT);
+  }
+  else {
+    m_input_fp = open_file(m_input_file, "rb");
+    read_header(m_input_fp, m_input_file, REC_FILE_KIND_INPUT);
+  }
+
+  m_output_fp = open_file(m_output_file, "wb");
+  write_header(m_output_fp, m_output_file, REC_FILE_KIND_OUTPUT);
+
+  if ( clock_gettime(get_clock_id(), &m_start_time) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+	      "Get start time failed for recording %s",
+	      m_input_file.c_str());
+  }
+
+  start_writer();
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_rec::finalize(void)
+{
+  // Writes all queued steps
+  stop_writer();
+
+  bool write_failed = m_write_failed;
+
+  if (m_input_fp) {
+    if (fclose(m_input_fp)) {
+      write_failed = is_recording();
+    }
+    m_input_fp = NULL;
+  }
+
+  if (m_output_fp) {
+    if (fclose(m_output_fp)) {
+      write_failed = true;
+    }
+    m_output_fp = NULL;
+  }
+
+  // Buffered steps are written when closing
+  if (write_failed) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "Failed to close recording %s or %s",
+	      m_input_file.c_str(), m_output_file.c_str());
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+bool redrobd_ctrl_rec::is_recording(void)
+{
+  return (m_mode == REDROBD_INPUT_RECORD);
+}
+
+////////////////////////////////////////////////////////////////
+
+bool redrobd_ctrl_rec::is_replaying(void)
+{
+  return ( (m_mode == REDROBD_INPUT_REPLAY_REALTIME) ||
+	   (m_mode == REDROBD_INPUT_REPLAY_FULL) );
+}
+
+////////////////////////////////////////////////////////////////
+
+bool redrobd_ctrl_rec::peek_step(uint16_t &step_type,
+				 struct timespec *step_time)
+{
+  if (!m_step_loaded) {
+    if (!read_step()) {
+      return false;
+    }
+  }
+
+  step_type = m_step.type;
+  step_time->tv_sec  = m_step.sec;
+  step_time->tv_nsec = m_step.nsec;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_rec::begin_step(uint16_t step_type)
+{
+  if (is_replaying()) {
+    struct timespec step_time;
+    uint16_t recorded_type;
+
+    if ( (!peek_step(recorded_type, &step_time)) ||
+	 (recorded_type != step_type) ) {
+      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_FILE_OPERATION_FAILED,
+		"Expected step type %u not found in %s, step %u",
+		step_type, m_input_file.c_str(), m_nr_steps);
+    }
+    m_step_loaded = false;
+
+    for (unsigned i=0; i < REDROBD_REC_NR_TYPES; i++) {
+      m_read_pos[i] = 0;
+    }
+  }
+  else {
+    struct timespec now;
+
+    if ( clock_gettime(get_clock_id(), &now) ) {
+      THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+		"Get step time failed for recording %s",
+		m_input_file.c_str());
+    }
+
+    // Time since start of recording
+    if (now.tv_nsec < m_start_time.tv_nsec) {
+      now.tv_sec--;
+      now.tv_nsec += 1000000000;
+    }
+    m_step.type       = step_type;
+    m_step.nr_entries = 0;
+    m_step.sec        = (uint32_t)(now.tv_sec - m_start_time.tv_sec);
+    m_step.nsec       = (uint32_t)(now.tv_nsec - m_start_time.tv_nsec);
+  }
+
+  // Outputs are tagged with the time of the input step
+  m_output_step = m_step;
+  m_output_step.nr_entries = 0;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_rec::end_step(void)
+{
+  if (__atomic_load_n(&m_write_failed, __ATOMIC_ACQUIRE)) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "Writer failed for recording %s or %s",
+	      m_input_file.c_str(), m_output_file.c_str());
+  }
+
+  if (is_recording()) {
+    queue_step(REC_FILE_KIND_INPUT, &m_step, m_step_entry);
+  }
+  queue_step(REC_FILE_KIND_OUTPUT, &m_output_step, m_output_entry);
+
+  m_nr_steps++;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_rec::record_input(uint16_t type,
+				    uint16_t value)
+{
+  if (m_step.nr_entries >= REDROBD_REC_MAX_STEP_ENTRIES) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_BAD_ARGUMENT,
+	      "Too many inputs in step %u for recording %s",
+	      m_nr_steps, m_input_file.c_str());
+  }
+
+  m_step_entry[m_step.nr_entries].type  = type;
+  m_step_entry[m_step.nr_entries].value = value;
+  m_step.nr_entries++;
+}
+
+////////////////////////////////////////////////////////////////
+
+uint16_t redrobd_ctrl_rec::replay_input(uint16_t type)
+{
+  if (type >= REDROBD_REC_NR_TYPES) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_BAD_ARGUMENT,
+	      "Bad input type %u for replay", type);
+  }
+
+  // Next recorded input of this type within step
+  for (unsigned i=m_read_pos[type]; i < m_step.nr_entries; i++) {
+    if (m_step_entry[i].type == type) {
+      m_read_pos[type] = i + 1;
+      m_last_value[type] = m_step_entry[i].value;
+      return m_last_value[type];
+    }
+  }
+  m_read_pos[type] = m_step.nr_entries;
+
+  m_sync_misses++;
+
+  return m_last_value[type];
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_rec::capture_output(uint16_t type,
+				      uint16_t value)
+{
+  if (m_output_step.nr_entries >= REDROBD_REC_MAX_STEP_ENTRIES) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_BAD_ARGUMENT,
+	      "Too many outputs in step %u for recording %s",
+	      m_nr_steps, m_output_file.c_str());
+  }
+
+  m_output_entry[m_output_step.nr_entries].type  = type;
+  m_output_entry[m_output_step.nr_entries].value = value;
+  m_output_step.nr_entries++;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Private member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_rec::init_members(void)
+{
+  m_start_time.tv_sec  = 0;
+  m_start_time.tv_nsec = 0;
+
+  m_step.type       = 0;
+  m_step.nr_entries = 0;
+  m_step.sec        = 0;
+  m_step.nsec       = 0;
+  m_step_loaded = false;
+
+  m_output_step = m_step;
+
+  for (unsigned i=0; i < REDROBD_REC_NR_TYPES; i++) {
+    m_read_pos[i]   = 0;
+    m_last_value[i] = 0;
+  }
+
+  m_nr_steps    = 0;
+  m_sync_misses = 0;
+  m_lost_steps  = 0;
+
+  m_write_failed = false;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_rec::queue_step(uint16_t kind,
+				  const REDROBD_REC_STEP *step,
+				  const REDROBD_REC_ENTRY *entry)
+{
+  m_queued_step.kind    = kind;
+  m_queued_step.step_nr = m_nr_steps;
+  m_queued_step.step    = *step;
+  memcpy(m_queued_step.entry, entry,
+	 step->nr_entries * sizeof(REDROBD_REC_ENTRY));
+
+  while (!m_queue.push(m_queued_step)) {
+    // Recorded step is lost if queue is full,
+    // replay waits for writer thread
+    if ( (!is_replaying()) ||
+	 (__atomic_load_n(&m_write_failed, __ATOMIC_ACQUIRE)) ) {
+      m_lost_steps++;
+      return;
+    }
+    delay(WRITER_PERIOD);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_rec::start_writer(void)
+{
+  if (m_writer_running) {
+    return;
+  }
+
+  m_writer_stop = false;
+
+  // Default attributes, writer lowers its own priority
+  if (pthread_create(&m_writer, NULL, writer_entry, this)) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_THREAD_OPERATION_FAILED,
+	      "pthread_create failed, recording writer");
+  }
+
+  m_writer_running = true;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_rec::stop_writer(void)
+{
+  if (!m_writer_running) {
+    return;
+  }
+
+  // Writer drains queue before it ends
+  __atomic_store_n(&m_writer_stop, true, __ATOMIC_RELEASE);
+
+  m_writer_running = false;
+
+  if (pthread_join(m_writer, NULL)) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_THREAD_OPERATION_FAILED,
+	      "pthread_join failed, recording writer");
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void *redrobd_ctrl_rec::writer_entry(void *p_this)
+{
+  redrobd_ctrl_rec *the_rec = static_cast<redrobd_ctrl_rec *>(p_this);
+  struct sched_param param;
+
+  // Created by control thread, leave its realtime policy
+  // and use lowest priority of normal threads
+  param.sched_priority = 0;
+  pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+  setpriority(PRIO_PROCESS, syscall(SYS_gettid), WRITER_NICE);
+
+  the_rec->writer_loop();
+
+  return NULL;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_rec::writer_loop(void)
+{
+  bool stop;
+
+  do {
+    stop = __atomic_load_n(&m_writer_stop, __ATOMIC_ACQUIRE);
+
+    // Failure is reported by control thread
+    try {
+      drain_queue();
+    }
+    catch (excep &exp) {
+      syslog_error(redrobd_error_syslog_string(exp).c_str());
+      __atomic_store_n(&m_write_failed, true, __ATOMIC_RELEASE);
+      stop = true;
+    }
+    catch (...) {
+      syslog_error("Recording writer failed : unexpected exception");
+      __atomic_store_n(&m_write_failed, true, __ATOMIC_RELEASE);
+      stop = true;
+    }
+
+    if (!stop) {
+      delay(WRITER_PERIOD);
+    }
+  } while (!stop);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_rec::drain_queue(void)
+{
+  REDROBD_REC_QUEUED_STEP queued_step;
+
+  while (m_queue.pop(queued_step)) {
+    if (queued_step.kind == REC_FILE_KIND_INPUT) {
+      write_step(m_input_fp, m_input_file, &queued_step);
+    }
+    else {
+      write_step(m_output_fp, m_output_file, &queued_step);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+FILE* redrobd_ctrl_rec::open_file(const string &file_name,
+				  const char *mode)
+{
+  FILE *fp = fopen(file_name.c_str(), mode);
+  if (fp == NULL) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "Failed to open recording %s", file_name.c_str());
+  }
+
+  if (setvbuf(fp, NULL, _IOFBF, REC_FILE_BUFFER_SIZE)) {
+    fclose(fp);
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "Failed to set buffer for recording %s", file_name.c_str());
+  }
+
+  return fp;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_rec::write_header(FILE *fp,
+				    const string &file_name,
+				    uint16_t kind)
+{
+  REDROBD_REC_FILE_HEADER header;
+
+  header.magic   = REC_FILE_MAGIC;
+  header.version = REC_FILE_VERSION;
+  header.kind    = kind;
+
+  if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "Failed to write header to recording %s", file_name.c_str());
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_rec::read_header(FILE *fp,
+				   const string &file_name,
+				   uint16_t kind)
+{
+  REDROBD_REC_FILE_HEADER header;
+
+  if (fread(&header, sizeof(header), 1, fp) != 1) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "Failed to read header from recording %s", file_name.c_str());
+  }
+
+  if ( (header.magic != REC_FILE_MAGIC) ||
+       (header.version != REC_FILE_VERSION) ||
+       (header.kind != kind) ) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "Bad header in recording %s (magic=0x%x, version=%u, kind=%u)",
+	      file_name.c_str(), header.magic, header.version, header.kind);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_rec::write_step(FILE *fp,
+				  const string &file_name,
+				  const REDROBD_REC_QUEUED_STEP *queued_step)
+{
+  const REDROBD_REC_STEP *step = &queued_step->step;
+
+  if ( (fwrite(step, sizeof(REDROBD_REC_STEP), 1, fp) != 1) ||
+       (fwrite(queued_step->entry, sizeof(REDROBD_REC_ENTRY),
+	       step->nr_entries, fp) != step->nr_entries) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "Failed to write step %u to recording %s",
+	      queued_step->step_nr, file_name.c_str());
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+bool redrobd_ctrl_rec::read_step(void)
+{
+  if (fread(&m_step, sizeof(m_step), 1, m_input_fp) != 1) {
+    if (feof(m_input_fp)) {
+      return false; // No more steps
+    }
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "Failed to read step %u from recording %s",
+	      m_nr_steps, m_input_file.c_str());
+  }
+
+  if ( (m_step.nr_entries > REDROBD_REC_MAX_STEP_ENTRIES) ||
+       (fread(m_step_entry, sizeof(REDROBD_REC_ENTRY),
+	      m_step.nr_entries, m_input_fp) != m_step.nr_entries) ) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "Bad step %u in recording %s",
+	      m_nr_steps, m_input_file.c_str());
+  }
+
+  m_step_loaded = true;
+
+  return true;
+}
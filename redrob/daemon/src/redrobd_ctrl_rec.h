@@ -0,0 +1,210 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#ifndef __REDROBD_CTRL_REC_H__
+#define __REDROBD_CTRL_REC_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <string>
+
+#include "redrobd.h"
+#include "spsc_queue.h"
+
+using namespace std;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of macros
+/////////////////////////////////////////////////////////////////////////////
+
+// Step types, one step for each control thread activation
+#define REDROBD_REC_STEP_SETUP  1
+#define REDROBD_REC_STEP_CYCLE  2
+#define REDROBD_REC_STEP_EVENT  3
+
+// Input entry types
+#define REDROBD_REC_CONT_STEER      1  // DIP-switch continuous steering
+#define REDROBD_REC_SHUTDOWN        2  // DIP-switch shutdown
+#define REDROBD_REC_BAT_CHECK       3  // Battery check allowed
+#define REDROBD_REC_VBAT            4  // Battery voltage (mV)
+#define REDROBD_REC_RF_STEER        5  // RF steer pins
+#define REDROBD_REC_RF_ACTIVE       6
+#define REDROBD_REC_NET_STEER       7  // NET steer code
+#define REDROBD_REC_NET_ACTIVE      8
+#define REDROBD_REC_STEER_PENDING   9
+#define REDROBD_REC_CAMERA_CODE     10 // NET camera code
+#define REDROBD_REC_CAMERA_PENDING  11
+
+// Output entry types
+#define REDROBD_REC_MOTOR        12 // Motor control code
+#define REDROBD_REC_CAMERA       13 // Camera control code
+#define REDROBD_REC_LED_BAT_LOW  14
+
+#define REDROBD_REC_NR_TYPES  15
+
+// Max number of entries in one step
+#define REDROBD_REC_MAX_STEP_ENTRIES  256
+
+// Steps from control thread to writer thread, input and output
+// steps are queued separately (power of two)
+#define REDROBD_REC_QUEUE_SIZE  256
+
+/////////////////////////////////////////////////////////////////////////////
+//               Class support types
+/////////////////////////////////////////////////////////////////////////////
+
+// File format (native byte order):
+// REDROBD_REC_FILE_HEADER followed by any number of steps.
+// Each step is a REDROBD_REC_STEP followed by 'nr_entries'
+// REDROBD_REC_ENTRY. Input and output files use the same format,
+// steps in output file have the time of the input step.
+
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t kind;    // Input or output file
+} __attribute__((packed)) REDROBD_REC_FILE_HEADER;
+
+typedef struct {
+  uint16_t type;       // REDROBD_REC_STEP_xxx
+  uint16_t nr_entries; // Number of entries following
+  uint32_t sec;        // Monotonic time since start of recording
+  uint32_t nsec;
+} __attribute__((packed)) REDROBD_REC_STEP;
+
+typedef struct {
+  uint16_t type;  // REDROBD_REC_xxx
+  uint16_t value;
+} __attribute__((packed)) REDROBD_REC_ENTRY;
+
+// Step queued for writer thread, not part of file format
+typedef struct {
+  uint16_t          kind;    // Input or output file
+  unsigned          step_nr;
+  REDROBD_REC_STEP  step;
+  REDROBD_REC_ENTRY entry[REDROBD_REC_MAX_STEP_ENTRIES];
+} REDROBD_REC_QUEUED_STEP;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of classes
+/////////////////////////////////////////////////////////////////////////////
+
+class redrobd_ctrl_rec {
+
+ public:
+  redrobd_ctrl_rec(REDROBD_INPUT_MODE mode,
+		   string input_file,
+		   string output_file);
+
+  ~redrobd_ctrl_rec(void);
+
+  void initialize(void);
+  void finalize(void);
+
+  bool is_recording(void);
+  bool is_replaying(void);
+
+  // Replay only, loads next step if not already loaded.
+  // Returns false when no more steps.
+  bool peek_step(uint16_t &step_type,
+		 struct timespec *step_time);
+
+  void begin_step(uint16_t step_type);
+  void end_step(void);
+
+  void record_input(uint16_t type,
+		    uint16_t value);
+
+  uint16_t replay_input(uint16_t type);
+
+  void capture_output(uint16_t type,
+		      uint16_t value);
+
+  unsigned get_nr_steps(void) {return m_nr_steps;}
+
+  // Replayed inputs not found in recorded step
+  unsigned get_sync_misses(void) {return m_sync_misses;}
+
+  // Recorded steps not written, writer thread did not keep up
+  unsigned get_lost_steps(void) {return m_lost_steps;}
+
+ private:
+  REDROBD_INPUT_MODE m_mode;
+  string             m_input_file;
+  string             m_output_file;
+
+  FILE *m_input_fp;
+  FILE *m_output_fp;
+
+  // Start of recording
+  struct timespec m_start_time;
+
+  // Current step
+  REDROBD_REC_STEP  m_step;
+  REDROBD_REC_ENTRY m_step_entry[REDROBD_REC_MAX_STEP_ENTRIES];
+  bool              m_step_loaded;
+
+  // Outputs of current step
+  REDROBD_REC_STEP  m_output_step;
+  REDROBD_REC_ENTRY m_output_entry[REDROBD_REC_MAX_STEP_ENTRIES];
+
+  // Replay position of each input type within current step,
+  // last replayed value is used when a step lacks an input.
+  unsigned m_read_pos[REDROBD_REC_NR_TYPES];
+  uint16_t m_last_value[REDROBD_REC_NR_TYPES];
+
+  unsigned m_nr_steps;
+  unsigned m_sync_misses;
+  unsigned m_lost_steps;
+
+  // Steps to writer thread
+  spsc_queue<REDROBD_REC_QUEUED_STEP, REDROBD_REC_QUEUE_SIZE> m_queue;
+  REDROBD_REC_QUEUED_STEP m_queued_step; // Push buffer
+
+  pthread_t m_writer;
+  bool      m_writer_running;
+  bool      m_writer_stop;
+  bool      m_write_failed; // Set by writer thread
+
+  void init_members(void);
+
+  void queue_step(uint16_t kind,
+		  const REDROBD_REC_STEP *step,
+		  const REDROBD_REC_ENTRY *entry);
+
+  void start_writer(void);
+  void stop_writer(void);
+
+  static void *writer_entry(void *p_this);
+  void writer_loop(void);
+  void drain_queue(void);
+
+  FILE *open_file(const string &file_name,
+		  const char *mode);
+
+  void write_header(FILE *fp,
+		    const string &file_name,
+		    uint16_t kind);
+
+  void read_header(FILE *fp,
+		   const string &file_name,
+		   uint16_t kind);
+
+  void write_step(FILE *fp,
+		  const string &file_name,
+		  const REDROBD_REC_QUEUED_STEP *queued_step);
+
+  bool read_step(void);
+};
+
+#endif // __REDROBD_CTRL_REC_H__
@@ -9,6 +9,7 @@
 // *                                                                      *
 // ************************************************************************
 
+#include <strings.h>
 #include <sstream>
 #include <iomanip>
 
@@ -18,6 +19,7 @@
 #include "redrobd_error_utility.h"
 #include "redrobd_thread_utility.h"
 #include "redrobd_led.h"
+#include "delay.h"
 #include "rpi_hw.h"
 #include "daemon_utility.h"
 #include "excep.h"
@@ -42,7 +44,26 @@
 
 #define BAT_MIN_ALLOWED_VOLTAGE  6.9 // Volt
 
-#define SYS_STAT_CHECK_FREQUENCY  1.0 // Hz
+#define TASK_SCHED_THREAD_NAME             "REDROBD_TASK_SCHED"
+#define TASK_SCHED_THREAD_START_TIMEOUT    1.0 // Seconds
+#define TASK_SCHED_THREAD_EXECUTE_TIMEOUT  0.5 // Seconds
+#define TASK_SCHED_THREAD_STOP_TIMEOUT     1.5 // Seconds
+                                               // Longest task period +
+                                               // one extra second
+
+#define BAT_MON_TASK_PRIO   2   // Executed first when due at same time
+#define BAT_MON_TASK_PHASE  0.0 // Seconds
+#define ALIVE_TASK_PRIO     1
+#define ALIVE_TASK_PHASE    0.125 // Seconds, half battery monitor period
+
+#define SYS_STAT_THREAD_NAME             "REDROBD_SYS_STAT"
+#define SYS_STAT_THREAD_START_TIMEOUT    1.0 // Seconds
+#define SYS_STAT_THREAD_EXECUTE_TIMEOUT  0.5 // Seconds
+#define SYS_STAT_THREAD_STOP_TIMEOUT     2.5 // Seconds
+                                             // Longest period time (1s) +
+                                             // slow shell commands + one second
+
+#define THREAD_STAT_LOG_INTERVAL  60.0 // Seconds
 
 #define RC_NET_SERVER_IP    ANY_IP_ADDRESS
 #define RC_NET_SERVER_PORT  52022
@@ -55,11 +76,11 @@
 
 redrobd_ctrl_thread::
 redrobd_ctrl_thread(string thread_name,
-		    double frequency,
-		    bool verbose) : cyclic_thread(thread_name,
-						  frequency)
+		    const REDROBD_CONFIG *config) : cyclic_thread(thread_name,
+								  config->ctrl_thread_freq)
 {
-  m_verbose = verbose;
+  m_config = *config;
+  m_verbose = config->verbose;
 
   init_members();
 }
@@ -68,7 +89,17 @@ redrobd_ctrl_thread(string thread_name,
 
 redrobd_ctrl_thread::~redrobd_ctrl_thread(void)
 {
-  delete m_mcp3008_io_ptr;
+  delete m_adc_io_ptr;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::reconfigure(const REDROBD_CONFIG *config)
+{
+  // Applied by this thread at next cycle
+  set_frequency(config->ctrl_thread_freq);
+
+  __atomic_store_n(&m_verbose, config->verbose, __ATOMIC_RELAXED);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -84,8 +115,33 @@ long redrobd_ctrl_thread::setup(void)
 
     init_members();
 
+    // Start timer measuring each startup step
+    if (m_startup_timer.reset() != TIMER_SUCCESS) {
+      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_TIME_ERROR,
+		"Error resetting startup timer for thread %s",
+		get_name().c_str());      
+    }
+
+    // Startup dependencies:
+    //
+    //   Subsystem             Depends on
+    //   alive thread          -
+    //   system stats thread   -
+    //   rc net server thread  -
+    //   A/D Converter         -
+    //   HW configuration      A/D Converter
+    //   rc RF, camera         -
+    //   input record/replay   -
+    //   motor control         HW configuration, input record/replay
+    //   battery monitor       A/D Converter
+    //   task scheduler        alive and battery monitor objects
+    //
+    // Threads are started first and do their setup concurrently
+    // while remaining subsystems are initialized. All threads are
+    // waited for at the end.
+
     /////////////////////////////////
-    //  INITIALIZE ALIVE THREAD
+    //  START ALIVE THREAD
     /////////////////////////////////
 
     // Create the cyclic alive thread object with garbage collector
@@ -94,36 +150,114 @@ long redrobd_ctrl_thread::setup(void)
 			       ALIVE_THREAD_FREQUENCY);    
     m_alive_thread_auto =
       auto_ptr<redrobd_alive_thread>(thread_ptr1);
+
+    // Scheduling and stack size of alive thread
+    redrobd_thread_set_sched(thread_ptr1,
+			     &m_config.alive_thread_sched,
+			     m_config.thread_stack_kb);
+    redrobd_thread_set_overrun(thread_ptr1,
+			       m_config.alive_thread_overrun);
+
+    // Executed by task scheduler, started together with battery monitor
+    if (!m_config.use_task_scheduler) {
+      redrobd_log_writeln("About to initialize alive thread");
+
+      // Take back ownership from auto_ptr
+      thread_ptr1 = m_alive_thread_auto.release();
     
-    redrobd_log_writeln("About to initialize alive thread");
+      try {
+	// Start cyclic alive thread object
+	redrobd_thread_start((thread *)thread_ptr1);
+      }
+      catch (...) {
+	m_alive_thread_auto = auto_ptr<redrobd_alive_thread>(thread_ptr1);
+	throw;
+      }
+
+      // Give back ownership to auto_ptr
+      m_alive_thread_auto = auto_ptr<redrobd_alive_thread>(thread_ptr1);
+    }
+
+    ///////////////////////////////////////
+    //  START system stats collector
+    ///////////////////////////////////////
+
+    // Create the cyclic system stats thread object with garbage collector
+    redrobd_sys_stat_thread *thread_ptr3 =
+      new redrobd_sys_stat_thread(SYS_STAT_THREAD_NAME,
+				  &m_config.sys_stat_rate,
+				  m_config.sys_stat_rpi_backend,
+				  m_config.sys_stat_rpi_root);
+    m_sys_stat_thread_auto =
+      auto_ptr<redrobd_sys_stat_thread>(thread_ptr3);
+
+    // Scheduling and stack size of system stats thread
+    redrobd_thread_set_sched(thread_ptr3,
+			     &m_config.sys_stat_thread_sched,
+			     m_config.thread_stack_kb);
+    redrobd_thread_set_overrun(thread_ptr3,
+			       m_config.sys_stat_thread_overrun);
+
+    redrobd_log_writeln("About to initialize system stats thread");
 
     // Take back ownership from auto_ptr
-    thread_ptr1 = m_alive_thread_auto.release();
-    
+    thread_ptr3 = m_sys_stat_thread_auto.release();
+
     try {
-       // Initialize cyclic alive thread object
-      redrobd_thread_initialize((thread *)thread_ptr1,
-				ALIVE_THREAD_START_TIMEOUT,
-				ALIVE_THREAD_EXECUTE_TIMEOUT);
+      // Start cyclic system stats thread object
+      redrobd_thread_start((thread *)thread_ptr3);
     }
     catch (...) {
-      m_alive_thread_auto = auto_ptr<redrobd_alive_thread>(thread_ptr1);
+      m_sys_stat_thread_auto =
+	auto_ptr<redrobd_sys_stat_thread>(thread_ptr3);
       throw;
     }
 
     // Give back ownership to auto_ptr
-    m_alive_thread_auto = auto_ptr<redrobd_alive_thread>(thread_ptr1);
+    m_sys_stat_thread_auto =
+      auto_ptr<redrobd_sys_stat_thread>(thread_ptr3);
+
+    /////////////////////////////////
+    //  START remote control (NET)
+    /////////////////////////////////
+
+    // Create the remote control object with garbage collector (NET, Sockets)
+    redrobd_rc_net *rc_net_ptr =
+      new redrobd_rc_net(RC_NET_SERVER_IP,    // Server local IP address
+			 RC_NET_SERVER_PORT,  // Server local port
+			 m_config.net_udp_steer_port,
+			 m_config.net_unix_socket,
+			 m_config.net_unix_allow_uid,
+			 &m_config.net_server_thread_sched,
+			 m_config.thread_stack_kb,
+			 this, // Signalled on new commands
+			 m_config.steer_cmd_policy,
+			 m_config.camera_cmd_policy);
+
+    m_rc_net_auto = auto_ptr<redrobd_rc_net>(rc_net_ptr);
+
+    // Start remote control server thread (NET, Sockets)
+    m_rc_net_auto->initialize_begin();
+
+    startup_step("threads started");
 
     /////////////////////////////////
     //  INITIALIZE A/D Converter
     /////////////////////////////////
 
     // Create the A/D Converter object
-    m_mcp3008_io_ptr = new mcp3008_io(MCP3008_SPI_DEV,
-				      MCP3008_REF_VOLTAGE);
+    if (m_config.hw_backend == REDROBD_HW_SIM) {
+      m_adc_io_ptr = new redrobd_sim_adc(MCP3008_REF_VOLTAGE);
+    }
+    else {
+      m_adc_io_ptr = new mcp3008_io(MCP3008_SPI_DEV,
+				    MCP3008_REF_VOLTAGE);
+    }
     
     // Initialize A/D Converter
-    m_mcp3008_io_ptr->initialize(MCP3008_SPI_SPEED);
+    m_adc_io_ptr->initialize(MCP3008_SPI_SPEED);
+
+    startup_step("A/D converter");
     
     /////////////////////////////////
     //  INITIALIZE HW configuration
@@ -131,15 +265,17 @@ long redrobd_ctrl_thread::setup(void)
 
     // Create the hardware configuration object object with garbage collector
     redrobd_hw_cfg *redrobd_hw_cfg_ptr =
-      new redrobd_hw_cfg(m_mcp3008_io_ptr,
-			 (MCP3008_IO_CHANNEL)MCP3008_CHN_SHUTDOWN,
-			 (MCP3008_IO_CHANNEL)MCP3008_CHN_CONT_STEER);
+      new redrobd_hw_cfg(m_adc_io_ptr,
+			 (ADC_IO_CHANNEL)MCP3008_CHN_SHUTDOWN,
+			 (ADC_IO_CHANNEL)MCP3008_CHN_CONT_STEER);
 
     m_hw_cfg_auto = auto_ptr<redrobd_hw_cfg>(redrobd_hw_cfg_ptr);
 
     // Initialize hardware configuration
     m_hw_cfg_auto->initialize();
 
+    startup_step("HW configuration");
+
     /////////////////////////////////
     //  INITIALIZE remote control
     /////////////////////////////////
@@ -156,16 +292,7 @@ long redrobd_ctrl_thread::setup(void)
     // Initialize remote control (RF, Radio)
     m_rc_rf_auto->initialize();
 
-    // Create the remote control object with garbage collector (NET, Sockets)
-    redrobd_rc_net *rc_net_ptr =
-      new redrobd_rc_net(RC_NET_SERVER_IP,    // Server local IP address
-			 RC_NET_SERVER_PORT); // Server local port
-
-    m_rc_net_auto = auto_ptr<redrobd_rc_net>(rc_net_ptr);
-
-    // Initialize remote control (NET, Sockets)
-    m_rc_net_auto->initialize();
-    m_rc_net_auto->set_voltage(0.0);
+    startup_step("remote control RF");
 
     /////////////////////////////////
     //  INITIALIZE camera control
@@ -177,13 +304,45 @@ long redrobd_ctrl_thread::setup(void)
 
     // Initialize camera control
     m_cc_auto->initialize();
+
+    startup_step("camera control");
     
+    //////////////////////////////////////
+    //  INITIALIZE input record/replay
+    //////////////////////////////////////
+
+    if (m_config.ctrl_input_mode != REDROBD_INPUT_NORMAL) {
+      // Create the record/replay object with garbage collector
+      redrobd_ctrl_rec *ctrl_rec_ptr =
+	new redrobd_ctrl_rec(m_config.ctrl_input_mode,
+			     m_config.ctrl_input_file,
+			     m_config.ctrl_output_file);
+
+      m_ctrl_rec_auto = auto_ptr<redrobd_ctrl_rec>(ctrl_rec_ptr);
+
+      // Open files for record/replay
+      m_ctrl_rec_auto->initialize();
+
+      if (m_ctrl_rec_auto->is_replaying()) {
+	redrobd_log_writeln(get_name() + " : Replay inputs from " +
+			    m_config.ctrl_input_file);
+      }
+      else {
+	redrobd_log_writeln(get_name() + " : Record inputs to " +
+			    m_config.ctrl_input_file);
+      }
+
+      startup_step("input record/replay");
+    }
+
     /////////////////////////////////
     //  INITIALIZE motor control
     /////////////////////////////////
 
     // Check if continuous steering was selected (DIP-switch)
-    m_cont_steering = m_hw_cfg_auto->select_continuous_steering();
+    begin_rec_step(REDROBD_REC_STEP_SETUP);
+    m_cont_steering = get_input(REDROBD_REC_CONT_STEER);
+    end_rec_step();
     if (m_cont_steering) {
       redrobd_log_writeln(get_name() + " : Continuous steering selected");      
     }
@@ -219,40 +378,119 @@ long redrobd_ctrl_thread::setup(void)
       m_mc_non_cont_steer_auto->initialize();
     }
 
+    // Motor pin writes end the steer command trace
+    if (m_config.ctrl_cmd_trace) {
+      get_motor_ctrl()->set_trace(true);
+    }
+
+    startup_step("motor control");
+
     /////////////////////////////////
-    //  INITIALIZE battery monitor
+    //  START battery monitor
     /////////////////////////////////
 
     // Create the cyclic battery monitor thread object with garbage collector
     redrobd_voltage_monitor_thread *thread_ptr2 =
       new redrobd_voltage_monitor_thread(BAT_MON_THREAD_NAME,
 					 BAT_MON_THREAD_FREQUENCY,
-					 m_mcp3008_io_ptr,
-					 (MCP3008_IO_CHANNEL)MCP3008_CHN_VBAT,
+					 m_adc_io_ptr,
+					 (ADC_IO_CHANNEL)MCP3008_CHN_VBAT,
 					 MCP3008_CHN_VBAT_SF);    
     m_bat_mon_thread_auto =
       auto_ptr<redrobd_voltage_monitor_thread>(thread_ptr2);
 
-    redrobd_log_writeln("About to initialize battery monitor thread");
+    // Scheduling and stack size of battery monitor thread
+    redrobd_thread_set_sched(thread_ptr2,
+			     &m_config.bat_mon_thread_sched,
+			     m_config.thread_stack_kb);
+    redrobd_thread_set_overrun(thread_ptr2,
+			       m_config.bat_mon_thread_overrun);
 
-    // Take back ownership from auto_ptr
-    thread_ptr2 = m_bat_mon_thread_auto.release();
-    
-    try {
-      // Initialize cyclic battery monitor thread object
-      redrobd_thread_initialize((thread *)thread_ptr2,
-				BAT_MON_THREAD_START_TIMEOUT,
-				BAT_MON_THREAD_EXECUTE_TIMEOUT);
+    if (m_config.use_task_scheduler) {
+      // Alive and battery monitor executed by one thread
+      start_task_scheduler();
     }
-    catch (...) {
+    else {
+      redrobd_log_writeln("About to initialize battery monitor thread");
+
+      // Take back ownership from auto_ptr
+      thread_ptr2 = m_bat_mon_thread_auto.release();
+    
+      try {
+	// Start cyclic battery monitor thread object
+	redrobd_thread_start((thread *)thread_ptr2);
+      }
+      catch (...) {
+	m_bat_mon_thread_auto =
+	  auto_ptr<redrobd_voltage_monitor_thread>(thread_ptr2);
+	throw;
+      }
+    
+      // Give back ownership to auto_ptr
       m_bat_mon_thread_auto =
 	auto_ptr<redrobd_voltage_monitor_thread>(thread_ptr2);
-      throw;
     }
+
+    /////////////////////////////////
+    //  WAIT for started threads
+    /////////////////////////////////
+
+    // Remote control (NET, Sockets)
+    m_rc_net_auto->initialize_end();
+    m_rc_net_auto->set_voltage(0.0);
+
+    startup_step("remote control NET");
+
+    // Alive
+    if (!m_config.use_task_scheduler) {
+      // Take back ownership from auto_ptr
+      thread_ptr1 = m_alive_thread_auto.release();
     
-    // Give back ownership to auto_ptr
-    m_bat_mon_thread_auto =
-      auto_ptr<redrobd_voltage_monitor_thread>(thread_ptr2);
+      try {
+	// Wait for cyclic alive thread object to execute
+	redrobd_thread_wait_started((thread *)thread_ptr1,
+				    ALIVE_THREAD_START_TIMEOUT,
+				    ALIVE_THREAD_EXECUTE_TIMEOUT);
+      }
+      catch (...) {
+	m_alive_thread_auto = auto_ptr<redrobd_alive_thread>(thread_ptr1);
+	throw;
+      }
+
+      // Give back ownership to auto_ptr
+      m_alive_thread_auto = auto_ptr<redrobd_alive_thread>(thread_ptr1);
+
+      startup_step("alive thread");
+    }
+
+    // Battery monitor
+    if (m_config.use_task_scheduler) {
+      wait_task_scheduler_started();
+
+      startup_step("task scheduler");
+    }
+    else {
+      // Take back ownership from auto_ptr
+      thread_ptr2 = m_bat_mon_thread_auto.release();
+    
+      try {
+	// Wait for cyclic battery monitor thread object to execute
+	redrobd_thread_wait_started((thread *)thread_ptr2,
+				    BAT_MON_THREAD_START_TIMEOUT,
+				    BAT_MON_THREAD_EXECUTE_TIMEOUT);
+      }
+      catch (...) {
+	m_bat_mon_thread_auto =
+	  auto_ptr<redrobd_voltage_monitor_thread>(thread_ptr2);
+	throw;
+      }
+    
+      // Give back ownership to auto_ptr
+      m_bat_mon_thread_auto =
+	auto_ptr<redrobd_voltage_monitor_thread>(thread_ptr2);
+
+      startup_step("battery monitor thread");
+    }
 
     // Start timer controlling when to check battery
     if (m_battery_check_timer.reset() != TIMER_SUCCESS) {
@@ -261,14 +499,39 @@ long redrobd_ctrl_thread::setup(void)
 		get_name().c_str());      
     }
 
-    // Start timer controlling when to check system stats
-    if (m_sys_stat_check_timer.reset() != TIMER_SUCCESS) {
+    // System stats collector
+    // Take back ownership from auto_ptr
+    thread_ptr3 = m_sys_stat_thread_auto.release();
+
+    try {
+      // Wait for cyclic system stats thread object to execute
+      redrobd_thread_wait_started((thread *)thread_ptr3,
+				  SYS_STAT_THREAD_START_TIMEOUT,
+				  SYS_STAT_THREAD_EXECUTE_TIMEOUT);
+    }
+    catch (...) {
+      m_sys_stat_thread_auto =
+	auto_ptr<redrobd_sys_stat_thread>(thread_ptr3);
+      throw;
+    }
+
+    // Give back ownership to auto_ptr
+    m_sys_stat_thread_auto =
+      auto_ptr<redrobd_sys_stat_thread>(thread_ptr3);
+
+    startup_step("system stats thread");
+
+    // Start timer controlling when to log thread statistics
+    if (m_thread_stat_log_timer.reset() != TIMER_SUCCESS) {
       THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_TIME_ERROR,
-		"Error resetting system stats check timer for thread %s",
+		"Error resetting thread stats log timer for thread %s",
 		get_name().c_str());      
     }
 
-    redrobd_log_writeln(get_name() + " : setup done");
+    ostringstream oss_msg;
+    oss_msg << get_name() << " : setup done in "
+	    << m_startup_timer.get_elapsed_time() * 1000.0 << " ms";
+    redrobd_log_writeln(oss_msg.str());
 
     return THREAD_SUCCESS;    
   }
@@ -289,29 +552,71 @@ long redrobd_ctrl_thread::cleanup(void)
   try {
     redrobd_log_writeln(get_name() + " : cleanup started");
 
+    // Final cycle timing statistics
+    log_thread_stats();
+
+    // Pending repeated and suppressed messages
+    m_log_steer.flush();
+    m_log_remote.flush();
+    m_log_camera.flush();
+    m_log_overrun.flush();
+
     ////////////////////////////////////////
-    //  FINALIZE battery monitor
+    //  FINALIZE system stats collector
     ////////////////////////////////////////
-    redrobd_log_writeln("About to finalize battery monitor thread");
+    redrobd_log_writeln("About to finalize system stats thread");
 
     // Take back ownership from auto_ptr
-    redrobd_voltage_monitor_thread *thread_ptr2 =
-      m_bat_mon_thread_auto.release();
-    
+    redrobd_sys_stat_thread *thread_ptr3 =
+      m_sys_stat_thread_auto.release();
+
     try {
-      // Finalize the cyclic battery monitor thread object
-      redrobd_thread_finalize((thread *)thread_ptr2,
-			      BAT_MON_THREAD_STOP_TIMEOUT);
+      // Finalize the cyclic system stats thread object
+      redrobd_thread_finalize((thread *)thread_ptr3,
+			      SYS_STAT_THREAD_STOP_TIMEOUT);
     }
     catch (...) {
-      m_bat_mon_thread_auto =
-	auto_ptr<redrobd_voltage_monitor_thread>(thread_ptr2);
+      m_sys_stat_thread_auto =
+	auto_ptr<redrobd_sys_stat_thread>(thread_ptr3);
       throw;
     }
-    
+
     // Give back ownership to auto_ptr
-    m_bat_mon_thread_auto =
-      auto_ptr<redrobd_voltage_monitor_thread>(thread_ptr2);
+    m_sys_stat_thread_auto =
+      auto_ptr<redrobd_sys_stat_thread>(thread_ptr3);
+
+    // Delete the cyclic system stats thread object
+    m_sys_stat_thread_auto.reset();
+
+    ////////////////////////////////////////
+    //  FINALIZE battery monitor
+    ////////////////////////////////////////
+    if (m_config.use_task_scheduler) {
+      // Alive and battery monitor tasks are cleaned up here
+      finalize_task_scheduler();
+    }
+    else {
+      redrobd_log_writeln("About to finalize battery monitor thread");
+
+      // Take back ownership from auto_ptr
+      redrobd_voltage_monitor_thread *thread_ptr2 =
+	m_bat_mon_thread_auto.release();
+    
+      try {
+	// Finalize the cyclic battery monitor thread object
+	redrobd_thread_finalize((thread *)thread_ptr2,
+				BAT_MON_THREAD_STOP_TIMEOUT);
+      }
+      catch (...) {
+	m_bat_mon_thread_auto =
+	  auto_ptr<redrobd_voltage_monitor_thread>(thread_ptr2);
+	throw;
+      }
+    
+      // Give back ownership to auto_ptr
+      m_bat_mon_thread_auto =
+	auto_ptr<redrobd_voltage_monitor_thread>(thread_ptr2);
+    }
 
     // Delete the cyclic battery monitor thread object
     m_bat_mon_thread_auto.reset();
@@ -330,6 +635,25 @@ long redrobd_ctrl_thread::cleanup(void)
       m_mc_non_cont_steer_auto.reset();
     }
 
+    ////////////////////////////////////////
+    //  FINALIZE input record/replay
+    ////////////////////////////////////////
+
+    // Finalize and delete the record/replay object
+    if (m_ctrl_rec_auto.get()) {
+      m_ctrl_rec_auto->finalize();
+
+      if (m_ctrl_rec_auto->is_recording()) {
+	ostringstream oss_msg;
+	oss_msg << get_name() << " : Record done"
+		<< ", steps=" << m_ctrl_rec_auto->get_nr_steps()
+		<< ", lost_steps=" << m_ctrl_rec_auto->get_lost_steps();
+	redrobd_log_writeln(oss_msg.str());
+      }
+
+      m_ctrl_rec_auto.reset();
+    }
+
     ////////////////////////////////////////
     //  FINALIZE camera control
     ////////////////////////////////////////
@@ -363,30 +687,32 @@ long redrobd_ctrl_thread::cleanup(void)
     ////////////////////////////////////////
 
     // Finalize and delete A/D Converter
-    m_mcp3008_io_ptr->finalize();
-    delete m_mcp3008_io_ptr;
-    m_mcp3008_io_ptr = NULL;
+    m_adc_io_ptr->finalize();
+    delete m_adc_io_ptr;
+    m_adc_io_ptr = NULL;
 
     /////////////////////////////////
     //  FINALIZE ALIVE THREAD
     /////////////////////////////////
-    redrobd_log_writeln("About to finalize alive thread");
+    if (!m_config.use_task_scheduler) {
+      redrobd_log_writeln("About to finalize alive thread");
 
-    // Take back ownership from auto_ptr
-    redrobd_alive_thread *thread_ptr1 = m_alive_thread_auto.release();
+      // Take back ownership from auto_ptr
+      redrobd_alive_thread *thread_ptr1 = m_alive_thread_auto.release();
     
-    try {
-      // Finalize the cyclic alive thread object
-      redrobd_thread_finalize((thread *)thread_ptr1,
-			      ALIVE_THREAD_STOP_TIMEOUT);
-    }
-    catch (...) {
+      try {
+	// Finalize the cyclic alive thread object
+	redrobd_thread_finalize((thread *)thread_ptr1,
+				ALIVE_THREAD_STOP_TIMEOUT);
+      }
+      catch (...) {
+	m_alive_thread_auto = auto_ptr<redrobd_alive_thread>(thread_ptr1);
+	throw;
+      }
+
+      // Give back ownership to auto_ptr
       m_alive_thread_auto = auto_ptr<redrobd_alive_thread>(thread_ptr1);
-      throw;
     }
-
-    // Give back ownership to auto_ptr
-    m_alive_thread_auto = auto_ptr<redrobd_alive_thread>(thread_ptr1);
     
     // Delete the cyclic alive thread object
     m_alive_thread_auto.reset();
@@ -410,100 +736,52 @@ long redrobd_ctrl_thread::cleanup(void)
 long redrobd_ctrl_thread::cyclic_execute(void)
 {
   try {
-    // Check if shutdown was selected (DIP-switch)
-    if ( (!m_shutdown_select) && (m_hw_cfg_auto->select_shutdown()) ) {
-      redrobd_log_writeln(get_name() + " : Shutdown selected");
-      // Send signal to main process
-      if (send_signal_self(SIG_TERMINATE_DAEMON) != DAEMON_SUCCESS) {
-	THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_SIGNAL_OPERATION_FAILED,
-		  "Error sending shutdown signal for thread %s",
-		  get_name().c_str());   
-      }
-      m_shutdown_select = true; // Only signal once
-    }
-
-    // Check battery voltage
-    if ( !battery_voltage_ok() ) {
-      redrobd_led_bat_low(true);   // Turn status LED on
-    }
-    else {
-      redrobd_led_bat_low(false);  // Turn status LED off
-    }
-
     // Check system stats
     check_system_stats();
 
     // Check state and status of created threads
     check_thread_run_status();
 
-    // Check remote control steering
-    uint16_t steering = get_remote_steering();
-
-    // Do motor control
-    switch (steering) {
-    case REDROBD_RC_STEER_NONE:
-      motor_control(REDROBD_MC_NONE);
-      break;
-    case REDROBD_RC_STEER_FORWARD:
-      if (m_verbose) {
-	redrobd_log_writeln(get_name() + " : steer forward");
-      }
-      motor_control(REDROBD_MC_FORWARD);
-      break;
-    case REDROBD_RC_STEER_REVERSE:
-      if (m_verbose) {
-	redrobd_log_writeln(get_name() + " : steer reverse");
-      }
-      motor_control(REDROBD_MC_REVERSE);
-      break; 
-    case REDROBD_RC_STEER_RIGHT:      
-      if (m_verbose) {
-	redrobd_log_writeln(get_name() + " : steer right");
-      }
-      motor_control(REDROBD_MC_RIGHT);
-      break;
-    case REDROBD_RC_STEER_LEFT:
-      if (m_verbose) {
-	redrobd_log_writeln(get_name() + " : steer left");
-      }
-      motor_control(REDROBD_MC_LEFT);
-      break;
-    default:
-      // All other steerings are ignored for now
-       ostringstream oss_msg;
-       oss_msg << get_name()
-	       << " : Got undefined steering = 0x"
-	       << hex << setw(4) << setfill('0') << (unsigned)steering;
-       redrobd_log_writeln(oss_msg.str());
-       oss_msg.str("");
+    // Check if time to log thread statistics
+    check_thread_stat_log();
 
-       motor_control(REDROBD_MC_STOP); 
+    if (is_replaying()) {
+      // Recorded cycles and events, instead of hardware and clients
+      replay_steps();
+    }
+    else {
+      begin_rec_step(REDROBD_REC_STEP_CYCLE);
+      control_cycle();
+      end_rec_step();
     }
 
-    // Check remote control camera code
-    uint16_t camera_code = m_rc_net_auto->get_camera_code();
+    return THREAD_SUCCESS;
+  }
+  catch (excep &exp) {
+    syslog_error(redrobd_error_syslog_string(exp).c_str());
+    return THREAD_INTERNAL_ERROR;
+  }
+  catch (...) {
+    syslog_error("redrobd_ctrl_thread::cyclic_execute->Unexpected exception");
+    return THREAD_INTERNAL_ERROR;
+  }
+}
 
-    // Do camera control
-    switch (camera_code) {
-    case REDROBD_RC_CAMERA_NONE:
-      camera_control(REDROBD_CC_NONE);
-      break;
-    case REDROBD_RC_CAMERA_STOP_STREAM:
-      camera_control(REDROBD_CC_STOP_STREAM);
-      break;
-    case REDROBD_RC_CAMERA_START_STREAM:
-      camera_control(REDROBD_CC_START_STREAM);
-      break; 
-    default:
-      // All other camera codes are ignored for now
-       ostringstream oss_msg;
-       oss_msg << get_name()
-	       << " : Got undefined camera code = 0x"
-	       << hex << setw(4) << setfill('0') << (unsigned)steering;
-       redrobd_log_writeln(oss_msg.str());
-       oss_msg.str("");
+////////////////////////////////////////////////////////////////
+
+long redrobd_ctrl_thread::event_execute(void)
+{
+  try {
+    // Recorded events are replayed by cyclic_execute
+    if (is_replaying()) {
+      return THREAD_SUCCESS;
     }
 
+    // New remote command, act on it without waiting for next cycle
+    begin_rec_step(REDROBD_REC_STEP_EVENT);
+    remote_control(true);
+    end_rec_step();
+
     return THREAD_SUCCESS;
   }
   catch (excep &exp) {
@@ -511,11 +789,21 @@ long redrobd_ctrl_thread::cyclic_execute(void)
     return THREAD_INTERNAL_ERROR;
   }
   catch (...) {
-    syslog_error("redrobd_ctrl_thread::cyclic_execute->Unexpected exception");
+    syslog_error("redrobd_ctrl_thread::event_execute->Unexpected exception");
     return THREAD_INTERNAL_ERROR;
   }
 }
 
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::cyclic_overrun(unsigned missed_periods)
+{
+  // Overruns are always counted, only log each one if verbose
+  if (m_verbose) {
+    m_log_overrun.writemsg(REDROBD_LOG_MSG_CTRL_OVERRUN, missed_periods);
+  }
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //               Private member functions
 /////////////////////////////////////////////////////////////////////////////
@@ -526,18 +814,38 @@ void redrobd_ctrl_thread::init_members(void)
 {
   m_alive_thread_auto.reset();
   m_bat_mon_thread_auto.reset();
+  m_task_sched_auto.reset();
+  m_sys_stat_thread_auto.reset();
   m_rc_rf_auto.reset();
   m_rc_net_auto.reset();
   m_cc_auto.reset();
   m_mc_cont_steer_auto.reset();
   m_mc_non_cont_steer_auto.reset();
 
-  m_mcp3008_io_ptr = NULL;
+  m_adc_io_ptr = NULL;
 
   m_hw_cfg_auto.reset();
+  m_ctrl_rec_auto.reset();
+
+  m_startup_last_step = 0.0;
+
+  m_replay_start.tv_sec  = 0;
+  m_replay_start.tv_nsec = 0;
+  m_replay_started = false;
+  m_replay_done    = false;
+  m_replay_step_time.reset();
 
   m_battery_check_allowed = false;
 
+  m_cmd_latency.reset();
+
+  bzero(&m_trace_pickup_time, sizeof(m_trace_pickup_time));
+  for (unsigned i=0; i < RC_NET_TRACE_STAGES; i++) {
+    m_trace_stage[i].reset();
+  }
+
+  m_event_steering = REDROBD_RC_STEER_NONE;
+
   m_shutdown_select = false;
 
   m_cont_steering = false;
@@ -551,8 +859,7 @@ bool redrobd_ctrl_thread::battery_voltage_ok(void)
 
   // Allow battery monitor thread to run at least one period
   if (!m_battery_check_allowed) {
-    if ( m_battery_check_timer.get_elapsed_time() > 
-	 (1.0/BAT_MON_THREAD_FREQUENCY) ) {      
+    if ( get_input(REDROBD_REC_BAT_CHECK) ) {
       m_battery_check_allowed = true;
     }
 
@@ -560,19 +867,17 @@ bool redrobd_ctrl_thread::battery_voltage_ok(void)
     m_rc_net_auto->set_voltage(0.0);
   }
   else {
-    // Safe to check battery voltage now
-    REDROBD_VOLTAGE v_bat;
-    
-    // Get latest monitored value
-    m_bat_mon_thread_auto->get_voltage(v_bat);
+    // Safe to check battery voltage now,
+    // latest monitored value with millivolt resolution
+    float v_in = (float)get_input(REDROBD_REC_VBAT) / 1000.0;
     
     // Check if value to low
-    if (v_bat.v_in < BAT_MIN_ALLOWED_VOLTAGE) {
+    if (v_in < BAT_MIN_ALLOWED_VOLTAGE) {
       battery_ok = false;
     }
 
     // Update voltage for remote control (NET, Sockets)
-    m_rc_net_auto->set_voltage(v_bat.v_in);
+    m_rc_net_auto->set_voltage(v_in);
   }
 
   return battery_ok;
@@ -582,179 +887,705 @@ bool redrobd_ctrl_thread::battery_voltage_ok(void)
 
 void redrobd_ctrl_thread::check_system_stats(void)
 {
-  if ( m_sys_stat_check_timer.get_elapsed_time() <
-	 (1.0/SYS_STAT_CHECK_FREQUENCY) ) {
-    return;
-  }
+  REDROBD_SYS_STAT sys_stat;
 
-  long rc;
+  // Get latest snapshot from collector thread
+  m_sys_stat_thread_auto->get_sys_stat(sys_stat);
 
-  // Get system stats (Linux)
-  float cpu_load;
-  unsigned mem_used;
-  unsigned irq;
-  unsigned uptime;
-  
-  rc = m_sys_stat.get_interval_cpu_load(cpu_load);
-  if (rc != SYS_STAT_SUCCESS) {      
-    cpu_load = 0;
-  }
-  
-  rc = m_sys_stat.get_mem_used_kb(mem_used);
-  if (rc != SYS_STAT_SUCCESS) {
-    mem_used = 0;
-  }
-  
-  rc = m_sys_stat.get_interval_irq(irq);
-  if (rc != SYS_STAT_SUCCESS) {
-    irq = 0;
-  }
-  
-  rc = m_sys_stat.get_uptime_sec(uptime);
-  if (rc != SYS_STAT_SUCCESS) {
-    uptime = 0;
-  }
-  
-  // Get system stats (Raspberry Pi)
-  float cpu_temp;
-  float cpu_voltage;
-  unsigned cpu_freq;
-  
-  rc = m_rpi_stat.get_temperature(cpu_temp);
-  if (rc != RPI_STAT_SUCCESS) {      
-    cpu_temp = 0.0;
-  }
-  
-  rc = m_rpi_stat.get_voltage(RPI_STAT_VOLT_ID_CORE,
-			      cpu_voltage);
-  if (rc != RPI_STAT_SUCCESS) {      
-    cpu_voltage = 0.0;
-  }
-  
-  rc = m_rpi_stat.get_frequency(RPI_STAT_FREQ_ID_ARM,
-				cpu_freq);
-  if (rc != RPI_STAT_SUCCESS) {      
-    cpu_freq = 0;
-  }
-  
-  // Reset system stats interval
-  rc = m_sys_stat.reset_interval_cpu_load();
-  if (rc != SYS_STAT_SUCCESS) {
-    if (rc != SYS_STAT_SUCCESS) {
-      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SYS_STAT_OPERATION_FAILED,
-		"Error resetting system stats interval(cpu_load) for thread %s",
-		get_name().c_str());  
-    }
-  }
-  
-  rc = m_sys_stat.reset_interval_irq();
-  if (rc != SYS_STAT_SUCCESS) {
-    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SYS_STAT_OPERATION_FAILED,
-	      "Error resetting system stats interval(irq) for thread %s",
-	      get_name().c_str());  
-  }
-  
   // Update system stats for remote control (NET, Sockets)
-  m_rc_net_auto->set_sys_stat((uint8_t)cpu_load,
-			      (uint32_t)mem_used,
-			      (uint16_t)irq,
-			      (uint32_t)uptime,
-			      (uint32_t)(cpu_temp * 1000.0),
-			      (uint16_t)(cpu_voltage * 1000.0),
-			      (uint16_t)((float)(cpu_freq) / 1000000.0));        
-  // Reset timer
-  if (m_sys_stat_check_timer.reset() != TIMER_SUCCESS) {
-    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_TIME_ERROR,
-	      "Error resetting system stats check timer for thread %s",
-	      get_name().c_str());   
-  }
+  m_rc_net_auto->set_sys_stat((uint8_t)sys_stat.cpu_load,
+			      (uint32_t)sys_stat.mem_used,
+			      (uint16_t)sys_stat.irq,
+			      (uint32_t)sys_stat.uptime,
+			      (uint32_t)(sys_stat.cpu_temp * 1000.0),
+			      (uint16_t)(sys_stat.cpu_voltage * 1000.0),
+			      (uint16_t)((float)(sys_stat.cpu_freq) / 1000000.0));
 }
 
 ////////////////////////////////////////////////////////////////
 
 void redrobd_ctrl_thread::check_thread_run_status(void)
 {
-  //////////////////////////
-  //  CHECK ALIVE THREAD   
-  //////////////////////////
+  if (m_config.use_task_scheduler) {
+    ///////////////////////////////////
+    //  CHECK TASK SCHEDULER THREAD
+    ///////////////////////////////////
 
-  // Take back ownership from auto_ptr
-  redrobd_alive_thread *thread_ptr1 =
-    m_alive_thread_auto.release();
+    // Take back ownership from auto_ptr
+    periodic_scheduler *thread_ptr =
+      m_task_sched_auto.release();
 
-  try {
-    // Check state and status of alive thread object
-    redrobd_thread_check((thread *)thread_ptr1);
-  }
-  catch (...) {
-    m_alive_thread_auto =
-      auto_ptr<redrobd_alive_thread>(thread_ptr1);
-    throw;
+    try {
+      // Check state and status of task scheduler thread object
+      redrobd_thread_check((thread *)thread_ptr);
+    }
+    catch (...) {
+      m_task_sched_auto =
+	auto_ptr<periodic_scheduler>(thread_ptr);
+      throw;
+    }
+
+    // Give back ownership to auto_ptr
+    m_task_sched_auto =
+      auto_ptr<periodic_scheduler>(thread_ptr);
   }
+  else {
+    //////////////////////////
+    //  CHECK ALIVE THREAD   
+    //////////////////////////
 
-  // Give back ownership to auto_ptr
-  m_alive_thread_auto =
-    auto_ptr<redrobd_alive_thread>(thread_ptr1);
+    // Take back ownership from auto_ptr
+    redrobd_alive_thread *thread_ptr1 =
+      m_alive_thread_auto.release();
 
-  /////////////////////////////////////////////////
-  //  CHECK REMOTE CONTROL (NET, SOCKETS) THREAD
-  /////////////////////////////////////////////////
+    try {
+      // Check state and status of alive thread object
+      redrobd_thread_check((thread *)thread_ptr1);
+    }
+    catch (...) {
+      m_alive_thread_auto =
+	auto_ptr<redrobd_alive_thread>(thread_ptr1);
+      throw;
+    }
 
-  // Check state and status of server thread object
-  m_rc_net_auto->server_thread_check();
+    // Give back ownership to auto_ptr
+    m_alive_thread_auto =
+      auto_ptr<redrobd_alive_thread>(thread_ptr1);
 
-  ///////////////////////////////////
-  //  CHECK BATTERY MONITOR THREAD   
-  ///////////////////////////////////
+    ///////////////////////////////////
+    //  CHECK BATTERY MONITOR THREAD   
+    ///////////////////////////////////
 
-  // Take back ownership from auto_ptr
-  redrobd_voltage_monitor_thread *thread_ptr2 =
-    m_bat_mon_thread_auto.release();
+    // Take back ownership from auto_ptr
+    redrobd_voltage_monitor_thread *thread_ptr2 =
+      m_bat_mon_thread_auto.release();
+
+    try {
+      // Check state and status of battery monitor thread object
+      redrobd_thread_check((thread *)thread_ptr2);
+    }
+    catch (...) {
+      m_bat_mon_thread_auto =
+	auto_ptr<redrobd_voltage_monitor_thread>(thread_ptr2);
+      throw;
+    }
+
+    // Give back ownership to auto_ptr
+    m_bat_mon_thread_auto =
+      auto_ptr<redrobd_voltage_monitor_thread>(thread_ptr2); 
+  }
+
+  /////////////////////////////////////////////////
+  //  CHECK REMOTE CONTROL (NET, SOCKETS) THREAD
+  /////////////////////////////////////////////////
+
+  // Check state and status of server thread object
+  m_rc_net_auto->server_thread_check();
+
+  ////////////////////////////////////////
+  //  CHECK SYSTEM STATS COLLECTOR THREAD
+  ////////////////////////////////////////
+
+  // Take back ownership from auto_ptr
+  redrobd_sys_stat_thread *thread_ptr3 =
+    m_sys_stat_thread_auto.release();
 
   try {
-    // Check state and status of alive thread object
-    redrobd_thread_check((thread *)thread_ptr2);
+    // Check state and status of system stats thread object
+    redrobd_thread_check((thread *)thread_ptr3);
   }
   catch (...) {
-    m_bat_mon_thread_auto =
-      auto_ptr<redrobd_voltage_monitor_thread>(thread_ptr2);
+    m_sys_stat_thread_auto =
+      auto_ptr<redrobd_sys_stat_thread>(thread_ptr3);
+    throw;
+  }
+
+  // Give back ownership to auto_ptr
+  m_sys_stat_thread_auto =
+    auto_ptr<redrobd_sys_stat_thread>(thread_ptr3);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::start_task_scheduler(void)
+{
+  long rc;
+
+  // Create the task scheduler thread object with garbage collector
+  periodic_scheduler *thread_ptr =
+    new periodic_scheduler(TASK_SCHED_THREAD_NAME);
+  m_task_sched_auto = auto_ptr<periodic_scheduler>(thread_ptr);
+
+  // Battery monitor is the most time critical task
+  redrobd_thread_set_sched(thread_ptr,
+			   &m_config.bat_mon_thread_sched,
+			   m_config.thread_stack_kb);
+
+  // Tasks are owned by their auto_ptr, not by the scheduler
+  rc = thread_ptr->add_task(m_bat_mon_thread_auto.get(),
+			    BAT_MON_THREAD_FREQUENCY,
+			    BAT_MON_TASK_PRIO,
+			    BAT_MON_TASK_PHASE);
+  if (rc == THREAD_SUCCESS) {
+    rc = thread_ptr->add_task(m_alive_thread_auto.get(),
+			      ALIVE_THREAD_FREQUENCY,
+			      ALIVE_TASK_PRIO,
+			      ALIVE_TASK_PHASE);
+  }
+  if (rc != THREAD_SUCCESS) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_THREAD_OPERATION_FAILED,
+	      "Add task failed for thread %s, rc:%ld",
+	      thread_ptr->get_name().c_str(), rc);
+  }
+
+  redrobd_log_writeln("About to initialize task scheduler thread");
+
+  // Take back ownership from auto_ptr
+  thread_ptr = m_task_sched_auto.release();
+
+  try {
+    // Start task scheduler thread object
+    redrobd_thread_start((thread *)thread_ptr);
+  }
+  catch (...) {
+    m_task_sched_auto = auto_ptr<periodic_scheduler>(thread_ptr);
     throw;
   }
 
   // Give back ownership to auto_ptr
-  m_bat_mon_thread_auto =
-    auto_ptr<redrobd_voltage_monitor_thread>(thread_ptr2); 
+  m_task_sched_auto = auto_ptr<periodic_scheduler>(thread_ptr);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::wait_task_scheduler_started(void)
+{
+  // Take back ownership from auto_ptr
+  periodic_scheduler *thread_ptr = m_task_sched_auto.release();
+
+  try {
+    // Wait for task scheduler thread object to execute
+    redrobd_thread_wait_started((thread *)thread_ptr,
+				TASK_SCHED_THREAD_START_TIMEOUT,
+				TASK_SCHED_THREAD_EXECUTE_TIMEOUT);
+  }
+  catch (...) {
+    m_task_sched_auto = auto_ptr<periodic_scheduler>(thread_ptr);
+    throw;
+  }
+
+  // Give back ownership to auto_ptr
+  m_task_sched_auto = auto_ptr<periodic_scheduler>(thread_ptr);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::finalize_task_scheduler(void)
+{
+  redrobd_log_writeln("About to finalize task scheduler thread");
+
+  // Take back ownership from auto_ptr
+  periodic_scheduler *thread_ptr = m_task_sched_auto.release();
+
+  try {
+    // Finalize the task scheduler thread object
+    redrobd_thread_finalize((thread *)thread_ptr,
+			    TASK_SCHED_THREAD_STOP_TIMEOUT);
+  }
+  catch (...) {
+    m_task_sched_auto = auto_ptr<periodic_scheduler>(thread_ptr);
+    throw;
+  }
+
+  // Give back ownership to auto_ptr
+  m_task_sched_auto = auto_ptr<periodic_scheduler>(thread_ptr);
+
+  // Delete the task scheduler thread object
+  m_task_sched_auto.reset();
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::startup_step(const string &step)
+{
+  double now = m_startup_timer.get_elapsed_time();
+
+  ostringstream oss_msg;
+  oss_msg << get_name() << " : startup " << step << " "
+	  << (now - m_startup_last_step) * 1000.0 << " ms (at "
+	  << now * 1000.0 << " ms)";
+  redrobd_log_writeln(oss_msg.str());
+
+  m_startup_last_step = now;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::check_thread_stat_log(void)
+{
+  if ( m_thread_stat_log_timer.get_elapsed_time() <
+       THREAD_STAT_LOG_INTERVAL ) {
+    return;
+  }
+
+  log_thread_stats();
+
+  // Reset timer
+  if (m_thread_stat_log_timer.reset() != TIMER_SUCCESS) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_TIME_ERROR,
+	      "Error resetting thread stats log timer for thread %s",
+	      get_name().c_str());   
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::log_thread_stats(void)
+{
+  // Statistics are accumulated since thread start
+  redrobd_thread_log_stat(this, m_verbose);
+
+  redrobd_log_histogram(get_name() + " : cmd latency",
+			m_cmd_latency,
+			m_verbose);
+
+  if (m_config.ctrl_cmd_trace) {
+    redrobd_log_histogram(get_name() + " : cmd trace queue",
+			  m_trace_stage[RC_NET_TRACE_QUEUE],
+			  m_verbose);
+    redrobd_log_histogram(get_name() + " : cmd trace control",
+			  m_trace_stage[RC_NET_TRACE_CONTROL],
+			  m_verbose);
+    redrobd_log_histogram(get_name() + " : cmd trace total",
+			  m_trace_stage[RC_NET_TRACE_TOTAL],
+			  m_verbose);
+  }
+
+  if (m_rc_net_auto.get()) {
+    log_code_stats();
+  }
+
+  if (m_task_sched_auto.get()) {
+    redrobd_scheduler_log_stat(m_task_sched_auto.get(), m_verbose);
+  }
+  else {
+    if (m_alive_thread_auto.get()) {
+      redrobd_thread_log_stat(m_alive_thread_auto.get(), m_verbose);
+    }
+    if (m_bat_mon_thread_auto.get()) {
+      redrobd_thread_log_stat(m_bat_mon_thread_auto.get(), m_verbose);
+    }
+  }
+
+  if (m_sys_stat_thread_auto.get()) {
+    redrobd_thread_log_stat(m_sys_stat_thread_auto.get(), m_verbose);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+bool redrobd_ctrl_thread::is_replaying(void)
+{
+  return ( (m_ctrl_rec_auto.get()) &&
+	   (m_ctrl_rec_auto->is_replaying()) );
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::begin_rec_step(uint16_t step_type)
+{
+  if (m_ctrl_rec_auto.get()) {
+    m_ctrl_rec_auto->begin_step(step_type);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::end_rec_step(void)
+{
+  if (m_ctrl_rec_auto.get()) {
+    m_ctrl_rec_auto->end_step();
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::replay_steps(void)
+{
+  struct timespec now;
+  struct timespec step_time;
+  struct timespec step_done;
+  uint16_t step_type;
+
+  if (m_replay_done) {
+    return;
+  }
+
+  if ( clock_gettime(get_clock_id(), &now) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+	      "Get replay time failed for thread %s",
+	      get_name().c_str());
+  }
+
+  // Recorded step times are relative to start of replay
+  if (!m_replay_started) {
+    m_replay_start = now;
+    m_replay_started = true;
+  }
+  double replay_time = get_time_diff(&m_replay_start, &now);
+
+  while ( !is_stopped() ) {
+
+    if ( !m_ctrl_rec_auto->peek_step(step_type, &step_time) ) {
+      replay_finished();
+      return;
+    }
+
+    // Real time replay executes all steps due since last cycle
+    if ( (m_config.ctrl_input_mode == REDROBD_INPUT_REPLAY_REALTIME) &&
+	 ((double)step_time.tv_sec + (double)step_time.tv_nsec / 1000000000.0 >
+	  replay_time) ) {
+      break;
+    }
+
+    m_ctrl_rec_auto->begin_step(step_type);
+    switch (step_type) {
+    case REDROBD_REC_STEP_CYCLE:
+      control_cycle();
+      break;
+    case REDROBD_REC_STEP_EVENT:
+      remote_control(true);
+      break;
+    default:
+      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_BAD_ARGUMENT,
+		"Unexpected replay step type %u for thread %s",
+		step_type, get_name().c_str());
+    }
+    m_ctrl_rec_auto->end_step();
+
+    // Benchmark of control step
+    if ( clock_gettime(get_clock_id(), &step_done) ) {
+      THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+		"Get replay step time failed for thread %s",
+		get_name().c_str());
+    }
+    m_replay_step_time.add(get_time_diff(&now, &step_done));
+    now = step_done;
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::replay_finished(void)
+{
+  ostringstream oss_msg;
+  struct timespec now;
+
+  m_replay_done = true;
+
+  if ( clock_gettime(get_clock_id(), &now) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+	      "Get replay time failed for thread %s",
+	      get_name().c_str());
+  }
+
+  oss_msg << get_name() << " : Replay done"
+	  << ", steps=" << m_ctrl_rec_auto->get_nr_steps()
+	  << ", sync_misses=" << m_ctrl_rec_auto->get_sync_misses()
+	  << ", time=" << get_time_diff(&m_replay_start, &now) << " s";
+  redrobd_log_writeln(oss_msg.str());
+
+  redrobd_log_histogram(get_name() + " : replay step time",
+			m_replay_step_time,
+			true);
+
+  // Replay session is over, send signal to main process
+  if (send_signal_self(SIG_TERMINATE_DAEMON) != DAEMON_SUCCESS) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_SIGNAL_OPERATION_FAILED,
+	      "Error sending shutdown signal for thread %s",
+	      get_name().c_str());   
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+uint16_t redrobd_ctrl_thread::get_input(uint16_t type)
+{
+  uint16_t value;
+
+  if (is_replaying()) {
+    return m_ctrl_rec_auto->replay_input(type);
+  }
+
+  switch (type) {
+  case REDROBD_REC_CONT_STEER:
+    value = m_hw_cfg_auto->select_continuous_steering();
+    break;
+  case REDROBD_REC_SHUTDOWN:
+    value = m_hw_cfg_auto->select_shutdown();
+    break;
+  case REDROBD_REC_BAT_CHECK:
+    value = ( m_battery_check_timer.get_elapsed_time() > 
+	      (1.0/BAT_MON_THREAD_FREQUENCY) );
+    break;
+  case REDROBD_REC_VBAT:
+    {
+      REDROBD_VOLTAGE v_bat;
+      m_bat_mon_thread_auto->get_voltage(v_bat);
+      value = (uint16_t)(v_bat.v_in * 1000.0 + 0.5);
+    }
+    break;
+  case REDROBD_REC_RF_STEER:
+    value = m_rc_rf_auto->get_steering();
+    break;
+  case REDROBD_REC_RF_ACTIVE:
+    value = m_rc_rf_auto->is_active();
+    break;
+  case REDROBD_REC_NET_STEER:
+    value = m_rc_net_auto->get_steering();
+    break;
+  case REDROBD_REC_NET_ACTIVE:
+    value = m_rc_net_auto->is_active();
+    break;
+  case REDROBD_REC_STEER_PENDING:
+    value = m_rc_net_auto->steering_pending();
+    break;
+  case REDROBD_REC_CAMERA_CODE:
+    value = m_rc_net_auto->get_camera_code();
+    break;
+  case REDROBD_REC_CAMERA_PENDING:
+    value = m_rc_net_auto->camera_code_pending();
+    break;
+  default:
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_BAD_ARGUMENT,
+	      "Unexpected input type %u for thread %s",
+	      type, get_name().c_str());
+  }
+
+  if (m_ctrl_rec_auto.get()) {
+    m_ctrl_rec_auto->record_input(type, value);
+  }
+
+  return value;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::capture_output(uint16_t type,
+					 uint16_t value)
+{
+  if (m_ctrl_rec_auto.get()) {
+    m_ctrl_rec_auto->capture_output(type, value);
+  }
 }
 
 ////////////////////////////////////////////////////////////////
 
-uint16_t redrobd_ctrl_thread::get_remote_steering(void)
+void redrobd_ctrl_thread::control_cycle(void)
+{
+  // Check if shutdown was selected (DIP-switch)
+  if ( (!m_shutdown_select) && (get_input(REDROBD_REC_SHUTDOWN)) ) {
+    redrobd_log_writeln(get_name() + " : Shutdown selected");
+    // Send signal to main process
+    if (send_signal_self(SIG_TERMINATE_DAEMON) != DAEMON_SUCCESS) {
+      THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_SIGNAL_OPERATION_FAILED,
+		"Error sending shutdown signal for thread %s",
+		get_name().c_str());   
+    }
+    m_shutdown_select = true; // Only signal once
+  }
+
+  // Check battery voltage
+  if ( !battery_voltage_ok() ) {
+    bat_low_indication(true);   // Turn status LED on
+  }
+  else {
+    bat_low_indication(false);  // Turn status LED off
+  }
+
+  // Check remote control
+  remote_control(false);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::remote_control(bool event_step)
+{
+  // Apply remote control commands.
+  // More than one command is only pending if client codes
+  // are transferred using policy REDROBD_CMD_ALL.
+  do {
+    remote_steer_control(event_step);
+  } while (get_input(REDROBD_REC_STEER_PENDING));
+
+  do {
+    remote_camera_control();
+  } while (get_input(REDROBD_REC_CAMERA_PENDING));
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::remote_steer_control(bool event_step)
+{
+  // Check remote control steering
+  uint16_t steering = get_remote_steering(event_step);
+
+  // Do motor control
+  switch (steering) {
+  case REDROBD_RC_STEER_NONE:
+    motor_control(REDROBD_MC_NONE);
+    break;
+  case REDROBD_RC_STEER_FORWARD:
+    if (m_verbose) {
+      m_log_steer.writemsg(REDROBD_LOG_MSG_CTRL_STEER_FORWARD);
+    }
+    motor_control(REDROBD_MC_FORWARD);
+    break;
+  case REDROBD_RC_STEER_REVERSE:
+    if (m_verbose) {
+      m_log_steer.writemsg(REDROBD_LOG_MSG_CTRL_STEER_REVERSE);
+    }
+    motor_control(REDROBD_MC_REVERSE);
+    break; 
+  case REDROBD_RC_STEER_RIGHT:      
+    if (m_verbose) {
+      m_log_steer.writemsg(REDROBD_LOG_MSG_CTRL_STEER_RIGHT);
+    }
+    motor_control(REDROBD_MC_RIGHT);
+    break;
+  case REDROBD_RC_STEER_LEFT:
+    if (m_verbose) {
+      m_log_steer.writemsg(REDROBD_LOG_MSG_CTRL_STEER_LEFT);
+    }
+    motor_control(REDROBD_MC_LEFT);
+    break;
+  default:
+    // All other steerings are ignored for now
+     m_log_steer.writemsg(REDROBD_LOG_MSG_CTRL_STEER_UNDEF,
+			  (unsigned)steering);
+
+     motor_control(REDROBD_MC_STOP); 
+  }
+
+  // Measure latency from command received to motor control (NET)
+  struct timespec recv_time;
+  if ( (!is_replaying()) &&
+       (!m_rc_rf_auto->is_active()) &&
+       (m_rc_net_auto->get_steering_recv_time(&recv_time)) ) {
+    update_cmd_latency(&recv_time);
+
+    if (m_config.ctrl_cmd_trace) {
+      update_cmd_trace(&recv_time);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::remote_camera_control(void)
+{
+  // Check remote control camera code
+  uint16_t camera_code = get_input(REDROBD_REC_CAMERA_CODE);
+
+  // Do camera control
+  switch (camera_code) {
+  case REDROBD_RC_CAMERA_NONE:
+    camera_control(REDROBD_CC_NONE);
+    break;
+  case REDROBD_RC_CAMERA_STOP_STREAM:
+    camera_control(REDROBD_CC_STOP_STREAM);
+    break;
+  case REDROBD_RC_CAMERA_START_STREAM:
+    camera_control(REDROBD_CC_START_STREAM);
+    break; 
+  default:
+    // All other camera codes are ignored for now
+     m_log_camera.writemsg(REDROBD_LOG_MSG_CTRL_CAMERA_UNDEF,
+			   (unsigned)camera_code);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::log_code_stats(void)
+{
+  RC_NET_CODE_STAT steer_stat;
+  RC_NET_CODE_STAT camera_stat;
+  ostringstream oss_msg;
+
+  // Transfer of client codes from rc net server thread
+  m_rc_net_auto->get_code_stat(&steer_stat, &camera_stat);
+
+  oss_msg << get_name() << " : steer codes"
+	  << " received=" << steer_stat.received
+	  << ", drops=" << steer_stat.drops
+	  << ", coalesced=" << steer_stat.coalesced
+	  << ", max_depth=" << steer_stat.max_depth;
+  redrobd_log_writeln(oss_msg.str());
+  oss_msg.str("");
+
+  oss_msg << get_name() << " : camera codes"
+	  << " received=" << camera_stat.received
+	  << ", drops=" << camera_stat.drops
+	  << ", coalesced=" << camera_stat.coalesced
+	  << ", max_depth=" << camera_stat.max_depth;
+  redrobd_log_writeln(oss_msg.str());
+}
+
+////////////////////////////////////////////////////////////////
+
+uint16_t redrobd_ctrl_thread::get_remote_steering(bool event_step)
 {
   uint16_t steering_rf;
   uint16_t steering_net;
   uint16_t steering;
 
   // Get steerings from remote control objects
-  steering_rf = m_rc_rf_auto->get_steering();
-  steering_net = m_rc_net_auto->get_steering();
+  steering_rf = get_input(REDROBD_REC_RF_STEER);
+  steering_net = get_input(REDROBD_REC_NET_STEER);
+
+  // Each steer code (NET) is returned once and the motors are stopped
+  // by a cycle without one. A code applied by an event is also used
+  // by the next cycle, so it is applied until the same cycle as if
+  // there were no events (one period after it would be picked up).
+  if (event_step) {
+    if (steering_net != REDROBD_RC_STEER_NONE) {
+      m_event_steering = steering_net;
+    }
+  }
+  else {
+    if (steering_net == REDROBD_RC_STEER_NONE) {
+      steering_net = m_event_steering;
+    }
+    m_event_steering = REDROBD_RC_STEER_NONE;
+  }
 
   // (RF, Radio) has highest priority
-  if (m_rc_rf_auto->is_active()) {
+  if (get_input(REDROBD_REC_RF_ACTIVE)) {
     steering = steering_rf;
     if (m_verbose) {
-      redrobd_log_writeln(get_name() + " : remote RF active");
+      m_log_remote.writemsg(REDROBD_LOG_MSG_CTRL_RF_ACTIVE);
     }
   }
-  else if (m_rc_net_auto->is_active()) {
+  else if (get_input(REDROBD_REC_NET_ACTIVE)) {
     steering = steering_net;
     if (m_verbose) {
-      redrobd_log_writeln(get_name() + " : remote NET active");
+      m_log_remote.writemsg(REDROBD_LOG_MSG_CTRL_NET_ACTIVE);
+    }
+
+    // Steering picked up, next trace stage
+    if (m_config.ctrl_cmd_trace) {
+      if ( clock_gettime(get_clock_id(), &m_trace_pickup_time) ) {
+	THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+		  "Get command pickup time failed for thread %s",
+		  get_name().c_str());
+      }
     }
   }
   else {
     steering = REDROBD_RC_STEER_NONE;
     if (m_verbose) {
-      redrobd_log_writeln(get_name() + " : remote NONE active");
+      m_log_remote.writemsg(REDROBD_LOG_MSG_CTRL_NONE_ACTIVE);
     }
   }
 
@@ -763,8 +1594,63 @@ uint16_t redrobd_ctrl_thread::get_remote_steering(void)
 
 ////////////////////////////////////////////////////////////////
 
+void redrobd_ctrl_thread::update_cmd_latency(const struct timespec *recv_time)
+{
+  struct timespec now;
+
+  if ( clock_gettime(get_clock_id(), &now) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+	      "Get command latency time failed for thread %s",
+	      get_name().c_str());
+  }
+
+  m_cmd_latency.add(get_time_diff(recv_time, &now));
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::update_cmd_trace(const struct timespec *recv_time)
+{
+  struct timespec write_time;
+
+  m_trace_stage[RC_NET_TRACE_QUEUE].add(get_time_diff(recv_time,
+						      &m_trace_pickup_time));
+
+  // Pins are not always written (non-continuous steering),
+  // a write before pickup belongs to an earlier steering
+  if ( (get_motor_ctrl()->get_pin_write_time(&write_time)) &&
+       (get_time_diff(&m_trace_pickup_time, &write_time) >= 0.0) ) {
+    m_trace_stage[RC_NET_TRACE_CONTROL].add(get_time_diff(&m_trace_pickup_time,
+							  &write_time));
+    m_trace_stage[RC_NET_TRACE_TOTAL].add(get_time_diff(recv_time,
+							&write_time));
+  }
+
+  // Latest summary for clients (NET)
+  m_rc_net_auto->set_trace_stat(m_trace_stage);
+}
+
+////////////////////////////////////////////////////////////////
+
+redrobd_motor_ctrl *redrobd_ctrl_thread::get_motor_ctrl(void)
+{
+  if (m_cont_steering) {
+    return m_mc_cont_steer_auto.get();
+  }
+  return m_mc_non_cont_steer_auto.get();
+}
+
+////////////////////////////////////////////////////////////////
+
 void redrobd_ctrl_thread::motor_control(uint16_t steer_code)
 {
+  capture_output(REDROBD_REC_MOTOR, steer_code);
+
+  // Outputs are only captured during replay
+  if (is_replaying()) {
+    return;
+  }
+
   if (m_cont_steering) {
     m_mc_cont_steer_auto->steer(steer_code);
   }
@@ -777,5 +1663,26 @@ void redrobd_ctrl_thread::motor_control(uint16_t steer_code)
 
 void redrobd_ctrl_thread::camera_control(uint16_t camera_code)
 {
+  capture_output(REDROBD_REC_CAMERA, camera_code);
+
+  // Outputs are only captured during replay
+  if (is_replaying()) {
+    return;
+  }
+
   m_cc_auto->command(camera_code);
 }
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_ctrl_thread::bat_low_indication(bool bat_low)
+{
+  capture_output(REDROBD_REC_LED_BAT_LOW, bat_low);
+
+  // Outputs are only captured during replay
+  if (is_replaying()) {
+    return;
+  }
+
+  redrobd_led_bat_low(bat_low);
+}
@@ -15,18 +15,23 @@
 #include <memory>
 
 #include "cyclic_thread.h"
+#include "redrobd.h"
 #include "redrobd_alive_thread.h"
 #include "redrobd_voltage_monitor_thread.h"
+#include "redrobd_sys_stat_thread.h"
+#include "periodic_scheduler.h"
 #include "redrobd_rc_rf.h"
 #include "redrobd_rc_net.h"
 #include "redrobd_camera_ctrl.h"
 #include "redrobd_mc_cont_steer.h"
 #include "redrobd_mc_non_cont_steer.h"
 #include "mcp3008_io.h"
+#include "redrobd_hw_sim.h"
 #include "redrobd_hw_cfg.h"
+#include "redrobd_ctrl_rec.h"
+#include "histogram.h"
 #include "timer.h"
-#include "sys_stat.h"
-#include "rpi_stat.h"
+#include "redrobd_log_limit.h"
 
 using namespace std;
 
@@ -38,26 +43,49 @@ class redrobd_ctrl_thread : public cyclic_thread {
 
  public:
   redrobd_ctrl_thread(string thread_name,
-		      double frequency,
-		      bool verbose);
+		      const REDROBD_CONFIG *config);
   ~redrobd_ctrl_thread(void);
 
+  // Applies frequency and verbose logging while running,
+  // other configuration items are ignored.
+  void reconfigure(const REDROBD_CONFIG *config);
+
  protected:
   virtual long setup(void);   // Implements pure virtual function from base class
   virtual long cleanup(void); // Implements pure virtual function from base class
 
   virtual long cyclic_execute(void); // Implements pure virtual function from base class
+
+  virtual long event_execute(void); // Overrides function from base class
+
+  virtual void cyclic_overrun(unsigned missed_periods); // Overrides function from base class
     
  private:
-  // Full verbose logging
+  // Configuration used during start
+  REDROBD_CONFIG m_config;
+
+  // Full verbose logging, may be changed by reconfigure
   bool m_verbose;
 
+  // Rate limited logging, each for a group of related messages
+  redrobd_log_limit m_log_steer;
+  redrobd_log_limit m_log_remote;
+  redrobd_log_limit m_log_camera;
+  redrobd_log_limit m_log_overrun;
+
   // The alive thread object
   auto_ptr<redrobd_alive_thread> m_alive_thread_auto;
 
   // The battery monitor thread object
   auto_ptr<redrobd_voltage_monitor_thread> m_bat_mon_thread_auto;
 
+  // The task scheduler thread object, executes alive and
+  // battery monitor as tasks if enabled by configuration
+  auto_ptr<periodic_scheduler> m_task_sched_auto;
+
+  // The system statistics collector thread object
+  auto_ptr<redrobd_sys_stat_thread> m_sys_stat_thread_auto;
+
   // Remote control object (RF, Radio)
   auto_ptr<redrobd_rc_rf> m_rc_rf_auto;
 
@@ -74,19 +102,41 @@ class redrobd_ctrl_thread : public cyclic_thread {
   auto_ptr<redrobd_mc_non_cont_steer> m_mc_non_cont_steer_auto;
 
   // A/D Converter object pointer
-  mcp3008_io *m_mcp3008_io_ptr;
+  adc_io *m_adc_io_ptr;
 
   // Hardware configuration object
   auto_ptr<redrobd_hw_cfg> m_hw_cfg_auto;
 
+  // Record and replay of inputs object (not used in normal mode)
+  auto_ptr<redrobd_ctrl_rec> m_ctrl_rec_auto;
+
+  // Controls replay
+  struct timespec m_replay_start;
+  bool            m_replay_started;
+  bool            m_replay_done;
+  histogram       m_replay_step_time;
+
+  // Startup timing of setup steps
+  timer  m_startup_timer;
+  double m_startup_last_step;
+
   // Controls battery check
   timer m_battery_check_timer;
   bool  m_battery_check_allowed;
 
-  // Controls system statistics check
-  sys_stat m_sys_stat;
-  rpi_stat m_rpi_stat;
-  timer    m_sys_stat_check_timer;
+  // Controls logging of thread cycle timing statistics
+  timer m_thread_stat_log_timer;
+
+  // Latency from remote command (NET) received to motor control
+  histogram m_cmd_latency;
+
+  // Trace of steer commands (NET) if enabled by configuration,
+  // latency of each stage indexed by RC_NET_TRACE_xxx
+  struct timespec m_trace_pickup_time;
+  histogram       m_trace_stage[RC_NET_TRACE_STAGES];
+
+  // Steering (NET) applied by an event, also used by next cycle
+  uint16_t m_event_steering;
 
   // Controls shutdown
   bool m_shutdown_select;
@@ -102,11 +152,56 @@ class redrobd_ctrl_thread : public cyclic_thread {
 
   void check_thread_run_status(void);
 
-  uint16_t get_remote_steering(void);
+  void start_task_scheduler(void);
+
+  void wait_task_scheduler_started(void);
+
+  void finalize_task_scheduler(void);
+
+  void startup_step(const string &step);
+
+  void check_thread_stat_log(void);
+
+  void log_thread_stats(void);
+
+  void log_code_stats(void);
+
+  bool is_replaying(void);
+
+  void begin_rec_step(uint16_t step_type);
+
+  void end_rec_step(void);
+
+  void replay_steps(void);
+
+  void replay_finished(void);
+
+  uint16_t get_input(uint16_t type);
+
+  void capture_output(uint16_t type,
+		      uint16_t value);
+
+  void control_cycle(void);
+
+  void remote_control(bool event_step);
+
+  void remote_steer_control(bool event_step);
+
+  void remote_camera_control(void);
+
+  uint16_t get_remote_steering(bool event_step);
+
+  void update_cmd_latency(const struct timespec *recv_time);
+
+  void update_cmd_trace(const struct timespec *recv_time);
+
+  redrobd_motor_ctrl *get_motor_ctrl(void);
 
   void motor_control(uint16_t steer_code);
 
   void camera_control(uint16_t camera_code);
+
+  void bat_low_indication(bool bat_low);
 };
 
 #endif // __REDROBD_CTRL_THREAD_H__
@@ -11,11 +11,14 @@
 
 #include "redrobd_gpio.h"
 #include "rpi_gpio.h"
+#include "redrobd_hw_sim.h"
 
 /////////////////////////////////////////////////////////////////////////////
 //               Module global variables
 /////////////////////////////////////////////////////////////////////////////
-static rpi_gpio g_object;
+static rpi_gpio         g_rpi_gpio;
+static redrobd_sim_gpio g_sim_gpio;
+static gpio_io          *g_object = &g_rpi_gpio;
 
 /////////////////////////////////////////////////////////////////////////////
 //               Public member functions
@@ -23,16 +26,23 @@ static rpi_gpio g_object;
 
 ////////////////////////////////////////////////////////////////
 
-void redrobd_gpio_initialize(void)
+void redrobd_gpio_initialize(bool simulated)
 {
-  g_object.initialize();
+  if (simulated) {
+    g_object = &g_sim_gpio;
+  }
+  else {
+    g_object = &g_rpi_gpio;
+  }
+
+  g_object->initialize();
 }
 
 ////////////////////////////////////////////////////////////////
 
 void redrobd_gpio_finalize(void)
 {
-  g_object.finalize();
+  g_object->finalize();
 }
 
 ////////////////////////////////////////////////////////////////
@@ -41,10 +51,10 @@ void redrobd_gpio_set_function_inp(uint8_t pin,
 				   uint8_t &old_func)
 {
   // Get current GPIO function for pin
-  old_func = (uint8_t)g_object.get_function(pin);
+  old_func = (uint8_t)g_object->get_function(pin);
 
   // Set pin as input
-  g_object.set_function(pin, RPI_GPIO_FUNC_INP);
+  g_object->set_function(pin, RPI_GPIO_FUNC_INP);
 }
 
 ////////////////////////////////////////////////////////////////
@@ -53,10 +63,10 @@ void redrobd_gpio_set_function_out(uint8_t pin,
 				   uint8_t &old_func)
 {
   // Get current GPIO function for pin
-  old_func = (uint8_t)g_object.get_function(pin);
+  old_func = (uint8_t)g_object->get_function(pin);
 
   // Set pin as output
-  g_object.set_function(pin, RPI_GPIO_FUNC_OUT);
+  g_object->set_function(pin, RPI_GPIO_FUNC_OUT);
 }
 
 ////////////////////////////////////////////////////////////////
@@ -64,26 +74,26 @@ void redrobd_gpio_set_function_out(uint8_t pin,
 void redrobd_gpio_set_function(uint8_t pin,
 			       uint8_t func)
 {
-  g_object.set_function(pin, (RPI_GPIO_FUNCTION)func);
+  g_object->set_function(pin, (RPI_GPIO_FUNCTION)func);
 }
 
 ////////////////////////////////////////////////////////////////
 
 void redrobd_gpio_set_pin_high(uint8_t pin)
 {
-  g_object.set_pin_high(pin);
+  g_object->set_pin_high(pin);
 }
 
 ////////////////////////////////////////////////////////////////
 
 void redrobd_gpio_set_pin_low(uint8_t pin)
 {
-  g_object.set_pin_low(pin);
+  g_object->set_pin_low(pin);
 }
 
 ////////////////////////////////////////////////////////////////
 
 uint8_t redrobd_gpio_get_pin(uint8_t pin)
 {
-  return g_object.get_pin(pin);
+  return g_object->get_pin(pin);
 }
@@ -21,7 +21,7 @@
 /////////////////////////////////////////////////////////////////////////////
 //               Definition of exported functions
 /////////////////////////////////////////////////////////////////////////////
-extern void redrobd_gpio_initialize(void);
+extern void redrobd_gpio_initialize(bool simulated);
 extern void redrobd_gpio_finalize(void);
 
 extern void redrobd_gpio_set_function_inp(uint8_t pin,
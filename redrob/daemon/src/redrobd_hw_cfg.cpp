@@ -35,13 +35,13 @@
 
 ////////////////////////////////////////////////////////////////
 
-redrobd_hw_cfg::redrobd_hw_cfg(mcp3008_io *mcp3008_io_ptr,
-			       MCP3008_IO_CHANNEL mcp3008_io_chn_shutdown,
-			       MCP3008_IO_CHANNEL mcp3008_io_chn_cont_steer)
+redrobd_hw_cfg::redrobd_hw_cfg(adc_io *adc_io_ptr,
+			       ADC_IO_CHANNEL adc_io_chn_shutdown,
+			       ADC_IO_CHANNEL adc_io_chn_cont_steer)
 {
-  m_mcp3008_io_ptr = mcp3008_io_ptr;
-  m_mcp3008_io_chn_shutdown   = mcp3008_io_chn_shutdown;
-  m_mcp3008_io_chn_cont_steer = mcp3008_io_chn_cont_steer;
+  m_adc_io_ptr = adc_io_ptr;
+  m_adc_io_chn_shutdown   = adc_io_chn_shutdown;
+  m_adc_io_chn_cont_steer = adc_io_chn_cont_steer;
 
   init_members();
 }
@@ -70,7 +70,7 @@ bool redrobd_hw_cfg::select_shutdown(void)
 {
   // Shutdown: Pull-up   : False
   //           Pull-down : True
-  if (adc_channel_high(m_mcp3008_io_chn_shutdown)) {
+  if (adc_channel_high(m_adc_io_chn_shutdown)) {
     return false;
   }
   else {
@@ -84,7 +84,7 @@ bool redrobd_hw_cfg::select_continuous_steering(void)
 {
   // Continuous: Pull-up   : True
   //             Pull-down : False
-  if (adc_channel_high(m_mcp3008_io_chn_cont_steer)) {
+  if (adc_channel_high(m_adc_io_chn_cont_steer)) {
     return true;
   }
   else {
@@ -104,14 +104,14 @@ void redrobd_hw_cfg::init_members(void)
 
 ////////////////////////////////////////////////////////////////
 
-bool redrobd_hw_cfg::adc_channel_high(MCP3008_IO_CHANNEL chn)
+bool redrobd_hw_cfg::adc_channel_high(ADC_IO_CHANNEL chn)
 {
   uint16_t adc_value;
   float v_chn;
 
   // Get voltage from analog input
-  m_mcp3008_io_ptr->read_single(chn, adc_value);
-  v_chn = m_mcp3008_io_ptr->to_voltage(adc_value);
+  m_adc_io_ptr->read_single(chn, adc_value);
+  v_chn = m_adc_io_ptr->to_voltage(adc_value);
 
   // Check voltage above level for 'logic 1'
   if (v_chn > MIN_HIGH_VOLTAGE) {
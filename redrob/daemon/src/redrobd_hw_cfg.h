@@ -12,7 +12,7 @@
 #ifndef __REDROBD_HW_CFG_H__
 #define __REDROBD_HW_CFG_H__
 
-#include "mcp3008_io.h"
+#include "adc_io.h"
 
 using namespace std;
 
@@ -27,9 +27,9 @@ using namespace std;
 class redrobd_hw_cfg {
 
  public:
-  redrobd_hw_cfg(mcp3008_io *mcp3008_io_ptr,
-		 MCP3008_IO_CHANNEL mcp3008_io_chn_shutdown,
-		 MCP3008_IO_CHANNEL mcp3008_io_chn_cont_steer);
+  redrobd_hw_cfg(adc_io *adc_io_ptr,
+		 ADC_IO_CHANNEL adc_io_chn_shutdown,
+		 ADC_IO_CHANNEL adc_io_chn_cont_steer);
 
   ~redrobd_hw_cfg(void);
 
@@ -41,15 +41,15 @@ class redrobd_hw_cfg {
     
  private:
   // A/D Converter object pointer
-  mcp3008_io *m_mcp3008_io_ptr;
+  adc_io *m_adc_io_ptr;
 
   // A/D Converter channels
-  MCP3008_IO_CHANNEL m_mcp3008_io_chn_shutdown;
-  MCP3008_IO_CHANNEL m_mcp3008_io_chn_cont_steer;
+  ADC_IO_CHANNEL m_adc_io_chn_shutdown;
+  ADC_IO_CHANNEL m_adc_io_chn_cont_steer;
 
   void init_members(void);
 
-  bool adc_channel_high(MCP3008_IO_CHANNEL chn);
+  bool adc_channel_high(ADC_IO_CHANNEL chn);
 };
 
 #endif // __REDROBD_HW_CFG_H__
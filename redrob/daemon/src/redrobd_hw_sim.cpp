@@ -0,0 +1,512 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <vector>
+
+#include "redrobd_hw_sim.h"
+#include "redrobd.h"
+#include "rpi_hw.h"
+#include "delay.h"
+#include "excep.h"
+
+// Implementation notes:
+// 1. Simulation script format, one point on each line:
+//    # This is a comment
+//    <time> <item> <value>
+//    loop <period>
+//
+//    Time is seconds since start of daemon. Items are rf_forward,
+//    rf_reverse, rf_right, rf_left, dip_shutdown and dip_cont_steer
+//    (0 or 1), and vbat (Volt). An item keeps its value until next
+//    point, except vbat which is interpolated between points.
+//    With 'loop' the script is restarted after each period.
+//
+// 2. The script is read-only after initialization, so simulated
+//    inputs can be read by any thread without locking.
+//
+// 3. Each change of a GPIO output is recorded to the output file
+//    with time since start, pin name and new level.
+//
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definitions of macros
+/////////////////////////////////////////////////////////////////////////////
+#define SIM_MAX_LINE_LENGTH  256
+#define SIM_MAX_ITEM_LENGTH  32
+
+#define SIM_DEF_VBAT  7.4 // Volt
+
+// 10-bit resolution, same as MCP3008
+#define SIM_ADC_NR_BITS_RES  10
+#define SIM_ADC_MAX_VAL      ( (1 << SIM_ADC_NR_BITS_RES) - 1 )
+
+/////////////////////////////////////////////////////////////////////////////
+//               Module types
+/////////////////////////////////////////////////////////////////////////////
+typedef enum {SIM_RF_FORWARD,
+	      SIM_RF_REVERSE,
+	      SIM_RF_RIGHT,
+	      SIM_RF_LEFT,
+	      SIM_DIP_SHUTDOWN,
+	      SIM_DIP_CONT_STEER,
+	      SIM_VBAT,
+	      SIM_NR_ITEMS} SIM_ITEM;
+
+typedef struct {
+  const char *name;
+  float       def_value;   // Used before first point
+  bool        interpolate;
+} SIM_ITEM_INFO;
+
+typedef struct {
+  double time;
+  float  value;
+} SIM_POINT;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Module global variables
+/////////////////////////////////////////////////////////////////////////////
+
+// Default DIP-switches are pull-up (not shutdown, continuous steering)
+static const SIM_ITEM_INFO g_item_info[SIM_NR_ITEMS] = {
+  {"rf_forward",     0.0,          false},
+  {"rf_reverse",     0.0,          false},
+  {"rf_right",       0.0,          false},
+  {"rf_left",        0.0,          false},
+  {"dip_shutdown",   0.0,          false},
+  {"dip_cont_steer", 1.0,          false},
+  {"vbat",           SIM_DEF_VBAT, true}
+};
+
+static vector<SIM_POINT> g_script[SIM_NR_ITEMS];
+static double            g_loop_period = 0.0;
+static struct timespec   g_start_time;
+
+static FILE            *g_output_fp = NULL;
+static pthread_mutex_t  g_output_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Module functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+static double sim_time(void)
+{
+  struct timespec now;
+
+  if ( clock_gettime(get_clock_id(), &now) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+	      "Get time failed for hardware simulation");
+  }
+
+  return get_time_diff(&g_start_time, &now);
+}
+
+////////////////////////////////////////////////////////////////
+
+static float sim_value(SIM_ITEM item)
+{
+  const vector<SIM_POINT> &points = g_script[item];
+  double t = sim_time();
+
+  if (g_loop_period > 0.0) {
+    t -= (unsigned long)(t / g_loop_period) * g_loop_period;
+  }
+
+  if ( (points.empty()) || (t < points[0].time) ) {
+    return g_item_info[item].def_value;
+  }
+
+  // Find last point passed
+  unsigned i = 0;
+  while ( (i + 1 < points.size()) && (points[i + 1].time <= t) ) {
+    i++;
+  }
+
+  if ( (!g_item_info[item].interpolate) || (i + 1 == points.size()) ) {
+    return points[i].value;
+  }
+
+  const SIM_POINT &p0 = points[i];
+  const SIM_POINT &p1 = points[i + 1];
+
+  return p0.value + (p1.value - p0.value) * (t - p0.time) / (p1.time - p0.time);
+}
+
+////////////////////////////////////////////////////////////////
+
+static void sim_add_point(SIM_ITEM item,
+			  double time,
+			  float value)
+{
+  vector<SIM_POINT> &points = g_script[item];
+  SIM_POINT point;
+
+  point.time  = time;
+  point.value = value;
+
+  // Keep points sorted on time, same time keeps file order
+  vector<SIM_POINT>::iterator it = points.end();
+  while ( (it != points.begin()) && ((it - 1)->time > time) ) {
+    it--;
+  }
+  points.insert(it, point);
+}
+
+////////////////////////////////////////////////////////////////
+
+static void sim_load_script(const string &script_file)
+{
+  char line[SIM_MAX_LINE_LENGTH];
+  char item_name[SIM_MAX_ITEM_LENGTH];
+  unsigned line_nr = 0;
+  double time;
+  float value;
+
+  FILE *fp = fopen(script_file.c_str(), "r");
+  if (fp == NULL) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "Failed to open simulation script %s", script_file.c_str());
+  }
+
+  while (fgets(line, SIM_MAX_LINE_LENGTH, fp) != NULL) {
+    line_nr++;
+
+    // Skip comments and empty lines
+    char *first = line + strspn(line, " \t");
+    if ( (*first == '#') || (*first == '\n') || (*first == '\r') ||
+	 (*first == '\0') ) {
+      continue;
+    }
+
+    if (sscanf(first, "loop %lf", &time) == 1) {
+      g_loop_period = time;
+      continue;
+    }
+
+    int item = SIM_NR_ITEMS;
+    if (sscanf(first, "%lf %31s %f", &time, item_name, &value) == 3) {
+      for (item=0; item < SIM_NR_ITEMS; item++) {
+	if (strcmp(item_name, g_item_info[item].name) == 0) {
+	  break;
+	}
+      }
+    }
+    if ( (item == SIM_NR_ITEMS) || (time < 0.0) ) {
+      fclose(fp);
+      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_CFG_FILE_BAD_FORMAT,
+		"Bad line %u in simulation script %s",
+		line_nr, script_file.c_str());
+    }
+
+    sim_add_point((SIM_ITEM)item, time, value);
+  }
+
+  fclose(fp);
+}
+
+////////////////////////////////////////////////////////////////
+
+static const char* sim_pin_name(uint8_t pin)
+{
+  switch (pin) {
+  case PIN_SYSFAIL:
+    return "SYSFAIL";
+  case PIN_ALIVE:
+    return "ALIVE";
+  case PIN_BAT_LOW:
+    return "BAT_LOW";
+  case PIN_L293D_1A:
+    return "L293D_1A";
+  case PIN_L293D_2A:
+    return "L293D_2A";
+  case PIN_L293D_3A:
+    return "L293D_3A";
+  case PIN_L293D_4A:
+    return "L293D_4A";
+  default:
+    return "GPIO";
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+static void sim_record_output(uint8_t pin,
+			      uint8_t value)
+{
+  double t = sim_time();
+
+  pthread_mutex_lock(&g_output_mutex);
+
+  if (g_output_fp) {
+    fprintf(g_output_fp, "%.6f %s(%u) %u\n",
+	    t, sim_pin_name(pin), pin, value);
+  }
+
+  pthread_mutex_unlock(&g_output_mutex);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_hw_sim_initialize(const string &script_file,
+			       const string &output_file)
+{
+  for (unsigned i=0; i < SIM_NR_ITEMS; i++) {
+    g_script[i].clear();
+  }
+  g_loop_period = 0.0;
+
+  sim_load_script(script_file);
+
+  g_output_fp = fopen(output_file.c_str(), "w");
+  if (g_output_fp == NULL) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "Failed to open simulation output %s", output_file.c_str());
+  }
+
+  if ( clock_gettime(get_clock_id(), &g_start_time) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+	      "Get start time failed for hardware simulation");
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_hw_sim_finalize(void)
+{
+  pthread_mutex_lock(&g_output_mutex);
+
+  if (g_output_fp) {
+    fclose(g_output_fp);
+    g_output_fp = NULL;
+  }
+
+  pthread_mutex_unlock(&g_output_mutex);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Public member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+redrobd_sim_gpio::redrobd_sim_gpio(void)
+{
+  init_members();
+}
+
+////////////////////////////////////////////////////////////////
+
+redrobd_sim_gpio::~redrobd_sim_gpio(void)
+{
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_sim_gpio::initialize(void)
+{
+  init_members();
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_sim_gpio::finalize(void)
+{
+  init_members();
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_sim_gpio::set_function(uint8_t pin,
+				    RPI_GPIO_FUNCTION func)
+{
+  check_valid_pin(pin);
+
+  m_func[pin] = func;
+}
+
+////////////////////////////////////////////////////////////////
+
+RPI_GPIO_FUNCTION redrobd_sim_gpio::get_function(uint8_t pin)
+{
+  check_valid_pin(pin);
+
+  return m_func[pin];
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_sim_gpio::set_pin_high(uint8_t pin)
+{
+  set_pin(pin, 1);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_sim_gpio::set_pin_low(uint8_t pin)
+{
+  set_pin(pin, 0);
+}
+
+////////////////////////////////////////////////////////////////
+
+uint8_t redrobd_sim_gpio::get_pin(uint8_t pin)
+{
+  check_valid_pin(pin);
+
+  // Remote control (RF, Radio) inputs are scripted
+  switch (pin) {
+  case PIN_RF_IN_3:
+    return (sim_value(SIM_RF_FORWARD) != 0.0);
+  case PIN_RF_IN_2:
+    return (sim_value(SIM_RF_REVERSE) != 0.0);
+  case PIN_RF_IN_0:
+    return (sim_value(SIM_RF_RIGHT) != 0.0);
+  case PIN_RF_IN_1:
+    return (sim_value(SIM_RF_LEFT) != 0.0);
+  default:
+    return ( (__atomic_load_n(&m_level, __ATOMIC_RELAXED) & (1 << pin)) ?
+	     1 : 0 );
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Private member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_sim_gpio::init_members(void)
+{
+  for (unsigned i=0; i <= REDROBD_SIM_MAX_PIN; i++) {
+    m_func[i] = RPI_GPIO_FUNC_INP;
+  }
+  m_level = 0;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_sim_gpio::check_valid_pin(uint8_t pin)
+{
+  // Check that pin is allowed
+  if (pin > REDROBD_SIM_MAX_PIN) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_BAD_ARGUMENT,
+	      "GPIO pin(%u) not allowed, max pin(%u)",
+	      pin, REDROBD_SIM_MAX_PIN);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_sim_gpio::set_pin(uint8_t pin,
+			       uint8_t value)
+{
+  check_valid_pin(pin);
+
+  uint32_t mask = (1 << pin);
+  uint32_t old_level;
+
+  // Pins are set by several threads (motor control, LEDs)
+  if (value) {
+    old_level = __atomic_fetch_or(&m_level, mask, __ATOMIC_RELAXED);
+  }
+  else {
+    old_level = __atomic_fetch_and(&m_level, ~mask, __ATOMIC_RELAXED);
+  }
+
+  // Only changes are recorded
+  if ( ((old_level & mask) != 0) != (value != 0) ) {
+    sim_record_output(pin, value);
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Public member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+redrobd_sim_adc::redrobd_sim_adc(float vref)
+{
+  m_vref = vref;
+}
+
+////////////////////////////////////////////////////////////////
+
+redrobd_sim_adc::~redrobd_sim_adc(void)
+{
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_sim_adc::initialize(uint32_t speed)
+{
+  // Make GCC happy (-Wextra)
+  (void)speed;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_sim_adc::finalize(void)
+{
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_sim_adc::read_single(ADC_IO_CHANNEL channel,
+				  uint16_t &value)
+{
+  float v_chn;
+
+  // Same channel usage as hardware
+  switch (channel) {
+  case MCP3008_CHN_SHUTDOWN:
+    // Pull-down when selected
+    v_chn = (sim_value(SIM_DIP_SHUTDOWN) != 0.0 ? 0.0 : m_vref);
+    break;
+  case MCP3008_CHN_CONT_STEER:
+    // Pull-up when selected
+    v_chn = (sim_value(SIM_DIP_CONT_STEER) != 0.0 ? m_vref : 0.0);
+    break;
+  case MCP3008_CHN_VBAT:
+    v_chn = sim_value(SIM_VBAT) * MCP3008_CHN_VBAT_SF;
+    break;
+  default:
+    v_chn = 0.0;
+  }
+
+  // Convert to ADC value
+  float adc_value = v_chn * (float)(1 << SIM_ADC_NR_BITS_RES) / m_vref;
+  if (adc_value < 0.0) {
+    adc_value = 0.0;
+  }
+  if (adc_value > SIM_ADC_MAX_VAL) {
+    adc_value = SIM_ADC_MAX_VAL;
+  }
+
+  value = (uint16_t)adc_value;
+}
+
+////////////////////////////////////////////////////////////////
+
+float redrobd_sim_adc::to_voltage(uint16_t value)
+{
+  if (value > SIM_ADC_MAX_VAL) {
+    value = SIM_ADC_MAX_VAL;
+  }
+
+  return (value * m_vref) / (float)(1 << SIM_ADC_NR_BITS_RES);
+}
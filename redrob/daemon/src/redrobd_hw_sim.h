@@ -0,0 +1,98 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#ifndef __REDROBD_HW_SIM_H__
+#define __REDROBD_HW_SIM_H__
+
+#include <stdint.h>
+#include <string>
+
+#include "gpio_io.h"
+#include "adc_io.h"
+
+using namespace std;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of macros
+/////////////////////////////////////////////////////////////////////////////
+#define REDROBD_SIM_MAX_PIN  31
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of exported functions
+/////////////////////////////////////////////////////////////////////////////
+
+// Loads simulation script and opens file for recorded outputs.
+// Script time starts when initialized.
+extern void redrobd_hw_sim_initialize(const string &script_file,
+				      const string &output_file);
+
+extern void redrobd_hw_sim_finalize(void);
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of classes
+/////////////////////////////////////////////////////////////////////////////
+
+// Simulated GPIO, RF inputs from script and outputs recorded
+class redrobd_sim_gpio : public gpio_io {
+
+ public:
+  redrobd_sim_gpio(void);
+  ~redrobd_sim_gpio(void);
+
+  // Implements pure virtual functions from base class
+  virtual void initialize(void);
+
+  virtual void finalize(void);
+
+  virtual void set_function(uint8_t pin,
+			    RPI_GPIO_FUNCTION func);
+
+  virtual RPI_GPIO_FUNCTION get_function(uint8_t pin);
+
+  virtual void set_pin_high(uint8_t pin);
+
+  virtual void set_pin_low(uint8_t pin);
+
+  virtual uint8_t get_pin(uint8_t pin);
+
+ private:
+  RPI_GPIO_FUNCTION m_func[REDROBD_SIM_MAX_PIN + 1];
+  uint32_t          m_level; // One bit for each pin
+
+  void init_members(void);
+
+  void check_valid_pin(uint8_t pin);
+
+  void set_pin(uint8_t pin,
+	       uint8_t value);
+};
+
+// Simulated MCP3008, DIP-switches and battery voltage from script
+class redrobd_sim_adc : public adc_io {
+
+ public:
+  redrobd_sim_adc(float vref);
+  ~redrobd_sim_adc(void);
+
+  // Implements pure virtual functions from base class
+  virtual void initialize(uint32_t speed);
+  virtual void finalize(void);
+
+  virtual void read_single(ADC_IO_CHANNEL channel,
+			   uint16_t &value);
+
+  virtual float to_voltage(uint16_t value);
+
+ private:
+  float m_vref;
+};
+
+#endif // __REDROBD_HW_SIM_H__
@@ -0,0 +1,698 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/epoll.h>
+
+#include "redrobd_rc_net_server_thread.h"
+#include "socket_support.h"
+#include "histogram.h"
+#include "delay.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of macros
+/////////////////////////////////////////////////////////////////////////////
+
+#define LOADGEN_DEF_SERVER_IP    "127.0.0.1"
+#define LOADGEN_DEF_SERVER_PORT  52022
+#define LOADGEN_DEF_CONNECTIONS  4
+#define LOADGEN_DEF_RATE         100.0 // Requests/s for each connection
+#define LOADGEN_DEF_DURATION     10.0  // Seconds
+#define LOADGEN_DEF_BATCH        3     // Commands in each frame
+
+#define LOADGEN_MAX_CONNECTIONS  RC_NET_MAX_CLIENTS // Server client slots
+#define LOADGEN_MAX_PENDING      256 // Requests waiting for reply
+
+// Command types
+#define LOADGEN_STEER     0
+#define LOADGEN_CAMERA    1
+#define LOADGEN_VOLTAGE   2
+#define LOADGEN_SYS_STAT  3
+#define LOADGEN_NR_TYPES  4
+
+// Latency histograms, one for each type and one for frames
+#define LOADGEN_FRAME     LOADGEN_NR_TYPES
+#define LOADGEN_NR_HISTS  (LOADGEN_NR_TYPES + 1)
+
+#define LOADGEN_BUF_SIZE  4096
+
+// Sender may lag at most this before rate is reset (seconds)
+#define LOADGEN_MAX_LAG  1.0
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of types
+/////////////////////////////////////////////////////////////////////////////
+
+// Request sent, waiting for reply
+typedef struct {
+  struct timespec send_time; // Intended send time (open loop)
+  unsigned        type;      // LOADGEN_xxx, LOADGEN_FRAME if framed
+  unsigned        reply_len; // Expected reply (legacy protocol)
+} LOADGEN_PENDING;
+
+typedef struct {
+  socket_connection conn;
+  uint8_t           rx_buf[LOADGEN_BUF_SIZE];
+  uint8_t           tx_buf[LOADGEN_BUF_SIZE];
+  unsigned          seed;      // Command mix random generator
+  struct timespec   next_send; // Open loop
+  LOADGEN_PENDING   pending[LOADGEN_MAX_PENDING];
+  unsigned          pending_first;
+  unsigned          pending_count;
+} LOADGEN_CONN;
+
+typedef struct {
+  string   server_ip;
+  uint16_t server_port;
+  string   unix_path; // Local socket (AF_UNIX) used if not empty
+  unsigned connections;
+  double   rate;     // Zero means closed loop
+  double   duration;
+  unsigned mix[LOADGEN_NR_TYPES];
+  bool     motion;   // Steer codes moving the robot, not only none
+  bool     framed;
+  unsigned batch;
+} LOADGEN_CONFIG;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Module global variables
+/////////////////////////////////////////////////////////////////////////////
+
+static const char *g_type_name[LOADGEN_NR_HISTS] = {
+  "steer", "camera", "voltage", "sys_stat", "frame"
+};
+
+static LOADGEN_CONFIG g_cfg;
+static LOADGEN_CONN   g_conn[LOADGEN_MAX_CONNECTIONS];
+static histogram      g_hist[LOADGEN_NR_HISTS];
+static uint32_t       g_sent[LOADGEN_NR_TYPES];
+static uint32_t       g_replies;
+static uint32_t       g_skipped; // Too many pending requests
+static uint32_t       g_lagged;  // Not sent, sender lagged too much
+static uint32_t       g_disconnected;
+
+static volatile sig_atomic_t g_stop = 0;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Function prototypes
+/////////////////////////////////////////////////////////////////////////////
+
+static void loadgen_usage(const char *prog);
+static bool loadgen_parse_args(int argc, char *argv[]);
+static void loadgen_signal(int sig);
+static bool loadgen_connect(unsigned index);
+static void loadgen_disconnect(unsigned index);
+static unsigned loadgen_pick_type(LOADGEN_CONN *c);
+static unsigned loadgen_put_command(uint8_t *buf, unsigned type);
+static bool loadgen_send(unsigned index,
+			 const struct timespec *send_time);
+static void loadgen_receive(unsigned index);
+static void loadgen_report(double elapsed);
+
+/////////////////////////////////////////////////////////////////////////////
+//               Public functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+  struct epoll_event events[LOADGEN_MAX_CONNECTIONS];
+  struct timespec start;
+  struct timespec now;
+
+  if (!loadgen_parse_args(argc, argv)) {
+    loadgen_usage(argv[0]);
+    return 1;
+  }
+
+  signal(SIGINT, loadgen_signal);
+  signal(SIGTERM, loadgen_signal);
+  signal(SIGPIPE, SIG_IGN);
+
+  int epoll_fd = epoll_create(LOADGEN_MAX_CONNECTIONS);
+  if (epoll_fd == -1) {
+    fprintf(stderr, "Create epoll failed (%s)\n", strerror(errno));
+    return 1;
+  }
+
+  clock_gettime(get_clock_id(), &start);
+
+  for (unsigned i=0; i < g_cfg.connections; i++) {
+    if (!loadgen_connect(i)) {
+      return 1;
+    }
+
+    struct epoll_event ev;
+    bzero(&ev, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = i;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD,
+		  g_conn[i].conn.get_sockd(), &ev) == -1) {
+      fprintf(stderr, "Add epoll failed (%s)\n", strerror(errno));
+      return 1;
+    }
+
+    // Spread start of connections over one period
+    double phase = (g_cfg.rate > 0.0 ?
+		    i / (g_cfg.rate * g_cfg.connections) : 0.0);
+    get_new_time(&start, phase, &g_conn[i].next_send);
+    g_conn[i].seed = i + 1;
+  }
+
+  if (g_cfg.unix_path.empty()) {
+    printf("Running %u connection(s) against %s:%u for %.1fs\n",
+	   g_cfg.connections, g_cfg.server_ip.c_str(),
+	   g_cfg.server_port, g_cfg.duration);
+  }
+  else {
+    printf("Running %u connection(s) against %s for %.1fs\n",
+	   g_cfg.connections, g_cfg.unix_path.c_str(), g_cfg.duration);
+  }
+
+  clock_gettime(get_clock_id(), &start);
+  now = start;
+
+  while ( (!g_stop) &&
+	  (get_time_diff(&start, &now) < g_cfg.duration) ) {
+
+    // Wake up for next send (open loop) or poll (closed loop)
+    int timeout_ms = 1;
+    if (g_cfg.rate > 0.0) {
+      double earliest = 1.0;
+      for (unsigned i=0; i < g_cfg.connections; i++) {
+	if (g_conn[i].conn.is_attached()) {
+	  double diff = get_time_diff(&now, &g_conn[i].next_send);
+	  if (diff < earliest) {
+	    earliest = diff;
+	  }
+	}
+      }
+      timeout_ms = (earliest > 0.0 ? (int)(earliest * 1000.0) : 0);
+    }
+
+    int nr_events = epoll_wait(epoll_fd, events,
+			       LOADGEN_MAX_CONNECTIONS, timeout_ms);
+    if ( (nr_events == -1) && (errno != EINTR) ) {
+      fprintf(stderr, "Wait epoll failed (%s)\n", strerror(errno));
+      break;
+    }
+
+    clock_gettime(get_clock_id(), &now);
+
+    for (int i=0; i < nr_events; i++) {
+      unsigned index = events[i].data.u32;
+      if (g_conn[index].conn.is_attached()) {
+	loadgen_receive(index);
+      }
+    }
+
+    unsigned active = 0;
+    for (unsigned i=0; i < g_cfg.connections; i++) {
+      LOADGEN_CONN *c = &g_conn[i];
+
+      if (!c->conn.is_attached()) {
+	continue;
+      }
+      active++;
+
+      if (g_cfg.rate > 0.0) {
+	// Open loop, all sends that are due
+	while (get_time_diff(&now, &c->next_send) <= 0.0) {
+	  double lag = get_time_diff(&c->next_send, &now);
+	  if (lag > LOADGEN_MAX_LAG) {
+	    g_lagged += (uint32_t)(lag * g_cfg.rate);
+	    c->next_send = now;
+	  }
+
+	  // Latency is measured from when the request should have
+	  // been sent, a slow reply can't hide delayed requests
+	  // (coordinated omission)
+	  struct timespec send_time = c->next_send;
+	  get_new_time(&c->next_send, 1.0 / g_cfg.rate, &c->next_send);
+	  if (!loadgen_send(i, &send_time)) {
+	    break;
+	  }
+	}
+      }
+      else {
+	// Closed loop, one request waiting for reply
+	while (!c->pending_count) {
+	  if (!loadgen_send(i, &now)) {
+	    break;
+	  }
+	}
+      }
+
+      long rc = c->conn.flush();
+      if ( (rc != SOCKET_SUPPORT_SUCCESS) &&
+	   (rc != SOCKET_SUPPORT_WOULD_BLOCK) &&
+	   (rc != SOCKET_SUPPORT_INTERRUPTED) ) {
+	loadgen_disconnect(i);
+      }
+    }
+
+    if (!active) {
+      fprintf(stderr, "All connections closed\n");
+      break;
+    }
+  }
+
+  clock_gettime(get_clock_id(), &now);
+  loadgen_report(get_time_diff(&start, &now));
+
+  for (unsigned i=0; i < g_cfg.connections; i++) {
+    if (g_conn[i].conn.is_attached()) {
+      g_conn[i].conn.close();
+    }
+  }
+  close(epoll_fd);
+
+  return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Private functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+static void loadgen_usage(const char *prog)
+{
+  printf("Usage: %s [options]\n", prog);
+  printf("  -a <ip>     Server address (default %s)\n",
+	 LOADGEN_DEF_SERVER_IP);
+  printf("  -p <port>   Server port (default %u)\n",
+	 LOADGEN_DEF_SERVER_PORT);
+  printf("  -u <path>   Local socket (AF_UNIX) instead of address and port\n");
+  printf("  -c <n>      Connections, max %u (default %u)\n",
+	 LOADGEN_MAX_CONNECTIONS, LOADGEN_DEF_CONNECTIONS);
+  printf("  -r <rate>   Requests/s for each connection, "
+	 "0 is closed loop (default %.0f)\n", LOADGEN_DEF_RATE);
+  printf("  -d <sec>    Duration (default %.0f)\n", LOADGEN_DEF_DURATION);
+  printf("  -m <mix>    Command weights steer:camera:voltage:sys_stat "
+	 "(default 70:0:20:10)\n");
+  printf("  -s          Steer codes move the robot (forward, right, left),\n"
+	 "              default is only none\n");
+  printf("  -f          Framed protocol, one request is a frame\n");
+  printf("  -b <n>      Commands in each frame (default %u)\n",
+	 LOADGEN_DEF_BATCH);
+  printf("Legacy protocol: latency is measured for voltage and sys_stat,\n");
+  printf("steer and camera have no reply. Framed protocol: latency is\n");
+  printf("measured for each frame.\n");
+}
+
+////////////////////////////////////////////////////////////////
+
+static bool loadgen_parse_args(int argc, char *argv[])
+{
+  int opt;
+
+  g_cfg.server_ip = LOADGEN_DEF_SERVER_IP;
+  g_cfg.server_port = LOADGEN_DEF_SERVER_PORT;
+  g_cfg.unix_path = "";
+  g_cfg.connections = LOADGEN_DEF_CONNECTIONS;
+  g_cfg.rate = LOADGEN_DEF_RATE;
+  g_cfg.duration = LOADGEN_DEF_DURATION;
+  g_cfg.mix[LOADGEN_STEER] = 70;
+  g_cfg.mix[LOADGEN_CAMERA] = 0;
+  g_cfg.mix[LOADGEN_VOLTAGE] = 20;
+  g_cfg.mix[LOADGEN_SYS_STAT] = 10;
+  g_cfg.motion = false;
+  g_cfg.framed = false;
+  g_cfg.batch = LOADGEN_DEF_BATCH;
+
+  while ((opt = getopt(argc, argv, "a:p:u:c:r:d:m:sfb:h")) != -1) {
+    switch (opt) {
+    case 'a':
+      g_cfg.server_ip = optarg;
+      break;
+    case 'p':
+      g_cfg.server_port = (uint16_t)atoi(optarg);
+      break;
+    case 'u':
+      g_cfg.unix_path = optarg;
+      break;
+    case 'c':
+      g_cfg.connections = (unsigned)atoi(optarg);
+      break;
+    case 'r':
+      g_cfg.rate = atof(optarg);
+      break;
+    case 'd':
+      g_cfg.duration = atof(optarg);
+      break;
+    case 'm':
+      if (sscanf(optarg, "%u:%u:%u:%u",
+		 &g_cfg.mix[LOADGEN_STEER],
+		 &g_cfg.mix[LOADGEN_CAMERA],
+		 &g_cfg.mix[LOADGEN_VOLTAGE],
+		 &g_cfg.mix[LOADGEN_SYS_STAT]) != 4) {
+	return false;
+      }
+      break;
+    case 's':
+      g_cfg.motion = true;
+      break;
+    case 'f':
+      g_cfg.framed = true;
+      break;
+    case 'b':
+      g_cfg.batch = (unsigned)atoi(optarg);
+      break;
+    default:
+      return false;
+    }
+  }
+
+  unsigned mix_sum = 0;
+  for (unsigned i=0; i < LOADGEN_NR_TYPES; i++) {
+    mix_sum += g_cfg.mix[i];
+  }
+
+  // More connections would be refused by server
+  if (g_cfg.connections > LOADGEN_MAX_CONNECTIONS) {
+    fprintf(stderr, "Server accepts at most %u clients\n",
+	    LOADGEN_MAX_CONNECTIONS);
+    return false;
+  }
+
+  // Closed loop needs commands with replies to wait for
+  if ( (!g_cfg.framed) && (g_cfg.rate <= 0.0) &&
+       (!g_cfg.mix[LOADGEN_VOLTAGE]) && (!g_cfg.mix[LOADGEN_SYS_STAT]) ) {
+    fprintf(stderr, "Closed loop needs voltage or sys_stat in mix\n");
+    return false;
+  }
+
+  return ( (g_cfg.connections > 0) &&
+	   (g_cfg.connections <= LOADGEN_MAX_CONNECTIONS) &&
+	   (g_cfg.rate >= 0.0) &&
+	   (g_cfg.duration > 0.0) &&
+	   (mix_sum > 0) &&
+	   (g_cfg.batch > 0) &&
+	   (g_cfg.batch * 3 <= RC_NET_MAX_FRAME_SIZE) );
+}
+
+////////////////////////////////////////////////////////////////
+
+static void loadgen_signal(int sig)
+{
+  if (sig) {
+    g_stop = 1;
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+static bool loadgen_connect(unsigned index)
+{
+  socket_address server_sa;
+  int sockd;
+
+  if (!g_cfg.unix_path.empty()) {
+    if (create_unix_socket(&sockd) != SOCKET_SUPPORT_SUCCESS) {
+      fprintf(stderr, "Create socket failed\n");
+      return false;
+    }
+    if (connect_unix_socket(sockd,
+			    g_cfg.unix_path.c_str()) != SOCKET_SUPPORT_SUCCESS) {
+      fprintf(stderr, "Connect[%u] to %s failed\n",
+	      index, g_cfg.unix_path.c_str());
+      close_socket(sockd);
+      return false;
+    }
+  }
+  else {
+    if ( (to_net_address(g_cfg.server_ip.c_str(),
+			 &server_sa.net_addr) != SOCKET_SUPPORT_SUCCESS) ||
+	 (create_tcp_socket(&sockd) != SOCKET_SUPPORT_SUCCESS) ) {
+      fprintf(stderr, "Create socket failed\n");
+      return false;
+    }
+    server_sa.port = g_cfg.server_port;
+
+    if (connect_socket(sockd, server_sa) != SOCKET_SUPPORT_SUCCESS) {
+      fprintf(stderr, "Connect[%u] to %s:%u failed\n",
+	      index, g_cfg.server_ip.c_str(), g_cfg.server_port);
+      close_socket(sockd);
+      return false;
+    }
+    set_opt_tcp_nodelay(sockd, true);
+  }
+
+  // Negotiate protocol before going non-blocking
+  if (g_cfg.framed) {
+    uint8_t hello[3];
+    uint8_t reply[3];
+    unsigned actual_bytes;
+    uint16_t cmd = CLI_CMD_HELLO;
+
+    hton16(&cmd);
+    memcpy(hello, &cmd, sizeof(cmd));
+    hello[sizeof(cmd)] = RC_NET_PROTO_FRAMED;
+
+    if ( (send_socket(sockd, hello, sizeof(hello), true,
+		      &actual_bytes) != SOCKET_SUPPORT_SUCCESS) ||
+	 (recv_socket(sockd, reply, sizeof(reply), true, false,
+		      &actual_bytes) != SOCKET_SUPPORT_SUCCESS) ||
+	 (actual_bytes != sizeof(reply)) ||
+	 (reply[sizeof(cmd)] != RC_NET_PROTO_FRAMED) ) {
+      fprintf(stderr, "Connect[%u] framed protocol not supported\n", index);
+      close_socket(sockd);
+      return false;
+    }
+  }
+
+  if (set_attr_blocked(sockd, false) != SOCKET_SUPPORT_SUCCESS) {
+    fprintf(stderr, "Non-blocking socket failed\n");
+    close_socket(sockd);
+    return false;
+  }
+
+  LOADGEN_CONN *c = &g_conn[index];
+  c->conn.attach(sockd,
+		 c->rx_buf, sizeof(c->rx_buf),
+		 c->tx_buf, sizeof(c->tx_buf));
+  c->pending_first = 0;
+  c->pending_count = 0;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////
+
+static void loadgen_disconnect(unsigned index)
+{
+  fprintf(stderr, "Connection[%u] closed by server\n", index);
+  g_conn[index].conn.close();
+  g_disconnected++;
+}
+
+////////////////////////////////////////////////////////////////
+
+static unsigned loadgen_pick_type(LOADGEN_CONN *c)
+{
+  unsigned mix_sum = 0;
+  for (unsigned i=0; i < LOADGEN_NR_TYPES; i++) {
+    mix_sum += g_cfg.mix[i];
+  }
+
+  unsigned pick = rand_r(&c->seed) % mix_sum;
+  for (unsigned i=0; i < LOADGEN_NR_TYPES; i++) {
+    if (pick < g_cfg.mix[i]) {
+      return i;
+    }
+    pick -= g_cfg.mix[i];
+  }
+  return LOADGEN_STEER;
+}
+
+////////////////////////////////////////////////////////////////
+
+static unsigned loadgen_put_command(uint8_t *buf, unsigned type)
+{
+  static const uint16_t cmd_code[LOADGEN_NR_TYPES] = {
+    CLI_CMD_STEER, CLI_CMD_CAMERA, CLI_CMD_GET_VOLTAGE, CLI_CMD_GET_SYS_STATS
+  };
+  static const uint8_t steer_code[4] = {
+    CLI_STEER_FORWARD, CLI_STEER_RIGHT, CLI_STEER_LEFT, CLI_STEER_NONE
+  };
+  static unsigned steer_index = 0;
+
+  uint16_t cmd = cmd_code[type];
+  hton16(&cmd);
+  memcpy(buf, &cmd, sizeof(cmd));
+
+  if (type == LOADGEN_STEER) {
+    buf[sizeof(cmd)] = (g_cfg.motion ?
+			steer_code[steer_index++ % 4] : CLI_STEER_NONE);
+    return sizeof(cmd) + sizeof(uint8_t);
+  }
+  if (type == LOADGEN_CAMERA) {
+    buf[sizeof(cmd)] = CLI_CAMERA_NONE;
+    return sizeof(cmd) + sizeof(uint8_t);
+  }
+  return sizeof(cmd);
+}
+
+////////////////////////////////////////////////////////////////
+
+static bool loadgen_send(unsigned index,
+			 const struct timespec *send_time)
+{
+  static const unsigned reply_len[LOADGEN_NR_TYPES] = {
+    0, 0, sizeof(uint16_t), sizeof(RC_NET_SYS_STAT)
+  };
+
+  LOADGEN_CONN *c = &g_conn[index];
+  uint8_t request[sizeof(uint16_t) + RC_NET_MAX_FRAME_SIZE];
+  unsigned request_len = 0;
+  unsigned type = LOADGEN_FRAME;
+  unsigned expected = 0;
+
+  if (c->pending_count == LOADGEN_MAX_PENDING) {
+    g_skipped++;
+    return false;
+  }
+
+  if (g_cfg.framed) {
+    // Frame : length (uint16) followed by commands
+    request_len = sizeof(uint16_t);
+    for (unsigned i=0; i < g_cfg.batch; i++) {
+      unsigned t = loadgen_pick_type(c);
+      request_len += loadgen_put_command(request + request_len, t);
+      g_sent[t]++;
+    }
+    uint16_t len = request_len - sizeof(uint16_t);
+    hton16(&len);
+    memcpy(request, &len, sizeof(len));
+  }
+  else {
+    type = loadgen_pick_type(c);
+    request_len = loadgen_put_command(request, type);
+    expected = reply_len[type];
+    g_sent[type]++;
+  }
+
+  if (c->conn.queue(request, request_len) != SOCKET_SUPPORT_SUCCESS) {
+    g_skipped++;
+    return false;
+  }
+
+  // Every frame has a reply, legacy commands may not
+  if ( (g_cfg.framed) || (expected) ) {
+    LOADGEN_PENDING *p =
+      &c->pending[(c->pending_first + c->pending_count) % LOADGEN_MAX_PENDING];
+    p->send_time = *send_time;
+    p->type = type;
+    p->reply_len = expected;
+    c->pending_count++;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////
+
+static void loadgen_receive(unsigned index)
+{
+  LOADGEN_CONN *c = &g_conn[index];
+  struct timespec now;
+  unsigned actual_bytes;
+
+  long rc = c->conn.fill(&actual_bytes);
+  if ( (rc == SOCKET_SUPPORT_WOULD_BLOCK) ||
+       (rc == SOCKET_SUPPORT_INTERRUPTED) ) {
+    return;
+  }
+  if ( (rc != SOCKET_SUPPORT_SUCCESS) || (!actual_bytes) ) {
+    loadgen_disconnect(index);
+    return;
+  }
+
+  clock_gettime(get_clock_id(), &now);
+
+  while (c->pending_count) {
+    LOADGEN_PENDING *p = &c->pending[c->pending_first];
+    const uint8_t *data = c->conn.get_rx_data();
+    unsigned avail = c->conn.get_rx_len();
+    unsigned len = p->reply_len;
+
+    if (g_cfg.framed) {
+      uint16_t frame_len;
+      if (avail < sizeof(frame_len)) {
+	break;
+      }
+      memcpy(&frame_len, data, sizeof(frame_len));
+      ntoh16(&frame_len);
+      len = sizeof(frame_len) + (frame_len & ~FRAME_PUSH_FLAG);
+      if (avail < len) {
+	break;
+      }
+      if (frame_len & FRAME_PUSH_FLAG) {
+	c->conn.consume(len); // Not subscribed, ignore
+	continue;
+      }
+    }
+    else if (avail < len) {
+      break;
+    }
+
+    c->conn.consume(len);
+    g_hist[p->type].add(get_time_diff(&p->send_time, &now));
+    g_replies++;
+
+    c->pending_first = (c->pending_first + 1) % LOADGEN_MAX_PENDING;
+    c->pending_count--;
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+static void loadgen_report(double elapsed)
+{
+  uint32_t total = 0;
+
+  for (unsigned i=0; i < LOADGEN_NR_TYPES; i++) {
+    total += g_sent[i];
+  }
+
+  printf("Elapsed %.2fs, %s protocol, %u connection(s)\n",
+	 elapsed, (g_cfg.framed ? "framed" : "legacy"), g_cfg.connections);
+  printf("Commands sent %u (%.0f/s), replies %u (%.0f/s)\n",
+	 total, total / elapsed, g_replies, g_replies / elapsed);
+  printf("  steer=%u, camera=%u, voltage=%u, sys_stat=%u\n",
+	 g_sent[LOADGEN_STEER], g_sent[LOADGEN_CAMERA],
+	 g_sent[LOADGEN_VOLTAGE], g_sent[LOADGEN_SYS_STAT]);
+  if ( (g_skipped) || (g_lagged) || (g_disconnected) ) {
+    printf("Skipped %u (too many pending), lagged %u, disconnected %u\n",
+	   g_skipped, g_lagged, g_disconnected);
+  }
+
+  printf("Round-trip latency (us):\n");
+  for (unsigned i=0; i < LOADGEN_NR_HISTS; i++) {
+    const histogram &h = g_hist[i];
+    if (!h.get_count()) {
+      continue;
+    }
+    printf("  %-8s n=%u min=%u p50=%u p99=%u p999=%u max=%u\n",
+	   g_type_name[i], h.get_count(), h.get_min_us(),
+	   h.get_percentile_us(50.0), h.get_percentile_us(99.0),
+	   h.get_percentile_us(99.9), h.get_max_us());
+  }
+}
@@ -10,16 +10,63 @@
 // ************************************************************************
 
 #include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <string.h>
 #include <time.h>
 #include <memory>
 #include <iostream>
 
 #include "redrobd_log.h"
 #include "redrobd.h"
+#include "redrobd_error_utility.h"
+#include "daemon_utility.h"
+#include "delay.h"
 #include "excep.h"
 
+// Implementation notes:
+// 1. Messages are time stamped and queued by the writing thread,
+//    no lock, formatting or file write is done by the caller.
+//    A full queue drops the message, a slow logfile (SD card)
+//    never delays the caller. Drops are reported in the logfile.
+//
+// 2. The writer thread runs with lowest priority (SCHED_OTHER,
+//    nice). It wakes up periodically, formats all queued messages
+//    and writes them in as few writes as possible.
+//
+// 3. Before initialize and after finalize messages are written
+//    directly by the caller.
+//
+// 4. Messages are time stamped with the monotonic clock. The writer
+//    maps it to realtime when formatting text. A binary logfile
+//    stores the monotonic time, the mapping is stored in sync
+//    records (see redrobd_log_msg.h). Text of a binary logfile is
+//    only formatted if written to STDOUT.
+//
+// 5. A circular logfile has a fixed size, allocated when created.
+//    It is written one whole block at a time at block aligned
+//    offsets, the newest block is rewritten until full. The header
+//    block is rewritten when the newest block has been written.
+//    An existing circular logfile of the same size and format is
+//    continued, one of other size or format is replaced. Any other
+//    file that is not empty is never overwritten, it must be moved
+//    or removed by the user.
+//
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definitions of macros
+/////////////////////////////////////////////////////////////////////////////
+#define WRITER_PERIOD  0.05 // Seconds
+#define WRITER_NICE    19
+
+#define NSEC_PER_SEC  1000000000LL
+
+// Realtime clock set, new sync record in binary logfile
+#define SYNC_LIMIT  NSEC_PER_SEC
+
 redrobd_log* redrobd_log::m_instance = NULL;
 
 /////////////////////////////////////////////////////////////////////////////
@@ -47,28 +94,30 @@ redrobd_log* redrobd_log::instance(void)
 ////////////////////////////////////////////////////////////////
 
 void redrobd_log::initialize(string logfile,
-			     bool log_stdout)
+			     bool log_stdout,
+			     bool binary,
+			     unsigned size_kb)
 {
-  int rc;
-
   m_logfile = logfile;
   m_log_stdout = log_stdout;
+  m_binary = binary;
+  m_need_sync = true;
+
+  // Header block is part of size
+  m_ring_blocks = 0;
+  if (size_kb) {
+    m_ring_blocks = (size_kb * 1024 / REDROBD_LOG_BLOCK_SIZE) - 1;
+    if (m_ring_blocks < 1) {
+      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_FILE_OPERATION_FAILED,
+		"Circular logfile too small (%u KB)", size_kb);
+    }
+  }
 
   // Open logfile
-  rc = open(m_logfile.c_str(), 
-	    O_WRONLY | O_CREAT,
-	    S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH);
-  if (rc == -1) {
-    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
-	      "open failed, logfile (%s)", m_logfile.c_str());
-  }
-  m_fd = rc;
+  m_fd = open_logfile(m_logfile, &m_ring);
+  load_block();
 
-  // Move to end of file
-  if ( lseek(m_fd, 0, SEEK_END) == -1 ) {
-    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
-	      "lseek failed, logfile (%s)", m_logfile.c_str());
-  }  
+  start_writer();
 }
 
 ////////////////////////////////////////////////////////////////
@@ -77,6 +126,9 @@ void redrobd_log::finalize(void)
 {
   int rc;
 
+  // Queued messages are written
+  stop_writer();
+
   // Close logfile
   rc = close(m_fd);
   if (rc == -1) {
@@ -87,28 +139,31 @@ void redrobd_log::finalize(void)
 
 ////////////////////////////////////////////////////////////////
 
-void redrobd_log::writeln(string str)
+void redrobd_log::reopen(string logfile,
+			 bool log_stdout)
 {
+  REDROBD_LOG_RING_HEADER ring;
+
+  // Open new logfile before old is closed,
+  // keeps old logfile if open fails
+  int fd = open_logfile(logfile, &ring);
+  int old_fd;
+
   try {
     // Lockdown write operation
     pthread_mutex_lock(&m_write_mutex);
 
-    // Decorate message with date and time prefix
-    char prefix[40];
-    get_date_time_prefix(prefix, sizeof(prefix));
+    // Anything not yet written goes to old logfile
+    write_batch();
 
-    // Add newline
-    string the_message = prefix + str + "\n";
+    old_fd = m_fd;
+    m_fd = fd;
+    m_logfile = logfile;
+    m_log_stdout = log_stdout;
+    m_need_sync = true;
 
-    // Write message to file
-    write_all(m_fd,
-	      (uint8_t *)the_message.c_str(),
-	      the_message.length());
-
-    // Write message to STDOUT
-    if (m_log_stdout) {
-      cout << the_message;
-    }
+    m_ring = ring;
+    load_block();
 
     // Lockup write operation
     pthread_mutex_unlock(&m_write_mutex);
@@ -117,6 +172,107 @@ void redrobd_log::writeln(string str)
     pthread_mutex_unlock(&m_write_mutex);
     throw;
   }
+
+  // Close old logfile
+  if (close(old_fd) == -1) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "close failed, old logfile");
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::writeln(string str)
+{
+  write_entry(REDROBD_LOG_MSG_TEXT, str.data(), str.length());
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::writemsg(uint16_t id)
+{
+  write_entry(id, NULL, 0);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::writemsg(uint16_t id,
+			   const redrobd_log_arg &a0)
+{
+  uint32_t args[1] = {a0.get_word()};
+
+  write_entry(id, args, sizeof(args));
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::writemsg(uint16_t id,
+			   const redrobd_log_arg &a0,
+			   const redrobd_log_arg &a1)
+{
+  uint32_t args[2] = {a0.get_word(), a1.get_word()};
+
+  write_entry(id, args, sizeof(args));
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::writemsg(uint16_t id,
+			   const redrobd_log_arg &a0,
+			   const redrobd_log_arg &a1,
+			   const redrobd_log_arg &a2)
+{
+  uint32_t args[3] = {a0.get_word(), a1.get_word(), a2.get_word()};
+
+  write_entry(id, args, sizeof(args));
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::writemsg(uint16_t id,
+			   const redrobd_log_arg &a0,
+			   const redrobd_log_arg &a1,
+			   const redrobd_log_arg &a2,
+			   const redrobd_log_arg &a3)
+{
+  uint32_t args[4] = {a0.get_word(), a1.get_word(),
+		      a2.get_word(), a3.get_word()};
+
+  write_entry(id, args, sizeof(args));
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::writemsg_args(uint16_t id,
+				const uint32_t *args,
+				unsigned nargs)
+{
+  write_entry(id, args, nargs * sizeof(uint32_t));
+}
+
+////////////////////////////////////////////////////////////////
+
+uint32_t redrobd_log::get_drops(void)
+{
+  return m_queue.get_drops();
+}
+
+////////////////////////////////////////////////////////////////
+
+int redrobd_log::open_reader(void)
+{
+  int fd = -1;
+
+  // Logfile may be switched by reopen
+  pthread_mutex_lock(&m_write_mutex);
+
+  if (m_fd >= 0) {
+    fd = open(m_logfile.c_str(), O_RDONLY | O_CLOEXEC);
+  }
+
+  pthread_mutex_unlock(&m_write_mutex);
+
+  return fd;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -129,34 +285,603 @@ redrobd_log::redrobd_log(void)
 {
   m_logfile    = "";
   m_log_stdout = false;
+  m_binary     = false;
+  m_ring_blocks = 0;
   m_fd         = -1;
 
   pthread_mutex_init(&m_write_mutex, NULL); // Use default mutex attributes
+
+  m_writer_running = false;
+  m_writer_stop    = false;
+  m_reported_drops = 0;
+  m_batch_len      = 0;
+  m_text_len       = 0;
+
+  m_clock_offset = 0;
+  m_sync_offset  = 0;
+  m_need_sync    = false;
+  m_prefix_time  = 0;
+  m_prefix[0]    = '\0';
+
+  memset(&m_ring, 0, sizeof(m_ring));
+  m_block_len   = 0;
+  m_block_dirty = false;
+}
+
+////////////////////////////////////////////////////////////////
+
+int redrobd_log::open_logfile(const string &logfile,
+			      REDROBD_LOG_RING_HEADER *ring)
+{
+  int fd;
+
+  // Circular logfile header is read
+  fd = open(logfile.c_str(), 
+	    (m_ring_blocks ? O_RDWR : O_WRONLY) | O_CREAT,
+	    S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH);
+  if (fd == -1) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "open failed, logfile (%s)", logfile.c_str());
+  }
+
+  if (m_ring_blocks) {
+    try {
+      open_ring(fd, logfile, ring);
+    }
+    catch (...) {
+      close(fd);
+      throw;
+    }
+    return fd;
+  }
+
+  // Move to end of file
+  if ( lseek(fd, 0, SEEK_END) == -1 ) {
+    close(fd);
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "lseek failed, logfile (%s)", logfile.c_str());
+  }
+
+  return fd;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::open_ring(int fd,
+			    const string &logfile,
+			    REDROBD_LOG_RING_HEADER *ring)
+{
+  // Continue existing circular logfile if same size and format
+  memset(ring, 0, sizeof(*ring));
+  if ( (pread(fd, ring, sizeof(*ring), 0) == sizeof(*ring)) &&
+       (ring->magic == REDROBD_LOG_RING_MAGIC) &&
+       (ring->version == REDROBD_LOG_RING_VERSION) &&
+       ((ring->binary != 0) == m_binary) &&
+       (ring->block_size == REDROBD_LOG_BLOCK_SIZE) &&
+       (ring->blocks == m_ring_blocks) &&
+       (ring->block < ring->blocks) &&
+       (ring->len <= REDROBD_LOG_BLOCK_SIZE) ) {
+    return;
+  }
+
+  // Only replace an empty file or a circular logfile
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == -1) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "fstat failed, logfile (%s)", logfile.c_str());
+  }
+  if ( (file_stat.st_size) &&
+       (ring->magic != REDROBD_LOG_RING_MAGIC) ) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "Not a circular logfile, move or remove it (%s)",
+	      logfile.c_str());
+  }
+
+  // Replace old content, allocate all blocks now
+  off_t size = (off_t)(m_ring_blocks + 1) * REDROBD_LOG_BLOCK_SIZE;
+
+  if (ftruncate(fd, 0) == -1) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "ftruncate failed, logfile (%s)", logfile.c_str());
+  }
+  if (posix_fallocate(fd, 0, size)) {
+    // Not supported by all file systems
+    if (ftruncate(fd, size) == -1) {
+      THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+		"ftruncate failed, logfile (%s)", logfile.c_str());
+    }
+  }
+
+  ring->magic = REDROBD_LOG_RING_MAGIC;
+  ring->version = REDROBD_LOG_RING_VERSION;
+  ring->binary = (m_binary ? 1 : 0);
+  ring->block_size = REDROBD_LOG_BLOCK_SIZE;
+  ring->blocks = m_ring_blocks;
+  ring->block = 0;
+  ring->len = 0;
+  ring->wrapped = 0;
+
+  write_header(fd, ring);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::load_block(void)
+{
+  memset(m_block, 0, sizeof(m_block));
+  m_block_len = 0;
+  m_block_dirty = false;
+
+  if ( (!m_ring_blocks) || (!m_ring.len) ) {
+    return;
+  }
+
+  // Continue newest block of existing circular logfile
+  off_t offset = (off_t)(1 + m_ring.block) * REDROBD_LOG_BLOCK_SIZE;
+  if (pread(m_fd, m_block, m_ring.len, offset) != (ssize_t)m_ring.len) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "pread failed, logfile (%s)", m_logfile.c_str());
+  }
+  m_block_len = m_ring.len;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::write_entry(uint16_t id,
+			      const void *data,
+			      unsigned len)
+{
+  REDROBD_LOG_ENTRY entry;
+
+  // Time stamp when written, formatted by writer
+  if ( clock_gettime(CLOCK_MONOTONIC, &entry.time) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+	      "clock_gettime failed, log message");
+  }
+
+  entry.id = id;
+  entry.len = (len < sizeof(entry.data) ? len : sizeof(entry.data));
+  if (entry.len) {
+    memcpy(entry.data, data, entry.len);
+  }
+
+  if (__atomic_load_n(&m_writer_running, __ATOMIC_ACQUIRE)) {
+    // A full queue counts the message as dropped
+    m_queue.push(entry);
+    return;
+  }
+
+  // No writer thread, write directly
+  try {
+    // Lockdown write operation
+    pthread_mutex_lock(&m_write_mutex);
+
+    update_clock_offset();
+    add_to_batch(&entry);
+    write_batch();
+
+    // Lockup write operation
+    pthread_mutex_unlock(&m_write_mutex);
+  }
+  catch (...) {
+    m_batch_len = 0;
+    m_text_len = 0;
+    pthread_mutex_unlock(&m_write_mutex);
+    throw;
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::start_writer(void)
+{
+  if (m_writer_running) {
+    return;
+  }
+
+  m_writer_stop = false;
+
+  // Default attributes, writer lowers its own priority
+  if (pthread_create(&m_writer, NULL, writer_entry, this)) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_THREAD_OPERATION_FAILED,
+	      "pthread_create failed, log writer");
+  }
+
+  __atomic_store_n(&m_writer_running, true, __ATOMIC_RELEASE);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::stop_writer(void)
+{
+  if (!m_writer_running) {
+    return;
+  }
+
+  // Writer drains queue before it ends
+  __atomic_store_n(&m_writer_stop, true, __ATOMIC_RELEASE);
+
+  if (pthread_join(m_writer, NULL)) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_THREAD_OPERATION_FAILED,
+	      "pthread_join failed, log writer");
+  }
+
+  __atomic_store_n(&m_writer_running, false, __ATOMIC_RELEASE);
+
+  // Messages queued while writer was ending
+  drain_queue();
+}
+
+////////////////////////////////////////////////////////////////
+
+void *redrobd_log::writer_entry(void *p_this)
+{
+  redrobd_log *the_log = static_cast<redrobd_log *>(p_this);
+
+  // Lowest priority of normal threads
+  setpriority(PRIO_PROCESS, syscall(SYS_gettid), WRITER_NICE);
+
+  the_log->writer_loop();
+
+  return NULL;
 }
 
 ////////////////////////////////////////////////////////////////
 
-void redrobd_log::get_date_time_prefix(char *buffer, unsigned len)
+void redrobd_log::writer_loop(void)
 {
-  time_t    now = time(NULL);
-  struct tm *tstruct;
+  bool stop;
+
+  do {
+    stop = __atomic_load_n(&m_writer_stop, __ATOMIC_ACQUIRE);
+
+    // Writer can't log its own failures, use syslog
+    try {
+      drain_queue();
+    }
+    catch (excep &exp) {
+      syslog_error(redrobd_error_syslog_string(exp).c_str());
+    }
+    catch (...) {
+      syslog_error("Log writer failed : unexpected exception");
+    }
+
+    if (!stop) {
+      delay(WRITER_PERIOD);
+    }
+  } while (!stop);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::drain_queue(void)
+{
+  REDROBD_LOG_ENTRY entry;
+
+  try {
+    // Lockdown write operation
+    pthread_mutex_lock(&m_write_mutex);
+
+    update_clock_offset();
+
+    while (m_queue.pop(entry)) {
+      add_to_batch(&entry);
+    }
+
+    // Report new drops after the messages that made it
+    uint32_t drops = m_queue.get_drops();
+    if (drops != m_reported_drops) {
+      uint32_t args[2] = {drops - m_reported_drops, drops};
+
+      clock_gettime(CLOCK_MONOTONIC, &entry.time);
+      entry.id = REDROBD_LOG_MSG_DROPS;
+      entry.len = sizeof(args);
+      memcpy(entry.data, args, sizeof(args));
+      add_to_batch(&entry);
+      m_reported_drops = drops;
+    }
+
+    write_batch();
+
+    // Lockup write operation
+    pthread_mutex_unlock(&m_write_mutex);
+  }
+  catch (...) {
+    m_batch_len = 0;
+    m_text_len = 0;
+    pthread_mutex_unlock(&m_write_mutex);
+    throw;
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::update_clock_offset(void)
+{
+  struct timespec rt;
+  struct timespec mono;
+
+  if ( (clock_gettime(CLOCK_REALTIME, &rt)) ||
+       (clock_gettime(CLOCK_MONOTONIC, &mono)) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+	      "clock_gettime failed, log clock offset");
+  }
+
+  m_clock_offset =
+    ((int64_t)rt.tv_sec - mono.tv_sec) * NSEC_PER_SEC +
+    (rt.tv_nsec - mono.tv_nsec);
+
+  if (!m_binary) {
+    return;
+  }
+
+  // New logfile or realtime clock set
+  int64_t diff = m_clock_offset - m_sync_offset;
+  if ( (m_need_sync) || (diff > SYNC_LIMIT) || (diff < -SYNC_LIMIT) ) {
+    add_sync();
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::add_to_batch(const REDROBD_LOG_ENTRY *entry)
+{
+  if (m_binary) {
+    add_record(entry->id, &entry->time, entry->data, entry->len);
+
+    if (!m_log_stdout) {
+      return;
+    }
+  }
+
+  if (entry->id == REDROBD_LOG_MSG_TEXT) {
+    add_text(&entry->time, entry->data, entry->len);
+    return;
+  }
+
+  // Format message from arguments
+  uint32_t args[REDROBD_LOG_MSG_MAX_ARGS];
+  char text[REDROBD_LOG_MAX_LINE];
+  unsigned nargs = entry->len / sizeof(uint32_t);
+
+  if (nargs > REDROBD_LOG_MSG_MAX_ARGS) {
+    nargs = REDROBD_LOG_MSG_MAX_ARGS;
+  }
+  memcpy(args, entry->data, nargs * sizeof(uint32_t));
+
+  unsigned len = redrobd_log_msg_print(entry->id, args, nargs,
+				       text, sizeof(text));
+  add_text(&entry->time, text, len);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::add_record(uint16_t id,
+			     const struct timespec *time,
+			     const void *payload,
+			     unsigned len)
+{
+  REDROBD_LOG_BIN_RECORD record;
+
+  record.id = id;
+  record.len = len;
+  record.sec = time->tv_sec;
+  record.nsec = time->tv_nsec;
+
+  char *dest = reserve(sizeof(record) + len);
+
+  memcpy(dest, &record, sizeof(record));
+  memcpy(dest + sizeof(record), payload, len);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::add_text(const struct timespec *time,
+			   const char *text,
+			   unsigned len)
+{
+  char line[sizeof(m_prefix) + REDROBD_LOG_MAX_LINE + 1];
+
+  // Decorate message with date and time prefix
+  int64_t rt = ((int64_t)time->tv_sec * NSEC_PER_SEC + time->tv_nsec +
+		m_clock_offset);
+  const char *prefix = get_date_time_prefix(rt / NSEC_PER_SEC);
+
+  unsigned prefix_len = strlen(prefix);
+  if (len > REDROBD_LOG_MAX_LINE) {
+    len = REDROBD_LOG_MAX_LINE;
+  }
+
+  memcpy(line, prefix, prefix_len);
+  memcpy(line + prefix_len, text, len);
+  line[prefix_len + len] = '\n';
+
+  unsigned line_len = prefix_len + len + 1;
+
+  // Text of binary logfile is only written to STDOUT
+  if (!m_binary) {
+    memcpy(reserve(line_len), line, line_len);
+  }
+
+  // STDOUT has own batch unless same as logfile
+  if ( (m_log_stdout) && ((m_binary) || (m_ring_blocks)) ) {
+    if (m_text_len + line_len > sizeof(m_text)) {
+      write_batch();
+    }
+    memcpy(m_text + m_text_len, line, line_len);
+    m_text_len += line_len;
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::add_sync(void)
+{
+  REDROBD_LOG_BIN_SYNC sync;
+  struct timespec rt;
+  struct timespec mono;
+
+  if ( (clock_gettime(CLOCK_REALTIME, &rt)) ||
+       (clock_gettime(CLOCK_MONOTONIC, &mono)) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+	      "clock_gettime failed, log sync");
+  }
+
+  sync.magic = REDROBD_LOG_BIN_MAGIC;
+  sync.version = REDROBD_LOG_BIN_VERSION;
+  sync.reserved = 0;
+  sync.rt_sec = rt.tv_sec;
+  sync.rt_nsec = rt.tv_nsec;
+
+  add_record(REDROBD_LOG_MSG_SYNC, &mono, &sync, sizeof(sync));
+
+  m_sync_offset =
+    ((int64_t)rt.tv_sec - mono.tv_sec) * NSEC_PER_SEC +
+    (rt.tv_nsec - mono.tv_nsec);
+  m_need_sync = false;
+}
+
+////////////////////////////////////////////////////////////////
+
+char *redrobd_log::reserve(unsigned len)
+{
+  char *dest;
+
+  if (m_ring_blocks) {
+    // A line or record never crosses a block boundary
+    if (m_block_len + len > sizeof(m_block)) {
+      next_block();
+    }
+    dest = m_block + m_block_len;
+    m_block_len += len;
+    m_block_dirty = true;
+  }
+  else {
+    if (m_batch_len + len > sizeof(m_batch)) {
+      write_batch();
+    }
+    dest = m_batch + m_batch_len;
+    m_batch_len += len;
+  }
+
+  return dest;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::next_block(void)
+{
+  // Full block, rest is zero
+  write_block();
+
+  m_ring.block++;
+  if (m_ring.block == m_ring.blocks) {
+    m_ring.block = 0;
+    m_ring.wrapped = 1;
+  }
+
+  memset(m_block, 0, sizeof(m_block));
+  m_block_len = 0;
+  m_block_dirty = true;
+
+  // Oldest block of binary logfile is decoded by itself
+  if (m_binary) {
+    add_sync();
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::write_batch(void)
+{
+  unsigned batch_len = m_batch_len;
+  unsigned text_len = m_text_len;
+  m_batch_len = 0;
+  m_text_len = 0;
+
+  // Write messages to file
+  if (m_ring_blocks) {
+    if (m_block_dirty) {
+      write_block();
+      m_ring.len = m_block_len;
+      write_header(m_fd, &m_ring);
+      m_block_dirty = false;
+    }
+  }
+  else if (batch_len) {
+    write_all(m_fd,
+	      (uint8_t *)m_batch,
+	      batch_len);
+  }
+
+  // Write messages to STDOUT
+  if (m_log_stdout) {
+    if ( (m_binary) || (m_ring_blocks) ) {
+      cout.write(m_text, text_len);
+    }
+    else {
+      cout.write(m_batch, batch_len);
+    }
+    cout.flush();
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::write_block(void)
+{
+  off_t offset = (off_t)(1 + m_ring.block) * REDROBD_LOG_BLOCK_SIZE;
+
+  pwrite_all(m_fd,
+	     (uint8_t *)m_block,
+	     sizeof(m_block),
+	     offset);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::write_header(int fd,
+			       const REDROBD_LOG_RING_HEADER *ring)
+{
+  uint8_t block[REDROBD_LOG_BLOCK_SIZE];
+
+  // Whole header block
+  memset(block, 0, sizeof(block));
+  memcpy(block, ring, sizeof(*ring));
+
+  pwrite_all(fd, block, sizeof(block), 0);
+}
+
+////////////////////////////////////////////////////////////////
+
+const char *redrobd_log::get_date_time_prefix(time_t the_time)
+{
+  struct tm tstruct;
+
+  // Same second as previous message
+  if ( (m_prefix[0]) && (the_time == m_prefix_time) ) {
+    return m_prefix;
+  }
 
   // Get broken down time
-  tstruct = localtime(&now);
-  if ( tstruct == NULL ) {
+  if ( localtime_r(&the_time, &tstruct) == NULL ) {
     THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_TIME_ERROR,
 	      "localtime failed");
   }
 
-  // Current date/time, format is YYYY-MM-DD.HH:mm:ss
-  if ( strftime(buffer,
-		len,
+  // Date/time of message, format is YYYY-MM-DD.HH:mm:ss
+  if ( strftime(m_prefix,
+		sizeof(m_prefix),
 		"[%Y-%m-%d.%X] ",
-		tstruct) == 0 ) {
+		&tstruct) == 0 ) {
     
+    m_prefix[0] = '\0';
     THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_TIME_ERROR,
 	      "strftime failed");
   }
+  m_prefix_time = the_time;
+
+  return m_prefix;
 }
 
 ////////////////////////////////////////////////////////////////
@@ -180,3 +905,24 @@ void redrobd_log::write_all(int fd,
     bytes_left -= n;
   }
 }
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log::pwrite_all(int fd,
+			     const uint8_t *data,
+			     unsigned nbytes,
+			     off_t offset)
+{
+  unsigned total = 0; // How many bytes written
+  int n = 0;
+
+  while (total < nbytes) {
+    n = pwrite(fd, data+total, nbytes-total, offset+total);
+    if (n == -1) {
+      THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+		"pwrite failed, logfile (%s), offset (%ld) bytes (%u)",
+		m_logfile.c_str(), (long)offset, nbytes);
+    }
+    total += n;
+  }
+}
@@ -13,9 +13,15 @@
 #define __REDROBD_LOG_H__
 
 #include <pthread.h>
+#include <sys/types.h>
 #include <stdint.h>
+#include <string.h>
+#include <time.h>
 #include <string>
 
+#include "mpsc_queue.h"
+#include "redrobd_log_msg.h"
+
 using namespace std;
 
 /////////////////////////////////////////////////////////////////////////////
@@ -24,35 +30,197 @@ using namespace std;
 
 #define redrobd_log_initialize redrobd_log::instance()->initialize
 #define redrobd_log_finalize   redrobd_log::instance()->finalize
+#define redrobd_log_reopen     redrobd_log::instance()->reopen
 #define redrobd_log_writeln    redrobd_log::instance()->writeln
+#define redrobd_log_writemsg   redrobd_log::instance()->writemsg
+#define redrobd_log_open_reader redrobd_log::instance()->open_reader
+
+// Longer messages are truncated
+#define REDROBD_LOG_MAX_LINE  320
+
+// Max number of messages not yet written (must be power of two)
+#define REDROBD_LOG_QUEUE_SIZE  256
+
+// Messages written by writer thread in each system call
+#define REDROBD_LOG_BATCH_SIZE  8192
+
+/////////////////////////////////////////////////////////////////////////////
+//               Class support types
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  struct timespec time; // When message was written (CLOCK_MONOTONIC)
+  uint16_t        id;   // REDROBD_LOG_MSG_xxx
+  uint16_t        len;
+  char            data[REDROBD_LOG_MAX_LINE]; // Text or arguments
+} REDROBD_LOG_ENTRY;
 
 /////////////////////////////////////////////////////////////////////////////
 //               Definition of classes
 /////////////////////////////////////////////////////////////////////////////
 
+// Message argument stored as 32-bit word
+class redrobd_log_arg {
+
+ public:
+  redrobd_log_arg(int value) : m_word((uint32_t)value) {}
+  redrobd_log_arg(unsigned value) : m_word(value) {}
+  redrobd_log_arg(long value) : m_word((uint32_t)value) {}
+  redrobd_log_arg(unsigned long value) : m_word((uint32_t)value) {}
+  redrobd_log_arg(double value)
+  {
+    float f_value = (float)value;
+    memcpy(&m_word, &f_value, sizeof(m_word));
+  }
+
+  uint32_t get_word(void) const {return m_word;}
+
+ private:
+  uint32_t m_word;
+};
+
 class redrobd_log {
 
  public:
   ~redrobd_log(void);
   static redrobd_log* instance(void);
 
+  // Binary or circular logfile is read with redrobd_logdec.
+  // Size of circular logfile is zero if appended without limit.
   void initialize(string logfile,
-		  bool log_stdout);
+		  bool log_stdout,
+		  bool binary,
+		  unsigned size_kb);
   void finalize(void);
 
+  // Switch logfile while other threads may write.
+  // Text or binary format and size is kept.
+  void reopen(string logfile,
+	      bool log_stdout);
+
+  // Queued for writer thread, never blocks.
+  // Message is dropped if queue is full.
   void writeln(string str);
 
+  // Message id and arguments, text formatted when read.
+  // Queued as writeln.
+  void writemsg(uint16_t id);
+  void writemsg(uint16_t id,
+		const redrobd_log_arg &a0);
+  void writemsg(uint16_t id,
+		const redrobd_log_arg &a0,
+		const redrobd_log_arg &a1);
+  void writemsg(uint16_t id,
+		const redrobd_log_arg &a0,
+		const redrobd_log_arg &a1,
+		const redrobd_log_arg &a2);
+  void writemsg(uint16_t id,
+		const redrobd_log_arg &a0,
+		const redrobd_log_arg &a1,
+		const redrobd_log_arg &a2,
+		const redrobd_log_arg &a3);
+  void writemsg_args(uint16_t id,
+		     const uint32_t *args,
+		     unsigned nargs);
+
+  // Messages dropped since initialized
+  uint32_t get_drops(void);
+
+  // Opens current logfile for reading, owned by caller.
+  // Returns -1 if no logfile or open fails.
+  int open_reader(void);
+
  private:
   static redrobd_log *m_instance;
   string             m_logfile;
   bool               m_log_stdout;
+  bool               m_binary;
+  unsigned           m_ring_blocks; // Zero if not circular
   int                m_fd;
-  pthread_mutex_t    m_write_mutex;
+  pthread_mutex_t    m_write_mutex; // Protects logfile, not queue
+
+  // Messages from all threads to writer thread
+  mpsc_queue<REDROBD_LOG_ENTRY, REDROBD_LOG_QUEUE_SIZE> m_queue;
+
+  // Writer thread, messages are written directly when not running
+  pthread_t m_writer;
+  bool      m_writer_running;
+  bool      m_writer_stop;
+  uint32_t  m_reported_drops;
+  char      m_batch[REDROBD_LOG_BATCH_SIZE];
+  unsigned  m_batch_len;
+  char      m_text[REDROBD_LOG_BATCH_SIZE]; // STDOUT if not m_batch
+  unsigned  m_text_len;
+
+  // Circular logfile, written block by block
+  REDROBD_LOG_RING_HEADER m_ring;
+  char                    m_block[REDROBD_LOG_BLOCK_SIZE];
+  unsigned                m_block_len;
+  bool                    m_block_dirty; // Written since header
+
+  // Realtime minus monotonic clock (ns)
+  int64_t   m_clock_offset;
+  int64_t   m_sync_offset;  // Of latest sync record
+  bool      m_need_sync;    // Binary logfile opened
+  time_t    m_prefix_time;  // Latest date and time prefix
+  char      m_prefix[40];
 
   redrobd_log(void); // Private constructor
                      // so it can't be called
 
-  void get_date_time_prefix(char *buffer, unsigned len);
+  int open_logfile(const string &logfile,
+		   REDROBD_LOG_RING_HEADER *ring);
+
+  void open_ring(int fd,
+		 const string &logfile,
+		 REDROBD_LOG_RING_HEADER *ring);
+
+  void load_block(void);
+
+  void write_entry(uint16_t id,
+		   const void *data,
+		   unsigned len);
+
+  void start_writer(void);
+  void stop_writer(void);
+
+  static void *writer_entry(void *p_this);
+  void writer_loop(void);
+
+  void drain_queue(void);
+
+  void update_clock_offset(void);
+
+  void add_to_batch(const REDROBD_LOG_ENTRY *entry);
+
+  void add_record(uint16_t id,
+		  const struct timespec *time,
+		  const void *payload,
+		  unsigned len);
+
+  void add_text(const struct timespec *time,
+		const char *text,
+		unsigned len);
+
+  void add_sync(void);
+
+  char *reserve(unsigned len);
+
+  void next_block(void);
+
+  void write_batch(void);
+
+  void write_block(void);
+
+  void write_header(int fd,
+		    const REDROBD_LOG_RING_HEADER *ring);
+
+  void pwrite_all(int fd,
+		  const uint8_t *data,
+		  unsigned nbytes,
+		  off_t offset);
+
+  const char *get_date_time_prefix(time_t the_time);
 
   void write_all(int fd,
 		 const uint8_t *data,
@@ -0,0 +1,182 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#include "redrobd_log_limit.h"
+#include "redrobd.h"
+#include "excep.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//               Public member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+redrobd_log_limit::redrobd_log_limit(double rate,
+				     unsigned burst,
+				     double interval)
+{
+  m_rate = rate;
+  m_burst = burst;
+  m_interval = interval;
+  m_tokens = burst; // Full bucket
+  m_token_time = 0.0;
+
+  m_last_valid = false;
+  m_last_id = 0;
+  m_last_args[0] = 0;
+  m_last_nargs = 0;
+  m_repeats = 0;
+  m_repeat_time = 0.0;
+
+  m_suppressed = 0;
+}
+
+////////////////////////////////////////////////////////////////
+
+redrobd_log_limit::~redrobd_log_limit(void)
+{
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log_limit::writemsg(uint16_t id)
+{
+  write(id, NULL, 0);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log_limit::writemsg(uint16_t id,
+				 const redrobd_log_arg &a0)
+{
+  uint32_t args[1] = {a0.get_word()};
+
+  write(id, args, 1);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log_limit::flush(void)
+{
+  report_repeats(get_time());
+  report_suppressed();
+
+  // Next message is logged even if same as latest
+  m_last_valid = false;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Private member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log_limit::write(uint16_t id,
+			      const uint32_t *args,
+			      unsigned nargs)
+{
+  double now = get_time();
+
+  // Same as latest logged message, only count it
+  if ( (m_last_valid) &&
+       (id == m_last_id) &&
+       (nargs == m_last_nargs) &&
+       ( (!nargs) || (args[0] == m_last_args[0]) ) ) {
+    if (!m_repeats) {
+      m_repeat_time = now;
+    }
+    m_repeats++;
+    if (now - m_repeat_time >= m_interval) {
+      report_repeats(now);
+    }
+    return;
+  }
+
+  report_repeats(now);
+
+  // Add tokens for time since last message
+  if (m_token_time > 0.0) {
+    m_tokens += (now - m_token_time) * m_rate;
+    if (m_tokens > m_burst) {
+      m_tokens = m_burst;
+    }
+  }
+  m_token_time = now;
+
+  if (m_tokens < 1.0) {
+    m_suppressed++;
+    m_last_valid = false; // Not logged
+    return;
+  }
+  m_tokens -= 1.0;
+
+  report_suppressed();
+
+  redrobd_log::instance()->writemsg_args(id, args, nargs);
+
+  m_last_valid = true;
+  m_last_id = id;
+  m_last_nargs = nargs;
+  if (nargs) {
+    m_last_args[0] = args[0];
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log_limit::report_repeats(double now)
+{
+  if (!m_repeats) {
+    return;
+  }
+
+  uint32_t args[REDROBD_LOG_MSG_REPEATED_ARGS + 1];
+  redrobd_log_arg elapsed(now - m_repeat_time);
+
+  args[0] = m_last_id;
+  args[1] = m_repeats;
+  args[2] = elapsed.get_word();
+  if (m_last_nargs) {
+    args[REDROBD_LOG_MSG_REPEATED_ARGS] = m_last_args[0];
+  }
+  redrobd_log::instance()->writemsg_args(REDROBD_LOG_MSG_REPEATED,
+					 args,
+					 REDROBD_LOG_MSG_REPEATED_ARGS +
+					 m_last_nargs);
+  m_repeats = 0;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log_limit::report_suppressed(void)
+{
+  if (!m_suppressed) {
+    return;
+  }
+
+  redrobd_log::instance()->writemsg(REDROBD_LOG_MSG_SUPPRESSED,
+				    m_suppressed);
+  m_suppressed = 0;
+}
+
+////////////////////////////////////////////////////////////////
+
+double redrobd_log_limit::get_time(void)
+{
+  struct timespec now;
+
+  if ( clock_gettime(CLOCK_MONOTONIC, &now) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+	      "Get time failed for log limit");
+  }
+
+  return (now.tv_sec + now.tv_nsec / 1000000000.0);
+}
@@ -0,0 +1,93 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#ifndef __REDROBD_LOG_LIMIT_H__
+#define __REDROBD_LOG_LIMIT_H__
+
+#include <stdint.h>
+#include <time.h>
+
+#include "redrobd_log.h"
+
+using namespace std;
+
+// Implementation notes:
+// 1. Limits messages logged from one call site, or a group of call
+//    sites logging related messages. Used for verbose logging in
+//    cyclic threads, where the same message may be logged each period.
+//
+// 2. A message identical to the latest logged (same id and arguments)
+//    is only counted. The count is logged as one REDROBD_LOG_MSG_REPEATED
+//    message when a different message is logged, when the report
+//    interval has elapsed or when flushed.
+//
+// 3. Other messages are limited by a token bucket. Messages without
+//    a token are counted and reported as REDROBD_LOG_MSG_SUPPRESSED
+//    before the next message logged. Reports need no token.
+//
+// 4. Not thread safe, each object is used by one thread only.
+//
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of macros
+/////////////////////////////////////////////////////////////////////////////
+
+#define REDROBD_LOG_LIMIT_RATE      10.0 // Messages per second
+#define REDROBD_LOG_LIMIT_BURST     20   // Messages
+#define REDROBD_LOG_LIMIT_INTERVAL  1.0  // Seconds between repeat reports
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of classes
+/////////////////////////////////////////////////////////////////////////////
+
+class redrobd_log_limit {
+
+ public:
+  redrobd_log_limit(double rate = REDROBD_LOG_LIMIT_RATE,
+		    unsigned burst = REDROBD_LOG_LIMIT_BURST,
+		    double interval = REDROBD_LOG_LIMIT_INTERVAL);
+  ~redrobd_log_limit(void);
+
+  void writemsg(uint16_t id);
+  void writemsg(uint16_t id,
+		const redrobd_log_arg &a0);
+
+  // Logs pending repeat and suppress counts
+  void flush(void);
+
+ private:
+  double   m_rate;
+  double   m_burst;
+  double   m_interval;
+  double   m_tokens;
+  double   m_token_time;  // When tokens were last added
+
+  // Latest logged message
+  bool     m_last_valid;
+  uint16_t m_last_id;
+  uint32_t m_last_args[1];
+  unsigned m_last_nargs;
+  uint32_t m_repeats;     // Not yet reported
+  double   m_repeat_time; // Start of not reported repeats
+
+  uint32_t m_suppressed;  // Not yet reported
+
+  void write(uint16_t id,
+	     const uint32_t *args,
+	     unsigned nargs);
+
+  void report_repeats(double now);
+  void report_suppressed(void);
+
+  double get_time(void);
+};
+
+#endif // __REDROBD_LOG_LIMIT_H__
@@ -0,0 +1,214 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#include <stdio.h>
+#include <string.h>
+
+#include "redrobd_log_msg.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definitions of macros
+/////////////////////////////////////////////////////////////////////////////
+
+// Longest conversion specification, like "%-08.3f"
+#define MAX_SPEC_LEN  16
+
+/////////////////////////////////////////////////////////////////////////////
+//               Module global variables
+/////////////////////////////////////////////////////////////////////////////
+
+// Indexed by message id.
+// Thread names are part of the format, same as get_name() of the thread.
+static const char *g_msg_format[REDROBD_LOG_MSG_NR_IDS] = {
+  NULL, // REDROBD_LOG_MSG_TEXT
+  NULL, // REDROBD_LOG_MSG_SYNC
+  "Log messages dropped : %u (total %u)",
+  "REDROBD_CTRL : steer forward",
+  "REDROBD_CTRL : steer reverse",
+  "REDROBD_CTRL : steer right",
+  "REDROBD_CTRL : steer left",
+  "REDROBD_CTRL : Got undefined steering = 0x%04x",
+  "REDROBD_CTRL : Got undefined camera code = 0x%04x",
+  "REDROBD_CTRL : remote RF active",
+  "REDROBD_CTRL : remote NET active",
+  "REDROBD_CTRL : remote NONE active",
+  "REDROBD_CTRL : overrun, missed periods = %u",
+  "Motor control : Got undefined steer code = 0x%04x",
+  "REDROBD_BAT_MON : Vmon=%.3f, Vin=%.3f",
+  " [repeated %u times in %.3f s]", // Appended to repeated message
+  "Log rate limit : %u messages suppressed"
+};
+
+/////////////////////////////////////////////////////////////////////////////
+//               Function prototypes
+/////////////////////////////////////////////////////////////////////////////
+
+static unsigned print_format(const char *format,
+			     const uint32_t *args,
+			     unsigned nargs,
+			     char *buffer,
+			     unsigned len);
+
+static unsigned print_arg(const char *spec,
+			  char conversion,
+			  uint32_t arg,
+			  char *buffer,
+			  unsigned len);
+
+/////////////////////////////////////////////////////////////////////////////
+//               Public functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+const char *redrobd_log_msg_format(uint16_t id)
+{
+  if (id >= REDROBD_LOG_MSG_NR_IDS) {
+    return NULL;
+  }
+  return g_msg_format[id];
+}
+
+////////////////////////////////////////////////////////////////
+
+unsigned redrobd_log_msg_print(uint16_t id,
+			       const uint32_t *args,
+			       unsigned nargs,
+			       char *buffer,
+			       unsigned len)
+{
+  const char *format = redrobd_log_msg_format(id);
+
+  if (!len) {
+    return 0;
+  }
+
+  // Repeated message followed by count and time
+  if ( (id == REDROBD_LOG_MSG_REPEATED) &&
+       (nargs >= REDROBD_LOG_MSG_REPEATED_ARGS) &&
+       (args[0] != REDROBD_LOG_MSG_REPEATED) &&
+       (redrobd_log_msg_format(args[0])) ) {
+    unsigned pos = print_format(redrobd_log_msg_format(args[0]),
+				args + REDROBD_LOG_MSG_REPEATED_ARGS,
+				nargs - REDROBD_LOG_MSG_REPEATED_ARGS,
+				buffer, len);
+    return pos + print_format(format, args + 1, 2,
+			      buffer + pos, len - pos);
+  }
+
+  if ( (!format) || (id == REDROBD_LOG_MSG_REPEATED) ) {
+    int n = snprintf(buffer, len, "Unknown log message id %u", id);
+    return ( (n < 0) ? 0 : ((unsigned)n < len ? (unsigned)n : len - 1) );
+  }
+
+  return print_format(format, args, nargs, buffer, len);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Private functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+static unsigned print_format(const char *format,
+			     const uint32_t *args,
+			     unsigned nargs,
+			     char *buffer,
+			     unsigned len)
+{
+  unsigned pos = 0;
+  unsigned arg = 0;
+
+  if (!len) {
+    return 0;
+  }
+
+  while ( (*format) && (pos < len - 1) ) {
+    if (*format != '%') {
+      buffer[pos++] = *format++;
+      continue;
+    }
+
+    if (format[1] == '%') {
+      buffer[pos++] = '%';
+      format += 2;
+      continue;
+    }
+
+    // Copy conversion specification, flags, width and precision
+    char spec[MAX_SPEC_LEN];
+    unsigned spec_len = 0;
+    spec[spec_len++] = *format++;
+    while ( (*format) &&
+	    (strchr("-+ #0123456789.", *format)) &&
+	    (spec_len < sizeof(spec) - 2) ) {
+      spec[spec_len++] = *format++;
+    }
+    if (!*format) {
+      break;
+    }
+    char conversion = *format++;
+    spec[spec_len++] = conversion;
+    spec[spec_len] = '\0';
+
+    // Missing argument (short record)
+    if (arg >= nargs) {
+      buffer[pos++] = '?';
+      continue;
+    }
+
+    pos += print_arg(spec, conversion, args[arg++],
+		     buffer + pos, len - pos);
+  }
+
+  buffer[pos] = '\0';
+
+  return pos;
+}
+
+////////////////////////////////////////////////////////////////
+
+static unsigned print_arg(const char *spec,
+			  char conversion,
+			  uint32_t arg,
+			  char *buffer,
+			  unsigned len)
+{
+  int n;
+
+  switch (conversion) {
+  case 'd':
+  case 'i':
+  case 'c':
+    n = snprintf(buffer, len, spec, (int)(int32_t)arg);
+    break;
+  case 'u':
+  case 'x':
+  case 'X':
+    n = snprintf(buffer, len, spec, (unsigned)arg);
+    break;
+  case 'f':
+    {
+      float value;
+      memcpy(&value, &arg, sizeof(value));
+      n = snprintf(buffer, len, spec, (double)value);
+    }
+    break;
+  default:
+    n = snprintf(buffer, len, "?");
+  }
+
+  // Output truncated to what fits
+  if (n < 0) {
+    return 0;
+  }
+  return ((unsigned)n < len ? (unsigned)n : len - 1);
+}
@@ -0,0 +1,133 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#ifndef __REDROBD_LOG_MSG_H__
+#define __REDROBD_LOG_MSG_H__
+
+#include <stdint.h>
+
+using namespace std;
+
+// Implementation notes:
+// 1. Messages written often are logged as a message id and raw
+//    32-bit arguments. The text is only produced from the format
+//    of the message id when read, by the log writer thread (text
+//    logfile) or by the decoder tool (binary logfile).
+//
+// 2. Message ids are stored in binary logfiles. An id must never be
+//    reused or renumbered, new messages are added last.
+//
+// 3. Binary logfile is a sequence of records in native byte order.
+//    Each record has a header followed by 'len' bytes of payload:
+//    - REDROBD_LOG_MSG_TEXT, payload is the text of writeln
+//    - REDROBD_LOG_MSG_SYNC, payload is REDROBD_LOG_BIN_SYNC
+//    - All other, payload is the arguments (uint32_t each)
+//    A sync record is written first in each logfile and when the
+//    realtime clock is set. Record time is CLOCK_MONOTONIC, the sync
+//    record maps it to realtime.
+//
+// 4. Circular logfile (text or binary) is a header block followed by
+//    a fixed number of data blocks, written in order and wrapping to
+//    the first data block. A text line or record never crosses a
+//    block boundary, the rest of the block is zero filled. A binary
+//    data block starts with a sync record. Header tells the newest
+//    block and bytes used in it, oldest block is the one after the
+//    newest if all blocks have been used.
+//
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of macros
+/////////////////////////////////////////////////////////////////////////////
+
+// Binary logfile
+#define REDROBD_LOG_BIN_MAGIC    0x474c4252 // "RBLG"
+#define REDROBD_LOG_BIN_VERSION  1
+
+// Circular logfile
+#define REDROBD_LOG_RING_MAGIC    0x474e5252 // "RRNG"
+#define REDROBD_LOG_RING_VERSION  1
+#define REDROBD_LOG_BLOCK_SIZE    4096
+
+// Max arguments of a message
+#define REDROBD_LOG_MSG_MAX_ARGS  8
+
+// Message ids
+#define REDROBD_LOG_MSG_TEXT                 0
+#define REDROBD_LOG_MSG_SYNC                 1
+#define REDROBD_LOG_MSG_DROPS                2
+#define REDROBD_LOG_MSG_CTRL_STEER_FORWARD   3
+#define REDROBD_LOG_MSG_CTRL_STEER_REVERSE   4
+#define REDROBD_LOG_MSG_CTRL_STEER_RIGHT     5
+#define REDROBD_LOG_MSG_CTRL_STEER_LEFT      6
+#define REDROBD_LOG_MSG_CTRL_STEER_UNDEF     7
+#define REDROBD_LOG_MSG_CTRL_CAMERA_UNDEF    8
+#define REDROBD_LOG_MSG_CTRL_RF_ACTIVE       9
+#define REDROBD_LOG_MSG_CTRL_NET_ACTIVE      10
+#define REDROBD_LOG_MSG_CTRL_NONE_ACTIVE     11
+#define REDROBD_LOG_MSG_CTRL_OVERRUN         12
+#define REDROBD_LOG_MSG_MC_STEER_UNDEF       13
+#define REDROBD_LOG_MSG_BAT_MON_VOLTAGES     14
+#define REDROBD_LOG_MSG_REPEATED             15
+#define REDROBD_LOG_MSG_SUPPRESSED           16
+#define REDROBD_LOG_MSG_NR_IDS               17
+
+// Arguments of REDROBD_LOG_MSG_REPEATED are message id, count and
+// time (float, seconds) followed by arguments of repeated message
+#define REDROBD_LOG_MSG_REPEATED_ARGS  3
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of types
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  uint16_t id;   // REDROBD_LOG_MSG_xxx
+  uint16_t len;  // Bytes of payload after header
+  uint32_t sec;  // CLOCK_MONOTONIC
+  uint32_t nsec;
+} __attribute__((packed)) REDROBD_LOG_BIN_RECORD;
+
+typedef struct {
+  uint32_t magic;   // REDROBD_LOG_BIN_MAGIC
+  uint16_t version; // REDROBD_LOG_BIN_VERSION
+  uint16_t reserved;
+  int64_t  rt_sec;  // CLOCK_REALTIME at record time
+  uint32_t rt_nsec;
+} __attribute__((packed)) REDROBD_LOG_BIN_SYNC;
+
+// First in header block of circular logfile
+typedef struct {
+  uint32_t magic;      // REDROBD_LOG_RING_MAGIC
+  uint16_t version;    // REDROBD_LOG_RING_VERSION
+  uint16_t binary;     // Records if not zero, else text lines
+  uint32_t block_size; // REDROBD_LOG_BLOCK_SIZE
+  uint32_t blocks;     // Data blocks after header block
+  uint32_t block;      // Newest data block (0 - blocks-1)
+  uint32_t len;        // Bytes used in newest data block
+  uint32_t wrapped;    // Not zero if all data blocks used
+} __attribute__((packed)) REDROBD_LOG_RING_HEADER;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of exported functions
+/////////////////////////////////////////////////////////////////////////////
+
+// Returns printf-like format of message id, NULL if unknown.
+// Conversions d, u, x, X, c and f (float argument) are supported.
+extern const char *redrobd_log_msg_format(uint16_t id);
+
+// Formats message into buffer (always terminated).
+// Returns length of text.
+extern unsigned redrobd_log_msg_print(uint16_t id,
+				      const uint32_t *args,
+				      unsigned nargs,
+				      char *buffer,
+				      unsigned len);
+
+#endif // __REDROBD_LOG_MSG_H__
@@ -0,0 +1,390 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "redrobd_log_msg.h"
+
+// Implementation notes:
+// 1. Decodes a binary logfile (log_format=binary) to the text format
+//    of the daemon. Date and time is local time of the host, set TZ
+//    to the timezone of the target if different.
+//
+// 2. Logfile starts with a sync record, mapping monotonic time of
+//    records to realtime. Later sync records follow if the realtime
+//    clock of the target was set.
+//
+// 3. A circular logfile (log_file_size_kb) is read from the oldest to
+//    the newest block, text or binary. It must be read from a file,
+//    not STDIN.
+//
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of macros
+/////////////////////////////////////////////////////////////////////////////
+
+#define LOGDEC_MAX_PAYLOAD  1024
+#define LOGDEC_MAX_LINE     1024
+#define LOGDEC_BUF_SIZE     65536 // At least one block or record
+
+#define NSEC_PER_SEC  1000000000LL
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of types
+/////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+  bool     monotonic; // Print monotonic time instead of date and time
+  bool     show_id;   // Print message id of each record
+  unsigned only_id;   // Only print this message id
+  bool     filter;
+} LOGDEC_CONFIG;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Module global variables
+/////////////////////////////////////////////////////////////////////////////
+
+static LOGDEC_CONFIG g_cfg;
+
+// Realtime minus monotonic clock (ns), from latest sync record
+static int64_t g_clock_offset;
+static bool    g_synced;
+
+static uint8_t g_buf[LOGDEC_BUF_SIZE];
+
+/////////////////////////////////////////////////////////////////////////////
+//               Function prototypes
+/////////////////////////////////////////////////////////////////////////////
+
+static void logdec_usage(const char *prog);
+static bool logdec_parse_args(int argc, char *argv[]);
+static bool logdec_stream(FILE *f,
+			  unsigned len);
+static bool logdec_ring(FILE *f,
+			const REDROBD_LOG_RING_HEADER *ring);
+static int logdec_records(const uint8_t *data,
+			  unsigned len,
+			  bool block);
+static bool logdec_sync(const REDROBD_LOG_BIN_RECORD *record,
+			const uint8_t *payload);
+static void logdec_print(const REDROBD_LOG_BIN_RECORD *record,
+			 const uint8_t *payload);
+
+/////////////////////////////////////////////////////////////////////////////
+//               Public functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+  REDROBD_LOG_RING_HEADER ring;
+  bool ok;
+  FILE *f;
+
+  if (!logdec_parse_args(argc, argv)) {
+    logdec_usage(argv[0]);
+    return 1;
+  }
+
+  if (strcmp(argv[optind], "-") == 0) {
+    f = stdin;
+  }
+  else {
+    f = fopen(argv[optind], "rb");
+    if (!f) {
+      perror(argv[optind]);
+      return 1;
+    }
+  }
+
+  g_clock_offset = 0;
+  g_synced = false;
+
+  // Circular logfile starts with header block
+  size_t n = fread(g_buf, 1, LOGDEC_BUF_SIZE, f);
+  memcpy(&ring, g_buf, sizeof(ring));
+
+  if ( (n >= sizeof(ring)) &&
+       (ring.magic == REDROBD_LOG_RING_MAGIC) ) {
+    ok = logdec_ring(f, &ring);
+  }
+  else {
+    ok = logdec_stream(f, n);
+  }
+
+  if (f != stdin) {
+    fclose(f);
+  }
+
+  return (ok ? 0 : 1);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Private functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+static void logdec_usage(const char *prog)
+{
+  printf("Usage: %s [options] <logfile|->\n", prog);
+  printf("  -m          Print monotonic time (s) instead of date and time\n");
+  printf("  -n          Print message id of each record\n");
+  printf("  -i <id>     Only print records with message id\n");
+  printf("Decodes binary logfile (log_format=binary) of the daemon to text.\n");
+  printf("Circular logfile (log_file_size_kb) is printed oldest first.\n");
+}
+
+////////////////////////////////////////////////////////////////
+
+static bool logdec_parse_args(int argc, char *argv[])
+{
+  int opt;
+
+  g_cfg.monotonic = false;
+  g_cfg.show_id = false;
+  g_cfg.only_id = 0;
+  g_cfg.filter = false;
+
+  while ((opt = getopt(argc, argv, "mni:h")) != -1) {
+    switch (opt) {
+    case 'm':
+      g_cfg.monotonic = true;
+      break;
+    case 'n':
+      g_cfg.show_id = true;
+      break;
+    case 'i':
+      g_cfg.only_id = (unsigned)atoi(optarg);
+      g_cfg.filter = true;
+      break;
+    default:
+      return false;
+    }
+  }
+
+  // One logfile
+  return (optind == argc - 1);
+}
+
+////////////////////////////////////////////////////////////////
+
+static bool logdec_stream(FILE *f,
+			  unsigned len)
+{
+  unsigned long offset = 0;
+
+  // First part of logfile already in buffer
+  while (len) {
+    int used = logdec_records(g_buf, len, false);
+    if (used < 0) {
+      return false;
+    }
+
+    // Keep incomplete record
+    len -= used;
+    memmove(g_buf, g_buf + used, len);
+    offset += used;
+
+    size_t n = fread(g_buf + len, 1, LOGDEC_BUF_SIZE - len, f);
+    if (!n) {
+      break;
+    }
+    len += n;
+  }
+
+  if (ferror(f)) {
+    fprintf(stderr, "Read failed at offset %lu\n", offset);
+    return false;
+  }
+
+  // Daemon may have been stopped while writing
+  if (len) {
+    fprintf(stderr, "Incomplete record at offset %lu\n", offset);
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////
+
+static bool logdec_ring(FILE *f,
+			const REDROBD_LOG_RING_HEADER *ring)
+{
+  if ( (ring->version != REDROBD_LOG_RING_VERSION) ||
+       (ring->block_size > LOGDEC_BUF_SIZE) ||
+       (!ring->blocks) ||
+       (ring->block >= ring->blocks) ||
+       (ring->len > ring->block_size) ) {
+    fprintf(stderr, "Bad circular logfile header\n");
+    return false;
+  }
+
+  // Oldest block is the one after newest, if all used
+  unsigned first = (ring->wrapped ? (ring->block + 1) % ring->blocks : 0);
+  unsigned count = (ring->wrapped ? ring->blocks : ring->block + 1);
+
+  for (unsigned i=0; i < count; i++) {
+    unsigned block = (first + i) % ring->blocks;
+    unsigned len = (block == ring->block ? ring->len : ring->block_size);
+    long offset = (long)(1 + block) * ring->block_size;
+
+    if ( (fseek(f, offset, SEEK_SET)) ||
+	 (fread(g_buf, 1, len, f) != len) ) {
+      fprintf(stderr, "Read failed at offset %ld\n", offset);
+      return false;
+    }
+
+    if (ring->binary) {
+      if (logdec_records(g_buf, len, true) < 0) {
+	return false;
+      }
+    }
+    else {
+      // Text lines, rest of block is zero
+      fwrite(g_buf, 1, strnlen((char *)g_buf, len), stdout);
+    }
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////
+
+static int logdec_records(const uint8_t *data,
+			  unsigned len,
+			  bool block)
+{
+  REDROBD_LOG_BIN_RECORD record;
+  unsigned pos = 0;
+
+  while (pos + sizeof(record) <= len) {
+    memcpy(&record, data + pos, sizeof(record));
+
+    // Zero filled rest of block
+    if ( (block) && (!record.id) && (!record.len) &&
+	 (!record.sec) && (!record.nsec) ) {
+      return len;
+    }
+
+    if ( (!g_synced) && (record.id != REDROBD_LOG_MSG_SYNC) ) {
+      // Logfile always starts with sync record
+      fprintf(stderr, "No sync record first, not a binary logfile?\n");
+      return -1;
+    }
+    if (record.len > LOGDEC_MAX_PAYLOAD) {
+      fprintf(stderr, "Bad record (id=%u, len=%u)\n",
+	      record.id, record.len);
+      return -1;
+    }
+    if (pos + sizeof(record) + record.len > len) {
+      break;
+    }
+
+    const uint8_t *payload = data + pos + sizeof(record);
+
+    if (record.id == REDROBD_LOG_MSG_SYNC) {
+      if (!logdec_sync(&record, payload)) {
+	fprintf(stderr, "Bad sync record, not a binary logfile?\n");
+	return -1;
+      }
+    }
+    else if ( (!g_cfg.filter) || (record.id == g_cfg.only_id) ) {
+      logdec_print(&record, payload);
+    }
+
+    pos += sizeof(record) + record.len;
+  }
+
+  return pos;
+}
+
+////////////////////////////////////////////////////////////////
+
+static bool logdec_sync(const REDROBD_LOG_BIN_RECORD *record,
+			const uint8_t *payload)
+{
+  REDROBD_LOG_BIN_SYNC sync;
+
+  if (record->len < sizeof(sync)) {
+    return false;
+  }
+  memcpy(&sync, payload, sizeof(sync));
+
+  if ( (sync.magic != REDROBD_LOG_BIN_MAGIC) ||
+       (sync.version != REDROBD_LOG_BIN_VERSION) ) {
+    return false;
+  }
+
+  g_clock_offset =
+    (sync.rt_sec - (int64_t)record->sec) * NSEC_PER_SEC +
+    ((int64_t)sync.rt_nsec - record->nsec);
+  g_synced = true;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////
+
+static void logdec_print(const REDROBD_LOG_BIN_RECORD *record,
+			 const uint8_t *payload)
+{
+  char prefix[64];
+  char text[LOGDEC_MAX_LINE];
+  unsigned len;
+
+  // Same date and time prefix as text logfile
+  if (g_cfg.monotonic) {
+    snprintf(prefix, sizeof(prefix), "[%u.%06u] ",
+	     record->sec, record->nsec / 1000);
+  }
+  else {
+    int64_t rt = ((int64_t)record->sec * NSEC_PER_SEC + record->nsec +
+		  g_clock_offset);
+    time_t the_time = (time_t)(rt / NSEC_PER_SEC);
+    struct tm tstruct;
+
+    if ( (localtime_r(&the_time, &tstruct) == NULL) ||
+	 (strftime(prefix, sizeof(prefix),
+		   "[%Y-%m-%d.%X] ", &tstruct) == 0) ) {
+      strcpy(prefix, "[?] ");
+    }
+  }
+
+  if (record->id == REDROBD_LOG_MSG_TEXT) {
+    len = (record->len < sizeof(text) ? record->len : sizeof(text) - 1);
+    memcpy(text, payload, len);
+    text[len] = '\0';
+  }
+  else {
+    uint32_t args[REDROBD_LOG_MSG_MAX_ARGS];
+    unsigned nargs = record->len / sizeof(uint32_t);
+
+    if (nargs > REDROBD_LOG_MSG_MAX_ARGS) {
+      nargs = REDROBD_LOG_MSG_MAX_ARGS;
+    }
+    memcpy(args, payload, nargs * sizeof(uint32_t));
+
+    redrobd_log_msg_print(record->id, args, nargs, text, sizeof(text));
+  }
+
+  if (g_cfg.show_id) {
+    printf("%s<%u> %s\n", prefix, record->id, text);
+  }
+  else {
+    printf("%s%s\n", prefix, text);
+  }
+}
@@ -25,6 +25,7 @@ using namespace std;
 /////////////////////////////////////////////////////////////////////////////
 //               Definition of macros
 /////////////////////////////////////////////////////////////////////////////
+#define MAIN_PREFAULT_STACK_KB  256
 
 /////////////////////////////////////////////////////////////////////////////
 //               Definition of types
@@ -40,6 +41,10 @@ static void daemon_signal_handler(int sig);
 static void daemon_exit_on_error(int fd_lock_file);
 static void daemon_report_prod_info(void);
 static int  daemon_get_config(REDROBD_CONFIG *config);
+static string daemon_sched_string(const REDROBD_THREAD_SCHED *sched);
+static string daemon_overrun_string(REDROBD_OVERRUN_POLICY policy);
+static string daemon_input_mode_string(REDROBD_INPUT_MODE mode);
+static string daemon_rpi_stat_string(REDROBD_RPI_STAT_BACKEND backend);
 static int  daemon_check_status(void);
 
 /////////////////////////////////////////////////////////////////////////////
@@ -191,9 +196,68 @@ static int daemon_get_config(REDROBD_CONFIG *config)
   oss_msg << "\tlock_file :" << config->lock_file  << "\\n";
   oss_msg << "\tlog_file  :" << config->log_file  << "\\n";
   oss_msg << "\tlog_stdout:" << config->log_stdout  << "\\n";
+  oss_msg << "\tlog_format:"
+	  << (config->log_format == REDROBD_LOG_BINARY ? "binary" : "text")
+	  << ", size_kb=" << config->log_file_size_kb << "\\n";
   oss_msg << "\tsup_freq  :" << config->supervision_freq << "\\n";
-  oss_msg << "\tctrl_freq :" << config->ctrl_thread_freq << "\n";
-  oss_msg << "\tverbose   :" << config->verbose << "\n";
+  oss_msg << "\tctrl_freq :" << config->ctrl_thread_freq << "\\n";
+  oss_msg << "\tctrl_event:" << config->ctrl_event_driven << "\\n";
+  oss_msg << "\tcmd_trace :" << config->ctrl_cmd_trace << "\\n";
+  oss_msg << "\tsteer_cmd :"
+	  << (config->steer_cmd_policy == REDROBD_CMD_ALL ? "all" : "latest")
+	  << "\\n";
+  oss_msg << "\tcamera_cmd:"
+	  << (config->camera_cmd_policy == REDROBD_CMD_ALL ? "all" : "latest")
+	  << "\\n";
+  oss_msg << "\tudp_steer :" << config->net_udp_steer_port << "\\n";
+  oss_msg << "\tunix_sock :"
+	  << (config->net_unix_socket[0] ? config->net_unix_socket : "none")
+	  << ", allow_uid=" << config->net_unix_allow_uid << "\\n";
+  oss_msg << "\tctrl_input:"
+	  << daemon_input_mode_string(config->ctrl_input_mode)
+	  << ", in=" << config->ctrl_input_file
+	  << ", out=" << config->ctrl_output_file << "\\n";
+  oss_msg << "\thw        :"
+	  << (config->hw_backend == REDROBD_HW_SIM ? "sim" : "rpi");
+  if (config->hw_backend == REDROBD_HW_SIM) {
+    oss_msg << ", script=" << config->hw_sim_script
+	    << ", out=" << config->hw_sim_output;
+  }
+  oss_msg << "\\n";
+  oss_msg << "\tverbose   :" << config->verbose << "\\n";
+  oss_msg << "\tlock_mem  :" << config->lock_memory << "\\n";
+  oss_msg << "\tstack_kb  :" << config->thread_stack_kb << "\\n";
+  oss_msg << "\ttask_sched:" << config->use_task_scheduler << "\\n";
+  oss_msg << "\tctrl      :"
+	  << daemon_sched_string(&config->ctrl_thread_sched)
+	  << ", overrun=" << daemon_overrun_string(config->ctrl_thread_overrun)
+	  << "\\n";
+  oss_msg << "\tbat_mon   :"
+	  << daemon_sched_string(&config->bat_mon_thread_sched)
+	  << ", overrun=" << daemon_overrun_string(config->bat_mon_thread_overrun)
+	  << "\\n";
+  oss_msg << "\talive     :"
+	  << daemon_sched_string(&config->alive_thread_sched)
+	  << ", overrun=" << daemon_overrun_string(config->alive_thread_overrun)
+	  << "\\n";
+  oss_msg << "\tnet_server:"
+	  << daemon_sched_string(&config->net_server_thread_sched) << "\\n";
+  oss_msg << "\tsys_stat  :"
+	  << daemon_sched_string(&config->sys_stat_thread_sched)
+	  << ", overrun=" << daemon_overrun_string(config->sys_stat_thread_overrun)
+	  << "\\n";
+  oss_msg << "\tstat_rate :"
+	  << "load=" << config->sys_stat_rate.cpu_load
+	  << ", mem=" << config->sys_stat_rate.mem_used
+	  << ", irq=" << config->sys_stat_rate.irq
+	  << ", uptime=" << config->sys_stat_rate.uptime
+	  << ", temp=" << config->sys_stat_rate.cpu_temp
+	  << ", volt=" << config->sys_stat_rate.cpu_voltage
+	  << ", freq=" << config->sys_stat_rate.cpu_freq
+	  << ", throttled=" << config->sys_stat_rate.throttled << "\\n";
+  oss_msg << "\trpi_stat  :"
+	  << daemon_rpi_stat_string(config->sys_stat_rpi_backend)
+	  << ", root=" << config->sys_stat_rpi_root << "\\n";
 
   // Print all info
   syslog_info(oss_msg.str().c_str());
@@ -203,6 +267,78 @@ static int daemon_get_config(REDROBD_CONFIG *config)
 
 ////////////////////////////////////////////////////////////////
 
+static string daemon_sched_string(const REDROBD_THREAD_SCHED *sched)
+{
+  ostringstream oss_sched;
+
+  switch (sched->policy) {
+  case REDROBD_SCHED_FIFO:
+    oss_sched << "fifo/" << sched->priority;
+    break;
+  case REDROBD_SCHED_RR:
+    oss_sched << "rr/" << sched->priority;
+    break;
+  default:
+    oss_sched << "other";
+  }
+
+  oss_sched << ", cpu=";
+  if (sched->cpu < 0) {
+    oss_sched << "any";
+  }
+  else {
+    oss_sched << sched->cpu;
+  }
+
+  return oss_sched.str();
+}
+
+////////////////////////////////////////////////////////////////
+
+static string daemon_overrun_string(REDROBD_OVERRUN_POLICY policy)
+{
+  switch (policy) {
+  case REDROBD_OVERRUN_SKIP:
+    return "skip";
+  case REDROBD_OVERRUN_STRETCH:
+    return "stretch";
+  default:
+    return "catch_up";
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+static string daemon_input_mode_string(REDROBD_INPUT_MODE mode)
+{
+  switch (mode) {
+  case REDROBD_INPUT_RECORD:
+    return "record";
+  case REDROBD_INPUT_REPLAY_REALTIME:
+    return "replay_realtime";
+  case REDROBD_INPUT_REPLAY_FULL:
+    return "replay_full";
+  default:
+    return "normal";
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+static string daemon_rpi_stat_string(REDROBD_RPI_STAT_BACKEND backend)
+{
+  switch (backend) {
+  case REDROBD_RPI_STAT_SYSFS:
+    return "sysfs";
+  case REDROBD_RPI_STAT_VCGENCMD:
+    return "vcgencmd";
+  default:
+    return "mailbox";
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
 static int daemon_check_status(void)
 {
   REDROBD_STATUS status;
@@ -280,11 +416,20 @@ int main(int argc, char *argv[])
   // We are now running as a daemon (or not)
   syslog_info("Started");
 
+  // Keep all memory resident, page faults shall not stall time
+  // critical threads. Stack of this thread is prefaulted.
+  if (g_config.lock_memory) {
+    rc = lock_memory(MAIN_PREFAULT_STACK_KB);
+    if (rc != DAEMON_SUCCESS) {
+      daemon_exit_on_error(fd_lock_file);
+    }
+    syslog_info("Memory locked (prefault stack %u KB)",
+		MAIN_PREFAULT_STACK_KB);
+  }
+
   // Initialize daemon
-  if (redrobd_initialize(g_config.log_file,
-			 (!g_is_daemon) && g_config.log_stdout,
-			 g_config.ctrl_thread_freq,
-			 g_config.verbose) != REDROBD_SUCCESS) {
+  if (redrobd_initialize(&g_config,
+			 (!g_is_daemon) && g_config.log_stdout) != REDROBD_SUCCESS) {
     daemon_exit_on_error(fd_lock_file);
   }
 
@@ -294,21 +439,31 @@ int main(int argc, char *argv[])
     if (g_received_sig_restart) {
       syslog_info("Got signal to restart");
       g_received_sig_restart = 0;
-      // Finalize
-      if (redrobd_finalize() != REDROBD_SUCCESS) {
-	daemon_exit_on_error(fd_lock_file);
-      }
       // Read configuration file
       if (!daemon_get_config(&g_config)) {
 	daemon_exit_on_error(fd_lock_file);
       }
-      // Initialize
-      if (redrobd_initialize(g_config.log_file,
-			     (!g_is_daemon) && g_config.log_stdout,
-			     g_config.ctrl_thread_freq,
-			     g_config.verbose) != REDROBD_SUCCESS) {
+      // Apply configuration while running if possible
+      bool applied;
+      if (redrobd_reconfigure(&g_config,
+			      (!g_is_daemon) && g_config.log_stdout,
+			      &applied) != REDROBD_SUCCESS) {
 	daemon_exit_on_error(fd_lock_file);
       }
+      if (applied) {
+	syslog_info("Reconfigured without restart");
+      }
+      else {
+	// Finalize
+	if (redrobd_finalize() != REDROBD_SUCCESS) {
+	  daemon_exit_on_error(fd_lock_file);
+	}
+	// Initialize
+	if (redrobd_initialize(&g_config,
+			       (!g_is_daemon) && g_config.log_stdout) != REDROBD_SUCCESS) {
+	  daemon_exit_on_error(fd_lock_file);
+	}
+      }
     }
     // Check if time to quit
     if (g_received_sig_terminate) {
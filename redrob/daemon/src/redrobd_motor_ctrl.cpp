@@ -9,12 +9,14 @@
 // *                                                                      *
 // ************************************************************************
 
-#include <sstream>
-#include <iomanip>
+#include <strings.h>
 
 #include "redrobd_motor_ctrl.h"
 #include "redrobd_gpio.h"
 #include "redrobd_log.h"
+#include "redrobd.h"
+#include "delay.h"
+#include "excep.h"
 
 // Implementation notes:
 // 1. Skid steering (differential drive, tank style).
@@ -84,6 +86,27 @@ void redrobd_motor_ctrl::finalize(void)
   redrobd_gpio_set_function(m_pin_lm_2, m_pin_func_lm_2);
 }
 
+////////////////////////////////////////////////////////////////
+
+void redrobd_motor_ctrl::set_trace(bool enable)
+{
+  m_trace = enable;
+  m_pin_written = false;
+}
+
+////////////////////////////////////////////////////////////////
+
+bool redrobd_motor_ctrl::get_pin_write_time(struct timespec *write_time)
+{
+  if (!m_pin_written) {
+    return false;
+  }
+  *write_time = m_pin_write_time;
+  m_pin_written = false;
+
+  return true;
+}
+
 /////////////////////////////////////////////////////////////////////////////
 //               Protected member functions
 /////////////////////////////////////////////////////////////////////////////
@@ -105,10 +128,7 @@ bool redrobd_motor_ctrl::check_steer_code(uint16_t code)
     break;
   default:
     // All other steer codes are ignored for now
-    ostringstream oss_msg;
-    oss_msg << "Motor control : Got undefined steer code = 0x"
-	    << hex << setw(4) << setfill('0') << (unsigned)code;
-    redrobd_log_writeln(oss_msg.str());
+    redrobd_log_writemsg(REDROBD_LOG_MSG_MC_STEER_UNDEF, (unsigned)code);
 
     steer_code_ok = false;
   }
@@ -193,6 +213,10 @@ void redrobd_motor_ctrl::init_members(void)
   m_pin_func_rm_2 = 0;
   m_pin_func_lm_1 = 0;
   m_pin_func_lm_2 = 0;
+
+  m_trace = false;
+  m_pin_written = false;
+  bzero(&m_pin_write_time, sizeof(m_pin_write_time));
 }
 
 ////////////////////////////////////////////////////////////////
@@ -228,4 +252,13 @@ void redrobd_motor_ctrl::steer_motor(REDROBD_MC_MOTOR_ID motor_id,
     redrobd_gpio_set_pin_high(l293d_inp2);
     break;
   }
+
+  // Last motor of a steering gives the write time
+  if (m_trace) {
+    if ( clock_gettime(get_clock_id(), &m_pin_write_time) ) {
+      THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+		"Get pin write time failed for motor control");
+    }
+    m_pin_written = true;
+  }
 }
@@ -13,6 +13,7 @@
 #define __REDROBD_MOTOR_CTRL_H__
 
 #include <stdint.h>
+#include <time.h>
 
 using namespace std;
 
@@ -58,6 +59,13 @@ class redrobd_motor_ctrl {
 
   virtual void steer(uint16_t code) = 0; // Pure virtual function
 
+  // Time of motor pin writes is kept when trace is enabled
+  void set_trace(bool enable);
+
+  // Time of latest pin write, false if no pin
+  // was written since previous call
+  bool get_pin_write_time(struct timespec *write_time);
+
  protected:
   bool check_steer_code(uint16_t code);
 
@@ -80,6 +88,11 @@ class redrobd_motor_ctrl {
   uint8_t m_pin_func_lm_1;
   uint8_t m_pin_func_lm_2;
 
+  // Trace of pin writes
+  bool            m_trace;
+  bool            m_pin_written;
+  struct timespec m_pin_write_time;
+
   void init_members(void);
 
   void steer_motor(REDROBD_MC_MOTOR_ID motor_id,
@@ -30,10 +30,26 @@
 ////////////////////////////////////////////////////////////////
 
 redrobd_rc_net::redrobd_rc_net(string server_ip_address,
-			       uint16_t server_port) : redrobd_remote_ctrl()
+			       uint16_t server_port,
+			       uint16_t udp_steer_port,
+			       string unix_path,
+			       int unix_allow_uid,
+			       const REDROBD_THREAD_SCHED *server_thread_sched,
+			       unsigned server_thread_stack_kb,
+			       cyclic_thread *cmd_notify_thread,
+			       REDROBD_CMD_POLICY steer_policy,
+			       REDROBD_CMD_POLICY camera_policy) : redrobd_remote_ctrl()
 {
   m_server_ip_address = server_ip_address;
   m_server_port = server_port;
+  m_udp_steer_port = udp_steer_port;
+  m_unix_path = unix_path;
+  m_unix_allow_uid = unix_allow_uid;
+  m_server_thread_sched = *server_thread_sched;
+  m_server_thread_stack_kb = server_thread_stack_kb;
+  m_cmd_notify_thread = cmd_notify_thread;
+  m_steer_policy = steer_policy;
+  m_camera_policy = camera_policy;
 
   init_members();
 }
@@ -47,6 +63,14 @@ redrobd_rc_net::~redrobd_rc_net(void)
 ////////////////////////////////////////////////////////////////
 
 void redrobd_rc_net::initialize(void)
+{
+  initialize_begin();
+  initialize_end();
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net::initialize_begin(void)
 {
   // Not yet active
   set_active(false);
@@ -55,20 +79,51 @@ void redrobd_rc_net::initialize(void)
   redrobd_rc_net_server_thread *thread_ptr =
     new redrobd_rc_net_server_thread(RC_NET_SERVER_THREAD_NAME,
 				     m_server_ip_address,
-				     m_server_port);
+				     m_server_port,
+				     m_udp_steer_port,
+				     m_unix_path,
+				     m_unix_allow_uid,
+				     m_cmd_notify_thread,
+				     m_steer_policy,
+				     m_camera_policy);
   m_server_thread_auto =
     auto_ptr<redrobd_rc_net_server_thread>(thread_ptr);
 
+  // Scheduling and stack size of server thread
+  redrobd_thread_set_sched(thread_ptr,
+			   &m_server_thread_sched,
+			   m_server_thread_stack_kb);
+
   redrobd_log_writeln("About to initialize rc net server thread");
 
   // Take back ownership from auto_ptr
   thread_ptr = m_server_thread_auto.release();
   
   try {
-    // Initialize server thread object
-    redrobd_thread_initialize((thread *)thread_ptr,
-			      RC_NET_SERVER_THREAD_START_TIMEOUT,
-			      RC_NET_SERVER_THREAD_EXECUTE_TIMEOUT);
+    // Start server thread object, setup is done concurrently
+    redrobd_thread_start((thread *)thread_ptr);
+  }
+  catch (...) {
+    m_server_thread_auto = auto_ptr<redrobd_rc_net_server_thread>(thread_ptr);
+    throw;
+  }
+  
+  // Give back ownership to auto_ptr
+  m_server_thread_auto = auto_ptr<redrobd_rc_net_server_thread>(thread_ptr);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net::initialize_end(void)
+{
+  // Take back ownership from auto_ptr
+  redrobd_rc_net_server_thread *thread_ptr = m_server_thread_auto.release();
+  
+  try {
+    // Wait for server thread object to execute
+    redrobd_thread_wait_started((thread *)thread_ptr,
+				RC_NET_SERVER_THREAD_START_TIMEOUT,
+				RC_NET_SERVER_THREAD_EXECUTE_TIMEOUT);
   }
   catch (...) {
     m_server_thread_auto = auto_ptr<redrobd_rc_net_server_thread>(thread_ptr);
@@ -132,6 +187,20 @@ uint16_t redrobd_rc_net::get_steering(void)
 
 ////////////////////////////////////////////////////////////////
 
+bool redrobd_rc_net::get_steering_recv_time(struct timespec *recv_time)
+{
+  return m_server_thread_auto->get_steer_code_recv_time(recv_time);
+}
+
+////////////////////////////////////////////////////////////////
+
+bool redrobd_rc_net::steering_pending(void)
+{
+  return m_server_thread_auto->steer_code_pending();
+}
+
+////////////////////////////////////////////////////////////////
+
 void redrobd_rc_net::set_voltage(float value)
 {
   m_server_thread_auto->set_voltage(value);
@@ -148,6 +217,21 @@ uint16_t redrobd_rc_net::get_camera_code(void)
 
 ////////////////////////////////////////////////////////////////
 
+bool redrobd_rc_net::camera_code_pending(void)
+{
+  return m_server_thread_auto->camera_code_pending();
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net::get_code_stat(RC_NET_CODE_STAT *steer_stat,
+				   RC_NET_CODE_STAT *camera_stat)
+{
+  m_server_thread_auto->get_code_stat(steer_stat, camera_stat);
+}
+
+////////////////////////////////////////////////////////////////
+
 void redrobd_rc_net::set_sys_stat(uint8_t cpu_load,
 				  uint32_t mem_used,
 				  uint16_t irq,
@@ -173,6 +257,23 @@ void redrobd_rc_net::set_sys_stat(uint8_t cpu_load,
 
 ////////////////////////////////////////////////////////////////
 
+void redrobd_rc_net::set_trace_stat(const histogram *stage)
+{
+  RC_NET_TRACE_STAT trace_stat;
+
+  for (unsigned i=0; i < RC_NET_TRACE_STAGES; i++) {
+    trace_stat.stage[i].count  = stage[i].get_count();
+    trace_stat.stage[i].min_us = stage[i].get_min_us();
+    trace_stat.stage[i].p50_us = stage[i].get_percentile_us(50.0);
+    trace_stat.stage[i].p99_us = stage[i].get_percentile_us(99.0);
+    trace_stat.stage[i].max_us = stage[i].get_max_us();
+  }
+
+  m_server_thread_auto->set_trace_stat(&trace_stat);
+}
+
+////////////////////////////////////////////////////////////////
+
 void redrobd_rc_net::server_thread_check(void)
 {
   // Take back ownership from auto_ptr
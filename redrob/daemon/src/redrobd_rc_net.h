@@ -18,6 +18,8 @@
 
 #include "redrobd_remote_ctrl.h"
 #include "redrobd_rc_net_server_thread.h"
+#include "redrobd.h"
+#include "histogram.h"
 
 using namespace std;
 
@@ -41,7 +43,15 @@ class redrobd_rc_net : public redrobd_remote_ctrl {
   
  public:
   redrobd_rc_net(string server_ip_address,
-		 uint16_t server_port);
+		 uint16_t server_port,
+		 uint16_t udp_steer_port, // 0 if disabled
+		 string unix_path,        // Empty if disabled
+		 int unix_allow_uid,      // -1 if none
+		 const REDROBD_THREAD_SCHED *server_thread_sched,
+		 unsigned server_thread_stack_kb,
+		 cyclic_thread *cmd_notify_thread,
+		 REDROBD_CMD_POLICY steer_policy,
+		 REDROBD_CMD_POLICY camera_policy);
 
   ~redrobd_rc_net(void);
 
@@ -50,10 +60,28 @@ class redrobd_rc_net : public redrobd_remote_ctrl {
   virtual void finalize(void);
   virtual uint16_t get_steering(void);
 
+  // Same as initialize in two parts, server thread
+  // setup is done concurrently with the caller in between.
+  void initialize_begin(void);
+  void initialize_end(void);
+
+  // Receive time of steering returned by latest get_steering.
+  // Returns false if it was not a new steering from client.
+  bool get_steering_recv_time(struct timespec *recv_time);
+
+  // True if more steerings are queued (policy REDROBD_CMD_ALL)
+  bool steering_pending(void);
+
   void set_voltage(float value);
 
   uint16_t get_camera_code(void);
 
+  // True if more camera codes are queued (policy REDROBD_CMD_ALL)
+  bool camera_code_pending(void);
+
+  void get_code_stat(RC_NET_CODE_STAT *steer_stat,
+		     RC_NET_CODE_STAT *camera_stat);
+
   void set_sys_stat(uint8_t cpu_load,     // %
 		    uint32_t mem_used,    // KBytes
 		    uint16_t irq,         // Irq/s
@@ -62,11 +90,29 @@ class redrobd_rc_net : public redrobd_remote_ctrl {
 		    uint16_t cpu_voltage, // milli-volt
 		    uint16_t cpu_freq);   // MHz
 
+  // Summary of steer command trace stages for clients,
+  // indexed by RC_NET_TRACE_xxx
+  void set_trace_stat(const histogram *stage);
+
   void server_thread_check(void);
 
  private:
   string   m_server_ip_address;
   uint16_t m_server_port;
+  uint16_t m_udp_steer_port;
+  string   m_unix_path;
+  int      m_unix_allow_uid;
+
+  // Scheduling and stack size of server thread
+  REDROBD_THREAD_SCHED m_server_thread_sched;
+  unsigned             m_server_thread_stack_kb;
+
+  // Thread signalled by server thread on new client codes
+  cyclic_thread *m_cmd_notify_thread;
+
+  // Transfer policy of client codes
+  REDROBD_CMD_POLICY m_steer_policy;
+  REDROBD_CMD_POLICY m_camera_policy;
 
   // The server thread object
   auto_ptr<redrobd_rc_net_server_thread> m_server_thread_auto;
@@ -9,8 +9,15 @@
 // *                                                                      *
 // ************************************************************************
 
+#include <errno.h>
 #include <strings.h>
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <sstream>
 #include <iomanip>
 
@@ -20,24 +27,89 @@
 #include "redrobd_error_utility.h"
 #include "daemon_utility.h"
 #include "redrobd.h"
+#include "delay.h"
 #include "excep.h"
 
 /////////////////////////////////////////////////////////////////////////////
 //               Definitions of macros
 /////////////////////////////////////////////////////////////////////////////
-#define DOTTED_IP_ADDR_LEN  20
-
-// Client commands
-#define CLI_CMD_STEER          1
-#define CLI_CMD_GET_VOLTAGE    2
-#define CLI_CMD_CAMERA         3
-#define CLI_CMD_GET_SYS_STATS  4
-
-/////////////////////////////////////////////////////////////////////////////
-//               Definition of types and constants
-/////////////////////////////////////////////////////////////////////////////
-
-static const int client_com_error = 1; // Exception for send/recv client
+// Pending connections not yet accepted
+#define SERVER_LISTEN_BACKLOG  4
+
+// Identifies source of epoll events,
+// values below RC_NET_MAX_CLIENTS are client index
+#define EPOLL_ID_SERVER    RC_NET_MAX_CLIENTS
+#define EPOLL_ID_SHUTDOWN  (RC_NET_MAX_CLIENTS + 1)
+#define EPOLL_ID_UDP       (RC_NET_MAX_CLIENTS + 2)
+#define EPOLL_ID_PUSH      (RC_NET_MAX_CLIENTS + 3)
+#define EPOLL_ID_UNIX      (RC_NET_MAX_CLIENTS + 4)
+
+#define EPOLL_MAX_EVENTS  (RC_NET_MAX_CLIENTS + 5)
+
+// Largest reply of one command
+#define MAX_CMD_REPLY_SIZE  sizeof(RC_NET_TRACE_STAT)
+
+// Implementation notes:
+// 1. One thread serves all clients. Server socket, clients and
+//    shutdown (eventfd) are waited for by epoll. All sockets are
+//    non-blocking (socket_connection). Each readiness event is
+//    served by one receive, partial commands are kept until complete.
+//    Replies are queued and sent by one send when all received
+//    commands are handled, data that can't be sent at once is kept.
+//
+// 2. Single driver: The first client sending a control command
+//    (steer, camera) becomes driver and owns steering and camera
+//    until it disconnects. Control commands from other clients are
+//    ignored (counted as rejected). Any client may get voltage and
+//    system statistics.
+//
+// 3. Protocol: A client starts in legacy protocol, a sequence of
+//    commands, each command (uint16) optionally followed by a
+//    code (uint8). Replies are sent as each command is handled.
+//    If the first command is CLI_CMD_HELLO (uint8 version) the
+//    reply is CLI_CMD_HELLO with the version selected by server.
+//    With version RC_NET_PROTO_FRAMED the client then sends frames,
+//    a length (uint16) followed by any number of legacy commands.
+//    Each frame gets one reply frame, a length (uint16) followed by
+//    the replies of the commands in the same order. A client may
+//    send several frames without waiting for replies.
+//
+//    With the framed protocol a client may subscribe to telemetry
+//    (CLI_CMD_SUBSCRIBE). The server then pushes frames with
+//    FRAME_PUSH_FLAG set in the length, the frame holds the pushed
+//    fields (uint8) followed by voltage (uint16) and/or
+//    RC_NET_SYS_STAT, same encoding as the replies of the GET
+//    commands. A period of zero ends the subscription.
+//    Push timer is disarmed when no client is subscribed.
+//
+//    CLI_CMD_PING echoes the client timestamp followed by the server
+//    receive time, for round-trip and clock offset measurements.
+//    Receive time is taken once for each epoll wakeup, it is also
+//    where the steer command trace starts (CLI_CMD_GET_TRACE).
+//    It is monotonic, a ping reply maps it to realtime so it can be
+//    compared with the clock of the client.
+//
+// 4. UDP steering (optional): A client gets a random token by
+//    CLI_CMD_GET_UDP_TOKEN and may then send RC_NET_UDP_STEER
+//    packets with the token from the same address as its TCP
+//    connection. The token binds the packets to that connection,
+//    also when several clients share an address (NAT), and the
+//    packets act as steer commands of that client. Lost packets
+//    are not resent, reordered and stale packets are dropped.
+//    Staleness is measured against the fastest packet seen, no
+//    clock synchronization with the client is needed.
+//
+// 5. Local control socket (optional): Clients on the same host may
+//    connect to a unix socket (AF_UNIX) instead, same commands and
+//    client slots as TCP clients. The socket file is accessible by
+//    anyone, peers are instead checked by their credentials
+//    (SO_PEERCRED). Local clients may get a read only descriptor
+//    for the logfile (CLI_CMD_GET_LOG_FD), it is passed (SCM_RIGHTS)
+//    with the next data sent to the client and must be read by
+//    recvmsg.
+//
+// 6. Shutdown is requested by other threads using the eventfd only,
+//    all sockets are closed by the server thread itself.
 
 /////////////////////////////////////////////////////////////////////////////
 //               Public member functions
@@ -48,17 +120,23 @@ static const int client_com_error = 1; // Exception for send/recv client
 redrobd_rc_net_server_thread::
 redrobd_rc_net_server_thread(string thread_name,
 			     string server_ip_address,
-			     uint16_t server_port) : thread(thread_name)
+			     uint16_t server_port,
+			     uint16_t udp_steer_port,
+			     string unix_path,
+			     int unix_allow_uid,
+			     cyclic_thread *cmd_notify_thread,
+			     REDROBD_CMD_POLICY steer_policy,
+			     REDROBD_CMD_POLICY camera_policy) : thread(thread_name)
 {
   m_server_ip_address = server_ip_address;
   m_server_port = server_port;
+  m_udp_steer_port = udp_steer_port;
+  m_unix_path = unix_path;
+  m_unix_allow_uid = unix_allow_uid;
+  m_cmd_notify_thread = cmd_notify_thread;
+  m_steer_code.policy = steer_policy;
+  m_camera_code.policy = camera_policy;
 
-  // Use default mutex attributes
-  pthread_mutex_init(&m_steer_code_mutex, NULL);
-  pthread_mutex_init(&m_voltage_mutex, NULL);
-  pthread_mutex_init(&m_camera_code_mutex, NULL);
-  pthread_mutex_init(&m_sys_stat_mutex, NULL);
-  
   init_members();
 }
 
@@ -66,125 +144,121 @@ redrobd_rc_net_server_thread(string thread_name,
 
 redrobd_rc_net_server_thread::~redrobd_rc_net_server_thread(void)
 {
-  pthread_mutex_destroy(&m_steer_code_mutex);
-  pthread_mutex_destroy(&m_voltage_mutex);
-  pthread_mutex_destroy(&m_camera_code_mutex);
-  pthread_mutex_destroy(&m_sys_stat_mutex);
+  // Not closed by cleanup, shutdown_server may write it until
+  // the thread has been joined
+  if (m_shutdown_fd >= 0) {
+    close(m_shutdown_fd);
+    m_shutdown_fd = -1;
+  }
 }
 
 ////////////////////////////////////////////////////////////////
 
 uint16_t redrobd_rc_net_server_thread::get_steer_code(void)
 {
-  uint16_t the_code;
+  RC_NET_CODE the_code;
 
-  // Lockdown get operation
-  pthread_mutex_lock(&m_steer_code_mutex);
+  m_steer_code_new = get_code(m_steer_code, the_code);
+  if (!m_steer_code_new) {
+    return CLI_STEER_NONE;
+  }
+  m_steer_code_recv_time = the_code.recv_time;
 
-  the_code = m_steer_code;  
-  m_steer_code = CLI_STEER_NONE;
-  
-  // Lockup get operation
-  pthread_mutex_unlock(&m_steer_code_mutex);
-  
-  return the_code;
+  return the_code.code;
 }
 
 ////////////////////////////////////////////////////////////////
 
-void redrobd_rc_net_server_thread::set_voltage(float value)
+bool redrobd_rc_net_server_thread::steer_code_pending(void)
 {
-  // Lockdown set operation
-  pthread_mutex_lock(&m_voltage_mutex);
+  return code_pending(m_steer_code);
+}
 
-  // Value is sent to client in milli-volts
-  m_voltage = (uint16_t)(value * 1000.0);
+////////////////////////////////////////////////////////////////
+
+bool redrobd_rc_net_server_thread::
+get_steer_code_recv_time(struct timespec *recv_time)
+{
+  if (!m_steer_code_new) {
+    return false;
+  }
+  *recv_time = m_steer_code_recv_time;
+
+  return true;
+}
 
-  // Lockup set operation
-  pthread_mutex_unlock(&m_voltage_mutex);
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net_server_thread::set_voltage(float value)
+{
+  // Value is sent to client in milli-volts
+  m_voltage.write((uint16_t)(value * 1000.0));
 }
 
 ////////////////////////////////////////////////////////////////
 
 uint16_t redrobd_rc_net_server_thread::get_camera_code(void)
 {
-  uint16_t the_code;
+  RC_NET_CODE the_code;
 
-  // Lockdown get operation
-  pthread_mutex_lock(&m_camera_code_mutex);
+  if (!get_code(m_camera_code, the_code)) {
+    return CLI_CAMERA_NONE;
+  }
 
-  the_code = m_camera_code;  
-  m_camera_code = CLI_CAMERA_NONE;
-  
-  // Lockup get operation
-  pthread_mutex_unlock(&m_camera_code_mutex);
-  
-  return the_code;
+  return the_code.code;
 }
 
 ////////////////////////////////////////////////////////////////
 
-void redrobd_rc_net_server_thread::set_sys_stat(const RC_NET_SYS_STAT *sys_stat)
+bool redrobd_rc_net_server_thread::camera_code_pending(void)
 {
-  // Lockdown set operation
-  pthread_mutex_lock(&m_sys_stat_mutex);
+  return code_pending(m_camera_code);
+}
 
-  memcpy(&m_sys_stat, sys_stat, sizeof(m_sys_stat));
+////////////////////////////////////////////////////////////////
 
-  // Lockup set operation
-  pthread_mutex_unlock(&m_sys_stat_mutex);
+void redrobd_rc_net_server_thread::get_code_stat(RC_NET_CODE_STAT *steer_stat,
+						 RC_NET_CODE_STAT *camera_stat)
+{
+  get_channel_stat(m_steer_code, steer_stat);
+  get_channel_stat(m_camera_code, camera_stat);
 }
 
 ////////////////////////////////////////////////////////////////
 
-void redrobd_rc_net_server_thread::shutdown_server(void)
+void redrobd_rc_net_server_thread::set_sys_stat(const RC_NET_SYS_STAT *sys_stat)
 {
-  // Initiate a controlled server shutdown
-  m_shutdown_requested = true;
+  m_sys_stat.write(*sys_stat);
+}
 
-  /////////////////////////////////////
-  //         Server socket
-  /////////////////////////////////////
+////////////////////////////////////////////////////////////////
 
-  if (!m_server_closed) {
+void redrobd_rc_net_server_thread::
+set_trace_stat(const RC_NET_TRACE_STAT *trace_stat)
+{
+  m_trace_stat.write(*trace_stat);
+}
 
-    // Shutdown server socket
-    if (shutdown_socket(m_server_sd,
-			true,
-			true) != SOCKET_SUPPORT_SUCCESS) {
-      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
-		"Shutdown (requested) server socket failed in thread %s",
-		get_name().c_str());
-    }
-    
-    // Close server socket
-    if (close_socket(m_server_sd) != SOCKET_SUPPORT_SUCCESS) {
-      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
-		"Close (requested) server socket failed in thread %s",
-		get_name().c_str());
-    }
-    m_server_closed = true;
-  }
+////////////////////////////////////////////////////////////////
 
-  /////////////////////////////////////
-  //         Client socket
-  /////////////////////////////////////
+unsigned redrobd_rc_net_server_thread::get_nr_clients(void)
+{
+  return __atomic_load_n(&m_nr_clients, __ATOMIC_RELAXED);
+}
 
-  if (m_client_connected) {
+////////////////////////////////////////////////////////////////
 
-    // Shutdown client socket
-    if (shutdown_socket(m_client_sd,
-			true,
-			true) != SOCKET_SUPPORT_SUCCESS) {
-      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
-		"Shutdown (requested) client socket failed in thread %s",
-		get_name().c_str());
-    }
-    
-    // Close client socket
-    if (close_socket(m_client_sd) != SOCKET_SUPPORT_SUCCESS) {
-      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
-		"Close (requested) client socket failed in thread %s",
+void redrobd_rc_net_server_thread::shutdown_server(void)
+{
+  // Initiate a controlled server shutdown
+  __atomic_store_n(&m_shutdown_requested, true, __ATOMIC_RELEASE);
+
+  // Wake up server thread
+  if (m_shutdown_fd >= 0) {
+    uint64_t value = 1;
+    if (write(m_shutdown_fd, &value, sizeof(value)) != sizeof(value)) {
+      THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+		"Shutdown (requested) server failed in thread %s",
 		get_name().c_str());
     }
   }
@@ -201,6 +275,14 @@ long redrobd_rc_net_server_thread::setup(void)
   try {
     redrobd_log_writeln(get_name() + " : setup started");
 
+    // Created first, shutdown may be requested any time after start
+    m_shutdown_fd = eventfd(0, EFD_NONBLOCK);
+    if (m_shutdown_fd == -1) {
+      THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+		"Create shutdown eventfd failed in thread %s",
+		get_name().c_str());
+    }
+
     // Create server socket
     if (create_tcp_socket(&m_server_sd) != SOCKET_SUPPORT_SUCCESS) {
       THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
@@ -208,6 +290,13 @@ long redrobd_rc_net_server_thread::setup(void)
 		get_name().c_str());
     }
 
+    // Allow bind on restart while old connections are in TIME_WAIT
+    if (set_opt_reuse_addr(m_server_sd, true) != SOCKET_SUPPORT_SUCCESS) {
+      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+		"Reuse address server socket failed in thread %s",
+		get_name().c_str());
+    }
+
     // Create socket address
     socket_address server_sa;
     if (to_net_address(m_server_ip_address.c_str(),
@@ -227,11 +316,43 @@ long redrobd_rc_net_server_thread::setup(void)
     }
 
     // Mark socket as accepting connections
-    if (listen_socket(m_server_sd, 0) != SOCKET_SUPPORT_SUCCESS) {
+    if (listen_socket(m_server_sd,
+		      SERVER_LISTEN_BACKLOG) != SOCKET_SUPPORT_SUCCESS) {
       THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
 		"Listen server socket failed in thread %s",
 		get_name().c_str());
     }
+    if (set_attr_blocked(m_server_sd, false) != SOCKET_SUPPORT_SUCCESS) {
+      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+		"Non-blocking server socket failed in thread %s",
+		get_name().c_str());
+    }
+
+    // Wait for server socket and shutdown
+    m_epoll_fd = epoll_create(EPOLL_MAX_EVENTS);
+    if (m_epoll_fd == -1) {
+      THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+		"Create epoll failed in thread %s",
+		get_name().c_str());
+    }
+    epoll_update(EPOLL_CTL_ADD, m_server_sd, EPOLLIN, EPOLL_ID_SERVER);
+    epoll_update(EPOLL_CTL_ADD, m_shutdown_fd, EPOLLIN, EPOLL_ID_SHUTDOWN);
+
+    // Telemetry push timer, armed on first subscription
+    m_push_timer_fd = timerfd_create(get_clock_id(), TFD_NONBLOCK);
+    if (m_push_timer_fd == -1) {
+      THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+		"Create push timer failed in thread %s",
+		get_name().c_str());
+    }
+    epoll_update(EPOLL_CTL_ADD, m_push_timer_fd, EPOLLIN, EPOLL_ID_PUSH);
+
+    if (m_udp_steer_port) {
+      setup_udp(server_sa);
+    }
+    if (!m_unix_path.empty()) {
+      setup_unix();
+    }
             
     redrobd_log_writeln(get_name() + " : setup done");
 
@@ -254,28 +375,55 @@ long redrobd_rc_net_server_thread::cleanup(void)
   try {
     redrobd_log_writeln(get_name() + " : cleanup started");
 
-    ///////////////////////////////////////////////
-    // If no controlled shutdown was requested,
-    // proceed with cleanup
-    ///////////////////////////////////////////////
-    if (!m_shutdown_requested) {
+    // Disconnect all clients
+    for (unsigned i=0; i < RC_NET_MAX_CLIENTS; i++) {
+      if (m_client[i].conn.is_attached()) {
+	close_client(i, "server shutdown");
+      }
+    }
+
+    if (m_epoll_fd >= 0) {
+      close(m_epoll_fd);
+      m_epoll_fd = -1;
+    }
+    if (m_push_timer_fd >= 0) {
+      close(m_push_timer_fd);
+      m_push_timer_fd = -1;
+    }
+
+    // Close server socket
+    if (m_server_sd >= 0) {
+      if (close_socket(m_server_sd) != SOCKET_SUPPORT_SUCCESS) {
+	THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+		  "Close server socket failed in thread %s",
+		  get_name().c_str());
+      }
+      m_server_sd = -1;
+    }
 
-      // Shutdown server socket
-      if (shutdown_socket(m_server_sd,
-			  true,
-			  true) != SOCKET_SUPPORT_SUCCESS) {
+    // Close steer socket
+    if (m_udp_sd >= 0) {
+      if (close_socket(m_udp_sd) != SOCKET_SUPPORT_SUCCESS) {
 	THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
-		  "Shutdown server socket failed in thread %s",
+		  "Close UDP steer socket failed in thread %s",
 		  get_name().c_str());
       }
-      
-      // Close server socket
-      if (close_socket(m_server_sd) != SOCKET_SUPPORT_SUCCESS) {
+      m_udp_sd = -1;
+
+      ostringstream oss_msg;
+      oss_msg << "UDP steer packets rejected:" << dec << m_udp_rejected;
+      redrobd_log_writeln(get_name() + " : " + oss_msg.str());
+    }
+
+    // Close local control socket, socket file is removed
+    if (m_unix_sd >= 0) {
+      if (close_socket(m_unix_sd) != SOCKET_SUPPORT_SUCCESS) {
 	THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
-		  "Close server socket failed in thread %s",
+		  "Close unix socket failed in thread %s",
 		  get_name().c_str());
       }
-      m_server_closed = true;
+      m_unix_sd = -1;
+      unlink(m_unix_path.c_str());
     }
 
     redrobd_log_writeln(get_name() + " : cleanup done");
@@ -329,223 +477,1296 @@ long redrobd_rc_net_server_thread::execute(void *arg)
 void redrobd_rc_net_server_thread::init_members(void)
 {
   m_shutdown_requested = false;
-  m_client_connected = false;
-  m_server_closed = false;
+  m_shutdown_fd = -1;
+
+  m_steer_code.latest_version = m_steer_code.latest.get_version();
+  m_steer_code.received = 0;
+  m_steer_code.coalesced = 0;
+  m_steer_code_new = false;
+  bzero(&m_steer_code_recv_time, sizeof(m_steer_code_recv_time));
+
+  m_voltage.write(0);
+
+  m_camera_code.latest_version = m_camera_code.latest.get_version();
+  m_camera_code.received = 0;
+  m_camera_code.coalesced = 0;
+
+  RC_NET_SYS_STAT sys_stat;
+  bzero(&sys_stat, sizeof(sys_stat));
+  m_sys_stat.write(sys_stat);
+
+  RC_NET_TRACE_STAT trace_stat;
+  bzero(&trace_stat, sizeof(trace_stat));
+  m_trace_stat.write(trace_stat);
+
+  bzero(&m_rx_time, sizeof(m_rx_time));
 
-  m_steer_code = CLI_STEER_NONE;
-  m_voltage = 0;
-  m_camera_code = CLI_CAMERA_NONE;
+  m_server_sd = -1;
+  m_epoll_fd = -1;
 
-  bzero(&m_sys_stat, sizeof(m_sys_stat));
+  m_udp_sd = -1;
+  m_udp_rejected = 0;
 
-  m_server_sd = 0;
-  m_client_sd = 0;
+  m_unix_sd = -1;
+
+  m_nr_clients = 0;
+  m_driver = -1;
+  m_push_timer_fd = -1;
 }
 
 ////////////////////////////////////////////////////////////////
 
 void redrobd_rc_net_server_thread::handle_clients(void)
 {
-  long rc;
-  socket_address client_sa;
-  char client_ip[DOTTED_IP_ADDR_LEN];
+  struct epoll_event events[EPOLL_MAX_EVENTS];
+  ostringstream oss_msg;
+
+  oss_msg << "Wait for clients on port:" << dec << m_server_port;
+  redrobd_log_writeln(get_name() + " : " + oss_msg.str());
+
+  while (!__atomic_load_n(&m_shutdown_requested, __ATOMIC_ACQUIRE)) {
+
+    int nr_events = epoll_wait(m_epoll_fd, events, EPOLL_MAX_EVENTS, -1);
+    if (nr_events == -1) {
+      if (errno == EINTR) {
+	continue;
+      }
+      THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+		"Wait epoll failed in thread %s",
+		get_name().c_str());
+    }
+
+    // One time stamp for all events
+    if ( clock_gettime(get_clock_id(), &m_rx_time) ) {
+      THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+		"Get receive time failed in thread %s",
+		get_name().c_str());
+    }
+
+    for (int i=0; i < nr_events; i++) {
+      uint32_t id = events[i].data.u32;
+
+      if (id == EPOLL_ID_SHUTDOWN) {
+	// Controlled shutdown, checked by loop
+	continue;
+      }
+      if (id == EPOLL_ID_SERVER) {
+	accept_clients(m_server_sd, false);
+	continue;
+      }
+      if (id == EPOLL_ID_UNIX) {
+	accept_clients(m_unix_sd, true);
+	continue;
+      }
+      if (id == EPOLL_ID_UDP) {
+	receive_udp();
+	continue;
+      }
+      if (id == EPOLL_ID_PUSH) {
+	push_telemetry();
+	continue;
+      }
+
+      // Client may have been closed by earlier event
+      if (!m_client[id].conn.is_attached()) {
+	continue;
+      }
+      if (events[i].events & EPOLLOUT) {
+	flush_client(id);
+      }
+      if ( (m_client[id].conn.is_attached()) &&
+	   (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) ) {
+	receive_client(id);
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net_server_thread::accept_clients(int listen_sd,
+						  bool local)
+{
   ostringstream oss_msg;
+  socket_address client_sa;
+  int client_sd;
+  uint32_t pid = 0;
+  uint32_t uid = 0;
+  uint32_t gid;
 
   while (1) {
-    
-    oss_msg << "Wait for client on port:" << dec << m_server_port;
-    redrobd_log_writeln(get_name() + " : " + oss_msg.str());
-    oss_msg.str("");
+    // Accept all pending connections
+    long rc = accept_socket(listen_sd,
+			    &client_sd,
+			    &client_sa);
+    if ( (rc == SOCKET_SUPPORT_WOULD_BLOCK) ||
+	 (rc == SOCKET_SUPPORT_INTERRUPTED) ) {
+      return;
+    }
+    if (rc != SOCKET_SUPPORT_SUCCESS) {
+      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+		"Accept %s socket failed in thread %s",
+		(local ? "unix" : "server"), get_name().c_str());
+    }
+
+    // Local peer process must be allowed
+    if (local) {
+      if (get_socket_peer_cred(client_sd,
+			       &pid,
+			       &uid,
+			       &gid) != SOCKET_SUPPORT_SUCCESS) {
+	THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+		  "Peer credentials for unix socket failed in thread %s",
+		  get_name().c_str());
+      }
+      if (!allowed_peer(uid)) {
+	oss_msg << "Local client rejected, pid:" << dec << pid
+		<< ", uid:" << uid;
+	redrobd_log_writeln(get_name() + " : " + oss_msg.str());
+	oss_msg.str("");
+	close_socket(client_sd);
+	continue;
+      }
+    }
+
+    // Find free client
+    unsigned index;
+    for (index=0; index < RC_NET_MAX_CLIENTS; index++) {
+      if (!m_client[index].conn.is_attached()) {
+	break;
+      }
+    }
+    if (index == RC_NET_MAX_CLIENTS) {
+      oss_msg << "Client rejected, max " << dec
+	      << RC_NET_MAX_CLIENTS << " clients";
+      redrobd_log_writeln(get_name() + " : " + oss_msg.str());
+      oss_msg.str("");
+      close_socket(client_sd);
+      continue;
+    }
 
-    // Wait for client to connect
-    rc = accept_socket(m_server_sd,
-		       &m_client_sd,
-		       &client_sa);
-   
-    // Check if controlled server shutdown
-    if ( (rc != SOCKET_SUPPORT_SUCCESS) &&
-	 (m_shutdown_requested) ) {
-
-      // This was a controlled shutdown.
-      // Quit server thread with no error.
-      break;
-    }
-    else if (rc != SOCKET_SUPPORT_SUCCESS) {
-      // This was not a controlled shutdown.
-      // Quit server thread with error.
+    if (set_attr_blocked(client_sd, false) != SOCKET_SUPPORT_SUCCESS) {
       THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
-		"Accept server socket failed in thread %s",
+		"Non-blocking client socket failed in thread %s",
 		get_name().c_str());
     }
-    else {
-      m_client_connected = true;
+
+    RC_NET_CLIENT &client = m_client[index];
+
+    client.conn.attach(client_sd,
+		       client.rx_buf, sizeof(client.rx_buf),
+		       client.tx_buf, sizeof(client.tx_buf));
+    client.sa = client_sa;
+    client.local = local;
+    client.pid = pid;
+    client.uid = uid;
+    client.pass_fd = -1;
+    client.proto = RC_NET_PROTO_LEGACY;
+    client.tx_wait = false;
+    bzero(&client.stat, sizeof(client.stat));
+    bzero(&client.udp, sizeof(client.udp));
+    bzero(&client.push, sizeof(client.push));
+    if ( clock_gettime(get_clock_id(), &client.connect_time) ) {
+      THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+		"Get connect time failed in thread %s",
+		get_name().c_str());
     }
 
     // Get address info for connected client
-    if (to_ip_address(client_sa.net_addr,
-		      client_ip,
-		      DOTTED_IP_ADDR_LEN) != SOCKET_SUPPORT_SUCCESS) {
+    if (local) {
+      strcpy(client.ip, "unix");
+    }
+    else if (to_ip_address(client_sa.net_addr,
+			   client.ip,
+			   RC_NET_IP_ADDR_LEN) != SOCKET_SUPPORT_SUCCESS) {
       THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
 		"Client address for server socket failed in thread %s",
 		get_name().c_str());
     }
-    oss_msg << "Client connected => " << client_ip
-	    << ", port:" << dec << client_sa.port;
+
+    epoll_update(EPOLL_CTL_ADD, client_sd, EPOLLIN, index);
+
+    __atomic_store_n(&m_nr_clients, m_nr_clients + 1, __ATOMIC_RELAXED);
+
+    oss_msg << "Client[" << index << "] connected => " << client.ip << dec;
+    if (local) {
+      oss_msg << ", pid:" << pid << ", uid:" << uid;
+    }
+    else {
+      oss_msg << ", port:" << client_sa.port;
+    }
+    oss_msg << ", clients:" << m_nr_clients;
     redrobd_log_writeln(get_name() + " : " + oss_msg.str());
     oss_msg.str("");
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+bool redrobd_rc_net_server_thread::allowed_peer(uint32_t uid)
+{
+  return ( (uid == 0) ||
+	   (uid == (uint32_t)geteuid()) ||
+	   ( (m_unix_allow_uid >= 0) && (uid == (uint32_t)m_unix_allow_uid) ) );
+}
 
-    // Handle client commands
-    bool handle_command = true;
-    while (handle_command) {      
-      
-      try {
-	uint16_t client_command;	
+////////////////////////////////////////////////////////////////
 
-	// Wait for command
-	recv_client((void *)&client_command,
-		    sizeof(client_command));
+void redrobd_rc_net_server_thread::receive_client(unsigned index)
+{
+  RC_NET_CLIENT &client = m_client[index];
+  unsigned actual_bytes;
 
-	ntoh16(&client_command);
+  // One receive for each readiness event, epoll reports
+  // again if more data is available. Partial command is kept.
+  long rc = client.conn.fill(&actual_bytes);
 
-	// Handle command
-	if (client_command == CLI_CMD_STEER) {
-	  uint8_t steer_code;
+  if ( (rc == SOCKET_SUPPORT_WOULD_BLOCK) ||
+       (rc == SOCKET_SUPPORT_INTERRUPTED) ) {
+    return;
+  }
+  if (rc != SOCKET_SUPPORT_SUCCESS) {
+    close_client(index, "receive failed");
+    return;
+  }
+  if (!actual_bytes) {
+    close_client(index, "closed by client");
+    return;
+  }
 
-	  // Get steer code
-	  recv_client((void *)&steer_code,
-		      sizeof(steer_code));
+  if (!handle_commands(index)) {
+    return; // Client closed
+  }
 
-	  // Update latest steer code
-	  pthread_mutex_lock(&m_steer_code_mutex);
-	  m_steer_code = steer_code;
-	  pthread_mutex_unlock(&m_steer_code_mutex);
-	  	  
-	}
-	else if (client_command == CLI_CMD_GET_VOLTAGE) {
-	  uint16_t voltage;
+  // All replies in one send
+  flush_client(index);
+}
 
-	  // Reply with latest voltage
-	  pthread_mutex_lock(&m_voltage_mutex);
-	  voltage = m_voltage;
-	  pthread_mutex_unlock(&m_voltage_mutex);
+////////////////////////////////////////////////////////////////
 
-	  hton16(&voltage);
+bool redrobd_rc_net_server_thread::handle_commands(unsigned index)
+{
+  RC_NET_CLIENT &client = m_client[index];
+  uint8_t reply[MAX_CMD_REPLY_SIZE];
+  unsigned pos = 0;
+
+  while (client.conn.get_rx_len() > pos) {
+    const uint8_t *data = client.conn.get_rx_data() + pos;
+    unsigned avail = client.conn.get_rx_len() - pos;
+
+    if (client.proto == RC_NET_PROTO_FRAMED) {
+      // Frame : length (uint16) followed by commands
+      if (avail < sizeof(uint16_t)) {
+	break;
+      }
+      uint16_t frame_len;
+      memcpy(&frame_len, data, sizeof(frame_len));
+      ntoh16(&frame_len);
 
-	  send_client((void *)&voltage,
-		      sizeof(voltage));
-	}
-	else if (client_command == CLI_CMD_CAMERA) {
-	  uint8_t camera_code;
+      if (frame_len > RC_NET_MAX_FRAME_SIZE) {
+	close_client(index, "frame too large");
+	return false;
+      }
+      if (avail < sizeof(frame_len) + frame_len) {
+	break; // Wait for rest of frame
+      }
+      if (!handle_frame(index, data + sizeof(frame_len), frame_len)) {
+	return false; // Client closed
+      }
+      pos += sizeof(frame_len) + frame_len;
+    }
+    else {
+      unsigned cmd_len = command_length(data, avail);
+      if (!cmd_len) {
+	break; // Wait for rest of command
+      }
 
-	  // Get camera code
-	  recv_client((void *)&camera_code,
-		      sizeof(camera_code));
+      // Protocol is negotiated by first command only
+      uint16_t client_command;
+      memcpy(&client_command, data, sizeof(client_command));
+      ntoh16(&client_command);
 
-	  // Update latest camera code
-	  pthread_mutex_lock(&m_camera_code_mutex);
-	  m_camera_code = camera_code;
-	  pthread_mutex_unlock(&m_camera_code_mutex);
+      if ( (client_command == CLI_CMD_HELLO) && (!client.stat.commands) ) {
+	if (!handle_hello(index, data)) {
+	  return false; // Client closed
 	}
-	else if (client_command == CLI_CMD_GET_SYS_STATS) {
-	  RC_NET_SYS_STAT sys_stat;
-
-	  // Reply with latest system statistics
-	  pthread_mutex_lock(&m_sys_stat_mutex);
-	  memcpy(&sys_stat, &m_sys_stat, sizeof(m_sys_stat));	  
-	  pthread_mutex_unlock(&m_sys_stat_mutex);
-
-	  hton32(&sys_stat.mem_used);
-	  hton16(&sys_stat.irq);
-	  hton32(&sys_stat.uptime);
-	  hton32(&sys_stat.cpu_temp);
-	  hton16(&sys_stat.cpu_voltage);
-	  hton16(&sys_stat.cpu_freq);
-
-	  send_client((void *)&sys_stat,
-		      sizeof(sys_stat));
-	}
-	else {
-	  oss_msg << "Unknown client command : 0x"
-		  << hex << (unsigned)client_command;
-	  redrobd_log_writeln(get_name() + " : " + oss_msg.str());
-	  oss_msg.str("");
+      }
+      else {
+	unsigned reply_len = 0;
 
-	  handle_command = false;
+	if (!execute_command(index, data, reply, &reply_len)) {
+	  close_client(index, "unknown command");
+	  return false;
+	}
+	if (reply_len) {
+	  send_client(index, reply, reply_len);
 	}
       }
-      catch (...) {
-	handle_command = false;
-      }
+      pos += cmd_len;
     }
-    
-    if (m_shutdown_requested) {
-      // This was a controlled shutdown.
-      // Quit server thread with no error.
-      break;
+
+    // Client closed by failed reply
+    if (!client.conn.is_attached()) {
+      return false;
     }
+  }
 
-    // Shutdown client socket
-    if (shutdown_socket(m_client_sd,
-			true,
-			true) != SOCKET_SUPPORT_SUCCESS) {
-      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
-		"Shutdown client socket failed in thread %s",
-		get_name().c_str());
+  // Keep partial command
+  client.conn.consume(pos);
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////
+
+bool redrobd_rc_net_server_thread::handle_hello(unsigned index,
+						const uint8_t *data)
+{
+  RC_NET_CLIENT &client = m_client[index];
+  ostringstream oss_msg;
+  uint8_t reply[3];
+
+  client.stat.commands++;
+
+  // Use highest version supported by both
+  uint8_t version = data[sizeof(uint16_t)];
+  if (version > RC_NET_PROTO_FRAMED) {
+    version = RC_NET_PROTO_FRAMED;
+  }
+
+  // Reply with selected version, in effect after reply
+  uint16_t hello = CLI_CMD_HELLO;
+  hton16(&hello);
+  memcpy(reply, &hello, sizeof(hello));
+  reply[sizeof(hello)] = version;
+
+  send_client(index, reply, sizeof(reply));
+  if (!client.conn.is_attached()) {
+    return false;
+  }
+  client.proto = version;
+
+  oss_msg << "Client[" << index << "] protocol version "
+	  << (unsigned)version;
+  redrobd_log_writeln(get_name() + " : " + oss_msg.str());
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////
+
+bool redrobd_rc_net_server_thread::handle_frame(unsigned index,
+						const uint8_t *frame,
+						unsigned frame_len)
+{
+  RC_NET_CLIENT &client = m_client[index];
+
+  // Reply frame must fit in send buffer
+  uint8_t reply[RC_NET_CLIENT_TX_SIZE];
+  unsigned reply_len = sizeof(uint16_t);
+  unsigned pos = 0;
+
+  client.stat.frames++;
+
+  // All commands in a frame must be complete
+  while (pos < frame_len) {
+    unsigned cmd_len = command_length(frame + pos, frame_len - pos);
+    if (!cmd_len) {
+      close_client(index, "bad frame");
+      return false;
     }
-    
-    // Close client socket
-    if (close_socket(m_client_sd) != SOCKET_SUPPORT_SUCCESS) {
-      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
-		"Close client socket failed in thread %s",
-		get_name().c_str());
+
+    if (reply_len + MAX_CMD_REPLY_SIZE > sizeof(reply)) {
+      close_client(index, "reply frame too large");
+      return false;
     }
 
-    m_client_connected = false;
+    unsigned cmd_reply_len = 0;
+    if (!execute_command(index,
+			 frame + pos,
+			 reply + reply_len,
+			 &cmd_reply_len)) {
+      close_client(index, "unknown command");
+      return false;
+    }
+    reply_len += cmd_reply_len;
+    pos += cmd_len;
   }
+
+  // One reply frame for each frame, replies in command order
+  uint16_t len = reply_len - sizeof(uint16_t);
+  hton16(&len);
+  memcpy(reply, &len, sizeof(len));
+
+  send_client(index, reply, reply_len);
+
+  return client.conn.is_attached();
 }
 
 ////////////////////////////////////////////////////////////////
 
-void redrobd_rc_net_server_thread::recv_client(void *data,
-					       unsigned nbytes)
+unsigned redrobd_rc_net_server_thread::command_length(const uint8_t *data,
+						      unsigned avail)
 {
-  long rc;
-  unsigned actual_bytes;
+  uint16_t client_command;
+  unsigned cmd_len = sizeof(client_command);
 
-  // Receive data from client
-  rc = recv_socket(m_client_sd,
-		   data,
-		   nbytes,
-		   true,  // Receive all
-		   false, // No peek
-		   &actual_bytes);
-  
-  if (rc != SOCKET_SUPPORT_SUCCESS) {
-    throw client_com_error;
+  if (avail < cmd_len) {
+    return 0;
+  }
+  memcpy(&client_command, data, sizeof(client_command));
+  ntoh16(&client_command);
+
+  // These commands have a one byte argument
+  if ( (client_command == CLI_CMD_STEER) ||
+       (client_command == CLI_CMD_CAMERA) ||
+       (client_command == CLI_CMD_HELLO) ) {
+    cmd_len += sizeof(uint8_t);
+  }
+  else if (client_command == CLI_CMD_SUBSCRIBE) {
+    cmd_len += CLI_SUBSCRIBE_ARG_SIZE;
+  }
+  else if (client_command == CLI_CMD_PING) {
+    cmd_len += CLI_PING_ARG_SIZE;
   }
 
-  // Check if client closed connection
-  if (!actual_bytes) {
-    throw client_com_error;
+  if (avail < cmd_len) {
+    return 0;
   }
+  return cmd_len;
 }
 
 ////////////////////////////////////////////////////////////////
 
-void redrobd_rc_net_server_thread::send_client(void *data,
-					       unsigned nbytes)
+bool redrobd_rc_net_server_thread::execute_command(unsigned index,
+						   const uint8_t *data,
+						   uint8_t *reply,
+						   unsigned *reply_len)
 {
-  long rc;
-  unsigned actual_bytes;
+  uint16_t client_command;
+  ostringstream oss_msg;
 
-  // Send data to client
-  rc = send_socket(m_client_sd,
-		   data,
-		   nbytes,
-		   true,  // Send all
-		   &actual_bytes);
-  
-  if (rc != SOCKET_SUPPORT_SUCCESS) {
-    throw client_com_error;
+  memcpy(&client_command, data, sizeof(client_command));
+  ntoh16(&client_command);
+
+  const uint8_t *code = data + sizeof(client_command);
+
+  m_client[index].stat.commands++;
+  *reply_len = 0;
+
+  // Handle command
+  if (client_command == CLI_CMD_STEER) {
+    // Update latest steer code
+    if (take_driver(index)) {
+      put_code(m_steer_code, *code);
+    }
   }
-}
+  else if (client_command == CLI_CMD_GET_VOLTAGE) {
+    uint16_t voltage;
+
+    // Reply with latest voltage
+    m_voltage.read(voltage);
+
+    hton16(&voltage);
+
+    memcpy(reply, &voltage, sizeof(voltage));
+    *reply_len = sizeof(voltage);
+  }
+  else if (client_command == CLI_CMD_CAMERA) {
+    // Update latest camera code
+    if (take_driver(index)) {
+      put_code(m_camera_code, *code);
+    }
+  }
+  else if (client_command == CLI_CMD_GET_SYS_STATS) {
+    RC_NET_SYS_STAT sys_stat;
+
+    // Reply with latest system statistics
+    read_sys_stat(sys_stat);
+
+    memcpy(reply, &sys_stat, sizeof(sys_stat));
+    *reply_len = sizeof(sys_stat);
+  }
+  else if (client_command == CLI_CMD_SUBSCRIBE) {
+    // No reply, pushed frames follow
+    return subscribe(index, data + sizeof(client_command));
+  }
+  else if (client_command == CLI_CMD_PING) {
+    struct timespec now;
+    struct timespec now_real;
+
+    if ( (clock_gettime(get_clock_id(), &now)) ||
+	 (clock_gettime(CLOCK_REALTIME, &now_real)) ) {
+      THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+		"Get ping time failed in thread %s",
+		get_name().c_str());
+    }
+
+    // Reply with client timestamp and server receive time,
+    // realtime now minus time since received
+    int64_t since_rx_ns = ( (int64_t)(now.tv_sec - m_rx_time.tv_sec) *
+			    1000000000LL +
+			    (now.tv_nsec - m_rx_time.tv_nsec) );
+    uint64_t rx_time_us = ( ( (int64_t)now_real.tv_sec * 1000000000LL +
+			      now_real.tv_nsec - since_rx_ns ) / 1000 );
+    hton64(&rx_time_us);
+
+    memcpy(reply, code, CLI_PING_ARG_SIZE);
+    memcpy(reply + CLI_PING_ARG_SIZE, &rx_time_us, sizeof(rx_time_us));
+    *reply_len = CLI_PING_REPLY_SIZE;
+  }
+  else if (client_command == CLI_CMD_GET_UDP_TOKEN) {
+    // Reply with token, zero if UDP steering is unavailable
+    uint32_t token = get_udp_token(index);
+    hton32(&token);
+
+    memcpy(reply, &token, sizeof(token));
+    *reply_len = sizeof(token);
+  }
+  else if (client_command == CLI_CMD_GET_TRACE) {
+    RC_NET_TRACE_STAT trace_stat;
+
+    // Reply with latest steer command trace statistics
+    read_trace_stat(trace_stat);
+
+    memcpy(reply, &trace_stat, sizeof(trace_stat));
+    *reply_len = sizeof(trace_stat);
+  }
+  else if (client_command == CLI_CMD_GET_LOG_FD) {
+    // Reply with status, descriptor is passed with reply
+    reply[0] = get_log_fd(index);
+    *reply_len = sizeof(uint8_t);
+  }
+  else {
+    oss_msg << "Unknown client command : 0x"
+	    << hex << (unsigned)client_command;
+    redrobd_log_writeln(get_name() + " : " + oss_msg.str());
+    return false;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////
+
+bool redrobd_rc_net_server_thread::take_driver(unsigned index)
+{
+  ostringstream oss_msg;
+
+  if (m_driver < 0) {
+    m_driver = index;
+
+    oss_msg << "Client[" << index << "] is driver";
+    redrobd_log_writeln(get_name() + " : " + oss_msg.str());
+  }
+
+  if (m_driver != (int)index) {
+    m_client[index].stat.rejected++;
+    return false;
+  }
+
+  return true;
+}
+////////////////////////////////////////////////////////////////
+
+bool redrobd_rc_net_server_thread::subscribe(unsigned index,
+					     const uint8_t *data)
+{
+  RC_NET_CLIENT &client = m_client[index];
+  ostringstream oss_msg;
+  uint16_t period_ms;
+
+  // Pushed frames can't be told from replies in legacy protocol
+  if (client.proto != RC_NET_PROTO_FRAMED) {
+    oss_msg << "Client[" << index << "] subscribe requires framed protocol";
+    redrobd_log_writeln(get_name() + " : " + oss_msg.str());
+    return false;
+  }
+
+  uint8_t fields = data[0] & (RC_NET_PUSH_VOLTAGE | RC_NET_PUSH_SYS_STAT);
+  uint8_t flags = data[1];
+  memcpy(&period_ms, data + 2, sizeof(period_ms));
+  ntoh16(&period_ms);
+
+  if ( (!fields) || (!period_ms) ) {
+    if (client.push.fields) {
+      client.push.fields = 0;
+      arm_push_timer();
+
+      oss_msg << "Client[" << index << "] unsubscribed";
+      redrobd_log_writeln(get_name() + " : " + oss_msg.str());
+    }
+    return true;
+  }
+
+  if (period_ms < RC_NET_PUSH_MIN_PERIOD_MS) {
+    period_ms = RC_NET_PUSH_MIN_PERIOD_MS;
+  }
+  if (period_ms > RC_NET_PUSH_MAX_PERIOD_MS) {
+    period_ms = RC_NET_PUSH_MAX_PERIOD_MS;
+  }
+
+  client.push.fields = fields;
+  client.push.flags = flags;
+  client.push.period = period_ms / 1000.0;
+  client.push.pushed = false;
+
+  // First push as soon as possible
+  if ( clock_gettime(get_clock_id(), &client.push.next_push) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+	      "Get subscribe time failed in thread %s",
+	      get_name().c_str());
+  }
+  arm_push_timer();
+
+  oss_msg << "Client[" << index << "] subscribed fields:0x"
+	  << hex << (unsigned)fields << dec
+	  << ", period:" << period_ms << "ms"
+	  << ((flags & RC_NET_PUSH_ON_CHANGE) ? ", on change" : "");
+  redrobd_log_writeln(get_name() + " : " + oss_msg.str());
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net_server_thread::push_telemetry(void)
+{
+  struct timespec now;
+  uint64_t expirations;
+  uint16_t voltage = 0;
+  RC_NET_SYS_STAT sys_stat;
+  bool values_read = false;
+
+  // May already be disarmed, nothing to read then
+  if (read(m_push_timer_fd, &expirations, sizeof(expirations)) == -1) {
+    if (errno != EAGAIN) {
+      THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+		"Read push timer failed in thread %s",
+		get_name().c_str());
+    }
+  }
+
+  if ( clock_gettime(get_clock_id(), &now) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+	      "Get push time failed in thread %s",
+	      get_name().c_str());
+  }
+
+  for (unsigned i=0; i < RC_NET_MAX_CLIENTS; i++) {
+    RC_NET_CLIENT &client = m_client[i];
+    RC_NET_PUSH &push = client.push;
+
+    if ( (!client.conn.is_attached()) ||
+	 (!push.fields) ||
+	 (get_time_diff(&now, &push.next_push) > 0.0) ) {
+      continue;
+    }
+
+    // Values are read once for all clients
+    if (!values_read) {
+      m_voltage.read(voltage);
+      hton16(&voltage);
+      read_sys_stat(sys_stat);
+      values_read = true;
+    }
+
+    // Frame : length, fields, voltage and/or system statistics
+    uint8_t frame[sizeof(uint16_t) + sizeof(uint8_t) +
+		  sizeof(voltage) + sizeof(sys_stat)];
+    unsigned frame_len = sizeof(uint16_t) + sizeof(uint8_t);
+    uint8_t fields = 0;
+    bool all = ( (!push.pushed) || (!(push.flags & RC_NET_PUSH_ON_CHANGE)) );
+
+    if ( (push.fields & RC_NET_PUSH_VOLTAGE) &&
+	 ( (all) || (voltage != push.last_voltage) ) ) {
+      memcpy(frame + frame_len, &voltage, sizeof(voltage));
+      frame_len += sizeof(voltage);
+      fields |= RC_NET_PUSH_VOLTAGE;
+    }
+    if ( (push.fields & RC_NET_PUSH_SYS_STAT) &&
+	 ( (all) || (memcmp(&sys_stat, &push.last_sys_stat, sizeof(sys_stat))) ) ) {
+      memcpy(frame + frame_len, &sys_stat, sizeof(sys_stat));
+      frame_len += sizeof(sys_stat);
+      fields |= RC_NET_PUSH_SYS_STAT;
+    }
+    push.last_voltage = voltage;
+    push.last_sys_stat = sys_stat;
+    push.pushed = true;
+
+    // Missed pushes are skipped
+    do {
+      if ( get_new_time(&push.next_push,
+			push.period,
+			&push.next_push) != DELAY_SUCCESS ) {
+	THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_TIME_ERROR,
+		  "Get next push time failed in thread %s",
+		  get_name().c_str());
+      }
+    } while (get_time_diff(&now, &push.next_push) <= 0.0);
+
+    if (fields) {
+      uint16_t len = (frame_len - sizeof(uint16_t)) | FRAME_PUSH_FLAG;
+      hton16(&len);
+      memcpy(frame, &len, sizeof(len));
+      frame[sizeof(len)] = fields;
+
+      push.pushes++;
+      send_client(i, frame, frame_len);
+      if (client.conn.is_attached()) {
+	flush_client(i);
+      }
+    }
+  }
+
+  arm_push_timer();
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net_server_thread::arm_push_timer(void)
+{
+  struct itimerspec its;
+  const struct timespec *earliest = NULL;
+
+  if (m_push_timer_fd < 0) {
+    return;
+  }
+
+  for (unsigned i=0; i < RC_NET_MAX_CLIENTS; i++) {
+    if ( (m_client[i].conn.is_attached()) && (m_client[i].push.fields) ) {
+      if ( (!earliest) ||
+	   (get_time_diff(earliest, &m_client[i].push.next_push) < 0.0) ) {
+	earliest = &m_client[i].push.next_push;
+      }
+    }
+  }
+
+  // Disarmed (zero) if no client is subscribed
+  bzero(&its, sizeof(its));
+  if (earliest) {
+    its.it_value = *earliest;
+  }
+
+  if (timerfd_settime(m_push_timer_fd, TFD_TIMER_ABSTIME, &its, NULL)) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+	      "Arm push timer failed in thread %s",
+	      get_name().c_str());
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net_server_thread::read_sys_stat(RC_NET_SYS_STAT &sys_stat)
+{
+  // Latest system statistics, network byte order
+  m_sys_stat.read(sys_stat);
+
+  hton32(&sys_stat.mem_used);
+  hton16(&sys_stat.irq);
+  hton32(&sys_stat.uptime);
+  hton32(&sys_stat.cpu_temp);
+  hton16(&sys_stat.cpu_voltage);
+  hton16(&sys_stat.cpu_freq);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net_server_thread::read_trace_stat(RC_NET_TRACE_STAT &trace_stat)
+{
+  // Latest trace statistics, network byte order
+  m_trace_stat.read(trace_stat);
+
+  for (unsigned i=0; i < RC_NET_TRACE_STAGES; i++) {
+    hton32(&trace_stat.stage[i].count);
+    hton32(&trace_stat.stage[i].min_us);
+    hton32(&trace_stat.stage[i].p50_us);
+    hton32(&trace_stat.stage[i].p99_us);
+    hton32(&trace_stat.stage[i].max_us);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+uint8_t redrobd_rc_net_server_thread::get_log_fd(unsigned index)
+{
+  RC_NET_CLIENT &client = m_client[index];
+  ostringstream oss_msg;
+
+  // Descriptors can only be passed to local clients, one at a time
+  if ( (!client.local) || (client.pass_fd >= 0) ) {
+    return CLI_LOG_FD_UNAVAILABLE;
+  }
+
+  client.pass_fd = redrobd_log_open_reader();
+  if (client.pass_fd < 0) {
+    return CLI_LOG_FD_UNAVAILABLE;
+  }
+
+  oss_msg << "Client[" << index << "] logfile descriptor requested";
+  redrobd_log_writeln(get_name() + " : " + oss_msg.str());
+
+  return CLI_LOG_FD_OK;
+}
+
+////////////////////////////////////////////////////////////////
+
+uint32_t redrobd_rc_net_server_thread::get_udp_token(unsigned index)
+{
+  RC_NET_CLIENT &client = m_client[index];
+  ostringstream oss_msg;
+
+  // UDP steering needs a network client, same token until disconnect
+  if ( (m_udp_sd < 0) || (client.local) ) {
+    return 0;
+  }
+  if (client.udp.token) {
+    return client.udp.token;
+  }
+
+  // Not guessable by other hosts sending from the same address
+  int fd = open("/dev/urandom", O_RDONLY);
+  if (fd == -1) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+	      "Open /dev/urandom failed in thread %s",
+	      get_name().c_str());
+  }
+  do {
+    if (read(fd, &client.udp.token,
+	     sizeof(client.udp.token)) != sizeof(client.udp.token)) {
+      close(fd);
+      THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_FILE_OPERATION_FAILED,
+		"Read /dev/urandom failed in thread %s",
+		get_name().c_str());
+    }
+  } while (!client.udp.token); // Zero means no token
+  close(fd);
+
+  oss_msg << "Client[" << index << "] UDP steer token requested";
+  redrobd_log_writeln(get_name() + " : " + oss_msg.str());
+
+  return client.udp.token;
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net_server_thread::setup_unix(void)
+{
+  // Remove socket file left by an earlier instance
+  if ( (unlink(m_unix_path.c_str()) == -1) && (errno != ENOENT) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+	      "Remove old unix socket (%s) failed in thread %s",
+	      m_unix_path.c_str(), get_name().c_str());
+  }
+
+  if (create_unix_socket(&m_unix_sd) != SOCKET_SUPPORT_SUCCESS) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+	      "Create unix socket failed in thread %s",
+	      get_name().c_str());
+  }
+  if (bind_unix_socket(m_unix_sd,
+		       m_unix_path.c_str()) != SOCKET_SUPPORT_SUCCESS) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+	      "Bind unix socket (%s) failed in thread %s",
+	      m_unix_path.c_str(), get_name().c_str());
+  }
+
+  // Anyone may connect, peers are checked by credentials
+  if (chmod(m_unix_path.c_str(), 0666) == -1) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+	      "Permissions of unix socket (%s) failed in thread %s",
+	      m_unix_path.c_str(), get_name().c_str());
+  }
+
+  if (listen_socket(m_unix_sd,
+		    SERVER_LISTEN_BACKLOG) != SOCKET_SUPPORT_SUCCESS) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+	      "Listen unix socket failed in thread %s",
+	      get_name().c_str());
+  }
+  if (set_attr_blocked(m_unix_sd, false) != SOCKET_SUPPORT_SUCCESS) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+	      "Non-blocking unix socket failed in thread %s",
+	      get_name().c_str());
+  }
+
+  epoll_update(EPOLL_CTL_ADD, m_unix_sd, EPOLLIN, EPOLL_ID_UNIX);
+
+  redrobd_log_writeln(get_name() + " : Wait for local clients on " +
+		      m_unix_path);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net_server_thread::setup_udp(const socket_address &server_sa)
+{
+  if (create_udp_socket(&m_udp_sd) != SOCKET_SUPPORT_SUCCESS) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+	      "Create UDP steer socket failed in thread %s",
+	      get_name().c_str());
+  }
+
+  socket_address udp_sa = server_sa;
+  udp_sa.port = m_udp_steer_port;
+
+  if (bind_socket(m_udp_sd,
+		  udp_sa) != SOCKET_SUPPORT_SUCCESS) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+	      "Bind UDP steer socket failed in thread %s",
+	      get_name().c_str());
+  }
+  if (set_attr_blocked(m_udp_sd, false) != SOCKET_SUPPORT_SUCCESS) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+	      "Non-blocking UDP steer socket failed in thread %s",
+	      get_name().c_str());
+  }
+
+  epoll_update(EPOLL_CTL_ADD, m_udp_sd, EPOLLIN, EPOLL_ID_UDP);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net_server_thread::receive_udp(void)
+{
+  while (1) {
+    RC_NET_UDP_STEER packet;
+    socket_address src_sa;
+    unsigned actual_bytes;
+
+    // One extra byte detects too large packets
+    uint8_t buf[sizeof(packet) + 1];
+
+    long rc = recv_socket_unconnected(m_udp_sd,
+				      buf,
+				      sizeof(buf),
+				      &src_sa,
+				      false, // No peek
+				      &actual_bytes);
+    if ( (rc == SOCKET_SUPPORT_WOULD_BLOCK) ||
+	 (rc == SOCKET_SUPPORT_INTERRUPTED) ) {
+      return;
+    }
+    if (rc != SOCKET_SUPPORT_SUCCESS) {
+      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+		"Receive UDP steer socket failed in thread %s",
+		get_name().c_str());
+    }
+    if (actual_bytes != sizeof(packet)) {
+      m_udp_rejected++;
+      continue;
+    }
+    memcpy(&packet, buf, sizeof(packet));
+    ntoh32(&packet.token);
+
+    // Sender must have a client connection (TCP) with this token
+    unsigned index;
+    for (index=0; index < RC_NET_MAX_CLIENTS; index++) {
+      if ( (m_client[index].conn.is_attached()) &&
+	   (!m_client[index].local) &&
+	   (m_client[index].udp.token) &&
+	   (m_client[index].udp.token == packet.token) &&
+	   (m_client[index].sa.net_addr == src_sa.net_addr) ) {
+	break;
+      }
+    }
+    if (index == RC_NET_MAX_CLIENTS) {
+      m_udp_rejected++;
+      continue;
+    }
+
+    steer_udp(index, packet);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net_server_thread::steer_udp(unsigned index,
+					     RC_NET_UDP_STEER &packet)
+{
+  RC_NET_UDP_STAT &udp = m_client[index].udp;
+  struct timespec now;
+
+  ntoh32(&packet.seq);
+  ntoh32(&packet.time_ms);
+
+  if ( clock_gettime(get_clock_id(), &now) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+	      "Get UDP receive time failed in thread %s",
+	      get_name().c_str());
+  }
+
+  // Offset between clocks plus one-way delay,
+  // all arithmetic modulo 2^32 to handle wrap around
+  uint32_t now_ms = (uint32_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+  uint32_t offset = now_ms - packet.time_ms;
+
+  int32_t seq_diff = (int32_t)(packet.seq - udp.last_seq);
+
+  if ( (!udp.active) || (seq_diff < -RC_NET_UDP_SEQ_RESTART) ) {
+    // First packet or restarted client
+    if (!udp.active) {
+      ostringstream oss_msg;
+      oss_msg << "Client[" << index << "] UDP steering";
+      redrobd_log_writeln(get_name() + " : " + oss_msg.str());
+    }
+    udp.active = true;
+    udp.min_offset = offset;
+  }
+  else if (seq_diff <= 0) {
+    // Older than latest steering, never applied
+    udp.reordered++;
+    return;
+  }
+  else {
+    udp.lost += seq_diff - 1;
+
+    int32_t late_ms = (int32_t)(offset - udp.min_offset);
+    if (late_ms < 0) {
+      udp.min_offset = offset; // Fastest packet so far
+    }
+    else if (late_ms > RC_NET_UDP_MAX_LATE_MS) {
+      udp.last_seq = packet.seq;
+      udp.late++;
+      return;
+    }
+  }
+  udp.last_seq = packet.seq;
+  udp.packets++;
+
+  // Update latest steer code
+  if (take_driver(index)) {
+    put_code(m_steer_code, packet.code);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net_server_thread::send_client(unsigned index,
+					       const void *data,
+					       unsigned nbytes)
+{
+  RC_NET_CLIENT &client = m_client[index];
+
+  // Queued until flushed
+  if (client.conn.queue(data, nbytes) == SOCKET_SUPPORT_SUCCESS) {
+    return;
+  }
+
+  // Make room by sending queued data,
+  // client not reading replies is disconnected
+  flush_client(index);
+  if (!client.conn.is_attached()) {
+    return;
+  }
+  if (client.conn.queue(data, nbytes) != SOCKET_SUPPORT_SUCCESS) {
+    close_client(index, "send buffer full");
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net_server_thread::flush_client(unsigned index)
+{
+  RC_NET_CLIENT &client = m_client[index];
+  long rc;
+
+  if ( (client.pass_fd >= 0) && (client.conn.get_tx_len()) ) {
+    rc = client.conn.flush(client.pass_fd);
+    if (rc == SOCKET_SUPPORT_SUCCESS) {
+      // Client has its own descriptor now
+      close(client.pass_fd);
+      client.pass_fd = -1;
+    }
+  }
+  else {
+    rc = client.conn.flush();
+  }
+
+  if ( (rc != SOCKET_SUPPORT_SUCCESS) &&
+       (rc != SOCKET_SUPPORT_WOULD_BLOCK) &&
+       (rc != SOCKET_SUPPORT_INTERRUPTED) ) {
+    close_client(index, "send failed");
+    return;
+  }
+
+  // Wait for socket to be writable only while data is queued
+  bool tx_wait = (client.conn.get_tx_len() > 0);
+  if (tx_wait != client.tx_wait) {
+    epoll_update(EPOLL_CTL_MOD,
+		 client.conn.get_sockd(),
+		 (tx_wait ? EPOLLIN | EPOLLOUT : EPOLLIN),
+		 index);
+    client.tx_wait = tx_wait;
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net_server_thread::close_client(unsigned index,
+						const char *reason)
+{
+  RC_NET_CLIENT &client = m_client[index];
+  struct timespec now;
+  socket_connection_stat conn_stat;
+  ostringstream oss_msg;
+
+  epoll_update(EPOLL_CTL_DEL, client.conn.get_sockd(), 0, index);
+
+  client.conn.get_stat(&conn_stat);
+  if (client.conn.close() != SOCKET_SUPPORT_SUCCESS) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+	      "Close client socket failed in thread %s",
+	      get_name().c_str());
+  }
+
+  __atomic_store_n(&m_nr_clients, m_nr_clients - 1, __ATOMIC_RELAXED);
+
+  // Descriptor never passed
+  if (client.pass_fd >= 0) {
+    close(client.pass_fd);
+    client.pass_fd = -1;
+  }
+
+  if ( clock_gettime(get_clock_id(), &now) ) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_TIME_ERROR,
+	      "Get disconnect time failed in thread %s",
+	      get_name().c_str());
+  }
+
+  oss_msg << "Client[" << index << "] disconnected => " << client.ip << dec;
+  if (client.local) {
+    oss_msg << ", pid:" << client.pid;
+  }
+  else {
+    oss_msg << ", port:" << client.sa.port;
+  }
+  oss_msg << " (" << reason << ")"
+	  << ", time:" << fixed << setprecision(1)
+	  << get_time_diff(&client.connect_time, &now) << "s"
+	  << ", cmds:" << client.stat.commands
+	  << ", frames:" << client.stat.frames
+	  << ", rejected:" << client.stat.rejected
+	  << ", rx:" << conn_stat.rx_bytes
+	  << ", tx:" << conn_stat.tx_bytes
+	  << ", recv:" << conn_stat.recv_calls
+	  << ", send:" << conn_stat.send_calls;
+  if (client.push.pushes) {
+    oss_msg << ", pushes:" << client.push.pushes;
+  }
+  if (client.udp.active) {
+    oss_msg << ", udp:" << client.udp.packets
+	    << ", lost:" << client.udp.lost
+	    << ", reordered:" << client.udp.reordered
+	    << ", late:" << client.udp.late;
+  }
+  redrobd_log_writeln(get_name() + " : " + oss_msg.str());
+
+  // Steering is free for next client
+  if (m_driver == (int)index) {
+    m_driver = -1;
+  }
+
+  // Push timer may not be needed anymore
+  if (client.push.fields) {
+    client.push.fields = 0;
+    arm_push_timer();
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net_server_thread::epoll_update(int op,
+						int fd,
+						uint32_t events,
+						uint32_t id)
+{
+  struct epoll_event ev;
+
+  bzero(&ev, sizeof(ev));
+  ev.events = events;
+  ev.data.u32 = id;
+
+  if (epoll_ctl(m_epoll_fd, op, fd, &ev) == -1) {
+    THROW_EXP(REDROBD_LINUX_ERROR, REDROBD_SOCKET_OPERATION_FAILED,
+	      "Update epoll (op:%d) failed in thread %s",
+	      op, get_name().c_str());
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net_server_thread::put_code(RC_NET_CODE_CHANNEL &channel,
+					    uint16_t code)
+{
+  RC_NET_CODE the_code;
+
+  the_code.code = code;
+
+  // Receive time is used to measure command latency
+  the_code.recv_time = m_rx_time;
+
+  __atomic_store_n(&channel.received, channel.received + 1, __ATOMIC_RELAXED);
+
+  if (channel.policy == REDROBD_CMD_ALL) {
+    // A full queue is counted as a drop by the queue
+    channel.queue.push(the_code);
+  }
+  else {
+    channel.latest.write(the_code);
+  }
+
+  // Let receiver act on new code immediately
+  if (m_cmd_notify_thread) {
+    m_cmd_notify_thread->signal_event();
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+bool redrobd_rc_net_server_thread::get_code(RC_NET_CODE_CHANNEL &channel,
+					    RC_NET_CODE &the_code)
+{
+  if (channel.policy == REDROBD_CMD_ALL) {
+    // Oldest code first
+    return channel.queue.pop(the_code);
+  }
+
+  // Latest wins, each code is only returned once
+  uint32_t last_version = channel.latest_version;
+  if (!channel.latest.read_new(the_code, last_version)) {
+    return false;
+  }
+
+  // Codes overwritten since last read
+  uint32_t coalesced = last_version - channel.latest_version - 1;
+  if (coalesced) {
+    __atomic_store_n(&channel.coalesced,
+		     channel.coalesced + coalesced, __ATOMIC_RELAXED);
+  }
+  channel.latest_version = last_version;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////
+
+bool redrobd_rc_net_server_thread::code_pending(const RC_NET_CODE_CHANNEL &channel)
+{
+  if (channel.policy == REDROBD_CMD_ALL) {
+    return (channel.queue.get_depth() > 0);
+  }
+
+  return false; // Only latest code is used
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_rc_net_server_thread::get_channel_stat(const RC_NET_CODE_CHANNEL &channel,
+						    RC_NET_CODE_STAT *stat)
+{
+  stat->received  = __atomic_load_n(&channel.received, __ATOMIC_RELAXED);
+  stat->drops     = channel.queue.get_drops();
+  stat->coalesced = __atomic_load_n(&channel.coalesced, __ATOMIC_RELAXED);
+  stat->max_depth = channel.queue.get_max_depth();
+}
+
@@ -14,9 +14,13 @@
 
 #include <string>
 #include <stdint.h>
-#include <pthread.h>
-
+#include <time.h>
 #include "thread.h"
+#include "cyclic_thread.h"
+#include "latest_value.h"
+#include "spsc_queue.h"
+#include "redrobd.h"
+#include "socket_support.h"
 
 using namespace std;
 
@@ -24,6 +28,34 @@ using namespace std;
 //               Definitions of macros
 /////////////////////////////////////////////////////////////////////////////
 
+// Client commands
+#define CLI_CMD_STEER          1
+#define CLI_CMD_GET_VOLTAGE    2
+#define CLI_CMD_CAMERA         3
+#define CLI_CMD_GET_SYS_STATS  4
+#define CLI_CMD_SUBSCRIBE      5    // Telemetry push (framed protocol)
+#define CLI_CMD_GET_LOG_FD     6    // Logfile descriptor (local clients)
+#define CLI_CMD_PING           7    // Echo of client timestamp (uint64)
+#define CLI_CMD_GET_TRACE      8    // Steer command trace statistics
+#define CLI_CMD_GET_UDP_TOKEN  9    // Token of UDP steer packets (uint32)
+#define CLI_CMD_HELLO          0x80 // Protocol version (uint8)
+
+// Subscribe arguments, fields (uint8), flags (uint8), period ms (uint16)
+#define CLI_SUBSCRIBE_ARG_SIZE  4
+
+// Ping argument, client timestamp (uint64) echoed in reply
+// followed by server receive time (uint64, realtime micro
+// seconds since the epoch)
+#define CLI_PING_ARG_SIZE    8
+#define CLI_PING_REPLY_SIZE  16
+
+// Marks frame from server as pushed telemetry, not a reply
+#define FRAME_PUSH_FLAG  0x8000
+
+// Reply status of CLI_CMD_GET_LOG_FD (uint8)
+#define CLI_LOG_FD_OK           0 // Descriptor passed with reply
+#define CLI_LOG_FD_UNAVAILABLE  1
+
 // Client steer codes
 #define CLI_STEER_NONE     0x00
 #define CLI_STEER_FORWARD  0x01
@@ -36,6 +68,44 @@ using namespace std;
 #define CLI_CAMERA_STOP_STREAM   0x01
 #define CLI_CAMERA_START_STREAM  0x02
 
+// Max number of queued client codes (must be power of two)
+#define RC_NET_CODE_QUEUE_SIZE  16
+
+// Max number of connected clients (one driver, others observers)
+#define RC_NET_MAX_CLIENTS  8
+
+// Client protocol versions, negotiated by CLI_CMD_HELLO
+#define RC_NET_PROTO_LEGACY  0 // One command at a time, no framing
+#define RC_NET_PROTO_FRAMED  1 // Length-framed batches of commands
+
+// Max size of commands in one frame (excluding length)
+#define RC_NET_MAX_FRAME_SIZE  64
+
+// Buffered data of each client
+#define RC_NET_CLIENT_RX_SIZE   128
+#define RC_NET_CLIENT_TX_SIZE  1024
+
+#define RC_NET_IP_ADDR_LEN  20
+
+// Telemetry fields pushed to subscribing clients
+#define RC_NET_PUSH_VOLTAGE   0x01
+#define RC_NET_PUSH_SYS_STAT  0x02
+
+// Telemetry subscription flags
+#define RC_NET_PUSH_ON_CHANGE  0x01 // Only push changed fields
+
+// Limits of requested push period
+#define RC_NET_PUSH_MIN_PERIOD_MS     20
+#define RC_NET_PUSH_MAX_PERIOD_MS  60000
+
+// UDP steer packet arriving later than fastest packet
+// plus this margin is stale and dropped
+#define RC_NET_UDP_MAX_LATE_MS  100
+
+// UDP sequence number moving back more than this is
+// a restarted client, not a reordered packet
+#define RC_NET_UDP_SEQ_RESTART  1000
+
 /////////////////////////////////////////////////////////////////////////////
 //               Class support types
 /////////////////////////////////////////////////////////////////////////////
@@ -49,6 +119,108 @@ typedef struct {
   uint16_t cpu_freq;    // MHz
 } __attribute__((packed)) RC_NET_SYS_STAT;
 
+typedef struct {
+  uint16_t        code;
+  struct timespec recv_time; // When code was received from client
+} RC_NET_CODE;
+
+typedef struct {
+  uint32_t received;  // Codes received from client
+  uint32_t drops;     // Codes lost because queue was full
+  uint32_t coalesced; // Codes replaced by a newer code (latest wins)
+  uint32_t max_depth; // Max number of queued codes
+} RC_NET_CODE_STAT;
+
+// Latency of one stage of steer commands
+typedef struct {
+  uint32_t count;
+  uint32_t min_us;
+  uint32_t p50_us;
+  uint32_t p99_us;
+  uint32_t max_us;
+} __attribute__((packed)) RC_NET_TRACE_STAGE;
+
+// Stages of steer command trace, received by server thread,
+// picked up by control thread and motor pins written
+#define RC_NET_TRACE_QUEUE    0 // Received to picked up
+#define RC_NET_TRACE_CONTROL  1 // Picked up to pins written
+#define RC_NET_TRACE_TOTAL    2 // Received to pins written
+#define RC_NET_TRACE_STAGES   3
+
+typedef struct {
+  RC_NET_TRACE_STAGE stage[RC_NET_TRACE_STAGES];
+} __attribute__((packed)) RC_NET_TRACE_STAT;
+
+// UDP steer packet (network byte order)
+typedef struct {
+  uint32_t token;   // From CLI_CMD_GET_UDP_TOKEN
+  uint32_t seq;     // Incremented by client for each packet
+  uint32_t time_ms; // Client send time, any epoch
+  uint8_t  code;    // CLI_STEER_xxx
+} __attribute__((packed)) RC_NET_UDP_STEER;
+
+// UDP steering of one client
+typedef struct {
+  uint32_t token;      // Zero until requested by client
+  bool     active;     // Any packet received
+  uint32_t last_seq;   // Latest accepted sequence number
+  uint32_t min_offset; // Lowest (receive time - send time), ms
+  uint32_t packets;    // Packets accepted
+  uint32_t lost;       // Sequence numbers never seen in order
+  uint32_t reordered;  // Older than latest accepted, dropped
+  uint32_t late;       // Stale, dropped
+} RC_NET_UDP_STAT;
+
+// Telemetry subscription of one client
+typedef struct {
+  uint8_t         fields;    // RC_NET_PUSH_xxx, zero if not subscribed
+  uint8_t         flags;     // RC_NET_PUSH_ON_CHANGE
+  double          period;    // Seconds
+  struct timespec next_push;
+  bool            pushed;    // Any push done, last values valid
+  uint16_t        last_voltage;
+  RC_NET_SYS_STAT last_sys_stat;
+  uint32_t        pushes;
+} RC_NET_PUSH;
+
+// Statistics of one client connection
+typedef struct {
+  uint32_t commands; // Commands received
+  uint32_t frames;   // Frames received (framed protocol)
+  uint32_t rejected; // Control commands ignored, client not driver
+} RC_NET_CLIENT_STAT;
+
+// One client connection, only used by server thread
+typedef struct {
+  socket_connection  conn; // Not attached if not connected
+  socket_address     sa;
+  char               ip[RC_NET_IP_ADDR_LEN];
+  bool               local;   // Unix socket (AF_UNIX), sa and ip not used
+  uint32_t           pid;     // Peer credentials (local)
+  uint32_t           uid;
+  int                pass_fd; // Passed with next send, negative if none
+  struct timespec    connect_time;
+  uint8_t            proto;   // RC_NET_PROTO_xxx
+  bool               tx_wait; // Waiting to send queued data (EPOLLOUT)
+  uint8_t            rx_buf[RC_NET_CLIENT_RX_SIZE];
+  uint8_t            tx_buf[RC_NET_CLIENT_TX_SIZE];
+  RC_NET_CLIENT_STAT stat;
+  RC_NET_UDP_STAT    udp;
+  RC_NET_PUSH        push;
+} RC_NET_CLIENT;
+
+// Transfer of client codes from server thread to reader.
+// Policy REDROBD_CMD_LATEST uses the latest value only,
+// policy REDROBD_CMD_ALL queues every code.
+typedef struct {
+  REDROBD_CMD_POLICY                              policy;
+  latest_value<RC_NET_CODE>                       latest;
+  uint32_t                                        latest_version;
+  spsc_queue<RC_NET_CODE, RC_NET_CODE_QUEUE_SIZE> queue;
+  uint32_t                                        received;
+  uint32_t                                        coalesced;
+} RC_NET_CODE_CHANNEL;
+
 /////////////////////////////////////////////////////////////////////////////
 //               Definition of classes
 /////////////////////////////////////////////////////////////////////////////
@@ -58,18 +230,40 @@ class redrobd_rc_net_server_thread : public thread {
  public:
   redrobd_rc_net_server_thread(string thread_name,
 			       string server_ip_address,
-			       uint16_t server_port);
+			       uint16_t server_port,
+			       uint16_t udp_steer_port, // 0 if disabled
+			       string unix_path,        // Empty if disabled
+			       int unix_allow_uid,      // -1 if none
+			       cyclic_thread *cmd_notify_thread,
+			       REDROBD_CMD_POLICY steer_policy,
+			       REDROBD_CMD_POLICY camera_policy);
 
   ~redrobd_rc_net_server_thread(void);
 
+  // Each code from client is only returned once,
+  // CLI_xxx_NONE is returned if there is no new code.
   uint16_t get_steer_code(void);
+  bool steer_code_pending(void); // More codes queued
+
+  // Receive time of code returned by latest get_steer_code.
+  // Returns false if no new code was returned.
+  bool get_steer_code_recv_time(struct timespec *recv_time);
 
   void set_voltage(float value);
 
   uint16_t get_camera_code(void);
+  bool camera_code_pending(void); // More codes queued
+
+  void get_code_stat(RC_NET_CODE_STAT *steer_stat,
+		     RC_NET_CODE_STAT *camera_stat);
 
   void set_sys_stat(const RC_NET_SYS_STAT *sys_stat);
 
+  void set_trace_stat(const RC_NET_TRACE_STAT *trace_stat);
+
+  unsigned get_nr_clients(void);
+
+  // Controlled shutdown, may be called from any thread
   void shutdown_server(void);
 
  protected:
@@ -83,42 +277,140 @@ class redrobd_rc_net_server_thread : public thread {
   string   m_server_ip_address;
   uint16_t m_server_port;
 
-  // Controlled server shutdown
+  // Thread signalled when a new code is received (may be NULL)
+  cyclic_thread *m_cmd_notify_thread;
+
+  // Controlled server shutdown, wakes up server thread (eventfd)
   bool m_shutdown_requested;
-  bool m_client_connected;
-  bool m_server_closed;
+  int  m_shutdown_fd;
 
   // Server socket
   int m_server_sd;
 
-  // Client socket
-  int m_client_sd;
+  // Steer socket (UDP), negative if disabled
+  uint16_t m_udp_steer_port;
+  int      m_udp_sd;
+  uint32_t m_udp_rejected; // Bad size or unknown sender
+
+  // Local control socket (AF_UNIX), negative if disabled.
+  // Root and daemon user are always allowed.
+  string m_unix_path;
+  int    m_unix_allow_uid; // Additional allowed user, -1 if none
+  int    m_unix_sd;
 
-  // Latest client steer code
-  pthread_mutex_t m_steer_code_mutex;
-  uint16_t        m_steer_code;
+  // Waits for server socket, clients and shutdown (epoll)
+  int m_epoll_fd;
+
+  // Connected clients
+  RC_NET_CLIENT m_client[RC_NET_MAX_CLIENTS];
+  unsigned      m_nr_clients;
+
+  // Client owning steering and camera, negative if none
+  int m_driver;
+
+  // Expires at next telemetry push (timerfd),
+  // disarmed when no client is subscribed
+  int m_push_timer_fd;
+
+  // Client steer codes
+  RC_NET_CODE_CHANNEL m_steer_code;
+  bool                m_steer_code_new;
+  struct timespec     m_steer_code_recv_time;
 
   // Latest voltage
-  pthread_mutex_t m_voltage_mutex;
-  uint16_t        m_voltage;
+  latest_value<uint16_t> m_voltage;
 
-  // Latest client camera code
-  pthread_mutex_t m_camera_code_mutex;
-  uint16_t        m_camera_code;
+  // Client camera codes
+  RC_NET_CODE_CHANNEL m_camera_code;
 
   // Latest system statistics
-  pthread_mutex_t m_sys_stat_mutex;
-  RC_NET_SYS_STAT m_sys_stat;
+  latest_value<RC_NET_SYS_STAT> m_sys_stat;
+
+  // Latest steer command trace statistics
+  latest_value<RC_NET_TRACE_STAT> m_trace_stat;
+
+  // When ready sockets were reported by epoll,
+  // receive time of all commands handled
+  struct timespec m_rx_time;
 
   void init_members(void);
 
   void handle_clients(void);
 
-  void recv_client(void *data,
-		   unsigned nbytes);
+  void accept_clients(int listen_sd,
+		      bool local);
+
+  bool allowed_peer(uint32_t uid);
+
+  void receive_client(unsigned index);
+
+  bool handle_commands(unsigned index);
+
+  bool handle_hello(unsigned index,
+		    const uint8_t *data);
+
+  bool handle_frame(unsigned index,
+		    const uint8_t *frame,
+		    unsigned frame_len);
+
+  unsigned command_length(const uint8_t *data,
+			  unsigned avail);
+
+  bool execute_command(unsigned index,
+		       const uint8_t *data,
+		       uint8_t *reply,
+		       unsigned *reply_len);
 
-  void send_client(void *data,
+  bool take_driver(unsigned index);
+
+  bool subscribe(unsigned index,
+		 const uint8_t *data);
+
+  void push_telemetry(void);
+
+  void arm_push_timer(void);
+
+  void read_sys_stat(RC_NET_SYS_STAT &sys_stat);
+
+  void read_trace_stat(RC_NET_TRACE_STAT &trace_stat);
+
+  uint8_t get_log_fd(unsigned index);
+
+  uint32_t get_udp_token(unsigned index);
+
+  void setup_unix(void);
+
+  void setup_udp(const socket_address &server_sa);
+
+  void receive_udp(void);
+
+  void steer_udp(unsigned index,
+		 RC_NET_UDP_STEER &packet);
+
+  void send_client(unsigned index,
+		   const void *data,
 		   unsigned nbytes);
+
+  void flush_client(unsigned index);
+
+  void close_client(unsigned index,
+		    const char *reason);
+
+  void epoll_update(int op,
+		    int fd,
+		    uint32_t events,
+		    uint32_t id);
+
+  void put_code(RC_NET_CODE_CHANNEL &channel,
+		uint16_t code);
+
+  bool get_code(RC_NET_CODE_CHANNEL &channel,
+		RC_NET_CODE &the_code);
+
+  bool code_pending(const RC_NET_CODE_CHANNEL &channel);
+
+  void get_channel_stat(const RC_NET_CODE_CHANNEL &channel,
+			RC_NET_CODE_STAT *stat);
 };
 
 #endif // __REDROBD_RC_NET_SERVER_THREAD_H__
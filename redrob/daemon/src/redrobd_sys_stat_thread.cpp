@@ -0,0 +1,396 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#include <sstream>
+#include <iomanip>
+
+#include "redrobd_sys_stat_thread.h"
+#include "redrobd_log.h"
+#include "redrobd_error_utility.h"
+#include "daemon_utility.h"
+
+// Implementation notes:
+// 1. Raspberry Pi statistics are read from the VideoCore mailbox or
+//    sysfs by default. The vcgencmd backend forks a shell command which
+//    may take tens of milliseconds. This thread shall execute with low
+//    priority so it never delays the time critical threads.
+//
+// 2. Interval statistics (cpu load, irq) are measured from previous
+//    sample of the same statistics.
+//
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of macros
+/////////////////////////////////////////////////////////////////////////////
+#define MIN_THREAD_FREQUENCY  1.0 // Hz
+
+/////////////////////////////////////////////////////////////////////////////
+//               Public member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+redrobd_sys_stat_thread::
+redrobd_sys_stat_thread(string thread_name,
+			const REDROBD_SYS_STAT_RATE *rate,
+			REDROBD_RPI_STAT_BACKEND rpi_backend,
+			string rpi_root) :
+  cyclic_thread(thread_name,
+		get_thread_frequency(rate))
+{
+  m_rate = *rate;
+  m_rpi_backend = rpi_backend;
+  m_rpi_root = rpi_root;
+
+  init_members();
+}
+
+////////////////////////////////////////////////////////////////
+
+redrobd_sys_stat_thread::~redrobd_sys_stat_thread(void)
+{
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_sys_stat_thread::get_sys_stat(REDROBD_SYS_STAT &value)
+{
+  m_sys_stat.read(value);
+}
+
+////////////////////////////////////////////////////////////////
+
+double redrobd_sys_stat_thread::
+get_thread_frequency(const REDROBD_SYS_STAT_RATE *rate)
+{
+  double freq = MIN_THREAD_FREQUENCY;
+
+  const double all_rates[] = {rate->cpu_load,
+			      rate->mem_used,
+			      rate->irq,
+			      rate->uptime,
+			      rate->cpu_temp,
+			      rate->cpu_voltage,
+			      rate->cpu_freq,
+			      rate->throttled};
+
+  for (unsigned i=0; i < sizeof(all_rates)/sizeof(all_rates[0]); i++) {
+    if (all_rates[i] > freq) {
+      freq = all_rates[i];
+    }
+  }
+
+  return freq;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Protected member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_sys_stat_thread::setup(void)
+{
+  try {
+    redrobd_log_writeln(get_name() + " : setup started");
+
+    init_members();
+
+    initialize_rpi_stat();
+
+    // Start interval statistics
+    if (m_sys_stat_linux.reset_interval_cpu_load() != SYS_STAT_SUCCESS) {
+      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SYS_STAT_OPERATION_FAILED,
+		"Error resetting system stats interval(cpu_load) for thread %s",
+		get_name().c_str());
+    }
+    if (m_sys_stat_linux.reset_interval_irq() != SYS_STAT_SUCCESS) {
+      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SYS_STAT_OPERATION_FAILED,
+		"Error resetting system stats interval(irq) for thread %s",
+		get_name().c_str());
+    }
+
+    // Start timers controlling when to sample statistics
+    if ( (m_cpu_load_timer.reset()    != TIMER_SUCCESS) ||
+	 (m_mem_used_timer.reset()    != TIMER_SUCCESS) ||
+	 (m_irq_timer.reset()         != TIMER_SUCCESS) ||
+	 (m_uptime_timer.reset()      != TIMER_SUCCESS) ||
+	 (m_cpu_temp_timer.reset()    != TIMER_SUCCESS) ||
+	 (m_cpu_voltage_timer.reset() != TIMER_SUCCESS) ||
+	 (m_cpu_freq_timer.reset()    != TIMER_SUCCESS) ||
+	 (m_throttled_timer.reset()   != TIMER_SUCCESS) ) {
+      THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_TIME_ERROR,
+		"Error resetting sample timers for thread %s",
+		get_name().c_str());
+    }
+
+    redrobd_log_writeln(get_name() + " : setup done");
+
+    return THREAD_SUCCESS;    
+  }
+  catch (excep &exp) {
+    syslog_error(redrobd_error_syslog_string(exp).c_str());
+    return THREAD_INTERNAL_ERROR;
+  }
+  catch (...) {
+    syslog_error("redrobd_sys_stat_thread::setup->Unexpected exception");
+    return THREAD_INTERNAL_ERROR;
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_sys_stat_thread::cleanup(void)
+{
+  try {
+    redrobd_log_writeln(get_name() + " : cleanup started");
+
+    m_sys_stat_rpi.finalize();
+
+    redrobd_log_writeln(get_name() + " : cleanup done");
+
+    return THREAD_SUCCESS;
+  }
+  catch (excep &exp) {
+    syslog_error(redrobd_error_syslog_string(exp).c_str());
+    return THREAD_INTERNAL_ERROR;
+  }
+  catch (...) {
+    syslog_error("redrobd_sys_stat_thread::cleanup->Unexpected exception");
+    return THREAD_INTERNAL_ERROR;
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+long redrobd_sys_stat_thread::cyclic_execute(void)
+{
+  try {
+    long rc;
+    bool updated = false;
+
+    // Get system stats (Linux)
+    if (time_to_sample(m_cpu_load_timer, m_rate.cpu_load)) {
+      rc = m_sys_stat_linux.get_interval_cpu_load(m_sample.cpu_load);
+      if (rc != SYS_STAT_SUCCESS) {
+	m_sample.cpu_load = 0.0;
+      }
+      rc = m_sys_stat_linux.reset_interval_cpu_load();
+      if (rc != SYS_STAT_SUCCESS) {
+	THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SYS_STAT_OPERATION_FAILED,
+		  "Error resetting system stats interval(cpu_load) for thread %s",
+		  get_name().c_str());
+      }
+      updated = true;
+    }
+
+    if (time_to_sample(m_mem_used_timer, m_rate.mem_used)) {
+      rc = m_sys_stat_linux.get_mem_used_kb(m_sample.mem_used);
+      if (rc != SYS_STAT_SUCCESS) {
+	m_sample.mem_used = 0;
+      }
+      updated = true;
+    }
+
+    if (time_to_sample(m_irq_timer, m_rate.irq)) {
+      rc = m_sys_stat_linux.get_interval_irq(m_sample.irq);
+      if (rc != SYS_STAT_SUCCESS) {
+	m_sample.irq = 0;
+      }
+      rc = m_sys_stat_linux.reset_interval_irq();
+      if (rc != SYS_STAT_SUCCESS) {
+	THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SYS_STAT_OPERATION_FAILED,
+		  "Error resetting system stats interval(irq) for thread %s",
+		  get_name().c_str());
+      }
+      updated = true;
+    }
+
+    if (time_to_sample(m_uptime_timer, m_rate.uptime)) {
+      rc = m_sys_stat_linux.get_uptime_sec(m_sample.uptime);
+      if (rc != SYS_STAT_SUCCESS) {
+	m_sample.uptime = 0;
+      }
+      updated = true;
+    }
+
+    // Get system stats (Raspberry Pi)
+    if (time_to_sample(m_cpu_temp_timer, m_rate.cpu_temp)) {
+      rc = m_sys_stat_rpi.get_temperature(m_sample.cpu_temp);
+      if (rc != RPI_STAT_SUCCESS) {
+	m_sample.cpu_temp = 0.0;
+      }
+      updated = true;
+    }
+
+    if (time_to_sample(m_cpu_voltage_timer, m_rate.cpu_voltage)) {
+      rc = m_sys_stat_rpi.get_voltage(RPI_STAT_VOLT_ID_CORE,
+				      m_sample.cpu_voltage);
+      if (rc != RPI_STAT_SUCCESS) {
+	m_sample.cpu_voltage = 0.0;
+      }
+      updated = true;
+    }
+
+    if (time_to_sample(m_cpu_freq_timer, m_rate.cpu_freq)) {
+      rc = m_sys_stat_rpi.get_frequency(RPI_STAT_FREQ_ID_ARM,
+					m_sample.cpu_freq);
+      if (rc != RPI_STAT_SUCCESS) {
+	m_sample.cpu_freq = 0;
+      }
+      updated = true;
+    }
+
+    if (time_to_sample(m_throttled_timer, m_rate.throttled)) {
+      uint32_t throttled;
+      rc = m_sys_stat_rpi.get_throttled(throttled);
+      if (rc != RPI_STAT_SUCCESS) {
+	throttled = 0;
+      }
+      if (throttled != m_sample.throttled) {
+	log_throttled(throttled);
+	m_sample.throttled = throttled;
+      }
+      updated = true;
+    }
+
+    // Publish new snapshot
+    if (updated) {
+      m_sys_stat.write(m_sample);
+    }
+
+    return THREAD_SUCCESS;
+  }
+  catch (excep &exp) {
+    syslog_error(redrobd_error_syslog_string(exp).c_str());
+    return THREAD_INTERNAL_ERROR;
+  }
+  catch (...) {
+    syslog_error("redrobd_sys_stat_thread::cyclic_execute->Unexpected exception");
+    return THREAD_INTERNAL_ERROR;
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Private member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_sys_stat_thread::init_members(void)
+{
+  m_sample.cpu_load    = 0.0;
+  m_sample.mem_used    = 0;
+  m_sample.irq         = 0;
+  m_sample.uptime      = 0;
+  m_sample.cpu_temp    = 0.0;
+  m_sample.cpu_voltage = 0.0;
+  m_sample.cpu_freq    = 0;
+  m_sample.throttled   = 0;
+
+  m_sys_stat.write(m_sample);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_sys_stat_thread::initialize_rpi_stat(void)
+{
+  RPI_STAT_BACKEND backend;
+  string backend_str;
+
+  switch (m_rpi_backend) {
+  case REDROBD_RPI_STAT_MAILBOX:
+    backend = RPI_STAT_BACKEND_MAILBOX;
+    backend_str = "mailbox";
+    break;
+  case REDROBD_RPI_STAT_SYSFS:
+    backend = RPI_STAT_BACKEND_SYSFS;
+    backend_str = "sysfs";
+    break;
+  default:
+    backend = RPI_STAT_BACKEND_VCGENCMD;
+    backend_str = "vcgencmd";
+  }
+
+  long rc = m_sys_stat_rpi.initialize(backend, m_rpi_root);
+
+  // No mailbox device (old kernel, not a Raspberry Pi)
+  if (rc == RPI_STAT_OPEN_FAILED) {
+    redrobd_log_writeln(get_name() + " : rpi stats " + backend_str +
+			" not available, using vcgencmd");
+    backend_str = "vcgencmd";
+    rc = m_sys_stat_rpi.initialize(RPI_STAT_BACKEND_VCGENCMD, m_rpi_root);
+  }
+  if (rc != RPI_STAT_SUCCESS) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_SYS_STAT_OPERATION_FAILED,
+	      "Error initializing rpi stats(%s) for thread %s",
+	      backend_str.c_str(), get_name().c_str());
+  }
+
+  redrobd_log_writeln(get_name() + " : rpi stats from " + backend_str);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_sys_stat_thread::log_throttled(uint32_t flags)
+{
+  // RPI_STAT_THROTTLED_xxx current state flags, from bit 0
+  const char *flag_names[] = {"under-voltage",
+			      "freq-capped",
+			      "throttled",
+			      "soft-temp-limit"};
+  ostringstream oss_msg;
+  string state;
+
+  for (unsigned i=0; i < sizeof(flag_names)/sizeof(flag_names[0]); i++) {
+    if (flags & (1 << i)) {
+      state += (state.empty() ? "" : ", ") + string(flag_names[i]);
+    }
+  }
+  if (state.empty()) {
+    state = "ok";
+  }
+
+  // Upper half has flags set if it has occurred since boot
+  oss_msg << get_name() << " : throttled=0x"
+	  << hex << setw(5) << setfill('0') << flags << dec
+	  << " (" << state << ")";
+
+  redrobd_log_writeln(oss_msg.str());
+}
+
+////////////////////////////////////////////////////////////////
+
+bool redrobd_sys_stat_thread::time_to_sample(timer &sample_timer,
+					     double rate)
+{
+  // Check if disabled
+  if (rate <= 0.0) {
+    return false;
+  }
+
+  // Check if one period has elapsed.
+  // Allow half a thread period jitter, otherwise a statistics
+  // with same rate as the thread would only be sampled every
+  // second cycle.
+  if ( sample_timer.get_elapsed_time() <
+       ((1.0 / rate) - (0.5 / get_frequency())) ) {
+    return false;
+  }
+
+  if (sample_timer.reset() != TIMER_SUCCESS) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_TIME_ERROR,
+	      "Error resetting sample timer for thread %s",
+	      get_name().c_str());
+  }
+
+  return true;
+}
@@ -0,0 +1,102 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#ifndef __REDROBD_SYS_STAT_THREAD_H__
+#define __REDROBD_SYS_STAT_THREAD_H__
+
+#include "cyclic_thread.h"
+#include "latest_value.h"
+#include "redrobd.h"
+#include "timer.h"
+#include "sys_stat.h"
+#include "rpi_stat.h"
+
+using namespace std;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Class support types
+/////////////////////////////////////////////////////////////////////////////
+typedef struct {
+  float    cpu_load;    // %
+  unsigned mem_used;    // KBytes
+  unsigned irq;         // Irq/s
+  unsigned uptime;      // Seconds
+  float    cpu_temp;    // Degree Celsius
+  float    cpu_voltage; // Volt
+  unsigned cpu_freq;    // Hz
+  uint32_t throttled;   // RPI_STAT_THROTTLED_xxx flags
+} REDROBD_SYS_STAT;
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of classes
+/////////////////////////////////////////////////////////////////////////////
+
+class redrobd_sys_stat_thread : public cyclic_thread {
+
+ public:
+  redrobd_sys_stat_thread(string thread_name,
+			  const REDROBD_SYS_STAT_RATE *rate,
+			  REDROBD_RPI_STAT_BACKEND rpi_backend,
+			  string rpi_root);
+
+  ~redrobd_sys_stat_thread(void);
+
+  // Latest published snapshot
+  void get_sys_stat(REDROBD_SYS_STAT &value);
+
+  // Thread frequency needed to serve the fastest statistics
+  static double get_thread_frequency(const REDROBD_SYS_STAT_RATE *rate);
+
+ protected:
+  virtual long setup(void);   // Implements pure virtual function from base class
+  virtual long cleanup(void); // Implements pure virtual function from base class
+
+  virtual long cyclic_execute(void); // Implements pure virtual function from base class
+    
+ private:
+  // Sample rate (Hz) of each statistics, zero means disabled
+  REDROBD_SYS_STAT_RATE m_rate;
+
+  // Source of Raspberry Pi statistics
+  REDROBD_RPI_STAT_BACKEND m_rpi_backend;
+  string                   m_rpi_root;
+
+  // Latest published snapshot
+  latest_value<REDROBD_SYS_STAT> m_sys_stat;
+
+  // Snapshot under construction, only used by this thread
+  REDROBD_SYS_STAT m_sample;
+
+  // Controls when to sample each statistics
+  timer m_cpu_load_timer;
+  timer m_mem_used_timer;
+  timer m_irq_timer;
+  timer m_uptime_timer;
+  timer m_cpu_temp_timer;
+  timer m_cpu_voltage_timer;
+  timer m_cpu_freq_timer;
+  timer m_throttled_timer;
+
+  // System statistics (Linux, Raspberry Pi)
+  sys_stat m_sys_stat_linux;
+  rpi_stat m_sys_stat_rpi;
+
+  void init_members(void);
+
+  void initialize_rpi_stat(void);
+
+  void log_throttled(uint32_t flags);
+
+  bool time_to_sample(timer &sample_timer,
+		      double rate);
+};
+
+#endif // __REDROBD_SYS_STAT_THREAD_H__
@@ -9,12 +9,23 @@
 // *                                                                      *
 // ************************************************************************
 
+#include <sched.h>
+#include <sstream>
+
 #include "redrobd_thread_utility.h"
+#include "redrobd_log.h"
 #include "redrobd.h"
 #include "excep.h"
 #include "timer.h"
 #include "delay.h"
 
+/////////////////////////////////////////////////////////////////////////////
+//               Definitions of macros
+/////////////////////////////////////////////////////////////////////////////
+
+// How often thread state is checked when waiting for start
+#define THREAD_STATE_POLL_INTERVAL  0.01 // Seconds
+
 /////////////////////////////////////////////////////////////////////////////
 //               Module global variables
 /////////////////////////////////////////////////////////////////////////////
@@ -25,17 +36,130 @@
 
 ////////////////////////////////////////////////////////////////
 
+void redrobd_thread_set_sched(thread *ct,
+			      const REDROBD_THREAD_SCHED *sched,
+			      unsigned stack_size_kb)
+{
+  int policy;
+  string policy_str;
+
+  switch (sched->policy) {
+  case REDROBD_SCHED_FIFO:
+    policy = SCHED_FIFO;
+    policy_str = "fifo";
+    break;
+  case REDROBD_SCHED_RR:
+    policy = SCHED_RR;
+    policy_str = "rr";
+    break;
+  default:
+    policy = SCHED_OTHER;
+    policy_str = "other";
+  }
+
+  if ( ct->set_sched_param(policy,
+			   sched->priority,
+			   sched->cpu) != THREAD_SUCCESS ) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_BAD_ARGUMENT,
+	      "Bad scheduling for thread %s, policy:%s, prio:%d, cpu:%d",
+	      ct->get_name().c_str(),
+	      policy_str.c_str(),
+	      sched->priority,
+	      sched->cpu);
+  }
+
+  if ( ct->set_stack_size(stack_size_kb * 1024) != THREAD_SUCCESS ) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_BAD_ARGUMENT,
+	      "Bad stack size for thread %s, stack:%u KB",
+	      ct->get_name().c_str(),
+	      stack_size_kb);
+  }
+
+  ostringstream oss_msg;
+  oss_msg << ct->get_name()
+	  << " : sched=" << policy_str
+	  << ", prio=" << ct->get_sched_priority()
+	  << ", cpu=";
+  if (ct->get_sched_cpu() == THREAD_ANY_CPU) {
+    oss_msg << "any";
+  }
+  else {
+    oss_msg << ct->get_sched_cpu();
+  }
+  oss_msg << ", stack=";
+  if (stack_size_kb) {
+    oss_msg << stack_size_kb << " KB";
+  }
+  else {
+    oss_msg << "default";
+  }
+  redrobd_log_writeln(oss_msg.str());
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_thread_set_overrun(cyclic_thread *ct,
+				REDROBD_OVERRUN_POLICY policy)
+{
+  CYCLIC_OVERRUN_POLICY overrun_policy;
+  string policy_str;
+
+  switch (policy) {
+  case REDROBD_OVERRUN_SKIP:
+    overrun_policy = CYCLIC_OVERRUN_SKIP;
+    policy_str = "skip";
+    break;
+  case REDROBD_OVERRUN_STRETCH:
+    overrun_policy = CYCLIC_OVERRUN_STRETCH;
+    policy_str = "stretch";
+    break;
+  default:
+    overrun_policy = CYCLIC_OVERRUN_CATCH_UP;
+    policy_str = "catch_up";
+  }
+
+  if ( ct->set_overrun_policy(overrun_policy) != THREAD_SUCCESS ) {
+    THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_THREAD_OPERATION_FAILED,
+	      "Set overrun policy failed for thread %s, policy:%s",
+	      ct->get_name().c_str(),
+	      policy_str.c_str());
+  }
+
+  redrobd_log_writeln(ct->get_name() + " : overrun=" + policy_str);
+}
+
+////////////////////////////////////////////////////////////////
+
 void redrobd_thread_initialize(thread *ct,
 			       double ct_start_timeout,
 			       double ct_execute_timeout)
+{
+  redrobd_thread_start(ct);
+
+  redrobd_thread_wait_started(ct,
+			      ct_start_timeout,
+			      ct_execute_timeout);
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_thread_start(thread *ct)
 {
   // Step 1: Start thread
-  if ( ct->start(NULL) != THREAD_SUCCESS ) {
+  long rc = ct->start(NULL);
+  if ( rc != THREAD_SUCCESS ) {
     THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_THREAD_OPERATION_FAILED,
-	      "Error start thread %s",
-	      ct->get_name().c_str());
+	      "Error start thread %s, rc:%ld",
+	      ct->get_name().c_str(), rc);
   }
+}
+
+////////////////////////////////////////////////////////////////
 
+void redrobd_thread_wait_started(thread *ct,
+				 double ct_start_timeout,
+				 double ct_execute_timeout)
+{
   // Step 2: Wait for thread to complete setup
   timer thread_timer;
   bool thread_timeout = true;
@@ -49,7 +173,7 @@ void redrobd_thread_initialize(thread *ct,
       thread_timeout = false;
       break;
     }
-    if ( delay(0.1) != DELAY_SUCCESS ) {
+    if ( delay(THREAD_STATE_POLL_INTERVAL) != DELAY_SUCCESS ) {
       THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_TIME_ERROR,
 		"Delay operation failed(start), waiting for thread %s",
 		ct->get_name().c_str());
@@ -87,7 +211,7 @@ void redrobd_thread_initialize(thread *ct,
       thread_timeout = false;
       break;
     }
-    if ( delay(0.1) != DELAY_SUCCESS ) {
+    if ( delay(THREAD_STATE_POLL_INTERVAL) != DELAY_SUCCESS ) {
       THROW_EXP(REDROBD_INTERNAL_ERROR, REDROBD_TIME_ERROR,
 		"Delay operation failed(execute), waiting for thread %s",
 		ct->get_name().c_str());
@@ -162,3 +286,97 @@ void redrobd_thread_check(thread *ct)
 	      ct->get_state());
   }
 }
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_thread_log_stat(cyclic_thread *ct,
+			     bool verbose)
+{
+  CYCLIC_THREAD_STAT stat;
+  ostringstream oss_msg;
+
+  ct->get_cycle_stat(stat);
+
+  oss_msg << ct->get_name()
+	  << " : cycles=" << stat.cycles
+	  << ", missed=" << stat.missed_deadlines
+	  << ", missed_in_row(max)=" << stat.max_missed_in_row
+	  << ", skipped=" << stat.skipped_cycles;
+  redrobd_log_writeln(oss_msg.str());
+
+  redrobd_log_histogram(ct->get_name() + " : wakeup latency",
+			stat.wakeup_latency,
+			verbose);
+
+  redrobd_log_histogram(ct->get_name() + " : exec time",
+			stat.exec_time,
+			verbose);
+
+  if (stat.missed_deadlines) {
+    redrobd_log_histogram(ct->get_name() + " : overrun time",
+			  stat.overrun_time,
+			  verbose);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_scheduler_log_stat(periodic_scheduler *ps,
+				bool verbose)
+{
+  PERIODIC_TASK_STAT stat;
+  ostringstream oss_msg;
+
+  for (unsigned i=0; i < ps->get_nr_tasks(); i++) {
+    if (ps->get_task_stat(i, stat) != THREAD_SUCCESS) {
+      continue;
+    }
+
+    string prefix = ps->get_name() + " : " + ps->get_task_name(i);
+
+    oss_msg.str("");
+    oss_msg << prefix
+	    << " : executions=" << stat.executions
+	    << ", missed=" << stat.missed_periods;
+    redrobd_log_writeln(oss_msg.str());
+
+    redrobd_log_histogram(prefix + " : wakeup latency",
+			  stat.wakeup_latency,
+			  verbose);
+
+    redrobd_log_histogram(prefix + " : exec time",
+			  stat.exec_time,
+			  verbose);
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+void redrobd_log_histogram(const string &prefix,
+			   const histogram &hist,
+			   bool verbose)
+{
+  ostringstream oss_msg;
+
+  oss_msg << prefix << " (us)"
+	  << " min=" << hist.get_min_us()
+	  << ", mean=" << hist.get_mean_us()
+	  << ", p50=" << hist.get_percentile_us(50.0)
+	  << ", p99=" << hist.get_percentile_us(99.0)
+	  << ", max=" << hist.get_max_us();
+  redrobd_log_writeln(oss_msg.str());
+
+  if (!verbose) {
+    return;
+  }
+
+  // Only non-empty buckets are logged
+  for (unsigned i=0; i < hist.get_nr_buckets(); i++) {
+    if (hist.get_bucket_count(i)) {
+      oss_msg.str("");
+      oss_msg << prefix << " <= " << hist.get_bucket_upper_us(i)
+	      << " us : " << hist.get_bucket_count(i);
+      redrobd_log_writeln(oss_msg.str());
+    }
+  }
+}
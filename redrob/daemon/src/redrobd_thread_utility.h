@@ -13,6 +13,9 @@
 #define __REDROBD_THREAD_UTILITY_H__
 
 #include "thread.h"
+#include "cyclic_thread.h"
+#include "periodic_scheduler.h"
+#include "redrobd.h"
 
 using namespace std;
 
@@ -23,13 +26,39 @@ using namespace std;
 /////////////////////////////////////////////////////////////////////////////
 //               Definition of exported functions
 /////////////////////////////////////////////////////////////////////////////
+extern void redrobd_thread_set_sched(thread *ct,
+				     const REDROBD_THREAD_SCHED *sched,
+				     unsigned stack_size_kb);
+
+extern void redrobd_thread_set_overrun(cyclic_thread *ct,
+				       REDROBD_OVERRUN_POLICY policy);
+
+// Start thread and wait until it is executing
 extern void redrobd_thread_initialize(thread *ct,
 				      double ct_start_timeout,
 				      double ct_execute_timeout);
 
+// Same as redrobd_thread_initialize in two parts, thread setup
+// is done concurrently with the caller in between.
+extern void redrobd_thread_start(thread *ct);
+
+extern void redrobd_thread_wait_started(thread *ct,
+					double ct_start_timeout,
+					double ct_execute_timeout);
+
 extern void redrobd_thread_finalize(thread *ct,
 				    double ct_stop_timeout);
 
 extern void redrobd_thread_check(thread *ct);
 
+extern void redrobd_thread_log_stat(cyclic_thread *ct,
+				    bool verbose);
+
+extern void redrobd_scheduler_log_stat(periodic_scheduler *ps,
+				       bool verbose);
+
+extern void redrobd_log_histogram(const string &prefix,
+				  const histogram &hist,
+				  bool verbose);
+
 #endif // __REDROBD_THREAD_UTILITY_H__
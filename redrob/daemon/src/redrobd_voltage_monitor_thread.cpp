@@ -9,8 +9,6 @@
 // *                                                                      *
 // ************************************************************************
 
-#include <sstream>
-#include <iomanip>
 
 #include "redrobd_voltage_monitor_thread.h"
 #include "redrobd.h"
@@ -36,15 +34,13 @@
 redrobd_voltage_monitor_thread::
 redrobd_voltage_monitor_thread(string thread_name,
 			       double frequency,
-			       mcp3008_io *mcp3008_io_ptr,
-			       MCP3008_IO_CHANNEL mcp3008_io_chn,
+			       adc_io *adc_io_ptr,
+			       ADC_IO_CHANNEL adc_io_chn,
 			       float voltage_sf) : cyclic_thread(thread_name,
 								 frequency)
 {
-  pthread_mutex_init(&m_voltage_mutex, NULL); // Use default mutex attributes
-
-  m_mcp3008_io_ptr = mcp3008_io_ptr;
-  m_mcp3008_io_chn = mcp3008_io_chn;
+  m_adc_io_ptr = adc_io_ptr;
+  m_adc_io_chn = adc_io_chn;
   m_voltage_sf     = voltage_sf;
 
   init_members();
@@ -54,21 +50,14 @@ redrobd_voltage_monitor_thread(string thread_name,
 
 redrobd_voltage_monitor_thread::~redrobd_voltage_monitor_thread(void)
 {
-  pthread_mutex_destroy(&m_voltage_mutex);
 }
 
 ////////////////////////////////////////////////////////////////
 
 void redrobd_voltage_monitor_thread::get_voltage(REDROBD_VOLTAGE &value)
 {
-  // Lockdown read operation
-  pthread_mutex_lock(&m_voltage_mutex);
-
-  value.v_mon = m_voltage.v_mon;
-  value.v_in  = m_voltage.v_in;
-
-  // Lockup read operation
-  pthread_mutex_unlock(&m_voltage_mutex);
+  // Never blocks, even if monitor thread is preempted while writing
+  m_voltage.read(value);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -136,33 +125,24 @@ long redrobd_voltage_monitor_thread::cyclic_execute(void)
     float v_in;
 
     // Get voltage from analog input
-    m_mcp3008_io_ptr->read_single(m_mcp3008_io_chn, adc_value);
-    v_mon = m_mcp3008_io_ptr->to_voltage(adc_value);
+    m_adc_io_ptr->read_single(m_adc_io_chn, adc_value);
+    v_mon = m_adc_io_ptr->to_voltage(adc_value);
 
     // Scale back to input voltage
     v_in = v_mon / m_voltage_sf;
 
-    // Lockdown read operation
-    pthread_mutex_lock(&m_voltage_mutex);
-    
-    m_voltage.v_mon = v_mon;
-    m_voltage.v_in  = v_in;
-    
-    // Lockup read operation
-    pthread_mutex_unlock(&m_voltage_mutex);
+    // Publish latest value
+    REDROBD_VOLTAGE voltage;
+    voltage.v_mon = v_mon;
+    voltage.v_in  = v_in;
+    m_voltage.write(voltage);
 
     // Check if time to log voltages
     if ( m_voltage_log_timer.get_elapsed_time() >
 	 LOG_VOLTAGES_INTERVAL ) {
 
       // Log voltages
-      ostringstream oss_msg;
-      oss_msg.precision(3);
-      oss_msg << fixed;
-      oss_msg << get_name() << " : Vmon=" << v_mon << ", Vin=" << v_in;
-      
-      redrobd_log_writeln(oss_msg.str());
-      oss_msg.str("");
+      redrobd_log_writemsg(REDROBD_LOG_MSG_BAT_MON_VOLTAGES, v_mon, v_in);
 
       // Reset timer
       if (m_voltage_log_timer.reset() != TIMER_SUCCESS) {
@@ -192,6 +172,8 @@ long redrobd_voltage_monitor_thread::cyclic_execute(void)
 
 void redrobd_voltage_monitor_thread::init_members(void)
 {
-  m_voltage.v_mon = 0.0;
-  m_voltage.v_in  = 0.0;
+  REDROBD_VOLTAGE voltage;
+  voltage.v_mon = 0.0;
+  voltage.v_in  = 0.0;
+  m_voltage.write(voltage);
 }
@@ -12,10 +12,9 @@
 #ifndef __REDROBD_VOLTAGE_MONITOR_THREAD_H__
 #define __REDROBD_VOLTAGE_MONITOR_THREAD_H__
 
-#include <pthread.h>
-
 #include "cyclic_thread.h"
-#include "mcp3008_io.h"
+#include "latest_value.h"
+#include "adc_io.h"
 #include "timer.h"
 
 using namespace std;
@@ -37,8 +36,8 @@ class redrobd_voltage_monitor_thread : public cyclic_thread {
  public:
   redrobd_voltage_monitor_thread(string thread_name,
 				 double frequency,
-				 mcp3008_io *mcp3008_io_ptr,
-				 MCP3008_IO_CHANNEL mcp3008_io_chn,
+				 adc_io *adc_io_ptr,
+				 ADC_IO_CHANNEL adc_io_chn,
 				 float voltage_sf);
 
   ~redrobd_voltage_monitor_thread(void);
@@ -53,14 +52,13 @@ class redrobd_voltage_monitor_thread : public cyclic_thread {
     
  private:
   // Latest monitored value
-  pthread_mutex_t m_voltage_mutex;
-  REDROBD_VOLTAGE m_voltage;
+  latest_value<REDROBD_VOLTAGE> m_voltage;
 
   // A/D Converter object pointer
-  mcp3008_io *m_mcp3008_io_ptr;
+  adc_io *m_adc_io_ptr;
 
   // A/D Converter channel to monitor
-  MCP3008_IO_CHANNEL m_mcp3008_io_chn;
+  ADC_IO_CHANNEL m_adc_io_chn;
 
   // Scale factor used by voltage divider (v_mon = v_in * sf)
   float m_voltage_sf;
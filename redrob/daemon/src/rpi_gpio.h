@@ -14,6 +14,8 @@
 
 #include <stdint.h>
 
+#include "gpio_io.h"
+
 using namespace std;
 
 /////////////////////////////////////////////////////////////////////////////
@@ -21,44 +23,31 @@ using namespace std;
 /////////////////////////////////////////////////////////////////////////////
 #define RPI_GPIO_MAX_PIN  31  // This class only handles GPIO 0..31
 
-/////////////////////////////////////////////////////////////////////////////
-//               Class support types
-/////////////////////////////////////////////////////////////////////////////
-// GPIO Function Select Registers
-typedef enum {RPI_GPIO_FUNC_INP,  // 000
-	      RPI_GPIO_FUNC_OUT,  // 001
-              RPI_GPIO_FUNC_ALT5, // 010
-	      RPI_GPIO_FUNC_ALT4, // 011
-	      RPI_GPIO_FUNC_ALT0, // 100
-	      RPI_GPIO_FUNC_ALT1, // 101
-	      RPI_GPIO_FUNC_ALT2, // 110
-	      RPI_GPIO_FUNC_ALT3, // 111
-} RPI_GPIO_FUNCTION;
-
 /////////////////////////////////////////////////////////////////////////////
 //               Definition of classes
 /////////////////////////////////////////////////////////////////////////////
 
-class rpi_gpio {
+class rpi_gpio : public gpio_io {
   
  public:
   rpi_gpio(void);
   ~rpi_gpio(void);
 
-  void initialize(void);
+  // Implements pure virtual functions from base class
+  virtual void initialize(void);
 
-  void finalize(void);
+  virtual void finalize(void);
 
-  void set_function(uint8_t pin,
-		    RPI_GPIO_FUNCTION func);
+  virtual void set_function(uint8_t pin,
+			    RPI_GPIO_FUNCTION func);
 
-  RPI_GPIO_FUNCTION get_function(uint8_t pin);
+  virtual RPI_GPIO_FUNCTION get_function(uint8_t pin);
 
-  void set_pin_high(uint8_t pin);
+  virtual void set_pin_high(uint8_t pin);
 
-  void set_pin_low(uint8_t pin);
+  virtual void set_pin_low(uint8_t pin);
 
-  uint8_t get_pin(uint8_t pin);
+  virtual uint8_t get_pin(uint8_t pin);
 
  private:
   // Memory mapped I/O access
@@ -10,15 +10,69 @@
 // ************************************************************************
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
 
 #include "rpi_stat.h"
 #include "shell_cmd.h"
 
+// Implementation notes:
+// 1. The mailbox backend sends a property request to the VideoCore
+//    firmware with one ioctl, same values as vcgencmd without a fork.
+//    Clock rate is the rate set by firmware, vcgencmd measures it.
+//
+// 2. The sysfs backend only has ARM frequency (cpufreq), temperature
+//    (thermal zone) and throttled flags (firmware driver, if the
+//    kernel has it). It never forks, voltages and other clocks are
+//    unavailable (RPI_STAT_UNAVAILABLE).
+//
+// 3. Clocks without a mailbox clock id are read with vcgencmd
+//    also by the mailbox backend.
+//
+
 /////////////////////////////////////////////////////////////////////////////
 //               Definition of macros
 /////////////////////////////////////////////////////////////////////////////
 #define VCGENCMD "/usr/bin/vcgencmd"
 
+// VideoCore mailbox property interface
+#define MBOX_DEVICE          "/dev/vcio"
+#define MBOX_IOCTL_PROPERTY  _IOWR(100, 0, char *)
+#define MBOX_MAX_VALUES      2
+#define MBOX_REQUEST         0x00000000
+#define MBOX_RESPONSE_OK     0x80000000
+#define MBOX_TAG_RESPONSE    0x80000000
+#define MBOX_TAG_END         0x00000000
+
+#define MBOX_TAG_GET_CLOCK_RATE   0x00030002
+#define MBOX_TAG_GET_VOLTAGE      0x00030003
+#define MBOX_TAG_GET_TEMPERATURE  0x00030006
+#define MBOX_TAG_GET_THROTTLED    0x00030046
+
+#define MBOX_CLOCK_NONE   0 // Not in mailbox interface
+#define MBOX_CLOCK_EMMC   1
+#define MBOX_CLOCK_UART   2
+#define MBOX_CLOCK_ARM    3
+#define MBOX_CLOCK_CORE   4
+#define MBOX_CLOCK_V3D    5
+#define MBOX_CLOCK_H264   6
+#define MBOX_CLOCK_ISP    7
+#define MBOX_CLOCK_PIXEL  9
+#define MBOX_CLOCK_PWM    10
+
+#define MBOX_VOLT_CORE     1
+#define MBOX_VOLT_SDRAM_C  2
+#define MBOX_VOLT_SDRAM_P  3
+#define MBOX_VOLT_SDRAM_I  4
+
+// Sysfs nodes
+#define SYSFS_TEMP       "/sys/class/thermal/thermal_zone0/temp"
+#define SYSFS_ARM_FREQ   "/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq"
+#define SYSFS_THROTTLED  "/sys/devices/platform/soc/soc:firmware/get_throttled"
+#define SYSFS_MAX_CHARS  32
+
 /////////////////////////////////////////////////////////////////////////////
 //               Public member functions
 /////////////////////////////////////////////////////////////////////////////
@@ -27,28 +81,342 @@
 
 rpi_stat::rpi_stat(void)
 {
+  init_members();
 }
 
 ////////////////////////////////////////////////////////////////
 
 rpi_stat::~rpi_stat(void)
 {
+  finalize();
+}
+
+////////////////////////////////////////////////////////////////
+
+long rpi_stat::initialize(RPI_STAT_BACKEND backend,
+			  const string &root)
+{
+  finalize();
+
+  m_root = root;
+  while ( (!m_root.empty()) && (m_root[m_root.length() - 1] == '/') ) {
+    m_root.erase(m_root.length() - 1);
+  }
+
+  if (backend == RPI_STAT_BACKEND_MAILBOX) {
+    const string device = m_root + MBOX_DEVICE;
+
+    m_mbox_fd = open(device.c_str(), O_RDONLY);
+    if (m_mbox_fd < 0) {
+      return RPI_STAT_OPEN_FAILED;
+    }
+  }
+  m_backend = backend;
+
+  return RPI_STAT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+long rpi_stat::finalize(void)
+{
+  if (m_mbox_fd >= 0) {
+    close(m_mbox_fd);
+  }
+  init_members();
+
+  return RPI_STAT_SUCCESS;
 }
 
 ////////////////////////////////////////////////////////////////
 
 long rpi_stat::get_temperature(float &value)
 {
-  const string cmd = string(VCGENCMD) + string(" measure_temp");
-  shell_cmd rpi_cmd;  
-  
+  switch (m_backend) {
+  case RPI_STAT_BACKEND_MAILBOX:
+    {
+      uint32_t values[2] = {0, 0}; // Temperature id, value
+
+      long rc = mbox_property(MBOX_TAG_GET_TEMPERATURE, values, 2);
+      if (rc != RPI_STAT_SUCCESS) {
+	return rc;
+      }
+      value = (float)values[1] / 1000.0; // Millidegree Celsius
+    }
+    break;
+  case RPI_STAT_BACKEND_SYSFS:
+    {
+      unsigned long millidegree;
+
+      long rc = read_sysfs(SYSFS_TEMP, 10, millidegree);
+      if (rc != RPI_STAT_SUCCESS) {
+	return rc;
+      }
+      value = (float)millidegree / 1000.0;
+    }
+    break;
+  default:
+    return vcgencmd_temperature(value);
+  }
+
+  return RPI_STAT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+long rpi_stat::get_voltage(RPI_STAT_VOLT_ID id,
+			   float &value)
+{
+  if (m_backend == RPI_STAT_BACKEND_SYSFS) {
+    return RPI_STAT_UNAVAILABLE;
+  }
+  if (m_backend != RPI_STAT_BACKEND_MAILBOX) {
+    return vcgencmd_voltage(id, value);
+  }
+
+  // Actual voltage identifier
+  uint32_t values[2] = {0, 0}; // Voltage id, value
+
+  switch (id) {
+  case RPI_STAT_VOLT_ID_CORE:
+    values[0] = MBOX_VOLT_CORE;
+    break;
+  case RPI_STAT_VOLT_ID_SDRAM_C:
+    values[0] = MBOX_VOLT_SDRAM_C;
+    break;
+  case RPI_STAT_VOLT_ID_SDRAM_I:
+    values[0] = MBOX_VOLT_SDRAM_I;
+    break;
+  case RPI_STAT_VOLT_ID_SDRAM_P:
+    values[0] = MBOX_VOLT_SDRAM_P;
+    break;
+  }
+
+  long rc = mbox_property(MBOX_TAG_GET_VOLTAGE, values, 2);
+  if (rc != RPI_STAT_SUCCESS) {
+    return rc;
+  }
+  value = (float)values[1] / 1000000.0; // Microvolt
+
+  return RPI_STAT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+long rpi_stat::get_frequency(RPI_STAT_FREQ_ID id,
+			     unsigned &value)
+{
+  if ( (m_backend == RPI_STAT_BACKEND_SYSFS) &&
+       (id == RPI_STAT_FREQ_ID_ARM) ) {
+    unsigned long khz;
+
+    long rc = read_sysfs(SYSFS_ARM_FREQ, 10, khz);
+    if (rc != RPI_STAT_SUCCESS) {
+      return rc;
+    }
+    value = (unsigned)(khz * 1000);
+
+    return RPI_STAT_SUCCESS;
+  }
+
+  if (m_backend == RPI_STAT_BACKEND_SYSFS) {
+    return RPI_STAT_UNAVAILABLE;
+  }
+  if (m_backend != RPI_STAT_BACKEND_MAILBOX) {
+    return vcgencmd_frequency(id, value);
+  }
+
+  // Actual clock identifier
+  uint32_t values[2] = {MBOX_CLOCK_NONE, 0}; // Clock id, rate
+
+  switch (id) {
+  case RPI_STAT_FREQ_ID_ARM:
+    values[0] = MBOX_CLOCK_ARM;
+    break;
+  case RPI_STAT_FREQ_ID_CORE:
+    values[0] = MBOX_CLOCK_CORE;
+    break;
+  case RPI_STAT_FREQ_ID_H264:
+    values[0] = MBOX_CLOCK_H264;
+    break;
+  case RPI_STAT_FREQ_ID_ISP:
+    values[0] = MBOX_CLOCK_ISP;
+    break;
+  case RPI_STAT_FREQ_ID_V3D:
+    values[0] = MBOX_CLOCK_V3D;
+    break;
+  case RPI_STAT_FREQ_ID_UART:
+    values[0] = MBOX_CLOCK_UART;
+    break;
+  case RPI_STAT_FREQ_ID_PWM:
+    values[0] = MBOX_CLOCK_PWM;
+    break;
+  case RPI_STAT_FREQ_ID_EMMC:
+    values[0] = MBOX_CLOCK_EMMC;
+    break;
+  case RPI_STAT_FREQ_ID_PIXEL:
+    values[0] = MBOX_CLOCK_PIXEL;
+    break;
+  default:
+    break;
+  }
+
+  if (values[0] == MBOX_CLOCK_NONE) {
+    return vcgencmd_frequency(id, value);
+  }
+
+  long rc = mbox_property(MBOX_TAG_GET_CLOCK_RATE, values, 2);
+  if (rc != RPI_STAT_SUCCESS) {
+    return rc;
+  }
+  value = values[1]; // Hz
+
+  return RPI_STAT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+long rpi_stat::get_throttled(uint32_t &value)
+{
+  switch (m_backend) {
+  case RPI_STAT_BACKEND_MAILBOX:
+    {
+      uint32_t values[1] = {0}; // Flags
+
+      long rc = mbox_property(MBOX_TAG_GET_THROTTLED, values, 1);
+      if (rc != RPI_STAT_SUCCESS) {
+	return rc;
+      }
+      value = values[0];
+    }
+    break;
+  case RPI_STAT_BACKEND_SYSFS:
+    {
+      unsigned long flags;
+
+      long rc = read_sysfs(SYSFS_THROTTLED, 16, flags);
+      if (rc != RPI_STAT_SUCCESS) {
+	return rc;
+      }
+      value = (uint32_t)flags;
+    }
+    break;
+  default:
+    return vcgencmd_throttled(value);
+  }
+
+  return RPI_STAT_SUCCESS;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Private member functions
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+void rpi_stat::init_members(void)
+{
+  m_backend = RPI_STAT_BACKEND_VCGENCMD;
+  m_root = "";
+  m_mbox_fd = -1;
+}
+
+////////////////////////////////////////////////////////////////
+
+long rpi_stat::mbox_property(uint32_t tag,
+			     uint32_t *values,
+			     unsigned nr_values)
+{
+  // Request with one tag, values are both request and response
+  uint32_t msg[6 + MBOX_MAX_VALUES] __attribute__((aligned(16)));
+  unsigned len = 0;
+
+  msg[len++] = 0; // Size in bytes, set below
+  msg[len++] = MBOX_REQUEST;
+  msg[len++] = tag;
+  msg[len++] = nr_values * sizeof(uint32_t); // Value buffer size
+  msg[len++] = 0;                            // Tag request
+  for (unsigned i=0; i < nr_values; i++) {
+    msg[len++] = values[i];
+  }
+  msg[len++] = MBOX_TAG_END;
+  msg[0] = len * sizeof(uint32_t);
+
+  if (ioctl(m_mbox_fd, MBOX_IOCTL_PROPERTY, msg) < 0) {
+    return RPI_STAT_CMD_FAILED;
+  }
+
+  // Unknown tag (old firmware) is not marked as response
+  if ( (msg[1] != MBOX_RESPONSE_OK) ||
+       (!(msg[4] & MBOX_TAG_RESPONSE)) ) {
+    return RPI_STAT_UNEXPECTED_RESPONSE;
+  }
+
+  for (unsigned i=0; i < nr_values; i++) {
+    values[i] = msg[5 + i];
+  }
+
+  return RPI_STAT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+long rpi_stat::read_sysfs(const char *file_name,
+			  int base,
+			  unsigned long &value)
+{
+  const string path = m_root + file_name;
+  char buffer[SYSFS_MAX_CHARS];
+  char *end;
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return RPI_STAT_CMD_FAILED;
+  }
+  ssize_t n = read(fd, buffer, sizeof(buffer) - 1);
+  close(fd);
+
+  if (n <= 0) {
+    return RPI_STAT_CMD_FAILED;
+  }
+  buffer[n] = '\0';
+
+  // Value followed by newline
+  value = strtoul(buffer, &end, base);
+  if ( (end == buffer) ||
+       ( (*end != '\0') && (*end != '\n') ) ) {
+    return RPI_STAT_UNEXPECTED_RESPONSE;
+  }
+
+  return RPI_STAT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+long rpi_stat::vcgencmd(const string &args,
+			string &output)
+{
+  const string cmd = m_root + VCGENCMD + string(" ") + args;
+  shell_cmd rpi_cmd;
+
   // Execute shell command
-  string output;
   if (rpi_cmd.execute(cmd, output) != SHELL_CMD_SUCCESS) {
     return RPI_STAT_CMD_FAILED;
   }
 
-  // Extract result from command output  
+  return RPI_STAT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+long rpi_stat::vcgencmd_temperature(float &value)
+{
+  string output;
+  if (vcgencmd("measure_temp", output) != RPI_STAT_SUCCESS) {
+    return RPI_STAT_CMD_FAILED;
+  }
+
+  // Extract result from command output
   if (sscanf(output.c_str(), "temp=%f'C", &value) != 1) {
     return RPI_STAT_UNEXPECTED_RESPONSE;
   }
@@ -58,31 +426,29 @@ long rpi_stat::get_temperature(float &value)
 
 ////////////////////////////////////////////////////////////////
 
-long rpi_stat::get_voltage(RPI_STAT_VOLT_ID id,
-			   float &value)
+long rpi_stat::vcgencmd_voltage(RPI_STAT_VOLT_ID id,
+				float &value)
 {
-  string cmd = string(VCGENCMD) + string(" measure_volts");
-  shell_cmd rpi_cmd;  
+  string args = "measure_volts";
 
   // Actual voltage identifier
   switch (id) {
   case RPI_STAT_VOLT_ID_CORE:
-    cmd.append(" core");
+    args.append(" core");
     break;
   case RPI_STAT_VOLT_ID_SDRAM_C:
-    cmd.append(" sdram_c");
+    args.append(" sdram_c");
     break;
   case RPI_STAT_VOLT_ID_SDRAM_I:
-    cmd.append(" sdram_i");
+    args.append(" sdram_i");
     break;
   case RPI_STAT_VOLT_ID_SDRAM_P:
-    cmd.append(" sdram_p");
+    args.append(" sdram_p");
     break;
   }
-  
-  // Execute shell command
+
   string output;
-  if (rpi_cmd.execute(cmd, output) != SHELL_CMD_SUCCESS) {
+  if (vcgencmd(args, output) != RPI_STAT_SUCCESS) {
     return RPI_STAT_CMD_FAILED;
   }
 
@@ -96,55 +462,53 @@ long rpi_stat::get_voltage(RPI_STAT_VOLT_ID id,
 
 ////////////////////////////////////////////////////////////////
 
-long rpi_stat::get_frequency(RPI_STAT_FREQ_ID id,
-			     unsigned &value)
+long rpi_stat::vcgencmd_frequency(RPI_STAT_FREQ_ID id,
+				  unsigned &value)
 {
-  string cmd = string(VCGENCMD) + string(" measure_clock");
-  shell_cmd rpi_cmd;  
+  string args = "measure_clock";
 
   // Actual clock identifier
   switch (id) {
   case RPI_STAT_FREQ_ID_ARM:
-    cmd.append(" arm");
+    args.append(" arm");
     break;
   case RPI_STAT_FREQ_ID_CORE:
-    cmd.append(" core");
+    args.append(" core");
     break;
   case RPI_STAT_FREQ_ID_H264:
-    cmd.append(" h264");
+    args.append(" h264");
     break;
   case RPI_STAT_FREQ_ID_ISP:
-    cmd.append(" isp");
+    args.append(" isp");
     break;
   case RPI_STAT_FREQ_ID_V3D:
-    cmd.append(" v3d");
+    args.append(" v3d");
     break;
   case RPI_STAT_FREQ_ID_UART:
-    cmd.append(" uart");
+    args.append(" uart");
     break;
   case RPI_STAT_FREQ_ID_PWM:
-    cmd.append(" pwm");
+    args.append(" pwm");
     break;
   case RPI_STAT_FREQ_ID_EMMC:
-    cmd.append(" emmc");
+    args.append(" emmc");
     break;
   case RPI_STAT_FREQ_ID_PIXEL:
-    cmd.append(" pixel");
+    args.append(" pixel");
     break;
   case RPI_STAT_FREQ_ID_VEC:
-    cmd.append(" vec");
+    args.append(" vec");
     break;
   case RPI_STAT_FREQ_ID_HDMI:
-    cmd.append(" hdmi");
+    args.append(" hdmi");
     break;
   case RPI_STAT_FREQ_ID_DPI:
-    cmd.append(" dpi");
+    args.append(" dpi");
     break;
   }
-  
-  // Execute shell command
+
   string output;
-  if (rpi_cmd.execute(cmd, output) != SHELL_CMD_SUCCESS) {
+  if (vcgencmd(args, output) != RPI_STAT_SUCCESS) {
     return RPI_STAT_CMD_FAILED;
   }
 
@@ -159,6 +523,21 @@ long rpi_stat::get_frequency(RPI_STAT_FREQ_ID id,
   return RPI_STAT_SUCCESS;
 }
 
-/////////////////////////////////////////////////////////////////////////////
-//               Private member functions
-/////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////
+
+long rpi_stat::vcgencmd_throttled(uint32_t &value)
+{
+  string output;
+  if (vcgencmd("get_throttled", output) != RPI_STAT_SUCCESS) {
+    return RPI_STAT_CMD_FAILED;
+  }
+
+  // Extract result from command output
+  unsigned flags;
+  if (sscanf(output.c_str(), "throttled=%x", &flags) != 1) {
+    return RPI_STAT_UNEXPECTED_RESPONSE;
+  }
+  value = flags;
+
+  return RPI_STAT_SUCCESS;
+}
@@ -12,6 +12,9 @@
 #ifndef __RPI_STAT_H__
 #define __RPI_STAT_H__
 
+#include <stdint.h>
+#include <string>
+
 using namespace std;
 
 /////////////////////////////////////////////////////////////////////////////
@@ -21,10 +24,26 @@ using namespace std;
 #define RPI_STAT_SUCCESS               0
 #define RPI_STAT_CMD_FAILED           -1
 #define RPI_STAT_UNEXPECTED_RESPONSE  -2
+#define RPI_STAT_OPEN_FAILED          -3
+#define RPI_STAT_UNAVAILABLE          -4 // No source in backend
+
+// Throttled flags, current state
+#define RPI_STAT_THROTTLED_UNDER_VOLTAGE    0x00000001
+#define RPI_STAT_THROTTLED_FREQ_CAPPED      0x00000002
+#define RPI_STAT_THROTTLED_THROTTLED        0x00000004
+#define RPI_STAT_THROTTLED_SOFT_TEMP_LIMIT  0x00000008
+
+// Throttled flags, has occurred since boot
+#define RPI_STAT_THROTTLED_OCCURRED_SHIFT   16
 
 /////////////////////////////////////////////////////////////////////////////
 //               Class support types
 /////////////////////////////////////////////////////////////////////////////
+typedef enum {RPI_STAT_BACKEND_MAILBOX,   // VideoCore mailbox (/dev/vcio)
+	      RPI_STAT_BACKEND_SYSFS,     // Thermal and cpufreq nodes, no fork
+	      RPI_STAT_BACKEND_VCGENCMD}  // Shell command, forks
+  RPI_STAT_BACKEND;
+
 typedef enum {RPI_STAT_VOLT_ID_CORE,
 	      RPI_STAT_VOLT_ID_SDRAM_C,
 	      RPI_STAT_VOLT_ID_SDRAM_I,
@@ -52,7 +71,15 @@ class rpi_stat {
  public:
   rpi_stat(void);
   ~rpi_stat(void);
-  
+
+  // Device and file paths are below root directory,
+  // "/" unless reading from a fake tree.
+  // Uses vcgencmd if not initialized.
+  long initialize(RPI_STAT_BACKEND backend,
+		  const string &root);
+
+  long finalize(void);
+
   long get_temperature(float &value);
 
   long get_voltage(RPI_STAT_VOLT_ID id,
@@ -61,7 +88,36 @@ class rpi_stat {
   long get_frequency(RPI_STAT_FREQ_ID id,
 		     unsigned &value);
 
+  // RPI_STAT_THROTTLED_xxx flags
+  long get_throttled(uint32_t &value);
+
  private:
+  RPI_STAT_BACKEND m_backend;
+  string           m_root;    // No trailing slash
+  int              m_mbox_fd; // Mailbox device
+
+  void init_members(void);
+
+  long mbox_property(uint32_t tag,
+		     uint32_t *values,
+		     unsigned nr_values);
+
+  long read_sysfs(const char *file_name,
+		  int base,
+		  unsigned long &value);
+
+  long vcgencmd(const string &args,
+		string &output);
+
+  long vcgencmd_temperature(float &value);
+
+  long vcgencmd_voltage(RPI_STAT_VOLT_ID id,
+			float &value);
+
+  long vcgencmd_frequency(RPI_STAT_FREQ_ID id,
+			  unsigned &value);
+
+  long vcgencmd_throttled(uint32_t &value);
 };
 
 #endif // __RPI_STAT_H__
@@ -13,6 +13,7 @@
 #include <stddef.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <sys/time.h>
 #include <netdb.h>
 #include <netinet/tcp.h>
@@ -54,10 +55,19 @@
 // recv_socket               recv          EWOULDBLOCK, EINTR, ENOTCONN,
 // shutdown_socket           shutdown      ENOTCONN
 // close_socket              close         EINTR
+// create_unix_socket        socket        -
+// bind_unix_socket          bind          EADDRINUSE
+// connect_unix_socket       connect       ECONNREFUSED, EINTR, EISCONN
+// get_socket_peer_cred      getsockopt    -
+// send_socket_fd            sendmsg       EWOULDBLOCK, EINTR, ENOTCONN, EPIPE
+// recv_socket_fd            recvmsg       EWOULDBLOCK, EINTR, ENOTCONN
 // set_opt_xxx               setsockopt    -
 // get_opt_xxx               getsockopt    -
 // set_attr_xxx              fcntl         -
 // get_attr_xxx              fcntl         -
+// socket_connection::fill   recv          EWOULDBLOCK, EINTR, ENOTCONN
+// socket_connection::flush  send          EWOULDBLOCK, EINTR, ENOTCONN, EPIPE
+//                  (fd)     sendmsg       EWOULDBLOCK, EINTR, ENOTCONN, EPIPE
 
 /////////////////////////////////////////////////////////////////////////////
 //               Private member functions
@@ -780,6 +790,195 @@ long close_socket(int sockd)
 
 ////////////////////////////////////////////////////////////////
 
+long create_unix_socket(int *sockd)
+{
+  int rc;
+
+  // Create local stream socket
+  rc = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (rc == -1) {
+    return SOCKET_SUPPORT_FAILURE;
+  }
+
+  *sockd = rc; // Return socket descriptor
+
+  return SOCKET_SUPPORT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+static long to_unix_address(const char *path,
+			    struct sockaddr_un *addr)
+{
+  bzero((void *)addr, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+
+  if (strlen(path) >= sizeof(addr->sun_path)) {
+    return SOCKET_SUPPORT_FAILURE;
+  }
+  strcpy(addr->sun_path, path);
+
+  return SOCKET_SUPPORT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+long bind_unix_socket(int sockd, const char *path)
+{
+  int rc;
+  struct sockaddr_un local_addr;
+
+  if (to_unix_address(path, &local_addr) != SOCKET_SUPPORT_SUCCESS) {
+    return SOCKET_SUPPORT_FAILURE;
+  }
+
+  // Bind socket to path, fails if path exists
+  rc = bind(sockd, (struct sockaddr *)&local_addr, sizeof(local_addr));
+  if (rc) {
+    int local_errno = errno;
+    return get_error_code(local_errno);
+  }
+
+  return SOCKET_SUPPORT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+long connect_unix_socket(int sockd, const char *path)
+{
+  int rc;
+  struct sockaddr_un peer_addr;
+
+  if (to_unix_address(path, &peer_addr) != SOCKET_SUPPORT_SUCCESS) {
+    return SOCKET_SUPPORT_FAILURE;
+  }
+
+  rc = connect(sockd, (struct sockaddr *)&peer_addr, sizeof(peer_addr));
+  if (rc) {
+    int local_errno = errno;
+    return get_error_code(local_errno);
+  }
+
+  return SOCKET_SUPPORT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+long get_socket_peer_cred(int sockd,
+			  uint32_t *pid,
+			  uint32_t *uid,
+			  uint32_t *gid)
+{
+  int rc;
+  struct ucred cred;
+  socklen_t len = sizeof(cred);
+
+  rc = getsockopt(sockd, SOL_SOCKET, SO_PEERCRED, &cred, &len);
+  if (rc) {
+    return SOCKET_SUPPORT_FAILURE;
+  }
+
+  *pid = (uint32_t)cred.pid;
+  *uid = (uint32_t)cred.uid;
+  *gid = (uint32_t)cred.gid;
+
+  return SOCKET_SUPPORT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+long send_socket_fd(int sockd,
+		    const void *data, unsigned nbytes,
+		    int fd,
+		    unsigned *actual_bytes)
+{
+  int rc;
+  struct msghdr msg;
+  struct iovec iov;
+  union {
+    struct cmsghdr hdr;
+    char           buf[CMSG_SPACE(sizeof(int))];
+  } control;
+
+  *actual_bytes = 0; // No bytes sent yet
+
+  iov.iov_base = (void *)data;
+  iov.iov_len  = nbytes;
+
+  bzero((void *)&msg, sizeof(msg));
+  msg.msg_iov    = &iov;
+  msg.msg_iovlen = 1;
+
+  // Descriptor is passed as ancillary data (SCM_RIGHTS)
+  bzero((void *)&control, sizeof(control));
+  msg.msg_control    = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type  = SCM_RIGHTS;
+  cmsg->cmsg_len   = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+  rc = sendmsg(sockd, &msg, MSG_NOSIGNAL);
+  if (rc == -1) {
+    int local_errno = errno;
+    return get_error_code(local_errno);
+  }
+
+  *actual_bytes = rc;
+
+  return SOCKET_SUPPORT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+long recv_socket_fd(int sockd,
+		    void *data, unsigned nbytes,
+		    int *fd,
+		    unsigned *actual_bytes)
+{
+  int rc;
+  struct msghdr msg;
+  struct iovec iov;
+  union {
+    struct cmsghdr hdr;
+    char           buf[CMSG_SPACE(sizeof(int))];
+  } control;
+
+  *actual_bytes = 0; // No bytes received yet
+  *fd = -1;          // No descriptor received yet
+
+  iov.iov_base = data;
+  iov.iov_len  = nbytes;
+
+  bzero((void *)&msg, sizeof(msg));
+  msg.msg_iov        = &iov;
+  msg.msg_iovlen     = 1;
+  msg.msg_control    = control.buf;
+  msg.msg_controllen = sizeof(control.buf);
+
+  rc = recvmsg(sockd, &msg, MSG_CMSG_CLOEXEC);
+  if (rc == -1) {
+    int local_errno = errno;
+    return get_error_code(local_errno);
+  }
+
+  *actual_bytes = rc;
+
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if ( (cmsg) &&
+       (cmsg->cmsg_level == SOL_SOCKET) &&
+       (cmsg->cmsg_type == SCM_RIGHTS) &&
+       (cmsg->cmsg_len == CMSG_LEN(sizeof(int))) ) {
+    memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+  }
+
+  return SOCKET_SUPPORT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
 long set_opt_recv_buffer_size(int sockd, unsigned nbytes)
 {
   int rc;
@@ -1028,3 +1227,208 @@ long get_attr_blocked(int sockd, bool *on)
 
   return SOCKET_SUPPORT_SUCCESS;
 }
+
+/////////////////////////////////////////////////////////////////////////////
+//               Public member functions (socket_connection)
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+socket_connection::socket_connection(void)
+{
+  init_members();
+}
+
+////////////////////////////////////////////////////////////////
+
+socket_connection::~socket_connection(void)
+{
+}
+
+////////////////////////////////////////////////////////////////
+
+void socket_connection::attach(int sockd,
+			       uint8_t *rx_buf, unsigned rx_size,
+			       uint8_t *tx_buf, unsigned tx_size)
+{
+  init_members();
+
+  m_sockd = sockd;
+  m_rx_buf = rx_buf;
+  m_rx_size = rx_size;
+  m_tx_buf = tx_buf;
+  m_tx_size = tx_size;
+}
+
+////////////////////////////////////////////////////////////////
+
+long socket_connection::close(void)
+{
+  int sockd = m_sockd;
+
+  m_sockd = -1;
+
+  // Peer may already be gone, shutdown is allowed to fail
+  shutdown_socket(sockd, true, true);
+
+  return close_socket(sockd);
+}
+
+////////////////////////////////////////////////////////////////
+
+long socket_connection::fill(unsigned *actual_bytes)
+{
+  long rc;
+
+  *actual_bytes = 0;
+
+  // Move partial message to start of buffer
+  if (m_rx_start) {
+    memmove(m_rx_buf, m_rx_buf + m_rx_start, m_rx_end - m_rx_start);
+    m_rx_end -= m_rx_start;
+    m_rx_start = 0;
+  }
+  if (m_rx_end == m_rx_size) {
+    return SOCKET_SUPPORT_BUFFER_FULL;
+  }
+
+  m_stat.recv_calls++;
+  rc = do_recv_socket(m_sockd,
+		      m_rx_buf + m_rx_end,
+		      m_rx_size - m_rx_end,
+		      NULL,
+		      false, // Receive available
+		      false, // No peek
+		      actual_bytes);
+
+  m_rx_end += *actual_bytes;
+  m_stat.rx_bytes += *actual_bytes;
+
+  return rc;
+}
+
+////////////////////////////////////////////////////////////////
+
+void socket_connection::consume(unsigned nbytes)
+{
+  m_rx_start += nbytes;
+
+  if (m_rx_start == m_rx_end) {
+    m_rx_start = 0;
+    m_rx_end = 0;
+  }
+}
+
+////////////////////////////////////////////////////////////////
+
+long socket_connection::queue(const void *data, unsigned nbytes)
+{
+  // Make room at end of buffer
+  if (m_tx_end + nbytes > m_tx_size) {
+    if (m_tx_end - m_tx_start + nbytes > m_tx_size) {
+      return SOCKET_SUPPORT_BUFFER_FULL;
+    }
+    memmove(m_tx_buf, m_tx_buf + m_tx_start, m_tx_end - m_tx_start);
+    m_tx_end -= m_tx_start;
+    m_tx_start = 0;
+  }
+
+  memcpy(m_tx_buf + m_tx_end, data, nbytes);
+  m_tx_end += nbytes;
+
+  return SOCKET_SUPPORT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+long socket_connection::flush(void)
+{
+  unsigned actual_bytes;
+  long rc;
+
+  if (m_tx_start == m_tx_end) {
+    return SOCKET_SUPPORT_SUCCESS;
+  }
+
+  m_stat.send_calls++;
+  rc = do_send_socket(m_sockd,
+		      m_tx_buf + m_tx_start,
+		      m_tx_end - m_tx_start,
+		      NULL,
+		      false, // Send what is possible
+		      &actual_bytes);
+
+  if (rc == SOCKET_SUPPORT_SUCCESS) {
+    m_tx_start += actual_bytes;
+    m_stat.tx_bytes += actual_bytes;
+
+    if (m_tx_start == m_tx_end) {
+      m_tx_start = 0;
+      m_tx_end = 0;
+    }
+  }
+
+  return rc;
+}
+
+////////////////////////////////////////////////////////////////
+
+long socket_connection::flush(int fd)
+{
+  unsigned actual_bytes;
+  long rc;
+
+  // Descriptor can't be passed without data
+  if (m_tx_start == m_tx_end) {
+    return SOCKET_SUPPORT_FAILURE;
+  }
+
+  m_stat.send_calls++;
+  rc = send_socket_fd(m_sockd,
+		      m_tx_buf + m_tx_start,
+		      m_tx_end - m_tx_start,
+		      fd,
+		      &actual_bytes);
+
+  if (rc == SOCKET_SUPPORT_SUCCESS) {
+    m_tx_start += actual_bytes;
+    m_stat.tx_bytes += actual_bytes;
+
+    if (m_tx_start == m_tx_end) {
+      m_tx_start = 0;
+      m_tx_end = 0;
+    }
+  }
+
+  return rc;
+}
+
+////////////////////////////////////////////////////////////////
+
+void socket_connection::get_stat(socket_connection_stat *stat)
+{
+  *stat = m_stat;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//               Private member functions (socket_connection)
+/////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////
+
+void socket_connection::init_members(void)
+{
+  m_sockd = -1;
+
+  m_rx_buf = NULL;
+  m_rx_size = 0;
+  m_rx_start = 0;
+  m_rx_end = 0;
+
+  m_tx_buf = NULL;
+  m_tx_size = 0;
+  m_tx_start = 0;
+  m_tx_end = 0;
+
+  bzero(&m_stat, sizeof(m_stat));
+}
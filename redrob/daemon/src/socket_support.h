@@ -29,6 +29,7 @@
 #define SOCKET_SUPPORT_ADDR_IN_USE     -6
 #define SOCKET_SUPPORT_BROKEN_PIPE     -7
 #define SOCKET_SUPPORT_FAILURE         -8
+#define SOCKET_SUPPORT_BUFFER_FULL     -9
 
 // Special IP-addresses
 #define ANY_IP_ADDRESS       "ANY_IP_ADDRESS"
@@ -50,6 +51,13 @@ typedef struct {
   int      socktype; // SOCK_DGRAM, SOCK_STREAM, ...
 } resolve_element;
 
+typedef struct {
+  uint32_t recv_calls; // System calls
+  uint32_t send_calls;
+  uint32_t rx_bytes;
+  uint32_t tx_bytes;
+} socket_connection_stat;
+
 /////////////////////////////////////////////////////////////////////////////
 //               Definition of exported functions
 /////////////////////////////////////////////////////////////////////////////
@@ -113,6 +121,28 @@ extern long recv_socket(int sockd,
 extern long shutdown_socket(int sockd, bool recv, bool send);
 extern long close_socket(int sockd);
 
+// Local stream sockets (AF_UNIX), path is a file system name
+extern long create_unix_socket(int *sockd);
+extern long bind_unix_socket(int sockd, const char *path);
+extern long connect_unix_socket(int sockd, const char *path);
+
+// Credentials of connected peer process (AF_UNIX)
+extern long get_socket_peer_cred(int sockd,
+				 uint32_t *pid,
+				 uint32_t *uid,
+				 uint32_t *gid);
+
+// Data with a file descriptor passed to peer (AF_UNIX).
+// Received descriptor is -1 if none was passed.
+extern long send_socket_fd(int sockd,
+			   const void *data, unsigned nbytes,
+			   int fd,
+			   unsigned *actual_bytes);
+extern long recv_socket_fd(int sockd,
+			   void *data, unsigned nbytes,
+			   int *fd,
+			   unsigned *actual_bytes);
+
 extern long set_opt_recv_buffer_size(int sockd, unsigned nbytes);
 extern long get_opt_recv_buffer_size(int sockd, unsigned *nbytes);
 
@@ -134,4 +164,73 @@ extern long get_opt_recv_timeout(int sockd, double *timeout_sec);
 extern long set_attr_blocked(int sockd, bool on);
 extern long get_attr_blocked(int sockd, bool *on);
 
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of classes
+/////////////////////////////////////////////////////////////////////////////
+
+// Buffered connected socket (non-blocking TCP).
+// Reads fill the receive buffer with one recv, the caller parses
+// and consumes complete messages from it. Writes are queued in the
+// send buffer and sent with one send when flushed.
+// Buffers are owned by the caller.
+class socket_connection {
+
+ public:
+  socket_connection(void);
+  ~socket_connection(void);
+
+  void attach(int sockd,
+	      uint8_t *rx_buf, unsigned rx_size,
+	      uint8_t *tx_buf, unsigned tx_size);
+
+  // Shutdown and close socket, queued data is discarded
+  long close(void);
+
+  bool is_attached(void) {return (m_sockd >= 0);}
+  int get_sockd(void) {return m_sockd;}
+
+  // One recv into free part of receive buffer,
+  // zero actual bytes means closed by peer
+  long fill(unsigned *actual_bytes);
+
+  const uint8_t *get_rx_data(void) {return m_rx_buf + m_rx_start;}
+  unsigned get_rx_len(void) {return m_rx_end - m_rx_start;}
+  void consume(unsigned nbytes);
+
+  // Queue data to send, no system call
+  long queue(const void *data, unsigned nbytes);
+
+  // One send of queued data, rest is kept if not all was sent
+  long flush(void);
+
+  // Same as flush, descriptor is passed to peer (AF_UNIX) with
+  // first byte sent. Fails if no data is queued.
+  long flush(int fd);
+
+  unsigned get_tx_len(void) {return m_tx_end - m_tx_start;}
+
+  void get_stat(socket_connection_stat *stat);
+
+ private:
+  int m_sockd; // Negative if not attached
+
+  uint8_t *m_rx_buf;
+  unsigned m_rx_size;
+  unsigned m_rx_start; // First byte not consumed
+  unsigned m_rx_end;
+
+  uint8_t *m_tx_buf;
+  unsigned m_tx_size;
+  unsigned m_tx_start; // First byte not sent
+  unsigned m_tx_end;
+
+  socket_connection_stat m_stat;
+
+  void init_members(void);
+
+  // Not copyable
+  socket_connection(const socket_connection &);
+  socket_connection &operator=(const socket_connection &);
+};
+
 #endif // __SOCKET_SUPPORT_H__
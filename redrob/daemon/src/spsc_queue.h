@@ -0,0 +1,135 @@
+// ************************************************************************
+// *                                                                      *
+// * Copyright (C) 2014 Bonden i Nol (hakanbrolin@hotmail.com)            *
+// *                                                                      *
+// * This program is free software; you can redistribute it and/or modify *
+// * it under the terms of the GNU General Public License as published by *
+// * the Free Software Foundation; either version 2 of the License, or    *
+// * (at your option) any later version.                                  *
+// *                                                                      *
+// ************************************************************************
+
+#ifndef __SPSC_QUEUE_H__
+#define __SPSC_QUEUE_H__
+
+#include <stdint.h>
+
+using namespace std;
+
+// Implementation notes:
+// 1. Bounded lock-free FIFO queue of a POD type.
+//    One producer thread and one consumer thread.
+//
+// 2. Head is only written by producer and tail only by consumer.
+//    Both are free running counters, the slot is found using the
+//    lower bits, which requires that N is a power of two.
+//
+// 3. A push to a full queue is rejected and counted as a drop.
+//    The producer also keeps track of the maximum queue depth.
+//
+
+/////////////////////////////////////////////////////////////////////////////
+//               Definition of classes
+/////////////////////////////////////////////////////////////////////////////
+
+template <typename T, unsigned N>
+class spsc_queue {
+
+ public:
+
+  ////////////////////////////////////////////////////////////////
+
+  spsc_queue(void)
+  {
+    // Compile time check, N must be a power of two
+    typedef char n_is_power_of_two[((N != 0) && !(N & (N - 1))) ? 1 : -1];
+    (void)sizeof(n_is_power_of_two);
+
+    m_head      = 0;
+    m_tail      = 0;
+    m_drops     = 0;
+    m_max_depth = 0;
+  }
+
+  ////////////////////////////////////////////////////////////////
+
+  // Note! Only producer is allowed to push.
+  // Returns false if queue is full (value dropped).
+  bool push(const T &value)
+  {
+    uint32_t head = m_head;
+    uint32_t tail = __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE);
+
+    if ((head - tail) >= N) {
+      __atomic_store_n(&m_drops, m_drops + 1, __ATOMIC_RELAXED);
+      return false;
+    }
+
+    m_slot[head & (N - 1)] = value;
+
+    // Publish slot
+    __atomic_store_n(&m_head, head + 1, __ATOMIC_RELEASE);
+
+    uint32_t depth = head + 1 - tail;
+    if (depth > m_max_depth) {
+      __atomic_store_n(&m_max_depth, depth, __ATOMIC_RELAXED);
+    }
+
+    return true;
+  }
+
+  ////////////////////////////////////////////////////////////////
+
+  // Note! Only consumer is allowed to pop.
+  // Returns false if queue is empty.
+  bool pop(T &value)
+  {
+    uint32_t tail = m_tail;
+    uint32_t head = __atomic_load_n(&m_head, __ATOMIC_ACQUIRE);
+
+    if (head == tail) {
+      return false;
+    }
+
+    value = m_slot[tail & (N - 1)];
+
+    // Release slot
+    __atomic_store_n(&m_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return true;
+  }
+
+  ////////////////////////////////////////////////////////////////
+
+  // Number of values in queue, may be outdated when returned
+  unsigned get_depth(void) const
+  {
+    uint32_t tail = __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE);
+    uint32_t head = __atomic_load_n(&m_head, __ATOMIC_ACQUIRE);
+
+    return (unsigned)(head - tail);
+  }
+
+  ////////////////////////////////////////////////////////////////
+
+  unsigned get_size(void) const {return N;}
+
+  uint32_t get_drops(void) const
+  {
+    return __atomic_load_n(&m_drops, __ATOMIC_RELAXED);
+  }
+
+  uint32_t get_max_depth(void) const
+  {
+    return __atomic_load_n(&m_max_depth, __ATOMIC_RELAXED);
+  }
+
+ private:
+  T        m_slot[N];
+  uint32_t m_head;      // Next slot to write, only written by producer
+  uint32_t m_tail;      // Next slot to read, only written by consumer
+  uint32_t m_drops;     // Rejected pushes, only written by producer
+  uint32_t m_max_depth; // Only written by producer
+};
+
+#endif // __SPSC_QUEUE_H__
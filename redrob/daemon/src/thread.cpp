@@ -14,6 +14,7 @@
 #include <sys/syscall.h>
 #include <sched.h>
 #include <errno.h>
+#include <limits.h>
 
 #include "thread.h"
 #include "delay.h"
@@ -43,6 +44,12 @@ thread::thread(string thread_name)
   pthread_mutex_init(&m_mutex_thread_done,
 		     NULL); // Use default mutex attributes
 
+  // Default scheduling and stack
+  m_sched_policy   = SCHED_OTHER;
+  m_sched_priority = 0;
+  m_sched_cpu      = THREAD_ANY_CPU;
+  m_stack_size     = 0;
+
   init_members(); 
 }
 
@@ -58,9 +65,63 @@ thread::~thread(void)
 
 ////////////////////////////////////////////////////////////////
 
+long thread::set_sched_param(int policy,
+			     int priority,
+			     int cpu)
+{
+  // Check if already started
+  if (m_state != THREAD_STATE_NOT_STARTED) {
+    return THREAD_WRONG_STATE;
+  }
+
+  // Check arguments
+  if ( (policy != SCHED_OTHER) &&
+       (policy != SCHED_FIFO)  &&
+       (policy != SCHED_RR) ) {
+    return THREAD_SCHED_ERROR;
+  }
+  if ( (policy != SCHED_OTHER) &&
+       ( (priority < sched_get_priority_min(policy)) ||
+	 (priority > sched_get_priority_max(policy)) ) ) {
+    return THREAD_SCHED_ERROR;
+  }
+  if ( (cpu != THREAD_ANY_CPU) &&
+       ( (cpu < 0) || (cpu >= CPU_SETSIZE) ) ) {
+    return THREAD_SCHED_ERROR;
+  }
+
+  m_sched_policy   = policy;
+  m_sched_priority = (policy == SCHED_OTHER ? 0 : priority);
+  m_sched_cpu      = cpu;
+
+  return THREAD_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
+long thread::set_stack_size(size_t size_in_bytes)
+{
+  // Check if already started
+  if (m_state != THREAD_STATE_NOT_STARTED) {
+    return THREAD_WRONG_STATE;
+  }
+
+  // Check arguments
+  if ( size_in_bytes && (size_in_bytes < (size_t)PTHREAD_STACK_MIN) ) {
+    return THREAD_SCHED_ERROR;
+  }
+
+  m_stack_size = size_in_bytes;
+
+  return THREAD_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
 long thread::start(void *p_arg)
 {
   int rc;
+  pthread_attr_t attr;
 
   // Check if already started
   if (m_state != THREAD_STATE_NOT_STARTED) {
@@ -84,8 +145,18 @@ long thread::start(void *p_arg)
 
   init_members();
 
+  // Prepare scheduling attributes
+  if ( pthread_attr_init(&attr) ) {
+    return THREAD_PTHREAD_ERROR;
+  }
+  if ( setup_attr(&attr) != THREAD_SUCCESS ) {
+    pthread_attr_destroy(&attr);
+    return THREAD_SCHED_ERROR;
+  }
+
   // Create thread
-  rc = pthread_create(&m_thread, NULL, thread::entry_point, this);
+  rc = pthread_create(&m_thread, &attr, thread::entry_point, this);
+  pthread_attr_destroy(&attr);
   if ( rc ) {
     return THREAD_PTHREAD_ERROR;
   }
@@ -353,6 +424,58 @@ bool thread::is_stopped(void)
 
 ////////////////////////////////////////////////////////////////
 
+long thread::setup_attr(pthread_attr_t *attr)
+{
+  struct sched_param param;
+  cpu_set_t cpu_set;
+  long nr_cpus;
+
+  // Scheduling is always set explicitly, otherwise
+  // it would be inherited from the creating thread
+  param.sched_priority = m_sched_priority;
+
+  if ( pthread_attr_setinheritsched(attr, PTHREAD_EXPLICIT_SCHED) ) {
+    return THREAD_SCHED_ERROR;
+  }
+  if ( pthread_attr_setschedpolicy(attr, m_sched_policy) ) {
+    return THREAD_SCHED_ERROR;
+  }
+  if ( pthread_attr_setschedparam(attr, &param) ) {
+    return THREAD_SCHED_ERROR;
+  }
+
+  // CPU affinity is also inherited, allow all CPUs unless
+  // a specific CPU is present and selected
+  nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (nr_cpus < 1) {
+    nr_cpus = 1;
+  }
+  CPU_ZERO(&cpu_set);
+  if ( (m_sched_cpu != THREAD_ANY_CPU) &&
+       (m_sched_cpu < nr_cpus) ) {
+    CPU_SET(m_sched_cpu, &cpu_set);
+  }
+  else {
+    for (long i=0; (i < nr_cpus) && (i < CPU_SETSIZE); i++) {
+      CPU_SET(i, &cpu_set);
+    }
+  }
+  if ( pthread_attr_setaffinity_np(attr, sizeof(cpu_set), &cpu_set) ) {
+    return THREAD_SCHED_ERROR;
+  }
+
+  // Stack size
+  if (m_stack_size) {
+    if ( pthread_attr_setstacksize(attr, m_stack_size) ) {
+      return THREAD_SCHED_ERROR;
+    }
+  }
+
+  return THREAD_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////
+
 void thread::init_members(void)
 {
   m_state   = THREAD_STATE_NOT_STARTED;
@@ -13,6 +13,7 @@
 #define __THREAD_H__
 
 #include <string>
+#include <pthread.h>
 #include <semaphore.h>
 
 using namespace std;
@@ -29,6 +30,11 @@ using namespace std;
 #define THREAD_MUTEX_ERROR      -4
 #define THREAD_TIME_ERROR       -5
 #define THREAD_INTERNAL_ERROR   -6 // Used by derived class
+#define THREAD_SCHED_ERROR      -7
+#define THREAD_EVENT_ERROR      -8
+
+// Scheduling
+#define THREAD_ANY_CPU  -1
 
 /////////////////////////////////////////////////////////////////////////////
 //               Class support types
@@ -57,6 +63,23 @@ class thread {
   thread(string thread_name);
   virtual ~thread(void);
 
+  // Scheduling attributes used when thread is created (start).
+  // Policy is SCHED_OTHER, SCHED_FIFO or SCHED_RR.
+  // Priority is ignored for SCHED_OTHER.
+  long set_sched_param(int policy,
+		       int priority,
+		       int cpu); // THREAD_ANY_CPU or CPU number
+
+  int get_sched_policy(void) {return m_sched_policy;}
+  int get_sched_priority(void) {return m_sched_priority;}
+  int get_sched_cpu(void) {return m_sched_cpu;}
+
+  // Stack size used when thread is created (start).
+  // Zero means system default.
+  long set_stack_size(size_t size_in_bytes);
+
+  size_t get_stack_size(void) {return m_stack_size;}
+
   long start(void *p_arg);  // Create and start thread
   long release(void);       // Release thread (execute)
   long stop(void);          // Order thread to stop executing
@@ -112,6 +135,15 @@ class thread {
 
   sem_t m_sem_release; // Released when thread shall execute
 
+  // Scheduling attributes
+  int m_sched_policy;
+  int m_sched_priority;
+  int m_sched_cpu;
+
+  size_t m_stack_size;
+
+  long setup_attr(pthread_attr_t *attr);
+
   void init_members(void);
 };
 